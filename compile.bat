@@ -1,4 +1,21 @@
 %VULKAN_SDK%/Bin/glslc.exe shader/src/shader.vert -o shader/bin/vert.spv
 %VULKAN_SDK%/Bin/glslc.exe shader/src/shader.frag -o shader/bin/frag.spv
+%VULKAN_SDK%/Bin/glslc.exe shader/src/instanced.vert -o shader/bin/instanced_vert.spv
+%VULKAN_SDK%/Bin/glslc.exe shader/src/particle_init.comp -o shader/bin/particle_init.spv
+%VULKAN_SDK%/Bin/glslc.exe shader/src/particle_begin.comp -o shader/bin/particle_begin.spv
+%VULKAN_SDK%/Bin/glslc.exe shader/src/particle_emit.comp -o shader/bin/particle_emit.spv
+%VULKAN_SDK%/Bin/glslc.exe shader/src/particle_simulate.comp -o shader/bin/particle_simulate.spv
+%VULKAN_SDK%/Bin/glslc.exe shader/src/particle_finish.comp -o shader/bin/particle_finish.spv
+%VULKAN_SDK%/Bin/glslc.exe shader/src/particle.vert -o shader/bin/particle_vert.spv
+%VULKAN_SDK%/Bin/glslc.exe shader/src/particle.frag -o shader/bin/particle_frag.spv
+%VULKAN_SDK%/Bin/glslc.exe shader/src/light_cull.comp -o shader/bin/light_cull.spv
+%VULKAN_SDK%/Bin/glslc.exe shader/src/lit.vert -o shader/bin/lit_vert.spv
+%VULKAN_SDK%/Bin/glslc.exe shader/src/lit.frag -o shader/bin/lit_frag.spv
+%VULKAN_SDK%/Bin/glslc.exe shader/src/occluder.vert -o shader/bin/occluder_vert.spv
+%VULKAN_SDK%/Bin/glslc.exe shader/src/hiz_reduce.comp -o shader/bin/hiz_reduce.spv
+%VULKAN_SDK%/Bin/glslc.exe shader/src/occlusion_cull.comp -o shader/bin/occlusion_cull.spv
+%VULKAN_SDK%/Bin/glslc.exe shader/src/lod.vert -o shader/bin/lod_vert.spv
+%VULKAN_SDK%/Bin/glslc.exe shader/src/hud.vert -o shader/bin/hud_vert.spv
+%VULKAN_SDK%/Bin/glslc.exe shader/src/hud.frag -o shader/bin/hud_frag.spv
 
 pause
\ No newline at end of file
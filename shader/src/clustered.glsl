@@ -0,0 +1,70 @@
+// Clustered forward shading. Include from a fragment shader whose pipeline layout puts
+// ClusteredLighting::getSetLayout() at set 0. Positions and normals are in view space.
+
+// Specialized to false for scenes without spot lights, which compiles the cone test out. Matches
+// ke::ClusteredSpotLights, so constant_id 0 is taken in shaders that include this file.
+layout(constant_id = 0) const bool CLUSTERED_SPOT_LIGHTS = true;
+
+struct Light
+{
+	vec4 positionRadius;
+	vec4 colorType;
+	vec4 directionOuter;
+	vec4 params;
+};
+
+layout(std140, set = 0, binding = 0) uniform ClusterParams
+{
+	mat4 inverseProjection;
+	vec4 screenNearFar;
+	vec4 sliceTile;
+	uvec4 grid;
+	uvec4 limits;
+} cluster;
+
+layout(std430, set = 0, binding = 1) readonly buffer Lights
+{
+	Light lights[];
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer LightGrid
+{
+	uvec2 lightGrid[];
+};
+
+layout(std430, set = 0, binding = 3) readonly buffer LightIndices
+{
+	uint lightIndices[];
+};
+
+uint findCluster(vec2 fragCoord, float viewDepth)
+{
+	uint slice = uint(max(log(viewDepth) * cluster.sliceTile.x + cluster.sliceTile.y, 0.0));
+	uvec2 tile = min(uvec2(fragCoord / cluster.sliceTile.zw), cluster.grid.xy - 1u);
+	slice = min(slice, cluster.grid.z - 1u);
+	return tile.x + tile.y * cluster.grid.x + slice * cluster.grid.x * cluster.grid.y;
+}
+
+vec3 shadeClustered(vec3 viewPosition, vec3 viewNormal, vec3 albedo)
+{
+	uvec2 range = lightGrid[findCluster(gl_FragCoord.xy, -viewPosition.z)];
+
+	vec3 result = vec3(0.0);
+	for (uint i = 0u; i < range.y; i++)
+	{
+		Light light = lights[lightIndices[range.x + i]];
+		vec3 toLight = light.positionRadius.xyz - viewPosition;
+		float lightDistance = length(toLight);
+		if (lightDistance >= light.positionRadius.w)
+			continue;
+
+		vec3 direction = toLight / lightDistance;
+		float attenuation = 1.0 - lightDistance / light.positionRadius.w;
+		attenuation *= attenuation;
+		if (CLUSTERED_SPOT_LIGHTS && light.colorType.w > 0.5)
+			attenuation *= smoothstep(light.directionOuter.w, light.params.x, dot(-direction, light.directionOuter.xyz));
+
+		result += albedo * light.colorType.rgb * max(dot(viewNormal, direction), 0.0) * attenuation;
+	}
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform sampler2D atlas;
+
+layout(location = 0) in vec2 inUv;
+layout(location = 1) in vec4 inColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+	// Signed distance with the glyph edge at 0.5. Solid quads sample a cell that is 1.0 everywhere.
+	float distance = texture(atlas, inUv).r;
+	float width = max(fwidth(distance) * 0.7, 1e-4);
+	float coverage = smoothstep(0.5 - width, 0.5 + width, distance);
+	outColor = vec4(inColor.rgb, inColor.a * coverage);
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#version 450
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inUv;
+layout(location = 2) in vec4 inColor;
+
+// Maps swapchain pixels to clip space, so the overlay keeps its size under dynamic resolution.
+layout(push_constant) uniform Screen
+{
+	vec2 scale;
+} screen;
+
+layout(location = 0) out vec2 outUv;
+layout(location = 1) out vec4 outColor;
+
+void main()
+{
+	outUv = inUv;
+	outColor = inColor;
+	gl_Position = vec4(inPosition * screen.scale - 1.0, 0.0, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#version 450
+
+layout(location = 0) in vec4 inRow0;
+layout(location = 1) in vec4 inRow1;
+layout(location = 2) in vec4 inRow2;
+
+vec2 vertices[3] = vec2[](
+	vec2(0.0, -0.5),
+	vec2(-0.5, 0.5),
+	vec2(0.5, 0.5)
+);
+
+void main()
+{
+	vec4 local = vec4(vertices[gl_VertexIndex], 0.0, 1.0);
+	vec3 world = vec3(dot(inRow0, local), dot(inRow1, local), dot(inRow2, local));
+	gl_Position = vec4(world, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "clustered.glsl"
+
+layout(location = 0) in vec3 inViewPosition;
+layout(location = 1) in vec3 inViewNormal;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+	vec3 albedo = vec3(0.8);
+	vec3 color = albedo * 0.02 + shadeClustered(inViewPosition, normalize(inViewNormal), albedo);
+	outColor = vec4(color, 1.0);
+}
\ No newline at end of file
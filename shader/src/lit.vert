@@ -0,0 +1,31 @@
+#version 450
+
+layout(push_constant) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+} camera;
+
+layout(location = 0) out vec3 outViewPosition;
+layout(location = 1) out vec3 outViewNormal;
+
+// Ground plane on y = 0.
+vec2 corners[6] = vec2[](
+	vec2(-1.0, -1.0),
+	vec2(1.0, -1.0),
+	vec2(1.0, 1.0),
+	vec2(-1.0, -1.0),
+	vec2(1.0, 1.0),
+	vec2(-1.0, 1.0)
+);
+
+const float PLANE_EXTENT = 50.0;
+
+void main()
+{
+	vec2 corner = corners[gl_VertexIndex] * PLANE_EXTENT;
+	vec4 view = camera.view * vec4(corner.x, 0.0, corner.y, 1.0);
+	outViewPosition = view.xyz;
+	outViewNormal = mat3(camera.view) * vec3(0.0, 1.0, 0.0);
+	gl_Position = camera.projection * view;
+}
\ No newline at end of file
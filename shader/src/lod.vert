@@ -0,0 +1,18 @@
+#version 450
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec4 inRow0;
+layout(location = 2) in vec4 inRow1;
+layout(location = 3) in vec4 inRow2;
+
+layout(push_constant) uniform Camera
+{
+	mat4 viewProjection;
+} camera;
+
+void main()
+{
+	vec4 local = vec4(inPosition, 1.0);
+	vec3 world = vec3(dot(inRow0, local), dot(inRow1, local), dot(inRow2, local));
+	gl_Position = camera.viewProjection * vec4(world, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#version 450
+
+// One axis-aligned box per instance, expanded from its corners.
+layout(location = 0) in vec4 inMin;
+layout(location = 1) in vec4 inMax;
+
+layout(push_constant) uniform Camera
+{
+	mat4 viewProjection;
+} camera;
+
+// Corner bits are x, y and z; two triangles per face.
+const int indices[36] = int[](
+	0, 1, 3, 0, 3, 2,
+	4, 6, 7, 4, 7, 5,
+	0, 4, 5, 0, 5, 1,
+	2, 3, 7, 2, 7, 6,
+	0, 2, 6, 0, 6, 4,
+	1, 5, 7, 1, 7, 3
+);
+
+void main()
+{
+	int corner = indices[gl_VertexIndex];
+	vec3 weight = vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+	gl_Position = camera.viewProjection * vec4(mix(inMin.xyz, inMax.xyz, weight), 1.0);
+}
\ No newline at end of file
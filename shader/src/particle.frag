@@ -0,0 +1,16 @@
+#version 450
+
+layout(location = 0) in vec2 inCorner;
+layout(location = 1) in float inLife;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+	float falloff = 1.0 - dot(inCorner, inCorner);
+	if (falloff <= 0.0)
+		discard;
+
+	float life = clamp(inLife, 0.0, 1.0);
+	outColor = vec4(mix(vec3(1.0, 0.2, 0.05), vec3(1.0, 0.8, 0.3), life), falloff * life);
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#version 450
+
+struct Particle
+{
+	vec4 positionLife;
+	vec4 velocitySize;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Particles
+{
+	Particle particles[];
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer AliveLists
+{
+	uint alive[];
+};
+
+layout(location = 0) out vec2 outCorner;
+layout(location = 1) out float outLife;
+
+vec2 corners[6] = vec2[](
+	vec2(-1.0, -1.0),
+	vec2(1.0, -1.0),
+	vec2(1.0, 1.0),
+	vec2(-1.0, -1.0),
+	vec2(1.0, 1.0),
+	vec2(-1.0, 1.0)
+);
+
+void main()
+{
+	Particle particle = particles[alive[gl_VertexIndex / 6]];
+	vec2 corner = corners[gl_VertexIndex % 6];
+	outCorner = corner;
+	outLife = particle.positionLife.w;
+	gl_Position = vec4(particle.positionLife.xy + corner * particle.velocitySize.w, particle.positionLife.z, 1.0);
+}
\ No newline at end of file
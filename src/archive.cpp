@@ -0,0 +1,447 @@
+#include "archive.hpp"
+#include "compression.hpp"
+#include "profiler.hpp"
+#include "util.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+// "KEPK" read as a little-endian integer.
+static constexpr uint32_t gArchiveMagic = 0x4B50454B;
+static constexpr uint32_t gArchiveVersion = 1;
+static constexpr uint64_t gPageSize = 4096;
+static constexpr uint32_t gEntryCompressed = 1;
+
+struct ArchiveHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t reserved;
+	uint64_t tocOffset;
+	uint64_t namesOffset;
+	uint64_t namesSize;
+};
+
+namespace ke
+{
+	// Table of contents entry, read in place from the mapping.
+	struct ArchiveEntry
+	{
+		uint64_t hash;
+		uint64_t offset;
+		uint64_t storedSize;
+		uint64_t size;
+		uint32_t nameOffset;
+		uint32_t nameLength;
+		uint32_t flags;
+		uint32_t reserved;
+	};
+}
+
+// FNV-1a.
+static uint64_t hashPath(const std::string& path)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : path)
+	{
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static bool inRange(uint64_t offset, uint64_t size, uint64_t total)
+{
+	return offset <= total && size <= total - offset;
+}
+
+ke::MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool ke::MappedFile::open(const std::string& path)
+{
+	close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!view)
+	{
+		if (mapping)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	mFile = file;
+	mMapping = mapping;
+	mData = static_cast<const uint8_t*>(view);
+	mSize = static_cast<size_t>(size.QuadPart);
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat info{};
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		::close(fd);
+		return false;
+	}
+	void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps the file referenced on its own.
+	::close(fd);
+	if (view == MAP_FAILED)
+		return false;
+	mData = static_cast<const uint8_t*>(view);
+	mSize = static_cast<size_t>(info.st_size);
+#endif
+	return true;
+}
+
+void ke::MappedFile::close()
+{
+	if (!mData)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(mData);
+	CloseHandle(static_cast<HANDLE>(mMapping));
+	CloseHandle(static_cast<HANDLE>(mFile));
+#else
+	munmap(const_cast<uint8_t*>(mData), mSize);
+#endif
+	mData = nullptr;
+	mSize = 0;
+	mFile = nullptr;
+	mMapping = nullptr;
+}
+
+const uint8_t* ke::MappedFile::getData() const
+{
+	return mData;
+}
+
+size_t ke::MappedFile::getSize() const
+{
+	return mSize;
+}
+
+bool ke::AssetArchive::open(const std::string& path)
+{
+	KE_PROFILE_FUNCTION();
+	close();
+	if (!mFile.open(path))
+	{
+		mLogger.error("Failed to map archive {}.", path);
+		return false;
+	}
+
+	// Everything is validated once here, so lookups can trust the table of contents.
+	const uint8_t* data = mFile.getData();
+	uint64_t size = mFile.getSize();
+	ArchiveHeader header{};
+	if (size >= sizeof(header))
+		std::memcpy(&header, data, sizeof(header));
+
+	bool valid = header.magic == gArchiveMagic && header.version == gArchiveVersion
+		&& header.tocOffset % alignof(ArchiveEntry) == 0
+		&& inRange(header.tocOffset, static_cast<uint64_t>(header.entryCount) * sizeof(ArchiveEntry), size)
+		&& inRange(header.namesOffset, header.namesSize, size);
+	const ArchiveEntry* entries = valid ? reinterpret_cast<const ArchiveEntry*>(data + header.tocOffset) : nullptr;
+	for (uint32_t i = 0; valid && i < header.entryCount; i++)
+	{
+		const ArchiveEntry& entry = entries[i];
+		valid = inRange(entry.offset, entry.storedSize, size) && inRange(entry.nameOffset, entry.nameLength, header.namesSize)
+			&& ((entry.flags & gEntryCompressed) || entry.storedSize == entry.size)
+			&& (i == 0 || entries[i - 1].hash <= entry.hash);
+	}
+	if (!valid)
+	{
+		mLogger.error("{} is not a valid version {} archive.", path, gArchiveVersion);
+		mFile.close();
+		return false;
+	}
+
+	mPath = path;
+	mEntries = entries;
+	mEntryCount = header.entryCount;
+	mNames = reinterpret_cast<const char*>(data + header.namesOffset);
+	mNamesSize = static_cast<size_t>(header.namesSize);
+	if (enableLogging)
+		mLogger.info("Mapped archive {} with {} entries ({} KiB).", path, mEntryCount, size / 1024);
+	return true;
+}
+
+void ke::AssetArchive::close()
+{
+	mFile.close();
+	mEntries = nullptr;
+	mEntryCount = 0;
+	mNames = nullptr;
+	mNamesSize = 0;
+}
+
+const ke::ArchiveEntry* ke::AssetArchive::find(const std::string& path) const
+{
+	std::string name = normalizeAssetPath(path);
+	uint64_t hash = hashPath(name);
+	const ArchiveEntry* end = mEntries + mEntryCount;
+	const ArchiveEntry* it = std::lower_bound(mEntries, end, hash, [](const ArchiveEntry& entry, uint64_t value) { return entry.hash < value; });
+	for (; it != end && it->hash == hash; it++)
+		if (it->nameLength == name.size() && std::memcmp(mNames + it->nameOffset, name.data(), name.size()) == 0)
+			return it;
+	return nullptr;
+}
+
+bool ke::AssetArchive::contains(const std::string& path) const
+{
+	return find(path) != nullptr;
+}
+
+ke::AssetView ke::AssetArchive::view(const std::string& path) const
+{
+	const ArchiveEntry* entry = find(path);
+	if (!entry || (entry->flags & gEntryCompressed))
+		return {};
+	return { mFile.getData() + entry->offset, static_cast<size_t>(entry->size) };
+}
+
+bool ke::AssetArchive::read(const std::string& path, std::vector<char>& out) const
+{
+	const ArchiveEntry* entry = find(path);
+	if (!entry)
+		return false;
+
+	const uint8_t* stored = mFile.getData() + entry->offset;
+	out.resize(static_cast<size_t>(entry->size));
+	if (!(entry->flags & gEntryCompressed))
+	{
+		if (!out.empty())
+			std::memcpy(out.data(), stored, out.size());
+		return true;
+	}
+
+	if (!lz4::decompress(stored, static_cast<size_t>(entry->storedSize), reinterpret_cast<uint8_t*>(out.data()), out.size()))
+	{
+		mLogger.error("Entry {} in {} is corrupt.", path, mPath);
+		out.clear();
+		return false;
+	}
+	return true;
+}
+
+uint32_t ke::AssetArchive::getEntryCount() const
+{
+	return mEntryCount;
+}
+
+const std::string& ke::AssetArchive::getPath() const
+{
+	return mPath;
+}
+
+bool ke::AssetArchive::pack(const std::string& archivePath, const std::vector<std::string>& inputs, bool compress)
+{
+	static ke::Logger logger("Archive Packer Logger", spdlog::level::debug);
+	namespace fs = std::filesystem;
+
+	std::vector<std::string> files;
+	for (const auto& input : inputs)
+	{
+		std::error_code error;
+		if (fs::is_directory(input, error))
+		{
+			for (const auto& item : fs::recursive_directory_iterator(input, error))
+				if (item.is_regular_file())
+					files.push_back(normalizeAssetPath(item.path().generic_string()));
+		}
+		else if (fs::is_regular_file(input, error))
+			files.push_back(normalizeAssetPath(input));
+		else
+		{
+			logger.error("Pack input {} does not exist.", input);
+			return false;
+		}
+	}
+	std::sort(files.begin(), files.end());
+	files.erase(std::unique(files.begin(), files.end()), files.end());
+
+	std::ofstream out(archivePath, std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+	{
+		logger.error("Failed to open {} for writing.", archivePath);
+		return false;
+	}
+
+	uint64_t offset = sizeof(ArchiveHeader);
+	auto padTo = [&](uint64_t alignment)
+		{
+			static const char zeros[gPageSize] = {};
+			uint64_t padding = (alignment - offset % alignment) % alignment;
+			out.write(zeros, static_cast<std::streamsize>(padding));
+			offset += padding;
+		};
+
+	ArchiveHeader header{};
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	std::vector<ArchiveEntry> entries;
+	std::string names;
+	uint64_t rawBytes = 0, compressedCount = 0;
+	for (const auto& file : files)
+	{
+		std::vector<char> data = util::readFile(file);
+		ArchiveEntry entry{};
+		entry.hash = hashPath(file);
+		entry.size = data.size();
+		entry.nameOffset = static_cast<uint32_t>(names.size());
+		entry.nameLength = static_cast<uint32_t>(file.size());
+		names += file;
+		rawBytes += data.size();
+
+		std::vector<uint8_t> packed;
+		if (compress && !data.empty())
+			packed = lz4::compress(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+		if (!packed.empty() && packed.size() < data.size() - data.size() / 8)
+		{
+			entry.flags = gEntryCompressed;
+			entry.offset = offset;
+			entry.storedSize = packed.size();
+			out.write(reinterpret_cast<const char*>(packed.data()), static_cast<std::streamsize>(packed.size()));
+			compressedCount++;
+		}
+		else
+		{
+			padTo(gPageSize);
+			entry.offset = offset;
+			entry.storedSize = data.size();
+			out.write(data.data(), static_cast<std::streamsize>(data.size()));
+		}
+		offset += entry.storedSize;
+		entries.push_back(entry);
+	}
+
+	std::stable_sort(entries.begin(), entries.end(), [](const ArchiveEntry& a, const ArchiveEntry& b) { return a.hash < b.hash; });
+	padTo(alignof(ArchiveEntry));
+	header.magic = gArchiveMagic;
+	header.version = gArchiveVersion;
+	header.entryCount = static_cast<uint32_t>(entries.size());
+	header.tocOffset = offset;
+	out.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(ArchiveEntry)));
+	offset += entries.size() * sizeof(ArchiveEntry);
+	header.namesOffset = offset;
+	header.namesSize = names.size();
+	out.write(names.data(), static_cast<std::streamsize>(names.size()));
+	offset += names.size();
+
+	out.seekp(0);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	if (!out.good())
+	{
+		logger.error("Failed to write archive {}.", archivePath);
+		return false;
+	}
+
+	logger.info("Packed {} files ({} compressed) into {}: {} KiB of assets in {} KiB.", entries.size(), compressedCount, archivePath,
+		rawBytes / 1024, offset / 1024);
+	return true;
+}
+
+ke::AssetLoader& ke::AssetLoader::getInstance()
+{
+	static AssetLoader instance;
+	return instance;
+}
+
+bool ke::AssetLoader::mount(const std::string& archivePath)
+{
+	auto archive = std::make_unique<AssetArchive>();
+	if (!archive->open(archivePath))
+		return false;
+	std::unique_lock<std::shared_mutex> lock(mMutex);
+	mArchives.push_back(std::move(archive));
+	return true;
+}
+
+void ke::AssetLoader::unmountAll()
+{
+	std::unique_lock<std::shared_mutex> lock(mMutex);
+	mArchives.clear();
+}
+
+std::vector<char> ke::AssetLoader::load(const std::string& path) const
+{
+	KE_PROFILE_FUNCTION();
+	{
+		std::shared_lock<std::shared_mutex> lock(mMutex);
+		std::vector<char> data;
+		for (auto it = mArchives.rbegin(); it != mArchives.rend(); it++)
+			if ((*it)->read(path, data))
+				return data;
+	}
+	return util::readFile(path);
+}
+
+ke::AssetView ke::AssetLoader::view(const std::string& path) const
+{
+	std::shared_lock<std::shared_mutex> lock(mMutex);
+	// The newest archive holding the path decides. A compressed entry has no view, and older archives must not
+	// answer for it, so the caller falls back to load.
+	for (auto it = mArchives.rbegin(); it != mArchives.rend(); it++)
+		if ((*it)->contains(path))
+			return (*it)->view(path);
+	return {};
+}
+
+bool ke::AssetLoader::exists(const std::string& path) const
+{
+	{
+		std::shared_lock<std::shared_mutex> lock(mMutex);
+		for (const auto& archive : mArchives)
+			if (archive->contains(path))
+				return true;
+	}
+	std::error_code error;
+	return std::filesystem::is_regular_file(path, error);
+}
+
+std::string ke::normalizeAssetPath(const std::string& path)
+{
+	std::string normalized = path;
+	std::replace(normalized.begin(), normalized.end(), '\\', '/');
+	while (normalized.compare(0, 2, "./") == 0)
+		normalized.erase(0, 2);
+	return normalized;
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+#include "logger.hpp"
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+namespace ke
+{
+	struct ArchiveEntry;
+
+	// Read-only view of a whole file mapped into memory.
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool open(const std::string& path);
+		void close();
+
+		const uint8_t* getData() const;
+		size_t getSize() const;
+	private:
+		const uint8_t* mData = nullptr;
+		size_t mSize = 0;
+		void* mFile = nullptr;
+		void* mMapping = nullptr;
+	};
+
+	struct AssetView
+	{
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+
+		explicit operator bool() const { return data != nullptr; }
+	};
+
+	// Packed assets in one mapped file. The table of contents is sorted by path hash and searched in place.
+	// Entries are either LZ4 blocks or stored raw at page-aligned offsets, so raw ones can be used straight
+	// from the mapping.
+	class AssetArchive
+	{
+	public:
+		bool open(const std::string& path);
+		void close();
+
+		bool contains(const std::string& path) const;
+		// Zero-copy view of a stored entry. Empty for compressed or missing entries.
+		AssetView view(const std::string& path) const;
+		// Copies or decompresses the entry into out.
+		bool read(const std::string& path, std::vector<char>& out) const;
+
+		uint32_t getEntryCount() const;
+		const std::string& getPath() const;
+
+		// Packs every file under inputs, named by its path as given, e.g. shader/bin/vert.spv. Entries are
+		// compressed unless that saves less than an eighth of their size.
+		static bool pack(const std::string& archivePath, const std::vector<std::string>& inputs, bool compress = true);
+	private:
+		const ArchiveEntry* find(const std::string& path) const;
+	private:
+		std::string mPath;
+		MappedFile mFile;
+		const ArchiveEntry* mEntries = nullptr;
+		uint32_t mEntryCount = 0;
+		const char* mNames = nullptr;
+		size_t mNamesSize = 0;
+
+		ke::Logger mLogger = ke::Logger("Archive Logger", spdlog::level::debug);
+	};
+
+	// Resolves asset paths through the mounted archives, most recently mounted first, then falls back to loose files.
+	class AssetLoader
+	{
+	public:
+		static AssetLoader& getInstance();
+
+		bool mount(const std::string& archivePath);
+		void unmountAll();
+
+		// Empty if the asset exists nowhere.
+		std::vector<char> load(const std::string& path) const;
+		// Zero-copy view when the asset is stored uncompressed in an archive. Valid until the archive is unmounted.
+		AssetView view(const std::string& path) const;
+		bool exists(const std::string& path) const;
+	private:
+		AssetLoader() = default;
+	private:
+		mutable std::shared_mutex mMutex;
+		std::vector<std::unique_ptr<AssetArchive>> mArchives;
+
+		ke::Logger mLogger = ke::Logger("Asset Loader Logger", spdlog::level::debug);
+	};
+
+	// Forward slashes, no leading "./", so lookups match the names the packer stored.
+	std::string normalizeAssetPath(const std::string& path);
+}
\ No newline at end of file
@@ -0,0 +1,971 @@
+#include "benchmark.hpp"
+#include "instancing.hpp"
+#include "scene.hpp"
+#include "particles.hpp"
+#include "gputimer.hpp"
+#include "lighting.hpp"
+#include "occlusion.hpp"
+#include "lod.hpp"
+#include "pipelinevariants.hpp"
+#include "debughud.hpp"
+#include "geometrybuffer.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <glm/gtc/matrix_transform.hpp>
+
+using BenchClock = std::chrono::steady_clock;
+
+static ke::Logger gBenchLogger("Benchmark Logger", spdlog::level::trace);
+
+static double toMilliseconds(BenchClock::duration duration)
+{
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+bool ke::bench::run(const std::string& name, Window& window, Renderer& renderer)
+{
+	if (name == "instancing")
+		runInstancing(window, renderer, 100000, 300);
+	else if (name == "dispatch")
+		runDispatch(renderer, 1000000, 10);
+	else if (name == "particles")
+		runParticles(window, renderer, 300);
+	else if (name == "lights")
+		runLights(window, renderer, 300);
+	else if (name == "occlusion")
+		runOcclusion(window, renderer, 300);
+	else if (name == "lod")
+		runLod(window, renderer, 300);
+	else if (name == "static")
+		runStatic(window, renderer, 20000, 300);
+	else if (name == "budget")
+		runBudget(window, renderer, 600);
+	else if (name == "descriptors")
+		runDescriptors(window, renderer, 4096, 300);
+	else if (name == "hud")
+		runHud(window, renderer, 600);
+	else if (name == "geometry")
+		runGeometry(window, renderer, 600);
+	else if (name == "graph")
+		runGraph(window, renderer, 300);
+	else if (name == "scene")
+		runScene(window, renderer, 2048, 64, 300);
+	else
+	{
+		gBenchLogger.error("Unknown benchmark: {}", name);
+		return false;
+	}
+	return true;
+}
+
+void ke::bench::runInstancing(Window& window, Renderer& renderer, uint32_t instanceCount, uint32_t frames)
+{
+	std::vector<glm::mat4> transforms(instanceCount);
+	uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(instanceCount))));
+	float cell = 2.0f / side;
+	for (uint32_t i = 0; i < instanceCount; i++)
+	{
+		glm::vec3 position(-1.0f + cell * (i % side + 0.5f), -1.0f + cell * (i / side + 0.5f), 0.0f);
+		transforms[i] = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(cell));
+	}
+
+	const char* modeNames[] = { "per-draw", "instanced", "instanced (half)" };
+	for (int mode = 0; mode < 3; mode++)
+	{
+		InstanceRenderer instances;
+		instances.init(renderer, instanceCount, mode == 2 ? InstanceFormat::Float16 : InstanceFormat::Float32);
+		uint32_t mesh = instances.registerMesh(3);
+
+		BenchClock::duration recordTime{};
+		BenchClock::time_point start = BenchClock::now();
+		for (uint32_t frame = 0; frame < frames && !window.shouldClose(); frame++)
+		{
+			renderer.beginRecording(window.getWindow(), window.hasResized());
+
+			BenchClock::time_point recordStart = BenchClock::now();
+			instances.submit(mesh, transforms.data(), instanceCount);
+			if (mode == 0)
+				instances.recordPerDraw(renderer.getCommandBuffer());
+			else
+				instances.record(renderer.getCommandBuffer());
+			recordTime += BenchClock::now() - recordStart;
+
+			renderer.endRecording();
+			renderer.present(window.getWindow());
+			window.pollEvents();
+			renderer.advanceFrame();
+		}
+		double totalMs = toMilliseconds(BenchClock::now() - start);
+
+		renderer.getDeviceTable().DeviceWaitIdle(renderer.getDevice());
+		instances.cleanup();
+
+		FrameStats average = renderer.getStats().getAverage(frames);
+		gBenchLogger.info("{}: {} instances, {} draws, record {:.3f} ms/frame, frame {:.3f} ms, fence wait {:.3f} ms",
+			modeNames[mode], instanceCount, instances.getDrawCount(), toMilliseconds(recordTime) / frames, totalMs / frames, average.fenceWaitMs);
+	}
+}
+
+void ke::bench::runDispatch(Renderer& renderer, uint32_t commandCount, uint32_t rounds)
+{
+	const VkuDeviceDispatchTable& vkd = renderer.getDeviceTable();
+	VkDevice device = renderer.getDevice();
+
+	// Device commands queried from the instance are the loader trampolines that vulkan-1.lib exports.
+	PFN_vkGetInstanceProcAddr getInstanceProcAddr = renderer.getInstanceTable().GetInstanceProcAddr;
+	auto loaderSetViewport = reinterpret_cast<PFN_vkCmdSetViewport>(getInstanceProcAddr(renderer.getVulkanInstance(), "vkCmdSetViewport"));
+	auto loaderSetScissor = reinterpret_cast<PFN_vkCmdSetScissor>(getInstanceProcAddr(renderer.getVulkanInstance(), "vkCmdSetScissor"));
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = renderer.getGraphicsQueueFamily();
+	VkCommandPool pool;
+	if (vkd.CreateCommandPool(device, &poolInfo, renderer.getAllocationCallbacks(), &pool) != VK_SUCCESS)
+	{
+		gBenchLogger.error("Failed to create benchmark command pool.");
+		return;
+	}
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = pool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+	VkCommandBuffer cmd;
+	vkd.AllocateCommandBuffers(device, &allocInfo, &cmd);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	VkExtent2D extent = renderer.getSwapchainExtent();
+	VkViewport viewport{ 0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f };
+	VkRect2D scissor{ { 0, 0 }, extent };
+
+	// Paths alternate every round so clock and cache effects hit both equally.
+	BenchClock::duration loaderTime{}, tableTime{};
+	for (uint32_t round = 0; round < rounds * 2; round++)
+	{
+		bool useTable = round % 2 == 1;
+		PFN_vkCmdSetViewport setViewport = useTable ? vkd.CmdSetViewport : loaderSetViewport;
+		PFN_vkCmdSetScissor setScissor = useTable ? vkd.CmdSetScissor : loaderSetScissor;
+
+		vkd.ResetCommandPool(device, pool, 0);
+		vkd.BeginCommandBuffer(cmd, &beginInfo);
+		BenchClock::time_point start = BenchClock::now();
+		for (uint32_t i = 0; i < commandCount / 2; i++)
+		{
+			setViewport(cmd, 0, 1, &viewport);
+			setScissor(cmd, 0, 1, &scissor);
+		}
+		(useTable ? tableTime : loaderTime) += BenchClock::now() - start;
+		vkd.EndCommandBuffer(cmd);
+	}
+
+	vkd.DestroyCommandPool(device, pool, renderer.getAllocationCallbacks());
+
+	double commands = static_cast<double>(commandCount / 2 * 2) * rounds;
+	double loaderNs = toMilliseconds(loaderTime) * 1e6 / commands;
+	double tableNs = toMilliseconds(tableTime) * 1e6 / commands;
+	gBenchLogger.info("loader trampolines: {:.2f} ns/command, dispatch table: {:.2f} ns/command ({:.2f}x)",
+		loaderNs, tableNs, tableNs > 0.0 ? loaderNs / tableNs : 0.0);
+}
+
+void ke::bench::runParticles(Window& window, Renderer& renderer, uint32_t frames)
+{
+	// Registered first so its query reset lands ahead of the particle passes.
+	GpuTimer timer;
+	timer.init(renderer);
+	uint32_t simulateScope = timer.registerScope("particle simulate");
+	uint32_t renderScope = timer.registerScope("particle render");
+	if (!timer.isSupported())
+		gBenchLogger.warn("Timestamps are not supported, GPU times will read zero.");
+
+	const uint32_t counts[] = { 16384, 65536, 262144, 1048576 };
+	for (uint32_t count : counts)
+	{
+		ParticleSystem particles;
+		particles.init(renderer, count);
+		particles.setTimer(&timer, simulateScope, renderScope);
+
+		// Particles expire at most count / (lifetime / 2) per second, so this rate keeps the pool saturated.
+		ParticleEmitterSettings emitter = particles.getEmitter();
+		emitter.rate = count / (emitter.lifetime * 0.5f);
+		particles.setEmitter(emitter);
+		particles.burst(count);
+
+		// Timings lag by a frames-in-flight cycle, so the first frames only fill the pipeline.
+		uint32_t warmup = renderer.getMaxFramesInFlight() * 2;
+		double simulateMs = 0.0, renderMs = 0.0;
+		uint64_t aliveTotal = 0;
+		uint32_t measured = 0;
+		BenchClock::time_point start = BenchClock::now();
+		for (uint32_t frame = 0; frame < warmup + frames && !window.shouldClose(); frame++)
+		{
+			particles.update(1.0f / 60.0f);
+			renderer.beginRecording(window.getWindow(), window.hasResized());
+			particles.record(renderer.getCommandBuffer());
+			renderer.endRecording();
+			renderer.present(window.getWindow());
+			window.pollEvents();
+			renderer.advanceFrame();
+
+			if (frame < warmup)
+				continue;
+			simulateMs += timer.getMilliseconds(simulateScope);
+			renderMs += timer.getMilliseconds(renderScope);
+			aliveTotal += particles.getAliveCount();
+			measured++;
+		}
+		double totalMs = toMilliseconds(BenchClock::now() - start);
+
+		renderer.getDeviceTable().DeviceWaitIdle(renderer.getDevice());
+		particles.cleanup();
+
+		if (measured == 0)
+			break;
+		gBenchLogger.info("{} particles: {} alive on average, simulate {:.3f} ms, render {:.3f} ms (GPU), frame {:.3f} ms",
+			count, aliveTotal / measured, simulateMs / measured, renderMs / measured, totalMs / (warmup + measured));
+	}
+
+	timer.cleanup();
+}
+
+void ke::bench::runLights(Window& window, Renderer& renderer, uint32_t frames)
+{
+	const uint32_t counts[] = { 256, 1024, 4096, 8192 };
+	const uint32_t maxLights = 8192;
+
+	GpuTimer timer;
+	timer.init(renderer);
+	uint32_t cullScope = timer.registerScope("light cull");
+	uint32_t shadeScope = timer.registerScope("lit plane");
+
+	ClusteredLighting lighting;
+	lighting.init(renderer, maxLights);
+	lighting.setTimer(&timer, cullScope);
+
+	const VkuDeviceDispatchTable& vkd = renderer.getDeviceTable();
+	VkDescriptorSetLayout setLayout = lighting.getSetLayout();
+	VkPushConstantRange pushRange{ VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4) * 2 };
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &setLayout;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushRange;
+	VkPipelineLayout layout;
+	vkd.CreatePipelineLayout(renderer.getDevice(), &layoutInfo, renderer.getAllocationCallbacks(), &layout);
+
+	GraphicsPipelineDesc desc{};
+	desc.vertexShader = "shader/bin/lit_vert.spv";
+	desc.fragmentShader = "shader/bin/lit_frag.spv";
+	desc.layout = layout;
+	PipelineVariants variants;
+	variants.init(renderer, desc);
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<Light> lights(maxLights);
+	std::vector<Light> animated(maxLights);
+	for (auto& light : lights)
+	{
+		light.position = glm::vec3(unit(rng) * 90.0f - 45.0f, 0.5f + unit(rng) * 2.5f, unit(rng) * 90.0f - 45.0f);
+		light.radius = 2.0f + unit(rng) * 4.0f;
+		light.color = glm::vec3(unit(rng), unit(rng), unit(rng));
+		light.intensity = 2.0f;
+		light.type = unit(rng) < 0.5f ? LightType::Point : LightType::Spot;
+	}
+
+	float nearPlane = 0.1f, farPlane = 200.0f;
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 25.0f, 55.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	// Point-only scenes use the variant with the spot cone test specialized out.
+	for (bool spots : { true, false })
+	{
+		VkPipeline pipeline = variants.get(ClusteredShading().set<ClusteredSpotLights>(spots));
+		for (uint32_t count : counts)
+		{
+			double cullMs = 0.0, shadeMs = 0.0;
+			uint64_t occupied = 0, indices = 0, maxPerCluster = 0;
+			uint32_t warmup = renderer.getMaxFramesInFlight() * 2;
+			uint32_t measured = 0;
+			for (uint32_t frame = 0; frame < warmup + frames && !window.shouldClose(); frame++)
+			{
+				// Lights orbit the origin so the binning changes every frame.
+				float angle = frame * 0.01f;
+				glm::mat3 orbit = glm::mat3(glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+				for (uint32_t i = 0; i < count; i++)
+				{
+					animated[i] = lights[i];
+					animated[i].position = orbit * lights[i].position;
+					if (!spots)
+						animated[i].type = LightType::Point;
+				}
+
+				VkExtent2D extent = renderer.getSwapchainExtent();
+				glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.0f), extent.width / static_cast<float>(extent.height), nearPlane, farPlane);
+				projection[1][1] *= -1.0f;
+				lighting.setCamera(view, projection, nearPlane, farPlane);
+				lighting.submit(animated.data(), count);
+
+				renderer.beginRecording(window.getWindow(), window.hasResized());
+				VkCommandBuffer cmd = renderer.getCommandBuffer();
+				timer.begin(cmd, shadeScope);
+				renderer.bindPipeline(cmd, pipeline);
+				lighting.bind(cmd, layout, 0);
+				glm::mat4 camera[2] = { view, projection };
+				vkd.CmdPushConstants(cmd, layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(camera), camera);
+				renderer.draw(6);
+				timer.end(cmd, shadeScope);
+				renderer.endRecording();
+				renderer.present(window.getWindow());
+				window.pollEvents();
+				renderer.advanceFrame();
+
+				if (frame < warmup)
+					continue;
+				const LightClusterStats& stats = lighting.getClusterStats();
+				cullMs += timer.getMilliseconds(cullScope);
+				shadeMs += timer.getMilliseconds(shadeScope);
+				occupied += stats.occupiedClusters;
+				indices += stats.lightIndices;
+				maxPerCluster = std::max<uint64_t>(maxPerCluster, stats.maxLightsPerCluster);
+				measured++;
+			}
+			if (measured == 0)
+				break;
+
+			gBenchLogger.info("{} {} lights: cull {:.3f} ms, shade {:.3f} ms (GPU), {} of {} clusters occupied, {} indices, at most {} lights per cluster",
+				count, spots ? "point and spot" : "point", cullMs / measured, shadeMs / measured, occupied / measured, lighting.getClusterCount(), indices / measured, maxPerCluster);
+		}
+	}
+
+	vkd.DeviceWaitIdle(renderer.getDevice());
+	variants.cleanup();
+	vkd.DestroyPipelineLayout(renderer.getDevice(), layout, renderer.getAllocationCallbacks());
+	lighting.cleanup();
+	timer.cleanup();
+}
+
+void ke::bench::runOcclusion(Window& window, Renderer& renderer, uint32_t frames)
+{
+	const uint32_t side = 96;
+	const uint32_t objectCount = side * side;
+
+	GpuTimer timer;
+	timer.init(renderer);
+	uint32_t cullScope = timer.registerScope("occlusion cull");
+	uint32_t drawScope = timer.registerScope("boxes");
+
+	OcclusionCuller culler;
+	culler.init(renderer, objectCount, 4);
+	culler.setTimer(&timer, cullScope);
+
+	// A field of boxes on the ground; the wall in front of the camera hides most of it.
+	std::vector<OcclusionObject> objects(objectCount);
+	std::vector<glm::vec4> boxes(objectCount * 2);
+	for (uint32_t i = 0; i < objectCount; i++)
+	{
+		glm::vec3 center(-60.0f + 120.0f * (i % side + 0.5f) / side, 0.5f, -10.0f - 100.0f * (i / side + 0.5f) / side);
+		objects[i].bounds = { center - glm::vec3(0.4f), center + glm::vec3(0.4f) };
+		objects[i].vertexCount = 36;
+		boxes[i * 2] = glm::vec4(objects[i].bounds.min, 1.0f);
+		boxes[i * 2 + 1] = glm::vec4(objects[i].bounds.max, 1.0f);
+	}
+	Bounds wall = { glm::vec3(-20.0f, -1.0f, -6.0f), glm::vec3(20.0f, 8.0f, -5.5f) };
+
+	// Surviving draws use the object index as firstInstance, which selects the box from this buffer.
+	const VkuDeviceDispatchTable& vkd = renderer.getDeviceTable();
+	Buffer boxBuffer = renderer.createBuffer(sizeof(glm::vec4) * boxes.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	std::memcpy(boxBuffer.mapped, boxes.data(), boxBuffer.size);
+
+	VkPushConstantRange pushRange{ VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4) };
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushRange;
+	VkPipelineLayout layout;
+	vkd.CreatePipelineLayout(renderer.getDevice(), &layoutInfo, renderer.getAllocationCallbacks(), &layout);
+
+	GraphicsPipelineDesc desc{};
+	desc.vertexShader = "shader/bin/occluder_vert.spv";
+	desc.bindings = { { 0, sizeof(glm::vec4) * 2, VK_VERTEX_INPUT_RATE_INSTANCE } };
+	desc.attributes = {
+		{ 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT, 0 },
+		{ 1, 0, VK_FORMAT_R32G32B32A32_SFLOAT, sizeof(glm::vec4) }
+	};
+	desc.layout = layout;
+	VkPipeline pipeline = renderer.buildGraphicsPipeline(desc);
+
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 3.0f, 10.0f), glm::vec3(0.0f, 1.0f, -30.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	for (bool occlusion : { false, true })
+	{
+		culler.setOcclusionEnabled(occlusion);
+		double cullMs = 0.0, drawMs = 0.0;
+		uint64_t frustumCulled = 0, occlusionCulled = 0, visible = 0;
+		uint32_t warmup = renderer.getMaxFramesInFlight() * 2;
+		uint32_t measured = 0;
+		for (uint32_t frame = 0; frame < warmup + frames && !window.shouldClose(); frame++)
+		{
+			VkExtent2D extent = renderer.getSwapchainExtent();
+			glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.0f), extent.width / static_cast<float>(extent.height), 0.1f, 200.0f);
+			projection[1][1] *= -1.0f;
+			glm::mat4 viewProjection = projection * view;
+			culler.setCamera(viewProjection);
+			culler.submitOccluders(&wall, 1);
+			culler.submitObjects(objects.data(), objectCount);
+
+			renderer.beginRecording(window.getWindow(), window.hasResized());
+			VkCommandBuffer cmd = renderer.getCommandBuffer();
+			timer.begin(cmd, drawScope);
+			renderer.bindPipeline(cmd, pipeline);
+			VkDeviceSize offset = 0;
+			vkd.CmdBindVertexBuffers(cmd, 0, 1, &boxBuffer.buffer, &offset);
+			vkd.CmdPushConstants(cmd, layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &viewProjection);
+			culler.record(cmd);
+			timer.end(cmd, drawScope);
+			renderer.endRecording();
+			renderer.present(window.getWindow());
+			window.pollEvents();
+			renderer.advanceFrame();
+
+			if (frame < warmup)
+				continue;
+			const OcclusionCullStats& stats = culler.getCullStats();
+			cullMs += timer.getMilliseconds(cullScope);
+			drawMs += timer.getMilliseconds(drawScope);
+			frustumCulled += stats.frustumCulled;
+			occlusionCulled += stats.occlusionCulled;
+			visible += stats.visible;
+			measured++;
+		}
+		if (measured == 0)
+			break;
+
+		gBenchLogger.info("occlusion {}: {} tested, {} frustum culled, {} occluded, {} drawn, cull {:.3f} ms, draw {:.3f} ms (GPU)",
+			occlusion ? "on" : "off", objectCount, frustumCulled / measured, occlusionCulled / measured, visible / measured, cullMs / measured, drawMs / measured);
+	}
+
+	vkd.DeviceWaitIdle(renderer.getDevice());
+	renderer.destroyPipeline(pipeline);
+	vkd.DestroyPipelineLayout(renderer.getDevice(), layout, renderer.getAllocationCallbacks());
+	renderer.destroyBuffer(boxBuffer);
+	culler.cleanup();
+	timer.cleanup();
+}
+
+void ke::bench::runLod(Window& window, Renderer& renderer, uint32_t frames)
+{
+	const uint32_t rings = 96, segments = 192;
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+	for (uint32_t r = 0; r <= rings; r++)
+		for (uint32_t s = 0; s < segments; s++)
+		{
+			float theta = glm::pi<float>() * r / rings, phi = glm::two_pi<float>() * s / segments;
+			positions.push_back(glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+		}
+	for (uint32_t r = 0; r < rings; r++)
+		for (uint32_t s = 0; s < segments; s++)
+		{
+			uint32_t a = r * segments + s, b = r * segments + (s + 1) % segments;
+			indices.insert(indices.end(), { a, a + segments, b, b, a + segments, b + segments });
+		}
+
+	BenchClock::time_point generateStart = BenchClock::now();
+	LodMesh sphere = generateLods(positions.data(), static_cast<uint32_t>(positions.size()), indices.data(), static_cast<uint32_t>(indices.size()));
+	gBenchLogger.info("generated {} levels in {:.2f} ms", sphere.levels.size(), toMilliseconds(BenchClock::now() - generateStart));
+	for (uint32_t i = 0; i < sphere.levels.size(); i++)
+		gBenchLogger.info("  level {}: {} triangles, error {:.4f}", i, sphere.levels[i].indexCount / 3, sphere.levels[i].error);
+
+	const uint32_t side = 100;
+	std::vector<glm::mat4> transforms(side * side);
+	for (uint32_t i = 0; i < transforms.size(); i++)
+		transforms[i] = glm::translate(glm::mat4(1.0f), glm::vec3(-200.0f + 4.0f * (i % side), 1.0f, -4.0f * (i / side)));
+
+	GpuTimer timer;
+	timer.init(renderer);
+	uint32_t drawScope = timer.registerScope("spheres");
+
+	LodRenderer lods;
+	lods.init(renderer, static_cast<uint32_t>(transforms.size()));
+	uint32_t mesh = lods.addMesh(sphere);
+
+	glm::vec3 eye(0.0f, 6.0f, 12.0f);
+	glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f, 0.0f, -60.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	float fov = glm::radians(60.0f);
+	for (bool selectByError : { false, true })
+	{
+		lods.forceLevel(selectByError ? -1 : 0);
+		double drawMs = 0.0;
+		uint64_t triangles = 0;
+		std::vector<uint64_t> histogram(sphere.levels.size(), 0);
+		uint32_t warmup = renderer.getMaxFramesInFlight() * 2;
+		uint32_t measured = 0;
+		for (uint32_t frame = 0; frame < warmup + frames && !window.shouldClose(); frame++)
+		{
+			VkExtent2D extent = renderer.getRenderExtent();
+			glm::mat4 projection = glm::perspectiveRH_ZO(fov, extent.width / static_cast<float>(extent.height), 0.1f, 500.0f);
+			projection[1][1] *= -1.0f;
+			lods.setCamera(projection * view, eye, lodProjectionScale(fov, extent.height));
+			lods.submit(mesh, transforms.data(), static_cast<uint32_t>(transforms.size()));
+
+			renderer.beginRecording(window.getWindow(), window.hasResized());
+			VkCommandBuffer cmd = renderer.getCommandBuffer();
+			timer.begin(cmd, drawScope);
+			lods.record(cmd);
+			timer.end(cmd, drawScope);
+			renderer.endRecording();
+			renderer.present(window.getWindow());
+			window.pollEvents();
+			renderer.advanceFrame();
+
+			if (frame < warmup)
+				continue;
+			drawMs += timer.getMilliseconds(drawScope);
+			triangles += lods.getTriangleCount();
+			for (uint32_t level = 0; level < histogram.size(); level++)
+				histogram[level] += lods.getLevelHistogram()[level];
+			measured++;
+		}
+		if (measured == 0)
+			break;
+
+		std::string levels;
+		for (uint64_t count : histogram)
+			levels += std::to_string(count / measured) + " ";
+		gBenchLogger.info("{}: {} triangles/frame, draw {:.3f} ms (GPU), instances per level: {}",
+			selectByError ? "screen-space error" : "full detail", triangles / measured, drawMs / measured, levels);
+	}
+
+	renderer.getDeviceTable().DeviceWaitIdle(renderer.getDevice());
+	GeometryStats geometry = lods.getGeometryStats();
+	gBenchLogger.info("geometry: {} meshes, {:.2f} MB resident, {} of {} vertices and {} of {} indices used", geometry.meshCount,
+		geometry.residentBytes / (1024.0 * 1024.0), geometry.vertexUsed, geometry.vertexCapacity, geometry.indexUsed, geometry.indexCapacity);
+	lods.cleanup();
+	timer.cleanup();
+}
+
+void ke::bench::runStatic(Window& window, Renderer& renderer, uint32_t instanceCount, uint32_t frames)
+{
+	std::vector<glm::mat4> transforms(instanceCount);
+	uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(instanceCount))));
+	float cell = 2.0f / side;
+	for (uint32_t i = 0; i < instanceCount; i++)
+	{
+		glm::vec3 position(-1.0f + cell * (i % side + 0.5f), -1.0f + cell * (i / side + 0.5f), 0.0f);
+		transforms[i] = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(cell));
+	}
+
+	// One draw per instance makes recording, not the GPU, the cost being measured.
+	for (bool cached : { false, true })
+	{
+		InstanceRenderer instances;
+		instances.init(renderer, instanceCount);
+		uint32_t mesh = instances.registerMesh(3);
+
+		uint32_t bundle = UINT32_MAX;
+		if (cached)
+			bundle = renderer.addStaticBundle(BundleLayer::Background, [&](VkCommandBuffer cmd)
+				{
+					instances.submit(mesh, transforms.data(), instanceCount);
+					instances.recordPerDraw(cmd);
+				});
+
+		BenchClock::duration recordTime{};
+		uint32_t recorded = 0;
+		for (uint32_t frame = 0; frame < frames && !window.shouldClose(); frame++)
+		{
+			BenchClock::time_point recordStart = BenchClock::now();
+			renderer.beginRecording(window.getWindow(), window.hasResized());
+			if (!cached)
+			{
+				instances.submit(mesh, transforms.data(), instanceCount);
+				instances.recordPerDraw(renderer.getCommandBuffer());
+			}
+			renderer.endRecording();
+			recordTime += BenchClock::now() - recordStart;
+			recorded += renderer.getStats().getCurrent().bundlesRecorded;
+
+			renderer.present(window.getWindow());
+			window.pollEvents();
+			renderer.advanceFrame();
+		}
+
+		renderer.getDeviceTable().DeviceWaitIdle(renderer.getDevice());
+		if (cached)
+			renderer.removeStaticBundle(bundle);
+		instances.cleanup();
+
+		// Recording time includes the fence wait inside beginRecording, which is reported separately.
+		FrameStats average = renderer.getStats().getAverage(frames);
+		gBenchLogger.info("{}: {} draws/frame, {} bundle recordings, record {:.3f} ms/frame, fence wait {:.3f} ms",
+			cached ? "cached bundle" : "inline", average.drawCalls, recorded, toMilliseconds(recordTime) / frames, average.fenceWaitMs);
+	}
+}
+
+void ke::bench::runBudget(Window& window, Renderer& renderer, uint32_t frames)
+{
+	const VkDeviceSize chunkSize = 32ull << 20;
+	const uint32_t chunkCount = 32, residentChunks = 8, visibleChunks = 4;
+
+	MemoryBudget& budget = renderer.getMemoryBudget();
+	std::vector<Buffer> chunks(chunkCount);
+	std::vector<uint32_t> handles(chunkCount, UINT32_MAX);
+	uint32_t loads = 0, evictions = 0;
+	uint64_t peakUsage = 0;
+
+	// The threshold leaves room for residentChunks on top of what the device-local heap already holds.
+	Buffer probe = renderer.createBuffer(chunkSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	uint32_t heap = budget.getHeapIndex(probe.memoryType);
+	renderer.destroyBuffer(probe);
+	float previousThreshold = budget.getEvictionThreshold();
+	const HeapBudget& heapBudget = budget.getHeaps()[heap];
+	budget.setEvictionThreshold(static_cast<float>(static_cast<double>(heapBudget.usage + residentChunks * chunkSize) / heapBudget.budget));
+
+	BenchClock::time_point start = BenchClock::now();
+	for (uint32_t frame = 0; frame < frames && !window.shouldClose(); frame++)
+	{
+		renderer.beginRecording(window.getWindow(), window.hasResized());
+
+		// A window of visible chunks sweeps over the whole set, so older chunks fall out of use.
+		uint32_t first = (frame / 8) % chunkCount;
+		for (uint32_t i = 0; i < visibleChunks; i++)
+		{
+			uint32_t chunk = (first + i) % chunkCount;
+			if (handles[chunk] == UINT32_MAX)
+			{
+				chunks[chunk] = renderer.createBuffer(chunkSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+				handles[chunk] = budget.registerStreamable(chunks[chunk].memoryType, chunkSize, [&, chunk]
+					{
+						renderer.destroyBuffer(chunks[chunk]);
+						handles[chunk] = UINT32_MAX;
+					});
+				loads++;
+			}
+			budget.touch(handles[chunk]);
+		}
+		peakUsage = std::max<uint64_t>(peakUsage, budget.getHeaps()[heap].usage);
+		evictions += budget.getLastEvictionCount();
+
+		renderer.endRecording();
+		renderer.present(window.getWindow());
+		window.pollEvents();
+		renderer.advanceFrame();
+	}
+	double totalMs = toMilliseconds(BenchClock::now() - start);
+
+	renderer.getDeviceTable().DeviceWaitIdle(renderer.getDevice());
+	for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+		if (handles[chunk] != UINT32_MAX)
+		{
+			budget.unregisterStreamable(handles[chunk]);
+			renderer.destroyBuffer(chunks[chunk]);
+		}
+	budget.setEvictionThreshold(previousThreshold);
+
+	gBenchLogger.info("{}: {} loads, {} evictions, peak heap {} usage {} MiB of {} MiB budget, frame {:.3f} ms",
+		budget.hasBudgetExtension() ? "VK_EXT_memory_budget" : "heap size fallback", loads, evictions, heap, peakUsage >> 20,
+		heapBudget.budget >> 20, totalMs / frames);
+}
+
+void ke::bench::runDescriptors(Window& window, Renderer& renderer, uint32_t objectCount, uint32_t frames)
+{
+	const VkuDeviceDispatchTable& vkd = renderer.getDeviceTable();
+	VkDevice device = renderer.getDevice();
+	const uint32_t materialCount = 64;
+	const VkDeviceSize materialSize = 256;
+
+	VkDescriptorSetLayoutBinding binding{};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	vkd.CreateDescriptorSetLayout(device, &layoutInfo, renderer.getAllocationCallbacks(), &layout);
+	Buffer materials = renderer.createBuffer(materialCount * materialSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	// Every object asks for the set of its material, the way a material system would without its own caching.
+	DescriptorAllocator& descriptors = renderer.getDescriptorAllocator();
+	for (bool cached : { false, true })
+	{
+		BenchClock::duration descriptorTime{};
+		uint32_t frameCount = 0;
+		for (; frameCount < frames && !window.shouldClose(); frameCount++)
+		{
+			renderer.beginRecording(window.getWindow(), window.hasResized());
+			BenchClock::time_point start = BenchClock::now();
+			for (uint32_t object = 0; object < objectCount; object++)
+			{
+				VkDeviceSize offset = (object % materialCount) * materialSize;
+				if (cached)
+					descriptors.get(layout, DescriptorSetDesc().buffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, materials.buffer, offset, materialSize));
+				else
+				{
+					VkDescriptorSet set = descriptors.allocate(layout);
+					VkDescriptorBufferInfo bufferInfo{ materials.buffer, offset, materialSize };
+					VkWriteDescriptorSet write{};
+					write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+					write.dstSet = set;
+					write.descriptorCount = 1;
+					write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+					write.pBufferInfo = &bufferInfo;
+					vkd.UpdateDescriptorSets(device, 1, &write, 0, nullptr);
+				}
+			}
+			descriptorTime += BenchClock::now() - start;
+
+			renderer.endRecording();
+			renderer.present(window.getWindow());
+			window.pollEvents();
+			renderer.advanceFrame();
+		}
+
+		FrameStats average = renderer.getStats().getAverage(std::max(frameCount, 1u));
+		gBenchLogger.info("{}: {} requests/frame, {} sets allocated, {} reused, {} pools, {:.3f} ms/frame", cached ? "cached" : "allocate per object",
+			objectCount, average.descriptorSetsAllocated, average.descriptorSetsReused, descriptors.getPoolCount(),
+			toMilliseconds(descriptorTime) / std::max(frameCount, 1u));
+	}
+
+	// Identical create infos share one sampler.
+	VkSampler first = VK_NULL_HANDLE;
+	bool shared = true;
+	for (uint32_t i = 0; i < 1000; i++)
+	{
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_LINEAR;
+		samplerInfo.minFilter = VK_FILTER_LINEAR;
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+		VkSampler sampler = renderer.getSampler(samplerInfo);
+		if (i == 0)
+			first = sampler;
+		shared = shared && sampler == first;
+	}
+	gBenchLogger.info("1000 identical sampler requests {} one sampler.", shared ? "shared" : "did not share");
+
+	renderer.getDeviceTable().DeviceWaitIdle(device);
+	renderer.destroyBuffer(materials);
+	vkd.DestroyDescriptorSetLayout(device, layout, renderer.getAllocationCallbacks());
+}
+
+void ke::bench::runHud(Window& window, Renderer& renderer, uint32_t frames)
+{
+	GpuTimer timer;
+	timer.init(renderer);
+	uint32_t hudScope = timer.registerScope("debug hud");
+	DebugHud hud;
+	hud.init(renderer);
+	hud.setTimer(&timer, hudScope);
+
+	// The first frames in flight have no resolved GPU time yet.
+	double cpuMs = 0.0, gpuMs = 0.0, maxCpuMs = 0.0;
+	uint32_t frameCount = 0, gpuFrames = 0;
+	for (; frameCount < frames && !window.shouldClose(); frameCount++)
+	{
+		renderer.beginRecording(window.getWindow(), window.hasResized());
+		renderer.draw(3);
+		hud.record(renderer.getCommandBuffer());
+		renderer.endRecording();
+		renderer.present(window.getWindow());
+		window.pollEvents();
+		renderer.advanceFrame();
+
+		cpuMs += hud.getCpuMs();
+		maxCpuMs = std::max<double>(maxCpuMs, hud.getCpuMs());
+		if (frameCount >= renderer.getMaxFramesInFlight())
+		{
+			gpuMs += timer.getMilliseconds(hudScope);
+			gpuFrames++;
+		}
+	}
+
+	renderer.getDeviceTable().DeviceWaitIdle(renderer.getDevice());
+	uint32_t quads = hud.getLastQuadCount();
+	hud.cleanup();
+	timer.cleanup();
+
+	gBenchLogger.info("HUD: {} quads in one draw, CPU {:.3f} ms average {:.3f} ms max, GPU {:.3f} ms", quads, cpuMs / std::max(frameCount, 1u),
+		maxCpuMs, gpuMs / std::max(gpuFrames, 1u));
+}
+
+void ke::bench::runGeometry(Window& window, Renderer& renderer, uint32_t frames)
+{
+	const uint32_t liveTarget = 512, operationsPerFrame = 8;
+	GeometryBuffer geometry;
+	geometry.init(renderer, sizeof(glm::vec3), 1u << 16, 1u << 18);
+
+	std::mt19937 rng(7);
+	std::uniform_int_distribution<uint32_t> vertexCounts(64, 4096);
+	std::vector<glm::vec3> vertices(4096, glm::vec3(0.0f));
+	std::vector<uint32_t> indices(4096 * 3, 0);
+	std::vector<uint32_t> meshes;
+
+	double addMs = 0.0;
+	uint32_t adds = 0, removes = 0;
+	for (uint32_t frame = 0; frame < frames && !window.shouldClose(); frame++)
+	{
+		for (uint32_t op = 0; op < operationsPerFrame; op++)
+		{
+			if (meshes.size() >= liveTarget || (!meshes.empty() && rng() % 2 == 0))
+			{
+				uint32_t victim = rng() % meshes.size();
+				geometry.removeMesh(meshes[victim]);
+				meshes[victim] = meshes.back();
+				meshes.pop_back();
+				removes++;
+				continue;
+			}
+			uint32_t vertexCount = vertexCounts(rng);
+			BenchClock::time_point start = BenchClock::now();
+			uint32_t mesh = geometry.addMesh(vertices.data(), vertexCount, indices.data(), vertexCount * 3);
+			addMs += toMilliseconds(BenchClock::now() - start);
+			if (mesh != UINT32_MAX)
+				meshes.push_back(mesh);
+			adds++;
+		}
+
+		// Freed ranges only return to the allocator once the frames that could draw them have finished.
+		renderer.beginRecording(window.getWindow(), window.hasResized());
+		geometry.bind(renderer.getCommandBuffer());
+		renderer.endRecording();
+		renderer.present(window.getWindow());
+		window.pollEvents();
+		renderer.advanceFrame();
+	}
+
+	GeometryStats before = geometry.getStats();
+	BenchClock::time_point defragStart = BenchClock::now();
+	geometry.defragment();
+	double defragMs = toMilliseconds(BenchClock::now() - defragStart);
+	GeometryStats after = geometry.getStats();
+
+	renderer.getDeviceTable().DeviceWaitIdle(renderer.getDevice());
+	geometry.cleanup();
+
+	gBenchLogger.info("{} adds ({:.3f} ms average), {} removes, {} automatic compactions, {} grows", adds, addMs / std::max(adds, 1u), removes,
+		before.defragmentations, before.grows);
+	gBenchLogger.info("before defragment: {} meshes, {} free ranges, fragmentation {:.3f}, {} of {} vertices used, {:.2f} MB resident",
+		before.meshCount, before.freeRanges, before.fragmentation, before.vertexUsed, before.vertexCapacity, before.residentBytes / (1024.0 * 1024.0));
+	gBenchLogger.info("after defragment ({:.2f} ms): {} free ranges, fragmentation {:.3f}, {} of {} vertices used", defragMs, after.freeRanges,
+		after.fragmentation, after.vertexUsed, after.vertexCapacity);
+}
+
+void ke::bench::runGraph(Window& window, Renderer& renderer, uint32_t frames)
+{
+	const uint32_t chainLength = 6;
+	RGImageDesc desc{};
+	desc.format = VK_FORMAT_R8G8B8A8_UNORM;
+	desc.extent = { 1024, 1024 };
+
+	// Each transient is written by one pass and read by the next, so only two are ever alive at once. Debug builds
+	// validate that every image waits on the one that used its memory before it.
+	uint32_t hook = renderer.addRenderGraphHook(RenderGraphStage::BeforeMainPass, [&](RenderGraph& graph)
+		{
+			RGResource previous = RG_INVALID;
+			for (uint32_t i = 0; i < chainLength; i++)
+			{
+				RGResource image = graph.createImage("alias chain", desc);
+				RGPass pass = graph.addPass("alias chain");
+				if (previous != RG_INVALID)
+					graph.read(pass, previous, RGAccess::ComputeStorageRead);
+				graph.write(pass, image, RGAccess::ComputeStorageWrite);
+				previous = image;
+			}
+			RGPass last = graph.addPass("alias chain end");
+			graph.read(last, previous, RGAccess::ComputeStorageRead);
+			graph.setSideEffect(last);
+		});
+
+	double frameMs = 0.0;
+	uint32_t frameCount = 0, barrierBatches = 0;
+	for (; frameCount < frames && !window.shouldClose(); frameCount++)
+	{
+		BenchClock::time_point start = BenchClock::now();
+		renderer.beginRecording(window.getWindow(), window.hasResized());
+		renderer.endRecording();
+		renderer.present(window.getWindow());
+		window.pollEvents();
+		renderer.advanceFrame();
+		frameMs += toMilliseconds(BenchClock::now() - start);
+		barrierBatches = renderer.getRenderGraph().getBarrierBatchCount();
+	}
+
+	renderer.getDeviceTable().DeviceWaitIdle(renderer.getDevice());
+	VkDeviceSize transientBytes = renderer.getRenderGraph().getTransientMemorySize();
+	renderer.removeRenderGraphHook(hook);
+
+	VkDeviceSize unaliasedBytes = static_cast<VkDeviceSize>(chainLength) * desc.extent.width * desc.extent.height * 4;
+	gBenchLogger.info("render graph: {} chained transients in {:.2f} MB instead of {:.2f} MB, {} barrier batches, {:.3f} ms per frame", chainLength,
+		transientBytes / (1024.0 * 1024.0), unaliasedBytes / (1024.0 * 1024.0), barrierBatches, frameMs / std::max(frameCount, 1u));
+}
+
+void ke::bench::runScene(Window& window, Renderer& renderer, uint32_t rootCount, uint32_t childrenPerRoot, uint32_t frames)
+{
+	// Roots are unrendered pivots spread over the screen; their children orbit them.
+	Scene scene;
+	std::vector<Entity> roots(rootCount);
+	uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(rootCount))));
+	float cell = 2.0f / side;
+	for (uint32_t r = 0; r < rootCount; r++)
+	{
+		roots[r] = scene.create();
+		scene.setPosition(roots[r], glm::vec3(-1.0f + cell * (r % side + 0.5f), -1.0f + cell * (r / side + 0.5f), 0.0f));
+		for (uint32_t c = 0; c < childrenPerRoot; c++)
+		{
+			float angle = glm::two_pi<float>() * c / childrenPerRoot;
+			Entity child = scene.create(roots[r], 0);
+			scene.setTransform(child, glm::vec3(std::cos(angle), std::sin(angle), 0.0f) * cell * 0.4f, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(cell * 0.05f));
+		}
+	}
+	uint32_t nodeCount = scene.getNodeCount();
+
+	InstanceRenderer instances;
+	instances.init(renderer, scene.getEntityCapacity());
+	uint32_t mesh = instances.registerMesh(3);
+
+	for (uint32_t moving : { rootCount, std::max(rootCount / 100, 1u) })
+	{
+		double propagateMs = 0.0, uploadMs = 0.0;
+		uint64_t updated = 0, uploaded = 0;
+		uint32_t frameCount = 0;
+		for (; frameCount < frames && !window.shouldClose(); frameCount++)
+		{
+			glm::quat spin = glm::angleAxis(0.02f * frameCount, glm::vec3(0.0f, 0.0f, 1.0f));
+			for (uint32_t r = 0; r < moving; r++)
+				scene.setRotation(roots[r], spin);
+
+			BenchClock::time_point propagateStart = BenchClock::now();
+			scene.updateTransforms();
+			propagateMs += toMilliseconds(BenchClock::now() - propagateStart);
+			updated += scene.getLastUpdatedCount();
+
+			renderer.beginRecording(window.getWindow(), window.hasResized());
+			BenchClock::time_point uploadStart = BenchClock::now();
+			instances.recordScene(renderer.getCommandBuffer(), scene, mesh);
+			uploadMs += toMilliseconds(BenchClock::now() - uploadStart);
+			uploaded += instances.getUploadedCount();
+			renderer.endRecording();
+			renderer.present(window.getWindow());
+			window.pollEvents();
+			renderer.advanceFrame();
+		}
+		if (frameCount == 0)
+			break;
+
+		gBenchLogger.info("{} of {} roots moving ({} nodes, {} levels): {} updated/frame in {:.3f} ms, {} uploaded/frame in {:.3f} ms, {} draw",
+			moving, rootCount, nodeCount, scene.getLevelCount(), updated / frameCount, propagateMs / frameCount, uploaded / frameCount,
+			uploadMs / frameCount, instances.getDrawCount());
+	}
+
+	renderer.getDeviceTable().DeviceWaitIdle(renderer.getDevice());
+	instances.cleanup();
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+#include "window.hpp"
+#include "renderer.hpp"
+#include <string>
+
+namespace ke
+{
+	namespace bench
+	{
+		// Runs the named benchmark in place of the main loop. Returns false for unknown names.
+		bool run(const std::string& name, Window& window, Renderer& renderer);
+
+		void runInstancing(Window& window, Renderer& renderer, uint32_t instanceCount, uint32_t frames);
+		// Compares command recording through the loader trampolines against the renderer's device dispatch table.
+		void runDispatch(Renderer& renderer, uint32_t commandCount, uint32_t rounds);
+		// Sweeps GPU particle counts and reports simulation and render time from timestamp queries.
+		void runParticles(Window& window, Renderer& renderer, uint32_t frames);
+		// Lights a ground plane with increasing numbers of clustered point and spot lights, then with point lights
+		// only through the shader variant that has the spot cone test specialized out.
+		void runLights(Window& window, Renderer& renderer, uint32_t frames);
+		// Draws a field of boxes behind a wall with Hi-Z occlusion culling off and on.
+		void runOcclusion(Window& window, Renderer& renderer, uint32_t frames);
+		// Renders a large field of simplified spheres at full detail and with screen-space-error LOD selection.
+		void runLod(Window& window, Renderer& renderer, uint32_t frames);
+		// Records a static field of per-instance draws every frame, then once into a cached background bundle.
+		void runStatic(Window& window, Renderer& renderer, uint32_t instanceCount, uint32_t frames);
+		// Streams a working set of buffers through a budget that only fits part of it and reports eviction behaviour.
+		void runBudget(Window& window, Renderer& renderer, uint32_t frames);
+		// Requests a descriptor set per object for a small set of materials, allocating each one and then through the per-frame cache.
+		void runDescriptors(Window& window, Renderer& renderer, uint32_t objectCount, uint32_t frames);
+		// Draws the stats overlay over a minimal frame and reports its own CPU and GPU cost.
+		void runHud(Window& window, Renderer& renderer, uint32_t frames);
+		// Spins the roots of a large two-level hierarchy every frame, then only a few of them, and reports propagation and dirty upload cost.
+		void runScene(Window& window, Renderer& renderer, uint32_t rootCount, uint32_t childrenPerRoot, uint32_t frames);
+		// Chains compute passes over transients with disjoint lifetimes so they alias one block, and reports the graph's memory and barriers.
+		void runGraph(Window& window, Renderer& renderer, uint32_t frames);
+		// Adds and removes meshes of random size in the shared geometry buffer every frame and reports fragmentation around a defragmentation.
+		void runGeometry(Window& window, Renderer& renderer, uint32_t frames);
+	}
+}
\ No newline at end of file
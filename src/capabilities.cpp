@@ -0,0 +1,219 @@
+#include "capabilities.hpp"
+#include <algorithm>
+#include <cstring>
+
+static bool hasExtension(const std::vector<VkExtensionProperties>& extensions, const char* name)
+{
+	return std::any_of(extensions.begin(), extensions.end(), [name](const VkExtensionProperties& e) { return strcmp(e.extensionName, name) == 0; });
+}
+
+bool ke::DeviceCapabilities::hasSubgroupOperations(VkSubgroupFeatureFlags operations, VkShaderStageFlags stage) const
+{
+	return (subgroupOperations & operations) == operations && (subgroupStages & stage) == stage;
+}
+
+ke::DeviceCapabilities ke::probeDeviceCapabilities(const VkuInstanceDispatchTable& vki, VkPhysicalDevice device)
+{
+	DeviceCapabilities caps;
+
+	uint32_t extensionCount = 0;
+	vki.EnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> extensions(extensionCount);
+	vki.EnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+
+	VkPhysicalDeviceProperties properties{};
+	vki.GetPhysicalDeviceProperties(device, &properties);
+	caps.apiVersion = properties.apiVersion;
+	caps.vendorID = properties.vendorID;
+	caps.deviceType = properties.deviceType;
+	caps.deviceName = properties.deviceName;
+	caps.timestampComputeAndGraphics = properties.limits.timestampComputeAndGraphics;
+	caps.timestampPeriod = properties.limits.timestampPeriod;
+	caps.maxSamplerAnisotropy = properties.limits.maxSamplerAnisotropy;
+	caps.maxDrawIndirectCount = properties.limits.maxDrawIndirectCount;
+	caps.maxComputeWorkGroupInvocations = properties.limits.maxComputeWorkGroupInvocations;
+	caps.maxComputeSharedMemorySize = properties.limits.maxComputeSharedMemorySize;
+
+	bool version11 = properties.apiVersion >= VK_API_VERSION_1_1;
+	bool version12 = properties.apiVersion >= VK_API_VERSION_1_2;
+	bool version13 = properties.apiVersion >= VK_API_VERSION_1_3;
+
+	// Vulkan 1.0 devices only report the core feature set.
+	if (!version11)
+	{
+		VkPhysicalDeviceFeatures features{};
+		vki.GetPhysicalDeviceFeatures(device, &features);
+		caps.multiDrawIndirect = features.multiDrawIndirect;
+		caps.drawIndirectFirstInstance = features.drawIndirectFirstInstance;
+		caps.samplerAnisotropy = features.samplerAnisotropy;
+		caps.fillModeNonSolid = features.fillModeNonSolid;
+		return caps;
+	}
+
+	VkPhysicalDeviceSubgroupProperties subgroup{};
+	subgroup.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+	VkPhysicalDeviceProperties2 properties2{};
+	properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties2.pNext = &subgroup;
+	vki.GetPhysicalDeviceProperties2(device, &properties2);
+	caps.subgroupSize = subgroup.subgroupSize;
+	caps.subgroupStages = subgroup.supportedStages;
+	caps.subgroupOperations = subgroup.supportedOperations;
+	caps.memoryBudget = hasExtension(extensions, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+	DeviceFeatureChain query;
+	query.features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	void** next = &query.features2.pNext;
+	auto chain = [&next](auto& feature, VkStructureType type)
+		{
+			feature.sType = type;
+			*next = &feature;
+			next = &feature.pNext;
+		};
+
+	// VkPhysicalDeviceVulkan11Features only exists from 1.2 on.
+	if (version12)
+	{
+		chain(query.vulkan11, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES);
+		chain(query.vulkan12, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES);
+	}
+	else
+	{
+		chain(query.shaderDrawParameters, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_DRAW_PARAMETERS_FEATURES);
+		if (hasExtension(extensions, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+			chain(query.timelineSemaphore, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES);
+	}
+	if (version13)
+		chain(query.vulkan13, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES);
+	else
+	{
+		if (hasExtension(extensions, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME))
+			chain(query.synchronization2, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES);
+		// The extension's own dependencies are only core from 1.2 on.
+		if (version12 && hasExtension(extensions, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME))
+			chain(query.dynamicRendering, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES);
+	}
+	vki.GetPhysicalDeviceFeatures2(device, &query.features2);
+
+	const VkPhysicalDeviceFeatures& core = query.features2.features;
+	caps.multiDrawIndirect = core.multiDrawIndirect;
+	caps.drawIndirectFirstInstance = core.drawIndirectFirstInstance;
+	caps.samplerAnisotropy = core.samplerAnisotropy;
+	caps.fillModeNonSolid = core.fillModeNonSolid;
+	caps.shaderDrawParameters = version12 ? query.vulkan11.shaderDrawParameters : query.shaderDrawParameters.shaderDrawParameters;
+
+	if (version12)
+	{
+		const VkPhysicalDeviceVulkan12Features& v12 = query.vulkan12;
+		caps.timelineSemaphore = v12.timelineSemaphore;
+		caps.drawIndirectCount = v12.drawIndirectCount;
+		caps.bufferDeviceAddress = v12.bufferDeviceAddress;
+		caps.hostQueryReset = v12.hostQueryReset;
+		caps.descriptorIndexing = v12.runtimeDescriptorArray && v12.descriptorBindingPartiallyBound &&
+			v12.descriptorBindingVariableDescriptorCount && v12.shaderSampledImageArrayNonUniformIndexing;
+	}
+	else
+	{
+		caps.timelineSemaphore = query.timelineSemaphore.timelineSemaphore;
+		caps.drawIndirectCountExtension = hasExtension(extensions, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+		caps.drawIndirectCount = caps.drawIndirectCountExtension;
+	}
+
+	if (version13)
+	{
+		caps.synchronization2 = query.vulkan13.synchronization2;
+		caps.dynamicRendering = query.vulkan13.dynamicRendering;
+	}
+	else
+	{
+		caps.synchronization2Extension = query.synchronization2.synchronization2;
+		caps.dynamicRenderingExtension = query.dynamicRendering.dynamicRendering;
+		caps.synchronization2 = caps.synchronization2Extension;
+		caps.dynamicRendering = caps.dynamicRenderingExtension;
+	}
+
+	return caps;
+}
+
+void ke::buildFeatureChain(const DeviceCapabilities& caps, DeviceFeatureChain& chain)
+{
+	chain.features2 = {};
+	chain.features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	chain.features2.features.multiDrawIndirect = caps.multiDrawIndirect;
+	chain.features2.features.drawIndirectFirstInstance = caps.drawIndirectFirstInstance;
+	chain.features2.features.samplerAnisotropy = caps.samplerAnisotropy;
+	chain.features2.features.fillModeNonSolid = caps.fillModeNonSolid;
+
+	if (caps.apiVersion < VK_API_VERSION_1_1)
+		return;
+
+	void** next = &chain.features2.pNext;
+	auto link = [&next](auto& feature, VkStructureType type)
+		{
+			feature.sType = type;
+			*next = &feature;
+			next = &feature.pNext;
+		};
+
+	if (caps.memoryBudget)
+		chain.extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+	if (caps.apiVersion >= VK_API_VERSION_1_2)
+	{
+		chain.vulkan11 = {};
+		chain.vulkan11.shaderDrawParameters = caps.shaderDrawParameters;
+		link(chain.vulkan11, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES);
+
+		chain.vulkan12 = {};
+		chain.vulkan12.timelineSemaphore = caps.timelineSemaphore;
+		chain.vulkan12.drawIndirectCount = caps.drawIndirectCount;
+		chain.vulkan12.bufferDeviceAddress = caps.bufferDeviceAddress;
+		chain.vulkan12.hostQueryReset = caps.hostQueryReset;
+		chain.vulkan12.runtimeDescriptorArray = caps.descriptorIndexing;
+		chain.vulkan12.descriptorBindingPartiallyBound = caps.descriptorIndexing;
+		chain.vulkan12.descriptorBindingVariableDescriptorCount = caps.descriptorIndexing;
+		chain.vulkan12.shaderSampledImageArrayNonUniformIndexing = caps.descriptorIndexing;
+		link(chain.vulkan12, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES);
+	}
+	else
+	{
+		chain.shaderDrawParameters = {};
+		chain.shaderDrawParameters.shaderDrawParameters = caps.shaderDrawParameters;
+		link(chain.shaderDrawParameters, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_DRAW_PARAMETERS_FEATURES);
+
+		if (caps.timelineSemaphore)
+		{
+			chain.timelineSemaphore = {};
+			chain.timelineSemaphore.timelineSemaphore = VK_TRUE;
+			link(chain.timelineSemaphore, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES);
+			chain.extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+		}
+		if (caps.drawIndirectCountExtension)
+			chain.extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+	}
+
+	if (caps.apiVersion >= VK_API_VERSION_1_3)
+	{
+		chain.vulkan13 = {};
+		chain.vulkan13.synchronization2 = caps.synchronization2;
+		chain.vulkan13.dynamicRendering = caps.dynamicRendering;
+		link(chain.vulkan13, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES);
+	}
+	else
+	{
+		if (caps.synchronization2Extension)
+		{
+			chain.synchronization2 = {};
+			chain.synchronization2.synchronization2 = VK_TRUE;
+			link(chain.synchronization2, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES);
+			chain.extensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+		}
+		if (caps.dynamicRenderingExtension)
+		{
+			chain.dynamicRendering = {};
+			chain.dynamicRendering.dynamicRendering = VK_TRUE;
+			link(chain.dynamicRendering, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES);
+			chain.extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+		}
+	}
+}
\ No newline at end of file
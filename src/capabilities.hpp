@@ -0,0 +1,72 @@
+#pragma once
+#include "vk.hpp"
+#include <string>
+#include <vector>
+
+namespace ke
+{
+	// What the chosen device supports and the renderer enabled. Subsystems branch on these to pick their fastest path.
+	struct DeviceCapabilities
+	{
+		uint32_t apiVersion = 0;
+		uint32_t vendorID = 0;
+		VkPhysicalDeviceType deviceType = VK_PHYSICAL_DEVICE_TYPE_OTHER;
+		std::string deviceName;
+
+		bool timelineSemaphore = false;
+		bool synchronization2 = false;
+		bool dynamicRendering = false;
+		bool descriptorIndexing = false;
+		bool bufferDeviceAddress = false;
+		bool hostQueryReset = false;
+		bool drawIndirectCount = false;
+		bool multiDrawIndirect = false;
+		bool drawIndirectFirstInstance = false;
+		bool shaderDrawParameters = false;
+		bool samplerAnisotropy = false;
+		bool fillModeNonSolid = false;
+		// VK_EXT_memory_budget, for per-heap budget and usage queries.
+		bool memoryBudget = false;
+
+		uint32_t subgroupSize = 1;
+		VkShaderStageFlags subgroupStages = 0;
+		VkSubgroupFeatureFlags subgroupOperations = 0;
+
+		bool timestampComputeAndGraphics = false;
+		float timestampPeriod = 1.0f;
+		float maxSamplerAnisotropy = 1.0f;
+		uint32_t maxDrawIndirectCount = 1;
+		uint32_t maxComputeWorkGroupInvocations = 0;
+		uint32_t maxComputeSharedMemorySize = 0;
+
+		// Features that are only available through extensions on this device's API version.
+		bool synchronization2Extension = false;
+		bool dynamicRenderingExtension = false;
+		bool drawIndirectCountExtension = false;
+
+		bool hasSubgroupOperations(VkSubgroupFeatureFlags operations, VkShaderStageFlags stage) const;
+	};
+
+	// Feature structs passed to vkCreateDevice. Holds pointers into itself, so it must stay where it was built.
+	struct DeviceFeatureChain
+	{
+		VkPhysicalDeviceFeatures2 features2{};
+		VkPhysicalDeviceVulkan11Features vulkan11{};
+		// Vulkan 1.1 has no aggregate feature struct, so its features are queried one by one.
+		VkPhysicalDeviceShaderDrawParametersFeatures shaderDrawParameters{};
+		VkPhysicalDeviceVulkan12Features vulkan12{};
+		VkPhysicalDeviceVulkan13Features vulkan13{};
+		VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphore{};
+		VkPhysicalDeviceSynchronization2Features synchronization2{};
+		VkPhysicalDeviceDynamicRenderingFeatures dynamicRendering{};
+		std::vector<const char*> extensions;
+
+		DeviceFeatureChain() = default;
+		DeviceFeatureChain(const DeviceFeatureChain&) = delete;
+		DeviceFeatureChain& operator=(const DeviceFeatureChain&) = delete;
+	};
+
+	DeviceCapabilities probeDeviceCapabilities(const VkuInstanceDispatchTable& vki, VkPhysicalDevice device);
+	// Enables every probed capability and adds the extensions they need to chain.extensions.
+	void buildFeatureChain(const DeviceCapabilities& capabilities, DeviceFeatureChain& chain);
+}
\ No newline at end of file
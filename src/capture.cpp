@@ -0,0 +1,798 @@
+#include "capture.hpp"
+#include "renderer.hpp"
+#include "profiler.hpp"
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+// "KECP" read as a little-endian integer.
+static constexpr uint32_t gCaptureMagic = 0x5043454B;
+static constexpr uint32_t gCaptureVersion = 2;
+
+struct CaptureHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t frameCount;
+};
+
+template<typename T>
+static void put(std::vector<uint8_t>& out, const T& value)
+{
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+	out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+static void putBytes(std::vector<uint8_t>& out, const void* data, size_t size)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	out.insert(out.end(), bytes, bytes + size);
+}
+
+static void putString(std::vector<uint8_t>& out, const char* text)
+{
+	uint32_t length = text ? static_cast<uint32_t>(std::strlen(text)) : 0;
+	put(out, length);
+	putBytes(out, text, length);
+}
+
+bool ke::CommandCapture::open(const std::string& path, uint32_t frameCount)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mActive || frameCount == 0)
+	{
+		if (enableLogging)
+			mLogger.error("A capture is already running or no frames were requested.");
+		return false;
+	}
+
+	// Fail now rather than after the frames have been recorded.
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		if (enableLogging)
+			mLogger.error("Failed to open capture file {}.", path);
+		return false;
+	}
+
+	mPath = path;
+	mFramesLeft = frameCount;
+	mFrameCount = 0;
+	mSkippedCommands = 0;
+	mActive = true;
+	if (enableLogging)
+		mLogger.info("Capturing {} frames to {}.", frameCount, path);
+	return true;
+}
+
+void ke::CommandCapture::finish()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mActive)
+		writeFile();
+}
+
+bool ke::CommandCapture::isActive() const
+{
+	return mActive;
+}
+
+void ke::CommandCapture::recordCreateBuffer(const Buffer& buffer, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+{
+	if (!mActive)
+		return;
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	TrackedBuffer tracked;
+	tracked.id = mNextBuffer++;
+	tracked.size = buffer.size;
+	tracked.mapped = buffer.mapped;
+
+	put(mStream, CaptureOp::CreateBuffer);
+	put(mStream, tracked.id);
+	put(mStream, buffer.size);
+	put(mStream, usage);
+	put(mStream, properties);
+	mBuffers[buffer.buffer] = std::move(tracked);
+}
+
+void ke::CommandCapture::recordDestroyBuffer(const Buffer& buffer)
+{
+	if (!mActive)
+		return;
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	auto it = mBuffers.find(buffer.buffer);
+	if (it == mBuffers.end())
+		return;
+	put(mStream, CaptureOp::DestroyBuffer);
+	put(mStream, it->second.id);
+	mBuffers.erase(it);
+}
+
+void ke::CommandCapture::recordWrite(const Buffer& buffer, VkDeviceSize offset, VkDeviceSize size, const void* data)
+{
+	if (!mActive)
+		return;
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	// Mapped buffers are picked up by the end-of-frame diff, which also sees later writes through the pointer.
+	auto it = mBuffers.find(buffer.buffer);
+	if (it == mBuffers.end() || it->second.mapped)
+		return;
+
+	std::vector<uint8_t>& out = mFrameActive ? mFrameCommands : mStream;
+	put(out, CaptureOp::WriteBuffer);
+	put(out, it->second.id);
+	put(out, offset);
+	put(out, size);
+	putBytes(out, data, static_cast<size_t>(size));
+}
+
+void ke::CommandCapture::recordPipelineLayout(VkPipelineLayout layout, const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstants)
+{
+	if (!mActive)
+		return;
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	// Descriptor sets are outside the captured stream, so nothing built on such a layout can be replayed.
+	if (!setLayouts.empty())
+	{
+		mLayouts.erase(layout);
+		return;
+	}
+
+	uint32_t id = mNextLayout++;
+	put(mStream, CaptureOp::CreatePipelineLayout);
+	put(mStream, id);
+	put(mStream, static_cast<uint32_t>(pushConstants.size()));
+	for (const auto& range : pushConstants)
+		put(mStream, range);
+	mLayouts[layout] = id;
+}
+
+void ke::CommandCapture::recordPipeline(VkPipeline pipeline, const GraphicsPipelineDesc& desc)
+{
+	if (!mActive)
+		return;
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	// Only main pass pipelines are replayable; the render passes of other systems are not part of the capture.
+	auto layout = mLayouts.find(desc.layout);
+	if (layout == mLayouts.end() || desc.renderPass != VK_NULL_HANDLE)
+	{
+		mPipelines.erase(pipeline);
+		return;
+	}
+
+	uint32_t id = mNextPipeline++;
+	put(mStream, CaptureOp::CreatePipeline);
+	put(mStream, id);
+	put(mStream, layout->second);
+	putString(mStream, desc.vertexShader);
+	putString(mStream, desc.fragmentShader);
+	put(mStream, static_cast<uint32_t>(desc.bindings.size()));
+	for (const auto& binding : desc.bindings)
+		put(mStream, binding);
+	put(mStream, static_cast<uint32_t>(desc.attributes.size()));
+	for (const auto& attribute : desc.attributes)
+		put(mStream, attribute);
+	put(mStream, desc.topology);
+	// 1 is additive and 2 alpha blending, so older captures still read back.
+	put(mStream, static_cast<uint8_t>(desc.additiveBlend ? 1 : desc.alphaBlend ? 2 : 0));
+	put(mStream, static_cast<uint8_t>(desc.depthTest));
+	put(mStream, static_cast<uint8_t>(desc.depthWrite));
+	put(mStream, static_cast<uint32_t>(desc.specialization.entries.size()));
+	for (size_t i = 0; i < desc.specialization.entries.size(); i++)
+	{
+		put(mStream, desc.specialization.entries[i]);
+		put(mStream, desc.specialization.data[i]);
+	}
+	mPipelines[pipeline] = id;
+}
+
+void ke::CommandCapture::beginFrame(VkCommandBuffer cmd, VkExtent2D extent)
+{
+	if (!mActive)
+		return;
+	std::lock_guard<std::mutex> lock(mMutex);
+	mFrameCmd = cmd;
+	mFrameActive = true;
+	mSkipping = false;
+	mExtent = extent;
+	mFrameCommands.clear();
+}
+
+void ke::CommandCapture::endFrame()
+{
+	if (!mActive)
+		return;
+	KE_PROFILE_FUNCTION();
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!mFrameActive)
+		return;
+	mFrameActive = false;
+
+	// Host writes of this frame go ahead of its commands, which is when the GPU would have seen them.
+	put(mStream, CaptureOp::BeginFrame);
+	put(mStream, mExtent.width);
+	put(mStream, mExtent.height);
+	diffBuffers();
+	putBytes(mStream, mFrameCommands.data(), mFrameCommands.size());
+	put(mStream, CaptureOp::EndFrame);
+
+	mFrameCount++;
+	if (--mFramesLeft == 0)
+		writeFile();
+}
+
+void ke::CommandCapture::diffBuffers()
+{
+	for (auto& [handle, buffer] : mBuffers)
+	{
+		if (!buffer.mapped)
+			continue;
+
+		const uint8_t* current = static_cast<const uint8_t*>(buffer.mapped);
+		size_t size = static_cast<size_t>(buffer.size);
+		size_t first = 0;
+		size_t last = size;
+		if (buffer.shadow.empty())
+			buffer.shadow.resize(size);
+		else
+		{
+			while (first < size && current[first] == buffer.shadow[first])
+				first++;
+			if (first == size)
+				continue;
+			while (last > first && current[last - 1] == buffer.shadow[last - 1])
+				last--;
+		}
+
+		put(mStream, CaptureOp::WriteBuffer);
+		put(mStream, buffer.id);
+		put(mStream, static_cast<VkDeviceSize>(first));
+		put(mStream, static_cast<VkDeviceSize>(last - first));
+		putBytes(mStream, current + first, last - first);
+		std::memcpy(buffer.shadow.data() + first, current + first, last - first);
+	}
+}
+
+void ke::CommandCapture::writeFile()
+{
+	mActive = false;
+	mFrameActive = false;
+
+	CaptureHeader header{ gCaptureMagic, gCaptureVersion, mExtent.width, mExtent.height, mFrameCount };
+	std::ofstream file(mPath, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(mStream.data()), static_cast<std::streamsize>(mStream.size()));
+
+	if (!file.good() && enableLogging)
+		mLogger.error("Failed to write capture file {}.", mPath);
+	else if (enableLogging)
+		mLogger.info("Wrote {} captured frames ({} KiB) to {}.", mFrameCount, (mStream.size() + sizeof(header)) / 1024, mPath);
+	if (mSkippedCommands > 0 && enableLogging)
+		mLogger.warn("Dropped {} commands that used objects created outside the renderer.", mSkippedCommands);
+
+	std::vector<uint8_t>().swap(mStream);
+	std::vector<uint8_t>().swap(mFrameCommands);
+	mBuffers.clear();
+	mLayouts.clear();
+	mPipelines.clear();
+}
+
+// Callers hold mMutex, since beginFrame and endFrame may run on another thread.
+bool ke::CommandCapture::recording(VkCommandBuffer cmd) const
+{
+	return mActive && mFrameActive && cmd == mFrameCmd;
+}
+
+void ke::CommandCapture::recordBindPipeline(VkCommandBuffer cmd, VkPipeline pipeline)
+{
+	if (!mActive)
+		return;
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!recording(cmd))
+		return;
+
+	auto it = mPipelines.find(pipeline);
+	mSkipping = it == mPipelines.end();
+	if (mSkipping)
+	{
+		mSkippedCommands++;
+		return;
+	}
+	put(mFrameCommands, CaptureOp::BindPipeline);
+	put(mFrameCommands, it->second);
+}
+
+void ke::CommandCapture::recordBindVertexBuffers(VkCommandBuffer cmd, uint32_t firstBinding, uint32_t count, const VkBuffer* buffers, const VkDeviceSize* offsets)
+{
+	if (!mActive)
+		return;
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!recording(cmd))
+		return;
+	if (mSkipping)
+	{
+		mSkippedCommands++;
+		return;
+	}
+
+	size_t begin = mFrameCommands.size();
+	put(mFrameCommands, CaptureOp::BindVertexBuffers);
+	put(mFrameCommands, firstBinding);
+	put(mFrameCommands, count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		auto it = mBuffers.find(buffers[i]);
+		if (it == mBuffers.end())
+		{
+			mFrameCommands.resize(begin);
+			mSkipping = true;
+			mSkippedCommands++;
+			return;
+		}
+		put(mFrameCommands, it->second.id);
+		put(mFrameCommands, offsets[i]);
+	}
+}
+
+void ke::CommandCapture::recordBindIndexBuffer(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset, VkIndexType type)
+{
+	if (!mActive)
+		return;
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!recording(cmd))
+		return;
+	if (mSkipping)
+	{
+		mSkippedCommands++;
+		return;
+	}
+
+	auto it = mBuffers.find(buffer);
+	if (it == mBuffers.end())
+	{
+		mSkipping = true;
+		mSkippedCommands++;
+		return;
+	}
+	put(mFrameCommands, CaptureOp::BindIndexBuffer);
+	put(mFrameCommands, it->second.id);
+	put(mFrameCommands, offset);
+	put(mFrameCommands, type);
+}
+
+void ke::CommandCapture::recordPushConstants(VkCommandBuffer cmd, VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void* data)
+{
+	if (!mActive)
+		return;
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!recording(cmd))
+		return;
+	if (mSkipping)
+	{
+		mSkippedCommands++;
+		return;
+	}
+
+	auto it = mLayouts.find(layout);
+	if (it == mLayouts.end())
+	{
+		mSkipping = true;
+		mSkippedCommands++;
+		return;
+	}
+	put(mFrameCommands, CaptureOp::PushConstants);
+	put(mFrameCommands, it->second);
+	put(mFrameCommands, stages);
+	put(mFrameCommands, offset);
+	put(mFrameCommands, size);
+	putBytes(mFrameCommands, data, size);
+}
+
+void ke::CommandCapture::recordDraw(VkCommandBuffer cmd, uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance)
+{
+	if (!mActive)
+		return;
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!recording(cmd))
+		return;
+	if (mSkipping)
+	{
+		mSkippedCommands++;
+		return;
+	}
+
+	put(mFrameCommands, CaptureOp::Draw);
+	put(mFrameCommands, vertexCount);
+	put(mFrameCommands, instanceCount);
+	put(mFrameCommands, firstVertex);
+	put(mFrameCommands, firstInstance);
+}
+
+void ke::CommandCapture::recordDrawIndexed(VkCommandBuffer cmd, uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance)
+{
+	if (!mActive)
+		return;
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!recording(cmd))
+		return;
+	if (mSkipping)
+	{
+		mSkippedCommands++;
+		return;
+	}
+
+	put(mFrameCommands, CaptureOp::DrawIndexed);
+	put(mFrameCommands, indexCount);
+	put(mFrameCommands, instanceCount);
+	put(mFrameCommands, firstIndex);
+	put(mFrameCommands, vertexOffset);
+	put(mFrameCommands, firstInstance);
+}
+
+struct ke::CaptureReplay::Reader
+{
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+	size_t offset = 0;
+	bool overrun = false;
+
+	const uint8_t* bytes(size_t count)
+	{
+		if (count > size - offset)
+		{
+			overrun = true;
+			offset = size;
+			return nullptr;
+		}
+		const uint8_t* result = data + offset;
+		offset += count;
+		return result;
+	}
+
+	template<typename T>
+	T get()
+	{
+		T value{};
+		if (const uint8_t* source = bytes(sizeof(T)))
+			std::memcpy(&value, source, sizeof(T));
+		return value;
+	}
+
+	std::string string()
+	{
+		uint32_t length = get<uint32_t>();
+		const uint8_t* text = bytes(length);
+		return text ? std::string(reinterpret_cast<const char*>(text), length) : std::string();
+	}
+
+	bool done() const
+	{
+		return offset >= size;
+	}
+};
+
+bool ke::CaptureReplay::load(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		mLogger.error("Failed to open capture file {}.", path);
+		return false;
+	}
+
+	mData.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(mData.data()), static_cast<std::streamsize>(mData.size()));
+
+	CaptureHeader header{};
+	if (mData.size() >= sizeof(header))
+		std::memcpy(&header, mData.data(), sizeof(header));
+	if (header.magic != gCaptureMagic || header.version != gCaptureVersion)
+	{
+		mLogger.error("{} is not a version {} capture.", path, gCaptureVersion);
+		mData.clear();
+		return false;
+	}
+
+	mExtent = { header.width, header.height };
+	mFrameCount = header.frameCount;
+	if (enableLogging)
+		mLogger.info("Loaded capture {} with {} frames at {}x{}.", path, mFrameCount, mExtent.width, mExtent.height);
+	return true;
+}
+
+VkExtent2D ke::CaptureReplay::getExtent() const
+{
+	return mExtent;
+}
+
+uint32_t ke::CaptureReplay::getFrameCount() const
+{
+	return mFrameCount;
+}
+
+ke::ReplayResult ke::CaptureReplay::run(Renderer& renderer, uint32_t loops)
+{
+	using Clock = std::chrono::steady_clock;
+	ReplayResult result;
+	Reader reader{ mData.data(), mData.size(), sizeof(CaptureHeader) };
+	// Objects created ahead of the first frame are set up once and shared by every loop.
+	size_t framesBegin = 0;
+	VkCommandBuffer cmd = VK_NULL_HANDLE;
+	Clock::time_point frameStart;
+	bool failed = mData.empty();
+
+	for (uint32_t loop = 0; loop < loops && !failed; loop++)
+	{
+		if (loop > 0)
+		{
+			if (framesBegin == 0)
+				break;
+			// Frame counts that are not a multiple of the frames in flight would otherwise overwrite buffers still in use.
+			renderer.getDeviceTable().DeviceWaitIdle(renderer.getDevice());
+			reader.offset = framesBegin;
+		}
+
+		while (!reader.done())
+		{
+			CaptureOp op = reader.get<CaptureOp>();
+			if (op == CaptureOp::BeginFrame)
+			{
+				if (framesBegin == 0)
+					framesBegin = reader.offset - sizeof(CaptureOp);
+				reader.get<uint32_t>();
+				reader.get<uint32_t>();
+				frameStart = Clock::now();
+				renderer.beginRecording(nullptr, false);
+				cmd = renderer.getCommandBuffer();
+			}
+			else if (op == CaptureOp::EndFrame && cmd != VK_NULL_HANDLE)
+			{
+				renderer.endRecording();
+				renderer.present(nullptr);
+				renderer.advanceFrame();
+				cmd = VK_NULL_HANDLE;
+
+				double frameMs = std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count();
+				result.minFrameMs = result.frames == 0 ? frameMs : std::min(result.minFrameMs, frameMs);
+				result.maxFrameMs = std::max(result.maxFrameMs, frameMs);
+				result.totalMs += frameMs;
+				result.frames++;
+			}
+			else
+				execute(renderer, reader, op, cmd);
+
+			if (reader.overrun)
+			{
+				mLogger.error("Capture is truncated or corrupt at byte {}.", reader.offset);
+				failed = true;
+				break;
+			}
+		}
+	}
+
+	// Close a frame the capture left open so the renderer stays consistent.
+	if (cmd != VK_NULL_HANDLE)
+	{
+		renderer.endRecording();
+		renderer.present(nullptr);
+		renderer.advanceFrame();
+	}
+	renderer.getDeviceTable().DeviceWaitIdle(renderer.getDevice());
+	destroyObjects(renderer);
+	return result;
+}
+
+void ke::CaptureReplay::execute(Renderer& renderer, Reader& reader, CaptureOp op, VkCommandBuffer cmd)
+{
+	const VkuDeviceDispatchTable& vkd = renderer.getDeviceTable();
+	VkDevice device = renderer.getDevice();
+	auto buffer = [this](uint32_t id) -> Buffer* { return id < mBuffers.size() && mBuffers[id].buffer != VK_NULL_HANDLE ? &mBuffers[id] : nullptr; };
+	auto layout = [this](uint32_t id) -> VkPipelineLayout { return id < mLayouts.size() ? mLayouts[id] : VK_NULL_HANDLE; };
+	auto pipeline = [this](uint32_t id) -> VkPipeline { return id < mPipelines.size() ? mPipelines[id] : VK_NULL_HANDLE; };
+
+	// Commands outside a frame, or on objects the stream never created, mean the file is damaged.
+	bool isCommand = op >= CaptureOp::BindPipeline && op <= CaptureOp::DrawIndexed;
+	if (isCommand && cmd == VK_NULL_HANDLE)
+	{
+		reader.overrun = true;
+		return;
+	}
+
+	switch (op)
+	{
+	case CaptureOp::CreateBuffer:
+	{
+		uint32_t id = reader.get<uint32_t>();
+		VkDeviceSize size = reader.get<VkDeviceSize>();
+		VkBufferUsageFlags usage = reader.get<VkBufferUsageFlags>();
+		VkMemoryPropertyFlags properties = reader.get<VkMemoryPropertyFlags>();
+		if (reader.overrun || id > mData.size())
+			break;
+		if (id >= mBuffers.size())
+			mBuffers.resize(id + 1);
+		// Loops recreate buffers that were created mid-capture.
+		if (mBuffers[id].buffer != VK_NULL_HANDLE)
+		{
+			vkd.DeviceWaitIdle(device);
+			renderer.destroyBuffer(mBuffers[id]);
+		}
+		// Device-local contents arrive through uploads, which need a transfer destination.
+		mBuffers[id] = renderer.createBuffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, properties);
+		break;
+	}
+	case CaptureOp::DestroyBuffer:
+		if (Buffer* target = buffer(reader.get<uint32_t>()))
+		{
+			vkd.DeviceWaitIdle(device);
+			renderer.destroyBuffer(*target);
+		}
+		break;
+	case CaptureOp::WriteBuffer:
+	{
+		Buffer* target = buffer(reader.get<uint32_t>());
+		VkDeviceSize offset = reader.get<VkDeviceSize>();
+		VkDeviceSize size = reader.get<VkDeviceSize>();
+		const uint8_t* data = reader.bytes(static_cast<size_t>(size));
+		if (target && data && offset + size <= target->size)
+			renderer.uploadBuffer(*target, data, size, offset);
+		break;
+	}
+	case CaptureOp::CreatePipelineLayout:
+	{
+		uint32_t id = reader.get<uint32_t>();
+		uint32_t count = reader.get<uint32_t>();
+		std::vector<VkPushConstantRange> ranges;
+		for (uint32_t i = 0; i < count && !reader.overrun; i++)
+			ranges.push_back(reader.get<VkPushConstantRange>());
+		if (reader.overrun || id > mData.size())
+			break;
+		if (id >= mLayouts.size())
+			mLayouts.resize(id + 1, VK_NULL_HANDLE);
+		if (mLayouts[id] != VK_NULL_HANDLE)
+		{
+			vkd.DeviceWaitIdle(device);
+			vkd.DestroyPipelineLayout(device, mLayouts[id], renderer.getAllocationCallbacks());
+		}
+		mLayouts[id] = renderer.createPipelineLayout({}, ranges);
+		break;
+	}
+	case CaptureOp::CreatePipeline:
+	{
+		uint32_t id = reader.get<uint32_t>();
+		uint32_t layoutId = reader.get<uint32_t>();
+		std::string vertexShader = reader.string();
+		std::string fragmentShader = reader.string();
+
+		GraphicsPipelineDesc desc{};
+		uint32_t bindingCount = reader.get<uint32_t>();
+		for (uint32_t i = 0; i < bindingCount && !reader.overrun; i++)
+			desc.bindings.push_back(reader.get<VkVertexInputBindingDescription>());
+		uint32_t attributeCount = reader.get<uint32_t>();
+		for (uint32_t i = 0; i < attributeCount && !reader.overrun; i++)
+			desc.attributes.push_back(reader.get<VkVertexInputAttributeDescription>());
+		desc.topology = reader.get<VkPrimitiveTopology>();
+		uint8_t blend = reader.get<uint8_t>();
+		desc.additiveBlend = blend == 1;
+		desc.alphaBlend = blend == 2;
+		desc.depthTest = reader.get<uint8_t>() != 0;
+		desc.depthWrite = reader.get<uint8_t>() != 0;
+		uint32_t constantCount = reader.get<uint32_t>();
+		for (uint32_t i = 0; i < constantCount && !reader.overrun; i++)
+		{
+			desc.specialization.entries.push_back(reader.get<VkSpecializationMapEntry>());
+			desc.specialization.data.push_back(reader.get<uint32_t>());
+		}
+		desc.vertexShader = vertexShader.c_str();
+		desc.fragmentShader = fragmentShader.empty() ? nullptr : fragmentShader.c_str();
+		desc.layout = layout(layoutId);
+		if (reader.overrun || id > mData.size() || desc.layout == VK_NULL_HANDLE)
+			break;
+
+		if (id >= mPipelines.size())
+			mPipelines.resize(id + 1, VK_NULL_HANDLE);
+		if (mPipelines[id] != VK_NULL_HANDLE)
+		{
+			vkd.DeviceWaitIdle(device);
+			vkd.DestroyPipeline(device, mPipelines[id], renderer.getAllocationCallbacks());
+		}
+		mPipelines[id] = renderer.buildGraphicsPipeline(desc);
+		break;
+	}
+	case CaptureOp::BindPipeline:
+		if (VkPipeline target = pipeline(reader.get<uint32_t>()))
+			renderer.bindPipeline(cmd, target);
+		break;
+	case CaptureOp::BindVertexBuffers:
+	{
+		uint32_t firstBinding = reader.get<uint32_t>();
+		uint32_t count = reader.get<uint32_t>();
+		std::vector<VkBuffer> buffers;
+		std::vector<VkDeviceSize> offsets;
+		for (uint32_t i = 0; i < count && !reader.overrun; i++)
+		{
+			Buffer* target = buffer(reader.get<uint32_t>());
+			buffers.push_back(target ? target->buffer : VK_NULL_HANDLE);
+			offsets.push_back(reader.get<VkDeviceSize>());
+		}
+		if (!reader.overrun && std::find(buffers.begin(), buffers.end(), VK_NULL_HANDLE) == buffers.end())
+			renderer.bindVertexBuffers(cmd, firstBinding, count, buffers.data(), offsets.data());
+		break;
+	}
+	case CaptureOp::BindIndexBuffer:
+	{
+		Buffer* target = buffer(reader.get<uint32_t>());
+		VkDeviceSize offset = reader.get<VkDeviceSize>();
+		VkIndexType type = reader.get<VkIndexType>();
+		if (target && !reader.overrun)
+			renderer.bindIndexBuffer(cmd, target->buffer, offset, type);
+		break;
+	}
+	case CaptureOp::PushConstants:
+	{
+		VkPipelineLayout target = layout(reader.get<uint32_t>());
+		VkShaderStageFlags stages = reader.get<VkShaderStageFlags>();
+		uint32_t offset = reader.get<uint32_t>();
+		uint32_t size = reader.get<uint32_t>();
+		const uint8_t* data = reader.bytes(size);
+		if (target != VK_NULL_HANDLE && data)
+			renderer.pushConstants(cmd, target, stages, offset, size, data);
+		break;
+	}
+	case CaptureOp::Draw:
+	{
+		uint32_t vertexCount = reader.get<uint32_t>();
+		uint32_t instanceCount = reader.get<uint32_t>();
+		uint32_t firstVertex = reader.get<uint32_t>();
+		uint32_t firstInstance = reader.get<uint32_t>();
+		if (!reader.overrun)
+			renderer.draw(cmd, vertexCount, instanceCount, firstVertex, firstInstance);
+		break;
+	}
+	case CaptureOp::DrawIndexed:
+	{
+		uint32_t indexCount = reader.get<uint32_t>();
+		uint32_t instanceCount = reader.get<uint32_t>();
+		uint32_t firstIndex = reader.get<uint32_t>();
+		int32_t vertexOffset = reader.get<int32_t>();
+		uint32_t firstInstance = reader.get<uint32_t>();
+		if (!reader.overrun)
+			renderer.drawIndexed(cmd, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+		break;
+	}
+	default:
+		reader.overrun = true;
+		break;
+	}
+}
+
+void ke::CaptureReplay::destroyObjects(Renderer& renderer)
+{
+	const VkuDeviceDispatchTable& vkd = renderer.getDeviceTable();
+	for (VkPipeline pipeline : mPipelines)
+		if (pipeline != VK_NULL_HANDLE)
+			vkd.DestroyPipeline(renderer.getDevice(), pipeline, renderer.getAllocationCallbacks());
+	for (VkPipelineLayout layout : mLayouts)
+		if (layout != VK_NULL_HANDLE)
+			vkd.DestroyPipelineLayout(renderer.getDevice(), layout, renderer.getAllocationCallbacks());
+	for (Buffer& buffer : mBuffers)
+		if (buffer.buffer != VK_NULL_HANDLE)
+			renderer.destroyBuffer(buffer);
+	mPipelines.clear();
+	mLayouts.clear();
+	mBuffers.clear();
+}
\ No newline at end of file
@@ -0,0 +1,133 @@
+#pragma once
+#include "vk.hpp"
+#include "logger.hpp"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+
+namespace ke
+{
+	class Renderer;
+	struct Buffer;
+	struct GraphicsPipelineDesc;
+
+	enum class CaptureOp : uint8_t
+	{
+		CreateBuffer = 1,
+		DestroyBuffer,
+		WriteBuffer,
+		CreatePipelineLayout,
+		CreatePipeline,
+		BeginFrame,
+		EndFrame,
+		BindPipeline,
+		BindVertexBuffers,
+		BindIndexBuffer,
+		PushConstants,
+		Draw,
+		DrawIndexed
+	};
+
+	// Serialises the renderer-level command stream: buffers and their contents, pipelines built through the
+	// renderer, and everything recorded through it inside the main pass. Objects the renderer never saw, such as
+	// descriptor sets or pipelines for other render passes, are left out along with the draws that depend on them.
+	class CommandCapture
+	{
+	public:
+		bool open(const std::string& path, uint32_t frameCount);
+		// Writes the file. Happens on its own after the last frame; call it to keep a capture that ended early.
+		void finish();
+		bool isActive() const;
+
+		void recordCreateBuffer(const Buffer& buffer, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+		void recordDestroyBuffer(const Buffer& buffer);
+		void recordWrite(const Buffer& buffer, VkDeviceSize offset, VkDeviceSize size, const void* data);
+		void recordPipelineLayout(VkPipelineLayout layout, const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstants);
+		void recordPipeline(VkPipeline pipeline, const GraphicsPipelineDesc& desc);
+
+		// Host-visible buffers are diffed against their last captured contents when the frame ends, so writes through
+		// mapped pointers need no extra calls.
+		void beginFrame(VkCommandBuffer cmd, VkExtent2D extent);
+		void endFrame();
+
+		void recordBindPipeline(VkCommandBuffer cmd, VkPipeline pipeline);
+		void recordBindVertexBuffers(VkCommandBuffer cmd, uint32_t firstBinding, uint32_t count, const VkBuffer* buffers, const VkDeviceSize* offsets);
+		void recordBindIndexBuffer(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset, VkIndexType type);
+		void recordPushConstants(VkCommandBuffer cmd, VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void* data);
+		void recordDraw(VkCommandBuffer cmd, uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance);
+		void recordDrawIndexed(VkCommandBuffer cmd, uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance);
+	private:
+		struct TrackedBuffer
+		{
+			uint32_t id = 0;
+			VkDeviceSize size = 0;
+			const void* mapped = nullptr;
+			std::vector<uint8_t> shadow;
+		};
+
+		bool recording(VkCommandBuffer cmd) const;
+		void diffBuffers();
+		void writeFile();
+	private:
+		std::atomic<bool> mActive = false;
+		std::mutex mMutex;
+		std::string mPath;
+		uint32_t mFramesLeft = 0;
+		uint32_t mFrameCount = 0;
+		VkExtent2D mExtent{};
+
+		std::vector<uint8_t> mStream;
+		std::vector<uint8_t> mFrameCommands;
+		VkCommandBuffer mFrameCmd = VK_NULL_HANDLE;
+		bool mFrameActive = false;
+		// Set after binding something the capture does not know; draws are dropped until the next known pipeline.
+		bool mSkipping = false;
+		uint64_t mSkippedCommands = 0;
+
+		uint32_t mNextBuffer = 1;
+		uint32_t mNextLayout = 1;
+		uint32_t mNextPipeline = 1;
+		std::unordered_map<VkBuffer, TrackedBuffer> mBuffers;
+		std::unordered_map<VkPipelineLayout, uint32_t> mLayouts;
+		std::unordered_map<VkPipeline, uint32_t> mPipelines;
+
+		ke::Logger mLogger = ke::Logger("Capture Logger", spdlog::level::debug);
+	};
+
+	struct ReplayResult
+	{
+		uint32_t frames = 0;
+		double totalMs = 0.0;
+		double minFrameMs = 0.0;
+		double maxFrameMs = 0.0;
+	};
+
+	// Re-executes a capture on a renderer. Frames are submitted back to back without waiting on a display.
+	class CaptureReplay
+	{
+	public:
+		bool load(const std::string& path);
+		VkExtent2D getExtent() const;
+		uint32_t getFrameCount() const;
+
+		ReplayResult run(Renderer& renderer, uint32_t loops = 1);
+	private:
+		struct Reader;
+
+		void execute(Renderer& renderer, Reader& reader, CaptureOp op, VkCommandBuffer cmd);
+		void destroyObjects(Renderer& renderer);
+	private:
+		std::vector<uint8_t> mData;
+		VkExtent2D mExtent{};
+		uint32_t mFrameCount = 0;
+
+		// Indexed by capture id, which starts at 1 for every object kind.
+		std::vector<Buffer> mBuffers;
+		std::vector<VkPipelineLayout> mLayouts;
+		std::vector<VkPipeline> mPipelines;
+
+		ke::Logger mLogger = ke::Logger("Replay Logger", spdlog::level::debug);
+	};
+}
\ No newline at end of file
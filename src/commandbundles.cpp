@@ -0,0 +1,263 @@
+#include "commandbundles.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+void ke::CommandBundleCache::init(VkDevice device, const VkuDeviceDispatchTable* vkd, const VkAllocationCallbacks* allocator, uint32_t queueFamily, uint32_t framesInFlight)
+{
+	mDevice = device;
+	mVkd = vkd;
+	mAllocator = allocator;
+	mFramesInFlight = framesInFlight;
+
+	VkCommandPoolCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	createInfo.queueFamilyIndex = queueFamily;
+
+	if (mVkd->CreateCommandPool(mDevice, &createInfo, mAllocator, &mPool) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create command bundle pool!");
+}
+
+void ke::CommandBundleCache::cleanup()
+{
+	for (uint32_t bundle = 0; bundle < mBundles.size(); bundle++)
+		if (mBundles[bundle].alive)
+			remove(bundle);
+	freeRetired(true);
+	mBundles.clear();
+	mFreeBundles.clear();
+	mBackground.clear();
+	mOverlay.clear();
+
+	mVkd->DestroyCommandPool(mDevice, mPool, mAllocator);
+	mPool = VK_NULL_HANDLE;
+}
+
+uint32_t ke::CommandBundleCache::add(BundleLayer layer, RecordFn record)
+{
+	uint32_t index;
+	if (!mFreeBundles.empty())
+	{
+		index = mFreeBundles.back();
+		mFreeBundles.pop_back();
+	}
+	else
+	{
+		index = static_cast<uint32_t>(mBundles.size());
+		mBundles.emplace_back();
+	}
+
+	Bundle& bundle = mBundles[index];
+	bundle.alive = true;
+	bundle.layer = layer;
+	bundle.record = std::move(record);
+	bundle.slots.assign(mFramesInFlight, Slot{});
+
+	std::vector<VkCommandBuffer> cmds(mFramesInFlight);
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = mPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+	allocInfo.commandBufferCount = mFramesInFlight;
+	if (mVkd->AllocateCommandBuffers(mDevice, &allocInfo, cmds.data()) != VK_SUCCESS)
+	{
+		if (enableLogging)
+			mLogger.error("Failed to allocate command bundle buffers!");
+		bundle.alive = false;
+		bundle.record = nullptr;
+		mFreeBundles.push_back(index);
+		return UINT32_MAX;
+	}
+	for (uint32_t slot = 0; slot < mFramesInFlight; slot++)
+		bundle.slots[slot].cmd = cmds[slot];
+
+	mBundleCount++;
+	return index;
+}
+
+void ke::CommandBundleCache::remove(uint32_t bundle)
+{
+	if (bundle >= mBundles.size() || !mBundles[bundle].alive)
+		return;
+
+	// Frames still in flight may execute the buffers, so they are freed once every slot has come around again.
+	Bundle& entry = mBundles[bundle];
+	Retired retired;
+	retired.retireFrame = mFrame;
+	for (const auto& slot : entry.slots)
+		retired.cmds.push_back(slot.cmd);
+	mRetired.push_back(std::move(retired));
+
+	entry.alive = false;
+	entry.record = nullptr;
+	entry.slots.clear();
+	mFreeBundles.push_back(bundle);
+	mBundleCount--;
+}
+
+void ke::CommandBundleCache::invalidate(uint32_t bundle)
+{
+	if (bundle < mBundles.size() && mBundles[bundle].alive)
+		mBundles[bundle].version++;
+}
+
+void ke::CommandBundleCache::invalidateAll()
+{
+	mEpoch++;
+}
+
+void ke::CommandBundleCache::trackDependency(uint64_t handle)
+{
+	if (mRecording == nullptr || handle == 0)
+		return;
+	auto& dependencies = mRecording->dependencies;
+	if (std::any_of(dependencies.begin(), dependencies.end(), [handle](const auto& dependency) { return dependency.first == handle; }))
+		return;
+
+	std::lock_guard<std::mutex> lock(mVersionMutex);
+	dependencies.emplace_back(handle, mResourceVersions[handle]);
+}
+
+void ke::CommandBundleCache::resourceChanged(uint64_t handle)
+{
+	std::lock_guard<std::mutex> lock(mVersionMutex);
+	auto it = mResourceVersions.find(handle);
+	if (it != mResourceVersions.end())
+		it->second++;
+}
+
+bool ke::CommandBundleCache::dependenciesChanged(const Slot& slot)
+{
+	if (slot.dependencies.empty())
+		return false;
+	std::lock_guard<std::mutex> lock(mVersionMutex);
+	return std::any_of(slot.dependencies.begin(), slot.dependencies.end(), [this](const auto& dependency)
+		{
+			return mResourceVersions[dependency.first] != dependency.second;
+		});
+}
+
+void ke::CommandBundleCache::prepare(uint32_t slot, VkRenderPass renderPass, VkExtent2D extent, RendererStats& stats)
+{
+	KE_PROFILE_FUNCTION();
+	mFrame++;
+	freeRetired(false);
+
+	mBackground.clear();
+	mOverlay.clear();
+	mLastRecordCount = 0;
+	for (auto& bundle : mBundles)
+	{
+		if (!bundle.alive)
+			continue;
+
+		Slot& state = bundle.slots[slot];
+		bool stale = !state.recorded || state.version != bundle.version || state.epoch != mEpoch
+			|| state.extent.width != extent.width || state.extent.height != extent.height || dependenciesChanged(state);
+		if (stale)
+			record(bundle, state, renderPass, extent, stats);
+		else
+			stats.addReplayed(state.drawCalls, state.triangles, state.pipelineBinds, state.descriptorBinds);
+
+		if (state.recorded)
+			(bundle.layer == BundleLayer::Background ? mBackground : mOverlay).push_back(state.cmd);
+	}
+	stats.setBundleStats(static_cast<uint32_t>(mBackground.size() + mOverlay.size()), mLastRecordCount);
+}
+
+void ke::CommandBundleCache::record(Bundle& bundle, Slot& slot, VkRenderPass renderPass, VkExtent2D extent, RendererStats& stats)
+{
+	VkCommandBufferInheritanceInfo inheritance{};
+	inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritance.renderPass = renderPass;
+	inheritance.subpass = 0;
+	// Left unknown so swapchain framebuffers and the internal render target can all execute the bundle.
+	inheritance.framebuffer = VK_NULL_HANDLE;
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo = &inheritance;
+
+	slot.recorded = false;
+	if (mVkd->BeginCommandBuffer(slot.cmd, &beginInfo) != VK_SUCCESS)
+	{
+		if (enableLogging)
+			mLogger.error("Failed to begin command bundle!");
+		return;
+	}
+
+	// Dynamic state is not inherited from the primary.
+	VkViewport viewport{ 0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f };
+	VkRect2D scissor{ { 0, 0 }, extent };
+	mVkd->CmdSetViewport(slot.cmd, 0, 1, &viewport);
+	mVkd->CmdSetScissor(slot.cmd, 0, 1, &scissor);
+
+	// The renderer's recording helpers report every pipeline and buffer they bind through trackDependency.
+	FrameStats before = stats.getCurrent();
+	slot.dependencies.clear();
+	mRecording = &slot;
+	bundle.record(slot.cmd);
+	mRecording = nullptr;
+	const FrameStats& after = stats.getCurrent();
+	slot.drawCalls = after.drawCalls - before.drawCalls;
+	slot.triangles = after.triangles - before.triangles;
+	slot.pipelineBinds = after.pipelineBinds - before.pipelineBinds;
+	slot.descriptorBinds = after.descriptorBinds - before.descriptorBinds;
+
+	if (mVkd->EndCommandBuffer(slot.cmd) != VK_SUCCESS)
+	{
+		if (enableLogging)
+			mLogger.error("Failed to record command bundle!");
+		return;
+	}
+
+	slot.recorded = true;
+	slot.version = bundle.version;
+	slot.epoch = mEpoch;
+	slot.extent = extent;
+	mLastRecordCount++;
+}
+
+void ke::CommandBundleCache::freeRetired(bool all)
+{
+	for (size_t i = 0; i < mRetired.size();)
+	{
+		if (all || mFrame >= mRetired[i].retireFrame + mFramesInFlight)
+		{
+			mVkd->FreeCommandBuffers(mDevice, mPool, static_cast<uint32_t>(mRetired[i].cmds.size()), mRetired[i].cmds.data());
+			mRetired[i] = std::move(mRetired.back());
+			mRetired.pop_back();
+		}
+		else
+			i++;
+	}
+}
+
+bool ke::CommandBundleCache::hasCommands(BundleLayer layer) const
+{
+	return !(layer == BundleLayer::Background ? mBackground : mOverlay).empty();
+}
+
+void ke::CommandBundleCache::execute(VkCommandBuffer cmd, BundleLayer layer) const
+{
+	const std::vector<VkCommandBuffer>& cmds = layer == BundleLayer::Background ? mBackground : mOverlay;
+	if (!cmds.empty())
+		mVkd->CmdExecuteCommands(cmd, static_cast<uint32_t>(cmds.size()), cmds.data());
+}
+
+uint32_t ke::CommandBundleCache::getBundleCount() const
+{
+	return mBundleCount;
+}
+
+uint32_t ke::CommandBundleCache::getLastRecordCount() const
+{
+	return mLastRecordCount;
+}
\ No newline at end of file
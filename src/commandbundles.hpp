@@ -0,0 +1,111 @@
+#pragma once
+#include "vk.hpp"
+#include "logger.hpp"
+#include "stats.hpp"
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+namespace ke
+{
+	enum class BundleLayer
+	{
+		// Drawn before the frame's inline main pass commands.
+		Background,
+		// Drawn after them.
+		Overlay
+	};
+
+	// Main pass content that rarely changes, recorded into secondary command buffers and replayed with
+	// vkCmdExecuteCommands. Every frame in flight has its own copy, re-recorded only when the bundle's version,
+	// the render extent, the cache epoch or a resource it recorded changed since that copy was recorded.
+	class CommandBundleCache
+	{
+	public:
+		using RecordFn = std::function<void(VkCommandBuffer)>;
+
+		void init(VkDevice device, const VkuDeviceDispatchTable* vkd, const VkAllocationCallbacks* allocator, uint32_t queueFamily, uint32_t framesInFlight);
+		void cleanup();
+
+		uint32_t add(BundleLayer layer, RecordFn record);
+		void remove(uint32_t bundle);
+		// Bumps the bundle's version so every frame slot records it again.
+		void invalidate(uint32_t bundle);
+		// Bumps the epoch, which invalidates every bundle. Called on swapchain recreation.
+		void invalidateAll();
+		// Adds a handle to the dependencies of the bundle being recorded. Does nothing outside bundle recording.
+		void trackDependency(uint64_t handle);
+		// Bundles that recorded the handle are recorded again before they are next executed. Safe from any thread.
+		void resourceChanged(uint64_t handle);
+
+		// Re-records the slot's out of date bundles and builds this frame's execute lists. Bundles that are up to date
+		// add the counters of their last recording to stats, so draw counts match inline recording.
+		void prepare(uint32_t slot, VkRenderPass renderPass, VkExtent2D extent, RendererStats& stats);
+		bool hasCommands(BundleLayer layer) const;
+		// Must be called inside a render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+		void execute(VkCommandBuffer cmd, BundleLayer layer) const;
+
+		uint32_t getBundleCount() const;
+		uint32_t getLastRecordCount() const;
+	private:
+		struct Slot
+		{
+			VkCommandBuffer cmd = VK_NULL_HANDLE;
+			bool recorded = false;
+			uint64_t version = 0;
+			uint64_t epoch = 0;
+			VkExtent2D extent = { 0, 0 };
+
+			uint32_t drawCalls = 0;
+			uint64_t triangles = 0;
+			uint32_t pipelineBinds = 0;
+			uint32_t descriptorBinds = 0;
+			// Handle and its resource version at record time.
+			std::vector<std::pair<uint64_t, uint64_t>> dependencies;
+		};
+
+		struct Bundle
+		{
+			bool alive = false;
+			BundleLayer layer = BundleLayer::Background;
+			RecordFn record;
+			uint64_t version = 0;
+			std::vector<Slot> slots;
+		};
+
+		struct Retired
+		{
+			std::vector<VkCommandBuffer> cmds;
+			uint64_t retireFrame = 0;
+		};
+	private:
+		void record(Bundle& bundle, Slot& slot, VkRenderPass renderPass, VkExtent2D extent, RendererStats& stats);
+		void freeRetired(bool all);
+		bool dependenciesChanged(const Slot& slot);
+	private:
+		VkDevice mDevice = VK_NULL_HANDLE;
+		const VkuDeviceDispatchTable* mVkd = nullptr;
+		const VkAllocationCallbacks* mAllocator = nullptr;
+		VkCommandPool mPool = VK_NULL_HANDLE;
+		uint32_t mFramesInFlight = 1;
+
+		std::vector<Bundle> mBundles;
+		std::vector<uint32_t> mFreeBundles;
+		std::vector<Retired> mRetired;
+		uint64_t mEpoch = 0;
+		uint64_t mFrame = 0;
+		uint32_t mBundleCount = 0;
+		uint32_t mLastRecordCount = 0;
+
+		// Versions of every handle a bundle has recorded, bumped when the resource is destroyed or rebuilt.
+		std::unordered_map<uint64_t, uint64_t> mResourceVersions;
+		std::mutex mVersionMutex;
+		Slot* mRecording = nullptr;
+
+		std::vector<VkCommandBuffer> mBackground;
+		std::vector<VkCommandBuffer> mOverlay;
+
+		ke::Logger mLogger = ke::Logger("Command Bundle Logger", spdlog::level::debug);
+	};
+}
\ No newline at end of file
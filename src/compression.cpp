@@ -0,0 +1,146 @@
+#include "compression.hpp"
+#include <algorithm>
+#include <cstring>
+
+static constexpr size_t gMinMatch = 4;
+// The format requires the last five bytes to be literals and the last match to start twelve bytes before the end.
+static constexpr size_t gLastLiterals = 5;
+static constexpr size_t gMatchLimit = 12;
+static constexpr size_t gMaxOffset = 65535;
+static constexpr uint32_t gHashBits = 16;
+
+static uint32_t read32(const uint8_t* p)
+{
+	uint32_t value;
+	std::memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static uint32_t hashSequence(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - gHashBits);
+}
+
+static void putLength(std::vector<uint8_t>& out, size_t length)
+{
+	for (; length >= 255; length -= 255)
+		out.push_back(255);
+	out.push_back(static_cast<uint8_t>(length));
+}
+
+static bool getLength(const uint8_t* src, size_t srcSize, size_t& ip, size_t& length, size_t limit)
+{
+	uint8_t byte;
+	do
+	{
+		if (ip >= srcSize || length > limit)
+			return false;
+		byte = src[ip++];
+		length += byte;
+	} while (byte == 255);
+	return length <= limit;
+}
+
+size_t ke::lz4::compressBound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+std::vector<uint8_t> ke::lz4::compress(const uint8_t* src, size_t size)
+{
+	std::vector<uint8_t> out;
+	out.reserve(compressBound(size));
+	std::vector<uint32_t> table(size_t(1) << gHashBits, UINT32_MAX);
+
+	size_t anchor = 0;
+	size_t pos = 0;
+	size_t lastMatchStart = size > gMatchLimit ? size - gMatchLimit : 0;
+	while (pos < lastMatchStart)
+	{
+		uint32_t sequence = read32(src + pos);
+		uint32_t hash = hashSequence(sequence);
+		uint32_t candidate = table[hash];
+		table[hash] = static_cast<uint32_t>(pos);
+		if (candidate == UINT32_MAX || pos - candidate > gMaxOffset || read32(src + candidate) != sequence)
+		{
+			pos++;
+			continue;
+		}
+
+		size_t matchEnd = pos + gMinMatch;
+		size_t reference = candidate + gMinMatch;
+		while (matchEnd < size - gLastLiterals && src[matchEnd] == src[reference])
+		{
+			matchEnd++;
+			reference++;
+		}
+
+		size_t literalLength = pos - anchor;
+		size_t matchLength = matchEnd - pos - gMinMatch;
+		out.push_back(static_cast<uint8_t>((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchLength, 15)));
+		if (literalLength >= 15)
+			putLength(out, literalLength - 15);
+		out.insert(out.end(), src + anchor, src + pos);
+		size_t offset = pos - candidate;
+		out.push_back(static_cast<uint8_t>(offset));
+		out.push_back(static_cast<uint8_t>(offset >> 8));
+		if (matchLength >= 15)
+			putLength(out, matchLength - 15);
+
+		pos = matchEnd;
+		anchor = pos;
+	}
+
+	size_t literalLength = size - anchor;
+	out.push_back(static_cast<uint8_t>(std::min<size_t>(literalLength, 15) << 4));
+	if (literalLength >= 15)
+		putLength(out, literalLength - 15);
+	out.insert(out.end(), src + anchor, src + size);
+	return out;
+}
+
+bool ke::lz4::decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+{
+	size_t ip = 0, op = 0;
+	while (ip < srcSize)
+	{
+		uint8_t token = src[ip++];
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !getLength(src, srcSize, ip, literalLength, dstSize))
+			return false;
+		if (literalLength > srcSize - ip || literalLength > dstSize - op)
+			return false;
+		if (literalLength > 0)
+			std::memcpy(dst + op, src + ip, literalLength);
+		ip += literalLength;
+		op += literalLength;
+
+		// Only the last sequence ends after its literals.
+		if (ip == srcSize)
+			break;
+
+		if (srcSize - ip < 2)
+			return false;
+		size_t offset = src[ip] | (static_cast<size_t>(src[ip + 1]) << 8);
+		ip += 2;
+		if (offset == 0 || offset > op)
+			return false;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !getLength(src, srcSize, ip, matchLength, dstSize))
+			return false;
+		matchLength += gMinMatch;
+		if (matchLength > dstSize - op)
+			return false;
+
+		// Overlapping matches repeat the bytes just written, so they are copied forwards one at a time.
+		const uint8_t* match = dst + op - offset;
+		if (offset >= matchLength)
+			std::memcpy(dst + op, match, matchLength);
+		else
+			for (size_t i = 0; i < matchLength; i++)
+				dst[op + i] = match[i];
+		op += matchLength;
+	}
+	return op == dstSize;
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace ke
+{
+	// LZ4 block format: greedy single-probe compressor for pack time and a bounds-checked decoder that is safe on
+	// untrusted input. Blocks are raw, without the LZ4 frame header, and must be under 4 GiB.
+	namespace lz4
+	{
+		size_t compressBound(size_t size);
+		std::vector<uint8_t> compress(const uint8_t* src, size_t size);
+		// Fails unless src decodes to exactly dstSize bytes.
+		bool decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+	}
+}
\ No newline at end of file
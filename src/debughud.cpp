@@ -0,0 +1,449 @@
+#include "debughud.hpp"
+#include "profiler.hpp"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+static constexpr int GLYPH_WIDTH = 5;
+static constexpr int GLYPH_HEIGHT = 7;
+// Atlas texels per font pixel.
+static constexpr int GLYPH_SCALE = 4;
+// Border around every glyph cell, which is also the distance range the field encodes.
+static constexpr int GLYPH_PADDING = 4;
+static constexpr int CELL_WIDTH = GLYPH_WIDTH * GLYPH_SCALE + 2 * GLYPH_PADDING;
+static constexpr int CELL_HEIGHT = GLYPH_HEIGHT * GLYPH_SCALE + 2 * GLYPH_PADDING;
+static constexpr uint32_t ATLAS_SIZE = 256;
+static constexpr int ATLAS_COLUMNS = ATLAS_SIZE / CELL_WIDTH;
+
+// Screen pixels per font pixel, and the layout derived from it.
+static constexpr float TEXT_SCALE = 2.0f;
+static constexpr float GLYPH_ADVANCE = (GLYPH_WIDTH + 1) * TEXT_SCALE;
+static constexpr float LINE_HEIGHT = (GLYPH_HEIGHT + 3) * TEXT_SCALE;
+static constexpr float MARGIN = 8.0f;
+static constexpr uint32_t GRAPH_FRAMES = 120;
+static constexpr float GRAPH_BAR_WIDTH = 3.0f;
+static constexpr float GRAPH_HEIGHT = 64.0f;
+// Full height of the graph, two frames at 60 Hz.
+static constexpr float GRAPH_RANGE_MS = 1000.0f / 30.0f;
+static constexpr float TARGET_MS = 1000.0f / 60.0f;
+
+struct GlyphBitmap
+{
+	char character;
+	const char* rows[GLYPH_HEIGHT];
+};
+
+// Upper case only; lower case text is drawn with these.
+static const GlyphBitmap gFont[] = {
+	{ ' ', { ".....", ".....", ".....", ".....", ".....", ".....", "....." } },
+	{ '!', { "..#..", "..#..", "..#..", "..#..", "..#..", ".....", "..#.." } },
+	{ '%', { "##...", "##..#", "...#.", "..#..", ".#...", "#..##", "...##" } },
+	{ '(', { "...#.", "..#..", ".#...", ".#...", ".#...", "..#..", "...#." } },
+	{ ')', { ".#...", "..#..", "...#.", "...#.", "...#.", "..#..", ".#..." } },
+	{ '+', { ".....", "..#..", "..#..", "#####", "..#..", "..#..", "....." } },
+	{ ',', { ".....", ".....", ".....", ".....", "..##.", "..#..", ".#..." } },
+	{ '-', { ".....", ".....", ".....", "#####", ".....", ".....", "....." } },
+	{ '.', { ".....", ".....", ".....", ".....", ".....", ".##..", ".##.." } },
+	{ '/', { ".....", "....#", "...#.", "..#..", ".#...", "#....", "....." } },
+	{ '0', { ".###.", "#...#", "#..##", "#.#.#", "##..#", "#...#", ".###." } },
+	{ '1', { "..#..", ".##..", "..#..", "..#..", "..#..", "..#..", ".###." } },
+	{ '2', { ".###.", "#...#", "....#", "...#.", "..#..", ".#...", "#####" } },
+	{ '3', { "#####", "...#.", "..#..", "...#.", "....#", "#...#", ".###." } },
+	{ '4', { "...#.", "..##.", ".#.#.", "#..#.", "#####", "...#.", "...#." } },
+	{ '5', { "#####", "#....", "####.", "....#", "....#", "#...#", ".###." } },
+	{ '6', { "..##.", ".#...", "#....", "####.", "#...#", "#...#", ".###." } },
+	{ '7', { "#####", "....#", "...#.", "..#..", ".#...", ".#...", ".#..." } },
+	{ '8', { ".###.", "#...#", "#...#", ".###.", "#...#", "#...#", ".###." } },
+	{ '9', { ".###.", "#...#", "#...#", ".####", "....#", "...#.", ".##.." } },
+	{ ':', { ".....", ".##..", ".##..", ".....", ".##..", ".##..", "....." } },
+	{ '<', { "...#.", "..#..", ".#...", "#....", ".#...", "..#..", "...#." } },
+	{ '=', { ".....", ".....", "#####", ".....", "#####", ".....", "....." } },
+	{ '>', { ".#...", "..#..", "...#.", "....#", "...#.", "..#..", ".#..." } },
+	{ '?', { ".###.", "#...#", "....#", "...#.", "..#..", ".....", "..#.." } },
+	{ 'A', { ".###.", "#...#", "#...#", "#####", "#...#", "#...#", "#...#" } },
+	{ 'B', { "####.", "#...#", "#...#", "####.", "#...#", "#...#", "####." } },
+	{ 'C', { ".###.", "#...#", "#....", "#....", "#....", "#...#", ".###." } },
+	{ 'D', { "###..", "#..#.", "#...#", "#...#", "#...#", "#..#.", "###.." } },
+	{ 'E', { "#####", "#....", "#....", "####.", "#....", "#....", "#####" } },
+	{ 'F', { "#####", "#....", "#....", "####.", "#....", "#....", "#...." } },
+	{ 'G', { ".###.", "#...#", "#....", "#.###", "#...#", "#...#", ".####" } },
+	{ 'H', { "#...#", "#...#", "#...#", "#####", "#...#", "#...#", "#...#" } },
+	{ 'I', { ".###.", "..#..", "..#..", "..#..", "..#..", "..#..", ".###." } },
+	{ 'J', { "..###", "...#.", "...#.", "...#.", "...#.", "#..#.", ".##.." } },
+	{ 'K', { "#...#", "#..#.", "#.#..", "##...", "#.#..", "#..#.", "#...#" } },
+	{ 'L', { "#....", "#....", "#....", "#....", "#....", "#....", "#####" } },
+	{ 'M', { "#...#", "##.##", "#.#.#", "#.#.#", "#...#", "#...#", "#...#" } },
+	{ 'N', { "#...#", "#...#", "##..#", "#.#.#", "#..##", "#...#", "#...#" } },
+	{ 'O', { ".###.", "#...#", "#...#", "#...#", "#...#", "#...#", ".###." } },
+	{ 'P', { "####.", "#...#", "#...#", "####.", "#....", "#....", "#...." } },
+	{ 'Q', { ".###.", "#...#", "#...#", "#...#", "#.#.#", "#..#.", ".##.#" } },
+	{ 'R', { "####.", "#...#", "#...#", "####.", "#.#..", "#..#.", "#...#" } },
+	{ 'S', { ".####", "#....", "#....", ".###.", "....#", "....#", "####." } },
+	{ 'T', { "#####", "..#..", "..#..", "..#..", "..#..", "..#..", "..#.." } },
+	{ 'U', { "#...#", "#...#", "#...#", "#...#", "#...#", "#...#", ".###." } },
+	{ 'V', { "#...#", "#...#", "#...#", "#...#", "#...#", ".#.#.", "..#.." } },
+	{ 'W', { "#...#", "#...#", "#...#", "#.#.#", "#.#.#", "#.#.#", ".#.#." } },
+	{ 'X', { "#...#", "#...#", ".#.#.", "..#..", ".#.#.", "#...#", "#...#" } },
+	{ 'Y', { "#...#", "#...#", ".#.#.", "..#..", "..#..", "..#..", "..#.." } },
+	{ 'Z', { "#####", "....#", "...#.", "..#..", ".#...", "#....", "#####" } },
+	{ '[', { ".###.", ".#...", ".#...", ".#...", ".#...", ".#...", ".###." } },
+	{ ']', { ".###.", "...#.", "...#.", "...#.", "...#.", "...#.", ".###." } },
+	{ '_', { ".....", ".....", ".....", ".....", ".....", ".....", "#####" } },
+	{ '|', { "..#..", "..#..", "..#..", "..#..", "..#..", "..#..", "..#.." } }
+};
+
+static uint32_t packColor(float r, float g, float b, float a)
+{
+	return glm::packUnorm4x8(glm::vec4(r, g, b, a));
+}
+
+// Writes the signed distance field of one glyph into its atlas cell. Each font pixel is a square of GLYPH_SCALE
+// texels, and every texel stores the distance to the nearest square of the opposite state, so edges stay exact.
+static void rasterizeGlyph(const GlyphBitmap& glyph, uint8_t* atlas, int cellX, int cellY)
+{
+	auto isSet = [&glyph](int x, int y)
+		{
+			return x >= 0 && y >= 0 && x < GLYPH_WIDTH && y < GLYPH_HEIGHT && glyph.rows[y][x] == '#';
+		};
+
+	for (int ty = 0; ty < CELL_HEIGHT; ty++)
+		for (int tx = 0; tx < CELL_WIDTH; tx++)
+		{
+			float px = tx + 0.5f - GLYPH_PADDING;
+			float py = ty + 0.5f - GLYPH_PADDING;
+			bool inside = isSet(static_cast<int>(std::floor(px / GLYPH_SCALE)), static_cast<int>(std::floor(py / GLYPH_SCALE)));
+
+			// Empty pixels one step outside the bitmap stand in for everything beyond it.
+			float nearest = static_cast<float>(GLYPH_PADDING);
+			for (int y = -1; y <= GLYPH_HEIGHT; y++)
+				for (int x = -1; x <= GLYPH_WIDTH; x++)
+				{
+					if (isSet(x, y) == inside)
+						continue;
+					float dx = std::max({ x * GLYPH_SCALE - px, 0.0f, px - (x + 1) * GLYPH_SCALE });
+					float dy = std::max({ y * GLYPH_SCALE - py, 0.0f, py - (y + 1) * GLYPH_SCALE });
+					nearest = std::min(nearest, std::sqrt(dx * dx + dy * dy));
+				}
+
+			float distance = (inside ? nearest : -nearest) / GLYPH_PADDING;
+			atlas[(cellY + ty) * ATLAS_SIZE + cellX + tx] = static_cast<uint8_t>(std::lround((0.5f + 0.5f * distance) * 255.0f));
+		}
+}
+
+void ke::DebugHud::init(Renderer& renderer, uint32_t maxQuads)
+{
+	KE_PROFILE_FUNCTION();
+	mRenderer = &renderer;
+	mMaxVertices = maxQuads * 6;
+
+	createAtlas();
+	createPipeline();
+
+	mVertexBuffers.resize(renderer.getMaxFramesInFlight());
+	for (auto& buffer : mVertexBuffers)
+		buffer = renderer.createBuffer(sizeof(Vertex) * mMaxVertices, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	if (enableLogging)
+		mLogger.info("Created debug HUD with room for {} quads per frame.", maxQuads);
+}
+
+void ke::DebugHud::cleanup()
+{
+	const VkuDeviceDispatchTable& vkd = mRenderer->getDeviceTable();
+	VkDevice device = mRenderer->getDevice();
+	const VkAllocationCallbacks* allocator = mRenderer->getAllocationCallbacks();
+
+	for (auto& buffer : mVertexBuffers)
+		mRenderer->destroyBuffer(buffer);
+	mVertexBuffers.clear();
+	mRenderer->destroyPipeline(mPipeline);
+	vkd.DestroyPipelineLayout(device, mPipelineLayout, allocator);
+	vkd.DestroyDescriptorSetLayout(device, mSetLayout, allocator);
+	mRenderer->releaseImageViews(mAtlas);
+	vkd.DestroyImage(device, mAtlas, allocator);
+	vkd.FreeMemory(device, mAtlasMemory, allocator);
+}
+
+void ke::DebugHud::createAtlas()
+{
+	const VkuDeviceDispatchTable& vkd = mRenderer->getDeviceTable();
+	VkDevice device = mRenderer->getDevice();
+	const VkAllocationCallbacks* allocator = mRenderer->getAllocationCallbacks();
+
+	// Cell 0 is solid so rectangles and graphs can share the text pipeline; glyphs follow.
+	std::vector<uint8_t> pixels(ATLAS_SIZE * ATLAS_SIZE, 0);
+	for (int y = 0; y < CELL_HEIGHT; y++)
+		std::memset(&pixels[y * ATLAS_SIZE], 0xFF, CELL_WIDTH);
+	mSolidUv = glm::vec4(CELL_WIDTH / 2 - 1, CELL_HEIGHT / 2 - 1, CELL_WIDTH / 2 + 1, CELL_HEIGHT / 2 + 1) / static_cast<float>(ATLAS_SIZE);
+
+	int cell = 1;
+	for (const GlyphBitmap& glyph : gFont)
+	{
+		int cellX = (cell % ATLAS_COLUMNS) * CELL_WIDTH;
+		int cellY = (cell / ATLAS_COLUMNS) * CELL_HEIGHT;
+		rasterizeGlyph(glyph, pixels.data(), cellX, cellY);
+		mGlyphUv[static_cast<uint8_t>(glyph.character)] = glm::vec4(cellX, cellY, cellX + CELL_WIDTH, cellY + CELL_HEIGHT) / static_cast<float>(ATLAS_SIZE);
+		cell++;
+	}
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = VK_FORMAT_R8_UNORM;
+	imageInfo.extent = { ATLAS_SIZE, ATLAS_SIZE, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	if (vkd.CreateImage(device, &imageInfo, allocator, &mAtlas) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create the glyph atlas!");
+
+	VkMemoryRequirements requirements{};
+	vkd.GetImageMemoryRequirements(device, mAtlas, &requirements);
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = requirements.size;
+	allocInfo.memoryTypeIndex = mRenderer->findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (vkd.AllocateMemory(device, &allocInfo, allocator, &mAtlasMemory) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to allocate glyph atlas memory!");
+	vkd.BindImageMemory(device, mAtlas, mAtlasMemory, 0);
+
+	Buffer staging = mRenderer->createBuffer(pixels.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	std::memcpy(staging.mapped, pixels.data(), pixels.size());
+	mRenderer->submitImmediate([&](VkCommandBuffer cmd)
+		{
+			VkImageMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = mAtlas;
+			barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			vkd.CmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+			VkBufferImageCopy region{};
+			region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			region.imageExtent = { ATLAS_SIZE, ATLAS_SIZE, 1 };
+			vkd.CmdCopyBufferToImage(cmd, staging.buffer, mAtlas, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkd.CmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		});
+	mRenderer->destroyBuffer(staging);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = mAtlas;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = VK_FORMAT_R8_UNORM;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	mAtlasView = mRenderer->getImageView(viewInfo);
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	mSampler = mRenderer->getSampler(samplerInfo);
+}
+
+void ke::DebugHud::createPipeline()
+{
+	VkDescriptorSetLayoutBinding binding{};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+	if (mRenderer->getDeviceTable().CreateDescriptorSetLayout(mRenderer->getDevice(), &layoutInfo, mRenderer->getAllocationCallbacks(), &mSetLayout) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create the HUD descriptor set layout!");
+	mAtlasSet.image(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, mAtlasView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mSampler);
+
+	VkPushConstantRange pushRange{ VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::vec2) };
+	mPipelineLayout = mRenderer->createPipelineLayout({ mSetLayout }, { pushRange });
+
+	GraphicsPipelineDesc desc{};
+	desc.vertexShader = "shader/bin/hud_vert.spv";
+	desc.fragmentShader = "shader/bin/hud_frag.spv";
+	desc.bindings = { { 0, sizeof(Vertex), VK_VERTEX_INPUT_RATE_VERTEX } };
+	desc.attributes = {
+		{ 0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, position) },
+		{ 1, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv) },
+		{ 2, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(Vertex, color) }
+	};
+	desc.layout = mPipelineLayout;
+	desc.alphaBlend = true;
+	mPipeline = mRenderer->buildGraphicsPipeline(desc);
+}
+
+void ke::DebugHud::setTimer(GpuTimer* timer, uint32_t scope)
+{
+	mTimer = timer;
+	mTimerScope = scope;
+}
+
+void ke::DebugHud::addQuad(glm::vec2 min, glm::vec2 max, glm::vec4 uv, uint32_t color)
+{
+	if (mVertexCount + 6 > mMaxVertices)
+		return;
+	Vertex* v = mVertices + mVertexCount;
+	v[0] = { { min.x, min.y }, { uv.x, uv.y }, color };
+	v[1] = { { max.x, min.y }, { uv.z, uv.y }, color };
+	v[2] = { { max.x, max.y }, { uv.z, uv.w }, color };
+	v[3] = v[0];
+	v[4] = v[2];
+	v[5] = { { min.x, max.y }, { uv.x, uv.w }, color };
+	mVertexCount += 6;
+}
+
+void ke::DebugHud::addRect(glm::vec2 min, glm::vec2 max, uint32_t color)
+{
+	addQuad(min, max, mSolidUv, color);
+}
+
+float ke::DebugHud::addText(glm::vec2 position, uint32_t color, const char* text)
+{
+	// Quads cover the whole cell, padding included, so the field has room to fade out.
+	const glm::vec2 padding(GLYPH_PADDING * TEXT_SCALE / GLYPH_SCALE);
+	const glm::vec2 size(CELL_WIDTH * TEXT_SCALE / GLYPH_SCALE, CELL_HEIGHT * TEXT_SCALE / GLYPH_SCALE);
+	for (const char* c = text; *c; c++)
+	{
+		uint8_t character = static_cast<uint8_t>(*c >= 'a' && *c <= 'z' ? *c - 'a' + 'A' : *c);
+		if (character != ' ')
+		{
+			glm::vec4 uv = character < mGlyphUv.size() ? mGlyphUv[character] : glm::vec4(0.0f);
+			if (uv.z == 0.0f)
+				uv = mGlyphUv['?'];
+			glm::vec2 min = position - padding;
+			addQuad(min, min + size, uv, color);
+		}
+		position.x += GLYPH_ADVANCE;
+	}
+	return position.x;
+}
+
+void ke::DebugHud::build()
+{
+	RendererStats& stats = mRenderer->getStats();
+	uint32_t history = stats.getHistorySize();
+	FrameStats average = stats.getAverage(30);
+
+	const uint32_t white = packColor(1.0f, 1.0f, 1.0f, 1.0f);
+	const uint32_t dim = packColor(0.7f, 0.7f, 0.7f, 1.0f);
+	// The panel is the first quad so it sits under everything; its size is only known once the text is laid out.
+	mVertexCount = 6;
+
+	char line[128];
+	float right = 0.0f;
+	glm::vec2 cursor(2.0f * MARGIN, 2.0f * MARGIN);
+	auto text = [&](uint32_t color)
+		{
+			right = std::max(right, addText(cursor, color, line));
+			cursor.y += LINE_HEIGHT;
+		};
+
+	float fps = average.frameMs > 0.0f ? 1000.0f / average.frameMs : 0.0f;
+	std::snprintf(line, sizeof(line), "FRAME %6.2f MS %6.0f FPS", average.frameMs, fps);
+	text(white);
+	std::snprintf(line, sizeof(line), "CPU   %6.2f MS  GPU %6.2f MS", average.getCpuMs(), average.gpuMs);
+	text(white);
+	std::snprintf(line, sizeof(line), "DRAWS %u  TRIS %.1fK", average.drawCalls, average.triangles / 1000.0);
+	text(dim);
+	std::snprintf(line, sizeof(line), "PIPELINES %u  DESCRIPTORS %u", average.pipelineBinds, average.descriptorBinds);
+	text(dim);
+	std::snprintf(line, sizeof(line), "VRAM %llu / %llu MB", static_cast<unsigned long long>(average.memoryUsage >> 20),
+		static_cast<unsigned long long>(average.memoryBudget >> 20));
+	text(dim);
+	std::snprintf(line, sizeof(line), "HOST ALLOCS %llu  SCALE %.2f", static_cast<unsigned long long>(average.hostAllocations), average.renderScale);
+	text(dim);
+	std::snprintf(line, sizeof(line), "HUD CPU %.3f MS  GPU %.3f MS", mCpuMs, mTimer ? mTimer->getMilliseconds(mTimerScope) : 0.0);
+	text(dim);
+
+	// Frame time bars oldest to newest, with the GPU time marked on each and a line at the 60 Hz budget.
+	cursor.y += MARGIN;
+	glm::vec2 graphMin = cursor;
+	glm::vec2 graphMax(cursor.x + GRAPH_FRAMES * GRAPH_BAR_WIDTH, cursor.y + GRAPH_HEIGHT);
+	addRect(graphMin, graphMax, packColor(0.0f, 0.0f, 0.0f, 0.4f));
+	uint32_t frames = std::min(history, GRAPH_FRAMES);
+	for (uint32_t i = 0; i < frames; i++)
+	{
+		const FrameStats& frame = stats.getFrame(frames - 1 - i);
+		float x = graphMax.x - (frames - i) * GRAPH_BAR_WIDTH;
+		float height = std::min(frame.frameMs / GRAPH_RANGE_MS, 1.0f) * GRAPH_HEIGHT;
+		uint32_t color = frame.frameMs <= TARGET_MS ? packColor(0.3f, 0.8f, 0.3f, 0.9f)
+			: frame.frameMs <= GRAPH_RANGE_MS ? packColor(0.9f, 0.8f, 0.2f, 0.9f) : packColor(0.9f, 0.25f, 0.2f, 0.9f);
+		addRect({ x, graphMax.y - height }, { x + GRAPH_BAR_WIDTH - 1.0f, graphMax.y }, color);
+
+		float gpu = graphMax.y - std::min(frame.gpuMs / GRAPH_RANGE_MS, 1.0f) * GRAPH_HEIGHT;
+		addRect({ x, gpu - 1.0f }, { x + GRAPH_BAR_WIDTH - 1.0f, gpu + 1.0f }, packColor(0.3f, 0.8f, 1.0f, 1.0f));
+	}
+	float target = graphMax.y - TARGET_MS / GRAPH_RANGE_MS * GRAPH_HEIGHT;
+	addRect({ graphMin.x, target }, { graphMax.x, target + 1.0f }, packColor(1.0f, 1.0f, 1.0f, 0.5f));
+
+	// Written last into the reserved first quad.
+	uint32_t count = mVertexCount;
+	mVertexCount = 0;
+	addRect(glm::vec2(MARGIN), glm::vec2(std::max(right, graphMax.x) + MARGIN, graphMax.y + MARGIN), packColor(0.05f, 0.05f, 0.08f, 0.7f));
+	mVertexCount = count;
+}
+
+void ke::DebugHud::record(VkCommandBuffer cmd)
+{
+	KE_PROFILE_FUNCTION();
+	StatTimer timer;
+	uint32_t slot = mRenderer->getCurrentFrameInFlight();
+	mVertices = static_cast<Vertex*>(mVertexBuffers[slot].mapped);
+	build();
+
+	if (mTimer)
+		mTimer->begin(cmd, mTimerScope);
+
+	// Pixels are laid out in swapchain space whatever the render extent, so the HUD keeps its size under dynamic resolution.
+	VkExtent2D extent = mRenderer->getSwapchainExtent();
+	glm::vec2 scale(2.0f / extent.width, 2.0f / extent.height);
+	VkDescriptorSet set = mRenderer->getDescriptorAllocator().get(mSetLayout, mAtlasSet);
+	VkDeviceSize offset = 0;
+	mRenderer->bindPipeline(cmd, mPipeline);
+	mRenderer->bindDescriptorSets(cmd, mPipelineLayout, 0, 1, &set);
+	mRenderer->bindVertexBuffers(cmd, 0, 1, &mVertexBuffers[slot].buffer, &offset);
+	mRenderer->pushConstants(cmd, mPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(scale), &scale);
+	mRenderer->draw(cmd, mVertexCount, 1, 0, 0);
+
+	if (mTimer)
+		mTimer->end(cmd, mTimerScope);
+	mCpuMs = timer.elapsedMs();
+}
+
+float ke::DebugHud::getCpuMs() const
+{
+	return mCpuMs;
+}
+
+uint32_t ke::DebugHud::getLastQuadCount() const
+{
+	return mVertexCount / 6;
+}
\ No newline at end of file
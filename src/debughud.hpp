@@ -0,0 +1,69 @@
+#pragma once
+#include "renderer.hpp"
+#include "gputimer.hpp"
+#include <glm/glm.hpp>
+#include <array>
+#include <vector>
+
+namespace ke
+{
+	// Live frame statistics drawn over the scene: text from a signed distance field glyph atlas plus frame time
+	// graphs, all written into a per-frame vertex buffer and drawn with a single call.
+	class DebugHud
+	{
+	public:
+		void init(Renderer& renderer, uint32_t maxQuads = 4096);
+		void cleanup();
+
+		// Builds the overlay from the renderer's stats and records its draw. Call inside the main pass, right before endRecording.
+		void record(VkCommandBuffer cmd);
+
+		// Optional. The scope must be registered on the timer by the caller.
+		void setTimer(GpuTimer* timer, uint32_t scope);
+
+		// CPU time of the last record call, including building the vertices.
+		float getCpuMs() const;
+		uint32_t getLastQuadCount() const;
+	private:
+		struct Vertex
+		{
+			glm::vec2 position;
+			glm::vec2 uv;
+			uint32_t color;
+		};
+	private:
+		void createAtlas();
+		void createPipeline();
+		void build();
+		void addQuad(glm::vec2 min, glm::vec2 max, glm::vec4 uv, uint32_t color);
+		void addRect(glm::vec2 min, glm::vec2 max, uint32_t color);
+		// Returns the x after the last glyph.
+		float addText(glm::vec2 position, uint32_t color, const char* text);
+	private:
+		Renderer* mRenderer = nullptr;
+
+		VkImage mAtlas = VK_NULL_HANDLE;
+		VkDeviceMemory mAtlasMemory = VK_NULL_HANDLE;
+		VkImageView mAtlasView = VK_NULL_HANDLE;
+		VkSampler mSampler = VK_NULL_HANDLE;
+		// Atlas rectangle of each ASCII character, zero for characters without a glyph.
+		std::array<glm::vec4, 128> mGlyphUv{};
+		glm::vec4 mSolidUv{};
+
+		VkDescriptorSetLayout mSetLayout = VK_NULL_HANDLE;
+		DescriptorSetDesc mAtlasSet;
+		VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
+		VkPipeline mPipeline = VK_NULL_HANDLE;
+
+		std::vector<Buffer> mVertexBuffers;
+		uint32_t mMaxVertices = 0;
+		Vertex* mVertices = nullptr;
+		uint32_t mVertexCount = 0;
+
+		GpuTimer* mTimer = nullptr;
+		uint32_t mTimerScope = 0;
+		float mCpuMs = 0.0f;
+
+		ke::Logger mLogger = ke::Logger("Debug HUD Logger", spdlog::level::debug);
+	};
+}
\ No newline at end of file
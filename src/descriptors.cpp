@@ -0,0 +1,232 @@
+#include "descriptors.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <functional>
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+// Descriptors per set each new pool reserves, by type.
+static constexpr std::pair<VkDescriptorType, uint32_t> gPoolRatios[] = {
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 },
+	{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 },
+	{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 2 },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 },
+	{ VK_DESCRIPTOR_TYPE_SAMPLER, 1 }
+};
+static constexpr uint32_t gMaxPoolSize = 4096;
+
+ke::DescriptorSetDesc& ke::DescriptorSetDesc::buffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	Binding entry;
+	entry.binding = binding;
+	entry.type = type;
+	entry.buffer = { buffer, offset, range };
+	mBindings.push_back(entry);
+	return *this;
+}
+
+ke::DescriptorSetDesc& ke::DescriptorSetDesc::image(uint32_t binding, VkDescriptorType type, VkImageView view, VkImageLayout layout, VkSampler sampler)
+{
+	Binding entry;
+	entry.binding = binding;
+	entry.type = type;
+	entry.image = { sampler, view, layout };
+	mBindings.push_back(entry);
+	return *this;
+}
+
+void ke::DescriptorSetDesc::clear()
+{
+	mBindings.clear();
+}
+
+uint64_t ke::DescriptorSetDesc::hash(VkDescriptorSetLayout layout) const
+{
+	uint64_t hash = 14695981039346656037ull;
+	auto mix = [&hash](uint64_t value)
+		{
+			hash ^= value;
+			hash *= 1099511628211ull;
+		};
+
+	mix(std::hash<VkDescriptorSetLayout>{}(layout));
+	for (const auto& binding : mBindings)
+	{
+		mix((static_cast<uint64_t>(binding.binding) << 32) | static_cast<uint32_t>(binding.type));
+		mix(std::hash<VkBuffer>{}(binding.buffer.buffer));
+		mix(binding.buffer.offset);
+		mix(binding.buffer.range);
+		mix(std::hash<VkSampler>{}(binding.image.sampler));
+		mix(std::hash<VkImageView>{}(binding.image.imageView));
+		mix(binding.image.imageLayout);
+	}
+	return hash;
+}
+
+bool ke::DescriptorSetDesc::operator==(const DescriptorSetDesc& other) const
+{
+	return std::equal(mBindings.begin(), mBindings.end(), other.mBindings.begin(), other.mBindings.end(), [](const Binding& a, const Binding& b)
+		{
+			return a.binding == b.binding && a.type == b.type
+				&& a.buffer.buffer == b.buffer.buffer && a.buffer.offset == b.buffer.offset && a.buffer.range == b.buffer.range
+				&& a.image.sampler == b.image.sampler && a.image.imageView == b.image.imageView && a.image.imageLayout == b.image.imageLayout;
+		});
+}
+
+void ke::DescriptorAllocator::init(VkDevice device, const VkuDeviceDispatchTable* vkd, const VkAllocationCallbacks* allocator, uint32_t framesInFlight)
+{
+	mDevice = device;
+	mVkd = vkd;
+	mAllocator = allocator;
+	mSlots.resize(framesInFlight);
+}
+
+void ke::DescriptorAllocator::cleanup()
+{
+	for (auto& slot : mSlots)
+	{
+		for (VkDescriptorPool pool : slot.used)
+			mVkd->DestroyDescriptorPool(mDevice, pool, mAllocator);
+		for (VkDescriptorPool pool : slot.free)
+			mVkd->DestroyDescriptorPool(mDevice, pool, mAllocator);
+	}
+	mSlots.clear();
+	mPoolCount = 0;
+}
+
+void ke::DescriptorAllocator::beginFrame(uint32_t slot)
+{
+	KE_PROFILE_FUNCTION();
+	mCurrentSlot = slot;
+	mAllocatedCount = 0;
+	mReusedCount = 0;
+
+	FrameSlot& frame = mSlots[slot];
+	for (VkDescriptorPool pool : frame.used)
+	{
+		mVkd->ResetDescriptorPool(mDevice, pool, 0);
+		frame.free.push_back(pool);
+	}
+	frame.used.clear();
+	frame.cache.clear();
+}
+
+VkDescriptorPool ke::DescriptorAllocator::nextPool(FrameSlot& slot)
+{
+	if (!slot.free.empty())
+	{
+		slot.used.push_back(slot.free.back());
+		slot.free.pop_back();
+		return slot.used.back();
+	}
+
+	// Each new pool doubles in size, so a frame that needs many sets settles on a short chain.
+	std::vector<VkDescriptorPoolSize> sizes;
+	for (const auto& [type, ratio] : gPoolRatios)
+		sizes.push_back({ type, ratio * mNextPoolSize });
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = mNextPoolSize;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(sizes.size());
+	poolInfo.pPoolSizes = sizes.data();
+
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	if (mVkd->CreateDescriptorPool(mDevice, &poolInfo, mAllocator, &pool) != VK_SUCCESS)
+	{
+		mLogger.error("Failed to create a descriptor pool for {} sets!", mNextPoolSize);
+		return VK_NULL_HANDLE;
+	}
+	if (enableLogging)
+		mLogger.debug("Created descriptor pool {} with {} sets.", mPoolCount, mNextPoolSize);
+	mPoolCount++;
+	mNextPoolSize = std::min(mNextPoolSize * 2, gMaxPoolSize);
+	slot.used.push_back(pool);
+	return pool;
+}
+
+VkDescriptorSet ke::DescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+{
+	FrameSlot& slot = mSlots[mCurrentSlot];
+	VkDescriptorPool pool = slot.used.empty() ? nextPool(slot) : slot.used.back();
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	VkResult result = VK_ERROR_OUT_OF_POOL_MEMORY;
+	if (pool != VK_NULL_HANDLE)
+	{
+		allocInfo.descriptorPool = pool;
+		result = mVkd->AllocateDescriptorSets(mDevice, &allocInfo, &set);
+	}
+	// A full or fragmented pool moves the chain on to the next one.
+	if ((result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) && (pool = nextPool(slot)) != VK_NULL_HANDLE)
+	{
+		allocInfo.descriptorPool = pool;
+		result = mVkd->AllocateDescriptorSets(mDevice, &allocInfo, &set);
+	}
+	if (result != VK_SUCCESS)
+	{
+		mLogger.error("Failed to allocate a descriptor set!");
+		return VK_NULL_HANDLE;
+	}
+	mAllocatedCount++;
+	return set;
+}
+
+VkDescriptorSet ke::DescriptorAllocator::get(VkDescriptorSetLayout layout, const DescriptorSetDesc& desc)
+{
+	std::vector<CachedSet>& bucket = mSlots[mCurrentSlot].cache[desc.hash(layout)];
+	for (const auto& cached : bucket)
+		if (cached.layout == layout && cached.desc == desc)
+		{
+			mReusedCount++;
+			return cached.set;
+		}
+
+	VkDescriptorSet set = allocate(layout);
+	if (set == VK_NULL_HANDLE)
+		return VK_NULL_HANDLE;
+
+	std::vector<VkWriteDescriptorSet> writes(desc.mBindings.size());
+	for (size_t i = 0; i < writes.size(); i++)
+	{
+		const auto& binding = desc.mBindings[i];
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = set;
+		writes[i].dstBinding = binding.binding;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = binding.type;
+		if (binding.buffer.buffer != VK_NULL_HANDLE)
+			writes[i].pBufferInfo = &binding.buffer;
+		else
+			writes[i].pImageInfo = &binding.image;
+	}
+	mVkd->UpdateDescriptorSets(mDevice, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+	bucket.push_back({ layout, desc, set });
+	return set;
+}
+
+uint32_t ke::DescriptorAllocator::getAllocatedCount() const
+{
+	return mAllocatedCount;
+}
+
+uint32_t ke::DescriptorAllocator::getReusedCount() const
+{
+	return mReusedCount;
+}
+
+uint32_t ke::DescriptorAllocator::getPoolCount() const
+{
+	return mPoolCount;
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+#include "vk.hpp"
+#include "logger.hpp"
+#include <vector>
+#include <unordered_map>
+
+namespace ke
+{
+	// Contents of one descriptor set, compared by value so identical requests can share a set.
+	class DescriptorSetDesc
+	{
+	public:
+		DescriptorSetDesc& buffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+		DescriptorSetDesc& image(uint32_t binding, VkDescriptorType type, VkImageView view, VkImageLayout layout, VkSampler sampler = VK_NULL_HANDLE);
+		void clear();
+
+		uint64_t hash(VkDescriptorSetLayout layout) const;
+		bool operator==(const DescriptorSetDesc& other) const;
+	private:
+		friend class DescriptorAllocator;
+
+		struct Binding
+		{
+			uint32_t binding = 0;
+			VkDescriptorType type = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+			VkDescriptorBufferInfo buffer{};
+			VkDescriptorImageInfo image{};
+		};
+		std::vector<Binding> mBindings;
+	};
+
+	// Transient descriptor sets. Every frame in flight owns a chain of pools that grows on demand and is reset
+	// wholesale once that frame's fence has signalled, so sets are never freed individually. Sets that must outlive
+	// their frame, such as ones used by static bundles, belong in a pool of their own.
+	class DescriptorAllocator
+	{
+	public:
+		void init(VkDevice device, const VkuDeviceDispatchTable* vkd, const VkAllocationCallbacks* allocator, uint32_t framesInFlight);
+		void cleanup();
+
+		// Resets the slot's pools and set cache. Only call once the slot's fence has signalled.
+		void beginFrame(uint32_t slot);
+		// Valid until the current frame slot comes around again.
+		VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+		// Returns the set already written with the same layout and contents this frame, or allocates and writes one.
+		VkDescriptorSet get(VkDescriptorSetLayout layout, const DescriptorSetDesc& desc);
+
+		// Counters for the current frame.
+		uint32_t getAllocatedCount() const;
+		uint32_t getReusedCount() const;
+		uint32_t getPoolCount() const;
+	private:
+		struct CachedSet
+		{
+			VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+			DescriptorSetDesc desc;
+			VkDescriptorSet set = VK_NULL_HANDLE;
+		};
+
+		struct FrameSlot
+		{
+			// The last used pool is the one allocated from.
+			std::vector<VkDescriptorPool> used;
+			std::vector<VkDescriptorPool> free;
+			// Keyed by DescriptorSetDesc::hash(); the bucket resolves collisions.
+			std::unordered_map<uint64_t, std::vector<CachedSet>> cache;
+		};
+	private:
+		VkDescriptorPool nextPool(FrameSlot& slot);
+	private:
+		VkDevice mDevice = VK_NULL_HANDLE;
+		const VkuDeviceDispatchTable* mVkd = nullptr;
+		const VkAllocationCallbacks* mAllocator = nullptr;
+
+		std::vector<FrameSlot> mSlots;
+		uint32_t mCurrentSlot = 0;
+		uint32_t mNextPoolSize = 64;
+		uint32_t mPoolCount = 0;
+		uint32_t mAllocatedCount = 0;
+		uint32_t mReusedCount = 0;
+
+		ke::Logger mLogger = ke::Logger("Descriptor Allocator Logger", spdlog::level::debug);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+namespace ke
+{
+	// Bounded single-producer single-consumer ring of per-frame snapshots. tryPush and tryPop never block or lock;
+	// push and pop sleep on an atomic wait while the ring is full or empty.
+	template<typename T, uint32_t Capacity>
+	class FrameQueue
+	{
+		static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "FrameQueue capacity must be a power of two.");
+	public:
+		bool tryPush(T&& value)
+		{
+			uint32_t tail = mTail.load(std::memory_order_relaxed);
+			if (tail - mHead.load(std::memory_order_acquire) == Capacity)
+				return false;
+			mSlots[tail & (Capacity - 1)] = std::move(value);
+			mTail.store(tail + 1, std::memory_order_release);
+			signal();
+			return true;
+		}
+
+		bool tryPop(T& value)
+		{
+			uint32_t head = mHead.load(std::memory_order_relaxed);
+			if (head == mTail.load(std::memory_order_acquire))
+				return false;
+			value = std::move(mSlots[head & (Capacity - 1)]);
+			mHead.store(head + 1, std::memory_order_release);
+			signal();
+			return true;
+		}
+
+		// Blocks while the ring is full. Returns false without pushing once the queue is closed.
+		bool push(T&& value)
+		{
+			while (true)
+			{
+				// Read before trying, so a pop landing in between changes the signal and the wait returns at once.
+				uint32_t observed = mSignal.load(std::memory_order_acquire);
+				if (mClosed.load(std::memory_order_acquire))
+					return false;
+				if (tryPush(std::move(value)))
+					return true;
+				mSignal.wait(observed, std::memory_order_acquire);
+			}
+		}
+
+		// Blocks while the ring is empty. Returns false once the queue is closed and drained.
+		bool pop(T& value)
+		{
+			while (true)
+			{
+				uint32_t observed = mSignal.load(std::memory_order_acquire);
+				if (tryPop(value))
+					return true;
+				if (mClosed.load(std::memory_order_acquire))
+					return false;
+				mSignal.wait(observed, std::memory_order_acquire);
+			}
+		}
+
+		void close()
+		{
+			mClosed.store(true, std::memory_order_release);
+			signal();
+		}
+
+		void reopen()
+		{
+			mClosed.store(false, std::memory_order_release);
+		}
+
+		uint32_t size() const
+		{
+			return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+		}
+	private:
+		void signal()
+		{
+			mSignal.fetch_add(1, std::memory_order_release);
+			mSignal.notify_all();
+		}
+	private:
+		T mSlots[Capacity];
+		alignas(64) std::atomic<uint32_t> mHead = 0;
+		alignas(64) std::atomic<uint32_t> mTail = 0;
+		alignas(64) std::atomic<uint32_t> mSignal = 0;
+		std::atomic<bool> mClosed = false;
+	};
+}
\ No newline at end of file
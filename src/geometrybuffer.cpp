@@ -0,0 +1,395 @@
+#include "geometrybuffer.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+void ke::RangeAllocator::reset(uint64_t capacity)
+{
+	mFreeByOffset.clear();
+	mFreeBySize.clear();
+	mCapacity = capacity;
+	mUsed = 0;
+	if (capacity > 0)
+		insertFree(0, capacity);
+}
+
+uint64_t ke::RangeAllocator::allocate(uint64_t size)
+{
+	if (size == 0)
+		return INVALID;
+	auto fit = mFreeBySize.lower_bound({ size, 0 });
+	if (fit == mFreeBySize.end())
+		return INVALID;
+
+	uint64_t offset = fit->second, rangeSize = fit->first;
+	eraseFree(mFreeByOffset.find(offset));
+	if (rangeSize > size)
+		insertFree(offset + size, rangeSize - size);
+	mUsed += size;
+	return offset;
+}
+
+void ke::RangeAllocator::free(uint64_t offset, uint64_t size)
+{
+	if (size == 0)
+		return;
+	mUsed -= size;
+
+	auto next = mFreeByOffset.lower_bound(offset);
+	if (next != mFreeByOffset.end() && next->first == offset + size)
+	{
+		size += next->second;
+		next = std::next(next);
+		eraseFree(std::prev(next));
+	}
+	if (next != mFreeByOffset.begin())
+	{
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			eraseFree(previous);
+		}
+	}
+	insertFree(offset, size);
+}
+
+uint64_t ke::RangeAllocator::getCapacity() const
+{
+	return mCapacity;
+}
+
+uint64_t ke::RangeAllocator::getUsed() const
+{
+	return mUsed;
+}
+
+uint32_t ke::RangeAllocator::getFreeRangeCount() const
+{
+	return static_cast<uint32_t>(mFreeByOffset.size());
+}
+
+uint64_t ke::RangeAllocator::getLargestFreeRange() const
+{
+	return mFreeBySize.empty() ? 0 : mFreeBySize.rbegin()->first;
+}
+
+float ke::RangeAllocator::getFragmentation() const
+{
+	uint64_t free = mCapacity - mUsed;
+	if (free == 0)
+		return 0.0f;
+	return 1.0f - static_cast<float>(getLargestFreeRange()) / static_cast<float>(free);
+}
+
+void ke::RangeAllocator::insertFree(uint64_t offset, uint64_t size)
+{
+	mFreeByOffset.emplace(offset, size);
+	mFreeBySize.emplace(size, offset);
+}
+
+void ke::RangeAllocator::eraseFree(std::map<uint64_t, uint64_t>::iterator it)
+{
+	mFreeBySize.erase({ it->second, it->first });
+	mFreeByOffset.erase(it);
+}
+
+void ke::GeometryBuffer::init(Renderer& renderer, uint32_t vertexStride, uint32_t vertexCapacity, uint32_t indexCapacity)
+{
+	mRenderer = &renderer;
+	mStride = vertexStride;
+	mVertexRanges.reset(0);
+	mIndexRanges.reset(0);
+	if (!rebuild(std::max(vertexCapacity, 1u), std::max(indexCapacity, 1u)))
+		return;
+
+	// Runs after the frame fence wait, so frames that could still read a freed range have finished.
+	mHook = renderer.addRenderGraphHook(RenderGraphStage::BeforeMainPass, [this](RenderGraph&)
+		{
+			releaseRetired(false);
+		});
+
+	if (enableLogging)
+		mLogger.info("Created geometry buffer for {} vertices and {} indices.", vertexCapacity, indexCapacity);
+}
+
+void ke::GeometryBuffer::cleanup()
+{
+	if (mHook != UINT32_MAX)
+		mRenderer->removeRenderGraphHook(mHook);
+	mHook = UINT32_MAX;
+	releaseRetired(true);
+	mRenderer->destroyBuffer(mVertices);
+	mRenderer->destroyBuffer(mIndices);
+	mMeshes.clear();
+	mFreeMeshes.clear();
+	mPendingFrees.clear();
+	mMeshCount = 0;
+}
+
+uint32_t ke::GeometryBuffer::addMesh(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+{
+	if (vertexCount == 0 || indexCount == 0)
+	{
+		if (enableLogging)
+			mLogger.error("Cannot add a mesh without vertices or indices!");
+		return UINT32_MAX;
+	}
+
+	releaseRetired(false);
+	uint64_t vertexOffset = mVertexRanges.allocate(vertexCount);
+	uint64_t firstIndex = mIndexRanges.allocate(indexCount);
+	if (vertexOffset == RangeAllocator::INVALID || firstIndex == RangeAllocator::INVALID)
+	{
+		if (vertexOffset != RangeAllocator::INVALID)
+			mVertexRanges.free(vertexOffset, vertexCount);
+		if (firstIndex != RangeAllocator::INVALID)
+			mIndexRanges.free(firstIndex, indexCount);
+		if (!reserve(vertexCount, indexCount))
+			return UINT32_MAX;
+		// Compaction leaves all free space in one range at the end of each buffer.
+		vertexOffset = mVertexRanges.allocate(vertexCount);
+		firstIndex = mIndexRanges.allocate(indexCount);
+	}
+
+	mRenderer->uploadBuffer(mVertices, vertices, static_cast<VkDeviceSize>(vertexCount) * mStride, vertexOffset * mStride);
+	mRenderer->uploadBuffer(mIndices, indices, static_cast<VkDeviceSize>(indexCount) * sizeof(uint32_t), firstIndex * sizeof(uint32_t));
+
+	uint32_t index;
+	if (!mFreeMeshes.empty())
+	{
+		index = mFreeMeshes.back();
+		mFreeMeshes.pop_back();
+	}
+	else
+	{
+		index = static_cast<uint32_t>(mMeshes.size());
+		mMeshes.emplace_back();
+	}
+	Mesh& mesh = mMeshes[index];
+	mesh.alive = true;
+	mesh.range = { static_cast<uint32_t>(firstIndex), indexCount, static_cast<int32_t>(vertexOffset), vertexCount };
+	mMeshCount++;
+	return index;
+}
+
+void ke::GeometryBuffer::removeMesh(uint32_t mesh)
+{
+	if (mesh >= mMeshes.size() || !mMeshes[mesh].alive)
+		return;
+	mPendingFrees.push_back({ mMeshes[mesh].range, getFrame() });
+	mMeshes[mesh].alive = false;
+	mFreeMeshes.push_back(mesh);
+	mMeshCount--;
+}
+
+const ke::GeometryRange& ke::GeometryBuffer::getRange(uint32_t mesh) const
+{
+	return mMeshes[mesh].range;
+}
+
+VkDrawIndexedIndirectCommand ke::GeometryBuffer::getDrawCommand(uint32_t mesh, uint32_t instanceCount, uint32_t firstInstance) const
+{
+	const GeometryRange& range = mMeshes[mesh].range;
+	return { range.indexCount, instanceCount, range.firstIndex, range.vertexOffset, firstInstance };
+}
+
+void ke::GeometryBuffer::bind(VkCommandBuffer cmd, uint32_t vertexBinding)
+{
+	VkDeviceSize offset = 0;
+	mRenderer->bindVertexBuffers(cmd, vertexBinding, 1, &mVertices.buffer, &offset);
+	mRenderer->bindIndexBuffer(cmd, mIndices.buffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+void ke::GeometryBuffer::defragment()
+{
+	if (rebuild(mVertexRanges.getCapacity(), mIndexRanges.getCapacity()))
+		mDefragmentations++;
+}
+
+uint32_t ke::GeometryBuffer::getLayoutVersion() const
+{
+	return mLayoutVersion;
+}
+
+VkBuffer ke::GeometryBuffer::getVertexBuffer() const
+{
+	return mVertices.buffer;
+}
+
+VkBuffer ke::GeometryBuffer::getIndexBuffer() const
+{
+	return mIndices.buffer;
+}
+
+ke::GeometryStats ke::GeometryBuffer::getStats() const
+{
+	GeometryStats stats;
+	stats.meshCount = mMeshCount;
+	stats.vertexUsed = mVertexRanges.getUsed();
+	stats.vertexCapacity = mVertexRanges.getCapacity();
+	stats.indexUsed = mIndexRanges.getUsed();
+	stats.indexCapacity = mIndexRanges.getCapacity();
+	stats.residentBytes = mVertices.size + mIndices.size;
+	for (const auto& retired : mRetired)
+		stats.residentBytes += retired.vertices.size + retired.indices.size;
+	stats.freeRanges = mVertexRanges.getFreeRangeCount() + mIndexRanges.getFreeRangeCount();
+	stats.fragmentation = std::max(mVertexRanges.getFragmentation(), mIndexRanges.getFragmentation());
+	stats.defragmentations = mDefragmentations;
+	stats.grows = mGrows;
+	return stats;
+}
+
+bool ke::GeometryBuffer::reserve(uint32_t vertexCount, uint32_t indexCount)
+{
+	uint64_t liveVertices = 0, liveIndices = 0;
+	for (const auto& mesh : mMeshes)
+		if (mesh.alive)
+		{
+			liveVertices += mesh.range.vertexCount;
+			liveIndices += mesh.range.indexCount;
+		}
+
+	// vertexOffset is signed and firstIndex unsigned 32-bit in draw commands.
+	uint64_t neededVertices = liveVertices + vertexCount, neededIndices = liveIndices + indexCount;
+	if (neededVertices > INT32_MAX || neededIndices > UINT32_MAX)
+	{
+		if (enableLogging)
+			mLogger.error("Geometry buffer cannot address {} vertices and {} indices!", neededVertices, neededIndices);
+		return false;
+	}
+
+	uint64_t vertexCapacity = mVertexRanges.getCapacity(), indexCapacity = mIndexRanges.getCapacity();
+	bool grow = false;
+	if (neededVertices > vertexCapacity)
+	{
+		vertexCapacity = std::min<uint64_t>(std::max(vertexCapacity * 2, neededVertices), INT32_MAX);
+		grow = true;
+	}
+	if (neededIndices > indexCapacity)
+	{
+		indexCapacity = std::min<uint64_t>(std::max(indexCapacity * 2, neededIndices), UINT32_MAX);
+		grow = true;
+	}
+
+	if (!rebuild(vertexCapacity, indexCapacity))
+		return false;
+	if (grow)
+		mGrows++;
+	else
+		mDefragmentations++;
+	if (enableLogging)
+		mLogger.debug("{} geometry buffer to {} vertices and {} indices.", grow ? "Grew" : "Compacted", vertexCapacity, indexCapacity);
+	return true;
+}
+
+bool ke::GeometryBuffer::rebuild(uint64_t vertexCapacity, uint64_t indexCapacity)
+{
+	KE_PROFILE_FUNCTION();
+	Buffer vertices = mRenderer->createBuffer(vertexCapacity * mStride, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	Buffer indices = mRenderer->createBuffer(indexCapacity * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (vertices.buffer == VK_NULL_HANDLE || indices.buffer == VK_NULL_HANDLE)
+	{
+		if (enableLogging)
+			mLogger.error("Failed to create geometry buffers for {} vertices and {} indices!", vertexCapacity, indexCapacity);
+		mRenderer->destroyBuffer(vertices);
+		mRenderer->destroyBuffer(indices);
+		return false;
+	}
+
+	// Live meshes are packed in their current order, so neighbours stay neighbours and copies merge into few regions.
+	std::vector<uint32_t> byVertex, byIndex;
+	for (uint32_t i = 0; i < mMeshes.size(); i++)
+		if (mMeshes[i].alive)
+			byVertex.push_back(i);
+	byIndex = byVertex;
+	std::sort(byVertex.begin(), byVertex.end(), [this](uint32_t a, uint32_t b) { return mMeshes[a].range.vertexOffset < mMeshes[b].range.vertexOffset; });
+	std::sort(byIndex.begin(), byIndex.end(), [this](uint32_t a, uint32_t b) { return mMeshes[a].range.firstIndex < mMeshes[b].range.firstIndex; });
+
+	auto addRegion = [](std::vector<VkBufferCopy>& regions, VkDeviceSize src, VkDeviceSize dst, VkDeviceSize size)
+		{
+			if (!regions.empty() && regions.back().srcOffset + regions.back().size == src && regions.back().dstOffset + regions.back().size == dst)
+				regions.back().size += size;
+			else
+				regions.push_back({ src, dst, size });
+		};
+
+	mVertexRanges.reset(vertexCapacity);
+	mIndexRanges.reset(indexCapacity);
+	std::vector<VkBufferCopy> vertexRegions, indexRegions;
+	for (uint32_t i : byVertex)
+	{
+		GeometryRange& range = mMeshes[i].range;
+		uint64_t offset = mVertexRanges.allocate(range.vertexCount);
+		addRegion(vertexRegions, static_cast<VkDeviceSize>(range.vertexOffset) * mStride, offset * mStride, static_cast<VkDeviceSize>(range.vertexCount) * mStride);
+		range.vertexOffset = static_cast<int32_t>(offset);
+	}
+	for (uint32_t i : byIndex)
+	{
+		GeometryRange& range = mMeshes[i].range;
+		uint64_t offset = mIndexRanges.allocate(range.indexCount);
+		addRegion(indexRegions, range.firstIndex * sizeof(uint32_t), offset * sizeof(uint32_t), range.indexCount * sizeof(uint32_t));
+		range.firstIndex = static_cast<uint32_t>(offset);
+	}
+
+	if (!vertexRegions.empty())
+		mRenderer->submitImmediate([&](VkCommandBuffer cmd)
+			{
+				const VkuDeviceDispatchTable& vkd = mRenderer->getDeviceTable();
+				vkd.CmdCopyBuffer(cmd, mVertices.buffer, vertices.buffer, static_cast<uint32_t>(vertexRegions.size()), vertexRegions.data());
+				vkd.CmdCopyBuffer(cmd, mIndices.buffer, indices.buffer, static_cast<uint32_t>(indexRegions.size()), indexRegions.data());
+			});
+
+	// Frames in flight may still draw from the old buffers. Ranges freed in them no longer exist in the new ones.
+	if (mVertices.buffer != VK_NULL_HANDLE)
+		mRetired.push_back({ mVertices, mIndices, getFrame() });
+	mPendingFrees.clear();
+	mVertices = vertices;
+	mIndices = indices;
+	mLayoutVersion++;
+	return true;
+}
+
+void ke::GeometryBuffer::releaseRetired(bool all)
+{
+	uint64_t frame = getFrame();
+	uint32_t framesInFlight = mRenderer->getMaxFramesInFlight();
+	for (size_t i = 0; i < mPendingFrees.size();)
+	{
+		if (all || frame >= mPendingFrees[i].retireFrame + framesInFlight)
+		{
+			const GeometryRange& range = mPendingFrees[i].range;
+			mVertexRanges.free(static_cast<uint64_t>(range.vertexOffset), range.vertexCount);
+			mIndexRanges.free(range.firstIndex, range.indexCount);
+			mPendingFrees[i] = mPendingFrees.back();
+			mPendingFrees.pop_back();
+		}
+		else
+			i++;
+	}
+	for (size_t i = 0; i < mRetired.size();)
+	{
+		if (all || frame >= mRetired[i].retireFrame + framesInFlight)
+		{
+			mRenderer->destroyBuffer(mRetired[i].vertices);
+			mRenderer->destroyBuffer(mRetired[i].indices);
+			mRetired[i] = mRetired.back();
+			mRetired.pop_back();
+		}
+		else
+			i++;
+	}
+}
+
+uint64_t ke::GeometryBuffer::getFrame()
+{
+	return mRenderer->getStats().getCurrent().frame;
+}
\ No newline at end of file
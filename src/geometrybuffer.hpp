@@ -0,0 +1,132 @@
+#pragma once
+#include "renderer.hpp"
+#include <map>
+#include <set>
+#include <vector>
+
+namespace ke
+{
+	// Best-fit allocator over an abstract range of elements. Freed ranges are merged with their neighbours.
+	class RangeAllocator
+	{
+	public:
+		static constexpr uint64_t INVALID = UINT64_MAX;
+
+		void reset(uint64_t capacity);
+		uint64_t allocate(uint64_t size);
+		void free(uint64_t offset, uint64_t size);
+
+		uint64_t getCapacity() const;
+		uint64_t getUsed() const;
+		uint32_t getFreeRangeCount() const;
+		uint64_t getLargestFreeRange() const;
+		// 0 when all free space is one range, approaching 1 as it splits into many small ones.
+		float getFragmentation() const;
+	private:
+		void insertFree(uint64_t offset, uint64_t size);
+		void eraseFree(std::map<uint64_t, uint64_t>::iterator it);
+	private:
+		std::map<uint64_t, uint64_t> mFreeByOffset;
+		std::set<std::pair<uint64_t, uint64_t>> mFreeBySize;
+		uint64_t mCapacity = 0;
+		uint64_t mUsed = 0;
+	};
+
+	// Where a mesh lives in the shared buffers, in the terms vkCmdDrawIndexed takes.
+	struct GeometryRange
+	{
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		int32_t vertexOffset = 0;
+		uint32_t vertexCount = 0;
+	};
+
+	struct GeometryStats
+	{
+		uint32_t meshCount = 0;
+		// In elements. Used includes ranges freed while frames in flight may still read them.
+		uint64_t vertexUsed = 0;
+		uint64_t vertexCapacity = 0;
+		uint64_t indexUsed = 0;
+		uint64_t indexCapacity = 0;
+		VkDeviceSize residentBytes = 0;
+		uint32_t freeRanges = 0;
+		// The worse of the vertex and index allocators.
+		float fragmentation = 0.0f;
+		uint32_t defragmentations = 0;
+		uint32_t grows = 0;
+	};
+
+	// Static mesh data of many meshes in one device-local vertex buffer and one 32-bit index buffer, so a whole pass
+	// binds once and can draw every mesh from a single indirect buffer. Indices stay local to their mesh and are
+	// rebased through vertexOffset. When a mesh doesn't fit, live meshes are compacted into new buffers, grown if the
+	// free space alone isn't enough. Ranges move when that happens, so indirect commands must be rebuilt whenever
+	// getLayoutVersion changes.
+	class GeometryBuffer
+	{
+	public:
+		void init(Renderer& renderer, uint32_t vertexStride, uint32_t vertexCapacity, uint32_t indexCapacity);
+		void cleanup();
+
+		uint32_t addMesh(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+		// The ranges are reused once every frame in flight that could draw them has finished.
+		void removeMesh(uint32_t mesh);
+		const GeometryRange& getRange(uint32_t mesh) const;
+		VkDrawIndexedIndirectCommand getDrawCommand(uint32_t mesh, uint32_t instanceCount = 1, uint32_t firstInstance = 0) const;
+
+		// Binds the vertex buffer at vertexBinding and the index buffer.
+		void bind(VkCommandBuffer cmd, uint32_t vertexBinding = 0);
+		// Packs every live mesh to the front of new buffers. Blocks until the copy has finished.
+		void defragment();
+		uint32_t getLayoutVersion() const;
+
+		VkBuffer getVertexBuffer() const;
+		VkBuffer getIndexBuffer() const;
+		GeometryStats getStats() const;
+	private:
+		struct Mesh
+		{
+			bool alive = false;
+			GeometryRange range;
+		};
+
+		struct PendingFree
+		{
+			GeometryRange range;
+			uint64_t retireFrame = 0;
+		};
+
+		struct Retired
+		{
+			Buffer vertices;
+			Buffer indices;
+			uint64_t retireFrame = 0;
+		};
+	private:
+		bool reserve(uint32_t vertexCount, uint32_t indexCount);
+		bool rebuild(uint64_t vertexCapacity, uint64_t indexCapacity);
+		void releaseRetired(bool all);
+		uint64_t getFrame();
+	private:
+		Renderer* mRenderer = nullptr;
+		uint32_t mStride = 0;
+		uint32_t mHook = UINT32_MAX;
+
+		Buffer mVertices;
+		Buffer mIndices;
+		RangeAllocator mVertexRanges;
+		RangeAllocator mIndexRanges;
+
+		std::vector<Mesh> mMeshes;
+		std::vector<uint32_t> mFreeMeshes;
+		std::vector<PendingFree> mPendingFrees;
+		std::vector<Retired> mRetired;
+
+		uint32_t mMeshCount = 0;
+		uint32_t mLayoutVersion = 0;
+		uint32_t mDefragmentations = 0;
+		uint32_t mGrows = 0;
+
+		ke::Logger mLogger = ke::Logger("Geometry Buffer Logger", spdlog::level::debug);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "gputimer.hpp"
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+void ke::GpuTimer::init(Renderer& renderer, uint32_t maxScopes)
+{
+	mRenderer = &renderer;
+	mMaxScopes = maxScopes;
+	mResults.assign(maxScopes, 0.0);
+	mTimestamps.resize(static_cast<size_t>(maxScopes) * 2);
+	mSlotReset.assign(renderer.getMaxFramesInFlight(), 0);
+
+	uint32_t familyCount = 0;
+	renderer.getInstanceTable().GetPhysicalDeviceQueueFamilyProperties(renderer.getPhysicalDevice(), &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	renderer.getInstanceTable().GetPhysicalDeviceQueueFamilyProperties(renderer.getPhysicalDevice(), &familyCount, families.data());
+	uint32_t validBits = families[renderer.getGraphicsQueueFamily()].timestampValidBits;
+
+	const DeviceCapabilities& caps = renderer.getCapabilities();
+	mSupported = validBits > 0 && caps.timestampPeriod > 0.0f;
+	mPeriodNs = caps.timestampPeriod;
+	mValidMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+	if (!mSupported)
+	{
+		if (enableLogging)
+			mLogger.warn("Graphics queue has no timestamp support, GPU timings will read zero.");
+		return;
+	}
+
+	VkQueryPoolCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	createInfo.queryCount = maxScopes * 2 * renderer.getMaxFramesInFlight();
+	if (renderer.getDeviceTable().CreateQueryPool(renderer.getDevice(), &createInfo, renderer.getAllocationCallbacks(), &mQueryPool) != VK_SUCCESS)
+	{
+		mSupported = false;
+		if (enableLogging)
+			mLogger.error("Failed to create timestamp query pool!");
+		return;
+	}
+
+	// The hook runs after the frame fence wait, so the previous contents of this slot are final.
+	mHook = renderer.addRenderGraphHook(RenderGraphStage::BeforeMainPass, [this](RenderGraph& graph)
+		{
+			uint32_t slot = mRenderer->getCurrentFrameInFlight();
+			if (mSlotReset[slot])
+				resolve(slot);
+			mSlotReset[slot] = 1;
+			RGPass pass = graph.addPass("gpu timer reset", [this, slot](VkCommandBuffer cmd)
+				{
+					mRenderer->getDeviceTable().CmdResetQueryPool(cmd, mQueryPool, slot * mMaxScopes * 2, mMaxScopes * 2);
+				});
+			graph.setSideEffect(pass);
+		});
+
+	if (enableLogging)
+		mLogger.info("Created GPU timer with {} scopes, {} ns per tick.", maxScopes, mPeriodNs);
+}
+
+void ke::GpuTimer::cleanup()
+{
+	if (mQueryPool == VK_NULL_HANDLE)
+		return;
+	mRenderer->removeRenderGraphHook(mHook);
+	mRenderer->getDeviceTable().DestroyQueryPool(mRenderer->getDevice(), mQueryPool, mRenderer->getAllocationCallbacks());
+	mQueryPool = VK_NULL_HANDLE;
+}
+
+uint32_t ke::GpuTimer::registerScope(const std::string& name)
+{
+	if (mNames.size() >= mMaxScopes)
+	{
+		if (enableLogging)
+			mLogger.error("GPU timer is out of scopes, {} is not timed.", name);
+		return UINT32_MAX;
+	}
+	mNames.push_back(name);
+	return static_cast<uint32_t>(mNames.size() - 1);
+}
+
+void ke::GpuTimer::begin(VkCommandBuffer cmd, uint32_t scope)
+{
+	if (!mSupported || scope >= mMaxScopes)
+		return;
+	uint32_t query = (mRenderer->getCurrentFrameInFlight() * mMaxScopes + scope) * 2;
+	mRenderer->getDeviceTable().CmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, mQueryPool, query);
+}
+
+void ke::GpuTimer::end(VkCommandBuffer cmd, uint32_t scope)
+{
+	if (!mSupported || scope >= mMaxScopes)
+		return;
+	uint32_t query = (mRenderer->getCurrentFrameInFlight() * mMaxScopes + scope) * 2 + 1;
+	mRenderer->getDeviceTable().CmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mQueryPool, query);
+}
+
+void ke::GpuTimer::resolve(uint32_t slot)
+{
+	uint32_t count = static_cast<uint32_t>(mNames.size());
+	if (count == 0)
+		return;
+
+	// Scopes that were not written last time around stay unavailable and keep their previous result.
+	const VkuDeviceDispatchTable& vkd = mRenderer->getDeviceTable();
+	for (uint32_t scope = 0; scope < count; scope++)
+	{
+		uint32_t query = (slot * mMaxScopes + scope) * 2;
+		VkResult result = vkd.GetQueryPoolResults(mRenderer->getDevice(), mQueryPool, query, 2, sizeof(uint64_t) * 2,
+			&mTimestamps[scope * 2], sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+		if (result != VK_SUCCESS)
+			continue;
+		uint64_t ticks = (mTimestamps[scope * 2 + 1] - mTimestamps[scope * 2]) & mValidMask;
+		mResults[scope] = static_cast<double>(ticks) * mPeriodNs * 1e-6;
+	}
+}
+
+double ke::GpuTimer::getMilliseconds(uint32_t scope) const
+{
+	return scope < mResults.size() ? mResults[scope] : 0.0;
+}
+
+const std::string& ke::GpuTimer::getName(uint32_t scope) const
+{
+	return mNames[scope];
+}
+
+uint32_t ke::GpuTimer::getScopeCount() const
+{
+	return static_cast<uint32_t>(mNames.size());
+}
+
+bool ke::GpuTimer::isSupported() const
+{
+	return mSupported;
+}
\ No newline at end of file
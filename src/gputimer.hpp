@@ -0,0 +1,45 @@
+#pragma once
+#include "renderer.hpp"
+#include <string>
+#include <vector>
+
+namespace ke
+{
+	// Named timestamp scopes on the graphics queue. Every frame in flight owns its own slice of the query pool,
+	// which is read back and reset once the renderer has waited for that frame's fence.
+	class GpuTimer
+	{
+	public:
+		// Registers a render graph hook that resets the frame's queries, so it must come before any system that
+		// records scopes in its own hooks.
+		void init(Renderer& renderer, uint32_t maxScopes = 16);
+		void cleanup();
+
+		uint32_t registerScope(const std::string& name);
+		void begin(VkCommandBuffer cmd, uint32_t scope);
+		void end(VkCommandBuffer cmd, uint32_t scope);
+
+		// Latest resolved duration, one full frames-in-flight cycle behind recording.
+		double getMilliseconds(uint32_t scope) const;
+		const std::string& getName(uint32_t scope) const;
+		uint32_t getScopeCount() const;
+		bool isSupported() const;
+	private:
+		void resolve(uint32_t slot);
+	private:
+		Renderer* mRenderer = nullptr;
+		VkQueryPool mQueryPool = VK_NULL_HANDLE;
+		uint32_t mMaxScopes = 0;
+		uint32_t mHook = 0;
+		bool mSupported = false;
+		double mPeriodNs = 1.0;
+		uint64_t mValidMask = ~0ull;
+
+		std::vector<std::string> mNames;
+		std::vector<double> mResults;
+		std::vector<uint64_t> mTimestamps;
+		std::vector<uint8_t> mSlotReset;
+
+		ke::Logger mLogger = ke::Logger("GPU Timer Logger", spdlog::level::debug);
+	};
+}
\ No newline at end of file
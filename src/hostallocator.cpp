@@ -0,0 +1,243 @@
+#include "hostallocator.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+static const char* scopeNames[] = { "command", "object", "cache", "device", "instance" };
+
+static uintptr_t alignUp(uintptr_t value, size_t alignment)
+{
+	return (value + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+}
+
+void ke::HostAllocator::init(HostAllocatorMode mode, uint32_t framesInFlight, size_t arenaSize)
+{
+	mMode = mode;
+
+	mCallbacks = {};
+	mCallbacks.pUserData = this;
+	mCallbacks.pfnAllocation = allocationCallback;
+	mCallbacks.pfnReallocation = reallocationCallback;
+	mCallbacks.pfnFree = freeCallback;
+	mCallbacks.pfnInternalAllocation = internalAllocationCallback;
+	mCallbacks.pfnInternalFree = internalFreeCallback;
+
+	if (mMode == HostAllocatorMode::Arena)
+	{
+		for (uint32_t i = 0; i < framesInFlight; i++)
+		{
+			auto arena = std::make_unique<Arena>();
+			arena->memory = std::make_unique<char[]>(arenaSize);
+			arena->size = arenaSize;
+			mArenas.push_back(std::move(arena));
+		}
+	}
+
+	if (enableLogging && mMode != HostAllocatorMode::Default)
+		mLogger.info("Using {} host allocation callbacks.", mMode == HostAllocatorMode::Arena ? "arena-backed" : "tracking");
+}
+
+void ke::HostAllocator::cleanup()
+{
+	mArenas.clear();
+}
+
+const VkAllocationCallbacks* ke::HostAllocator::getCallbacks() const
+{
+	return mMode == HostAllocatorMode::Default ? nullptr : &mCallbacks;
+}
+
+ke::HostAllocatorMode ke::HostAllocator::getMode() const
+{
+	return mMode;
+}
+
+void ke::HostAllocator::beginFrame(uint32_t frameSlot)
+{
+	if (mArenas.empty())
+		return;
+	uint32_t arena = frameSlot % static_cast<uint32_t>(mArenas.size());
+	mArenas[arena]->offset.store(0, std::memory_order_relaxed);
+	mCurrentArena.store(arena, std::memory_order_release);
+}
+
+void* ke::HostAllocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	if (size == 0)
+		return nullptr;
+	alignment = std::max(alignment, alignof(Header));
+
+	void* memory = nullptr;
+	if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND && !mArenas.empty())
+		memory = allocateFromArena(size, alignment);
+
+	if (!memory)
+	{
+		void* base = std::malloc(size + alignment + sizeof(Header));
+		if (!base)
+			return nullptr;
+		memory = reinterpret_cast<void*>(alignUp(reinterpret_cast<uintptr_t>(base) + sizeof(Header), alignment));
+		Header* header = reinterpret_cast<Header*>(memory) - 1;
+		header->base = base;
+		header->fromArena = 0;
+	}
+
+	Header* header = reinterpret_cast<Header*>(memory) - 1;
+	header->size = size;
+	header->scope = static_cast<uint32_t>(scope);
+	track(header->scope, static_cast<int64_t>(size));
+	return memory;
+}
+
+void* ke::HostAllocator::allocateFromArena(size_t size, size_t alignment)
+{
+	Arena& arena = *mArenas[mCurrentArena.load(std::memory_order_acquire)];
+	uintptr_t base = reinterpret_cast<uintptr_t>(arena.memory.get());
+
+	size_t offset = arena.offset.load(std::memory_order_relaxed);
+	uintptr_t memory;
+	size_t end;
+	do
+	{
+		memory = alignUp(base + offset + sizeof(Header), alignment);
+		end = memory + size - base;
+		if (end > arena.size)
+			return nullptr;
+	} while (!arena.offset.compare_exchange_weak(offset, end, std::memory_order_relaxed));
+
+	Header* header = reinterpret_cast<Header*>(memory) - 1;
+	header->base = nullptr;
+	header->fromArena = 1;
+	mArenaAllocations.fetch_add(1, std::memory_order_relaxed);
+	return reinterpret_cast<void*>(memory);
+}
+
+void* ke::HostAllocator::reallocate(void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	if (!original)
+		return allocate(size, alignment, scope);
+	if (size == 0)
+	{
+		release(original);
+		return nullptr;
+	}
+
+	const Header* header = reinterpret_cast<const Header*>(original) - 1;
+	void* memory = allocate(size, alignment, scope);
+	if (memory)
+	{
+		std::memcpy(memory, original, std::min(size, header->size));
+		release(original);
+	}
+	return memory;
+}
+
+void ke::HostAllocator::release(void* memory)
+{
+	if (!memory)
+		return;
+
+	Header* header = reinterpret_cast<Header*>(memory) - 1;
+	track(header->scope, -static_cast<int64_t>(header->size));
+	// Arena memory is reclaimed wholesale when its frame slot comes round again.
+	if (!header->fromArena)
+		std::free(header->base);
+}
+
+void ke::HostAllocator::track(uint32_t scope, int64_t bytes)
+{
+	ScopeCounters& counters = mScopes[std::min(scope, scopeCount - 1)];
+	if (bytes > 0)
+	{
+		counters.allocations.fetch_add(1, std::memory_order_relaxed);
+		counters.totalBytes.fetch_add(static_cast<uint64_t>(bytes), std::memory_order_relaxed);
+	}
+	else
+		counters.frees.fetch_add(1, std::memory_order_relaxed);
+
+	int64_t live = counters.liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	int64_t peak = counters.peakBytes.load(std::memory_order_relaxed);
+	while (live > peak && !counters.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed));
+}
+
+ke::HostScopeStats ke::HostAllocator::getScopeStats(VkSystemAllocationScope scope) const
+{
+	const ScopeCounters& counters = mScopes[std::min(static_cast<uint32_t>(scope), scopeCount - 1)];
+	HostScopeStats stats;
+	stats.allocations = counters.allocations.load(std::memory_order_relaxed);
+	stats.frees = counters.frees.load(std::memory_order_relaxed);
+	stats.liveBytes = static_cast<uint64_t>(std::max<int64_t>(0, counters.liveBytes.load(std::memory_order_relaxed)));
+	stats.peakBytes = static_cast<uint64_t>(counters.peakBytes.load(std::memory_order_relaxed));
+	stats.totalBytes = counters.totalBytes.load(std::memory_order_relaxed);
+	stats.internalBytes = static_cast<uint64_t>(std::max<int64_t>(0, counters.internalBytes.load(std::memory_order_relaxed)));
+	return stats;
+}
+
+uint64_t ke::HostAllocator::getAllocationCount() const
+{
+	uint64_t count = 0;
+	for (const auto& counters : mScopes)
+		count += counters.allocations.load(std::memory_order_relaxed);
+	return count;
+}
+
+uint64_t ke::HostAllocator::getAllocatedBytes() const
+{
+	uint64_t bytes = 0;
+	for (const auto& counters : mScopes)
+		bytes += counters.totalBytes.load(std::memory_order_relaxed);
+	return bytes;
+}
+
+uint64_t ke::HostAllocator::getArenaAllocationCount() const
+{
+	return mArenaAllocations.load(std::memory_order_relaxed);
+}
+
+void ke::HostAllocator::logStats() const
+{
+	if (!enableLogging || mMode == HostAllocatorMode::Default)
+		return;
+
+	for (uint32_t scope = 0; scope < scopeCount; scope++)
+	{
+		HostScopeStats stats = getScopeStats(static_cast<VkSystemAllocationScope>(scope));
+		mLogger.info("{} scope: {} allocations, {} frees, {} bytes live, {} bytes peak, {} bytes total, {} bytes internal",
+			scopeNames[scope], stats.allocations, stats.frees, stats.liveBytes, stats.peakBytes, stats.totalBytes, stats.internalBytes);
+	}
+	if (mMode == HostAllocatorMode::Arena)
+		mLogger.info("{} command-scope allocations served from frame arenas.", getArenaAllocationCount());
+}
+
+void* VKAPI_CALL ke::HostAllocator::allocationCallback(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	return static_cast<HostAllocator*>(userData)->allocate(size, alignment, scope);
+}
+
+void* VKAPI_CALL ke::HostAllocator::reallocationCallback(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	return static_cast<HostAllocator*>(userData)->reallocate(original, size, alignment, scope);
+}
+
+void VKAPI_CALL ke::HostAllocator::freeCallback(void* userData, void* memory)
+{
+	static_cast<HostAllocator*>(userData)->release(memory);
+}
+
+void VKAPI_CALL ke::HostAllocator::internalAllocationCallback(void* userData, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+{
+	auto* allocator = static_cast<HostAllocator*>(userData);
+	allocator->mScopes[std::min(static_cast<uint32_t>(scope), scopeCount - 1)].internalBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+}
+
+void VKAPI_CALL ke::HostAllocator::internalFreeCallback(void* userData, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+{
+	auto* allocator = static_cast<HostAllocator*>(userData);
+	allocator->mScopes[std::min(static_cast<uint32_t>(scope), scopeCount - 1)].internalBytes.fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+}
\ No newline at end of file
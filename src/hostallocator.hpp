@@ -0,0 +1,97 @@
+#pragma once
+#include "vk.hpp"
+#include "logger.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ke
+{
+	enum class HostAllocatorMode
+	{
+		Default,	// nullptr callbacks, the driver uses its own heap
+		Tracking,	// heap allocations counted per VkSystemAllocationScope
+		Arena		// tracking, with command-scope allocations served from per-frame bump arenas
+	};
+
+	struct HostScopeStats
+	{
+		uint64_t allocations = 0;
+		uint64_t frees = 0;
+		uint64_t liveBytes = 0;
+		uint64_t peakBytes = 0;
+		uint64_t totalBytes = 0;
+		uint64_t internalBytes = 0;
+	};
+
+	class HostAllocator
+	{
+	public:
+		static constexpr uint32_t scopeCount = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+		void init(HostAllocatorMode mode, uint32_t framesInFlight, size_t arenaSize = 256 * 1024);
+		void cleanup();
+
+		// nullptr in Default mode. Objects must be destroyed with the same callbacks they were created with.
+		const VkAllocationCallbacks* getCallbacks() const;
+		HostAllocatorMode getMode() const;
+
+		// Recycles the arena of the given frame slot. Command-scope memory never outlives the call that
+		// requested it, so a slot is free again by the time the frame comes round.
+		void beginFrame(uint32_t frameSlot);
+
+		HostScopeStats getScopeStats(VkSystemAllocationScope scope) const;
+		uint64_t getAllocationCount() const;
+		uint64_t getAllocatedBytes() const;
+		uint64_t getArenaAllocationCount() const;
+		void logStats() const;
+	private:
+		struct Header
+		{
+			void* base;
+			size_t size;
+			uint32_t scope;
+			uint32_t fromArena;
+		};
+
+		struct ScopeCounters
+		{
+			std::atomic<uint64_t> allocations = 0;
+			std::atomic<uint64_t> frees = 0;
+			std::atomic<int64_t> liveBytes = 0;
+			std::atomic<int64_t> peakBytes = 0;
+			std::atomic<uint64_t> totalBytes = 0;
+			std::atomic<int64_t> internalBytes = 0;
+		};
+
+		struct Arena
+		{
+			std::unique_ptr<char[]> memory;
+			size_t size = 0;
+			std::atomic<size_t> offset = 0;
+		};
+
+		void* allocate(size_t size, size_t alignment, VkSystemAllocationScope scope);
+		void* reallocate(void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+		void release(void* memory);
+		void* allocateFromArena(size_t size, size_t alignment);
+		void track(uint32_t scope, int64_t bytes);
+
+		static VKAPI_ATTR void* VKAPI_CALL allocationCallback(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+		static VKAPI_ATTR void* VKAPI_CALL reallocationCallback(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+		static VKAPI_ATTR void VKAPI_CALL freeCallback(void* userData, void* memory);
+		static VKAPI_ATTR void VKAPI_CALL internalAllocationCallback(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+		static VKAPI_ATTR void VKAPI_CALL internalFreeCallback(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+	private:
+		HostAllocatorMode mMode = HostAllocatorMode::Default;
+		VkAllocationCallbacks mCallbacks{};
+
+		ScopeCounters mScopes[scopeCount];
+		std::vector<std::unique_ptr<Arena>> mArenas;
+		std::atomic<uint32_t> mCurrentArena = 0;
+		std::atomic<uint64_t> mArenaAllocations = 0;
+
+		ke::Logger mLogger = ke::Logger("Host Allocator Logger", spdlog::level::debug);
+	};
+}
\ No newline at end of file
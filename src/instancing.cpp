@@ -0,0 +1,161 @@
+#include "instancing.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+void ke::InstanceRenderer::init(Renderer& renderer, uint32_t maxInstances, InstanceFormat format)
+{
+	mRenderer = &renderer;
+	mMaxInstances = maxInstances;
+	mFormat = format;
+	mStride = format == InstanceFormat::Float32 ? sizeof(simd::Affine3x4) : sizeof(simd::Affine3x4Half);
+
+	mInstanceBuffers.resize(renderer.getMaxFramesInFlight());
+	for (auto& buffer : mInstanceBuffers)
+		buffer = renderer.createBuffer(static_cast<VkDeviceSize>(mStride) * maxInstances, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	VkFormat rowFormat = format == InstanceFormat::Float32 ? VK_FORMAT_R32G32B32A32_SFLOAT : VK_FORMAT_R16G16B16A16_SFLOAT;
+	uint32_t rowSize = mStride / 3;
+
+	GraphicsPipelineDesc desc{};
+	desc.vertexShader = "shader/bin/instanced_vert.spv";
+	desc.layout = renderer.getPipelineLayout();
+	desc.bindings.push_back({ 0, mStride, VK_VERTEX_INPUT_RATE_INSTANCE });
+	for (uint32_t row = 0; row < 3; row++)
+		desc.attributes.push_back({ row, 0, rowFormat, row * rowSize });
+
+	mPipeline = renderer.buildGraphicsPipeline(desc);
+
+	if (enableLogging)
+		mLogger.info("Created instance renderer for {} instances.", maxInstances);
+}
+
+void ke::InstanceRenderer::cleanup()
+{
+	for (auto& buffer : mInstanceBuffers)
+		mRenderer->destroyBuffer(buffer);
+	mRenderer->destroyPipeline(mPipeline);
+}
+
+uint32_t ke::InstanceRenderer::registerMesh(uint32_t vertexCount, uint32_t firstVertex)
+{
+	mMeshes.push_back({ vertexCount, firstVertex });
+	return static_cast<uint32_t>(mMeshes.size() - 1);
+}
+
+void ke::InstanceRenderer::submit(uint32_t mesh, const glm::mat4* transforms, uint32_t count)
+{
+	mSpans.push_back({ mesh, transforms, count });
+}
+
+void ke::InstanceRenderer::pack()
+{
+	std::stable_sort(mSpans.begin(), mSpans.end(), [](const Span& a, const Span& b) { return a.mesh < b.mesh; });
+
+	char* dst = static_cast<char*>(mInstanceBuffers[mRenderer->getCurrentFrameInFlight()].mapped);
+	mRanges.clear();
+	mInstanceCount = 0;
+
+	for (const auto& span : mSpans)
+	{
+		uint32_t count = std::min(span.count, mMaxInstances - mInstanceCount);
+		if (count < span.count && enableLogging)
+			mLogger.warn("Instance buffer is full, dropping {} instances.", span.count - count);
+		if (count == 0)
+			break;
+
+		char* out = dst + static_cast<size_t>(mInstanceCount) * mStride;
+		if (mFormat == InstanceFormat::Float32)
+			simd::packAffine(span.transforms, count, reinterpret_cast<simd::Affine3x4*>(out));
+		else
+			simd::packAffineHalf(span.transforms, count, reinterpret_cast<simd::Affine3x4Half*>(out));
+
+		if (!mRanges.empty() && mRanges.back().mesh == span.mesh)
+			mRanges.back().count += count;
+		else
+			mRanges.push_back({ span.mesh, mInstanceCount, count });
+		mInstanceCount += count;
+	}
+
+	mSpans.clear();
+	mRenderer->getStats().addUpload(static_cast<uint64_t>(mInstanceCount) * mStride);
+}
+
+void ke::InstanceRenderer::bind(VkCommandBuffer cmd)
+{
+	VkDeviceSize offset = 0;
+	mRenderer->bindPipeline(cmd, mPipeline);
+	mRenderer->bindVertexBuffers(cmd, 0, 1, &mInstanceBuffers[mRenderer->getCurrentFrameInFlight()].buffer, &offset);
+}
+
+void ke::InstanceRenderer::record(VkCommandBuffer cmd)
+{
+	KE_PROFILE_FUNCTION();
+	pack();
+	bind(cmd);
+
+	for (const auto& range : mRanges)
+	{
+		const Mesh& mesh = mMeshes[range.mesh];
+		mRenderer->draw(cmd, mesh.vertexCount, range.count, mesh.firstVertex, range.firstInstance);
+	}
+	mDrawCount = static_cast<uint32_t>(mRanges.size());
+}
+
+void ke::InstanceRenderer::recordPerDraw(VkCommandBuffer cmd)
+{
+	KE_PROFILE_FUNCTION();
+	pack();
+	bind(cmd);
+
+	for (const auto& range : mRanges)
+	{
+		const Mesh& mesh = mMeshes[range.mesh];
+		for (uint32_t i = 0; i < range.count; i++)
+			mRenderer->draw(cmd, mesh.vertexCount, 1, mesh.firstVertex, range.firstInstance + i);
+	}
+	mDrawCount = mInstanceCount;
+}
+
+void ke::InstanceRenderer::recordScene(VkCommandBuffer cmd, Scene& scene, uint32_t mesh)
+{
+	KE_PROFILE_FUNCTION();
+	uint32_t capacity = scene.getEntityCapacity();
+	if (mFormat != InstanceFormat::Float32 || capacity > mMaxInstances)
+	{
+		if (enableLogging)
+			mLogger.error("Cannot draw a scene of {} entities with this instance renderer!", capacity);
+		return;
+	}
+
+	uint32_t slot = mRenderer->getCurrentFrameInFlight();
+	mUploadedCount = scene.uploadDirty(slot, static_cast<simd::Affine3x4*>(mInstanceBuffers[slot].mapped));
+	mRenderer->getStats().addUpload(static_cast<uint64_t>(mUploadedCount) * mStride);
+
+	bind(cmd);
+	const Mesh& drawn = mMeshes[mesh];
+	mRenderer->draw(cmd, drawn.vertexCount, capacity, drawn.firstVertex, 0);
+	mInstanceCount = capacity;
+	mDrawCount = 1;
+}
+
+uint32_t ke::InstanceRenderer::getInstanceCount() const
+{
+	return mInstanceCount;
+}
+
+uint32_t ke::InstanceRenderer::getDrawCount() const
+{
+	return mDrawCount;
+}
+
+uint32_t ke::InstanceRenderer::getUploadedCount() const
+{
+	return mUploadedCount;
+}
\ No newline at end of file
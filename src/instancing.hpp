@@ -0,0 +1,80 @@
+#pragma once
+#include "renderer.hpp"
+#include "simd.hpp"
+#include "scene.hpp"
+#include <glm/glm.hpp>
+
+namespace ke
+{
+	enum class InstanceFormat
+	{
+		Float32,
+		Float16
+	};
+
+	// Draws many copies of a mesh with one instanced call per mesh. Transforms are packed into
+	// a per-frame instance buffer as 3x4 affine rows, in full or half precision.
+	class InstanceRenderer
+	{
+	public:
+		void init(Renderer& renderer, uint32_t maxInstances, InstanceFormat format = InstanceFormat::Float32);
+		void cleanup();
+
+		uint32_t registerMesh(uint32_t vertexCount, uint32_t firstVertex = 0);
+
+		// Transforms are only read when the batch is recorded, so they must stay alive until then.
+		void submit(uint32_t mesh, const glm::mat4* transforms, uint32_t count);
+
+		void record(VkCommandBuffer cmd);
+		void recordPerDraw(VkCommandBuffer cmd);
+		// Draws mesh once per entity of scene in a single call. The instance buffers are indexed by entity and keep
+		// their contents, so only transforms that changed since a buffer was last used are written. Needs Float32
+		// instances and maxInstances >= scene.getEntityCapacity(), and must not be mixed with submit on one renderer.
+		void recordScene(VkCommandBuffer cmd, Scene& scene, uint32_t mesh);
+
+		uint32_t getInstanceCount() const;
+		uint32_t getDrawCount() const;
+		// Transforms written by the last recordScene.
+		uint32_t getUploadedCount() const;
+	private:
+		struct Mesh
+		{
+			uint32_t vertexCount;
+			uint32_t firstVertex;
+		};
+
+		struct Span
+		{
+			uint32_t mesh;
+			const glm::mat4* transforms;
+			uint32_t count;
+		};
+
+		struct Range
+		{
+			uint32_t mesh;
+			uint32_t firstInstance;
+			uint32_t count;
+		};
+	private:
+		void pack();
+		void bind(VkCommandBuffer cmd);
+	private:
+		Renderer* mRenderer = nullptr;
+		InstanceFormat mFormat = InstanceFormat::Float32;
+		uint32_t mMaxInstances = 0;
+		uint32_t mStride = 0;
+
+		VkPipeline mPipeline = VK_NULL_HANDLE;
+		std::vector<Buffer> mInstanceBuffers;
+
+		std::vector<Mesh> mMeshes;
+		std::vector<Span> mSpans;
+		std::vector<Range> mRanges;
+		uint32_t mInstanceCount = 0;
+		uint32_t mDrawCount = 0;
+		uint32_t mUploadedCount = 0;
+
+		ke::Logger mLogger = ke::Logger("Instancing Logger", spdlog::level::debug);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,282 @@
+#include "lighting.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cmath>
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+void ke::ClusteredLighting::init(Renderer& renderer, uint32_t maxLights, const ClusterGridDesc& grid)
+{
+	mRenderer = &renderer;
+	mGrid = grid;
+	mMaxLights = maxLights;
+	mMaxIndices = getClusterCount() * grid.averageLightsPerCluster;
+
+	VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	uint32_t frames = renderer.getMaxFramesInFlight();
+	mParamBuffers.resize(frames);
+	mLightBuffers.resize(frames);
+	mReadback.resize(frames);
+	for (uint32_t i = 0; i < frames; i++)
+	{
+		mParamBuffers[i] = renderer.createBuffer(sizeof(ClusterParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, hostVisible);
+		mLightBuffers[i] = renderer.createBuffer(sizeof(GpuLight) * std::max(maxLights, 1u), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible);
+		mReadback[i] = renderer.createBuffer(sizeof(ClusterCounters), VK_BUFFER_USAGE_TRANSFER_DST_BIT, hostVisible);
+		*static_cast<ClusterCounters*>(mReadback[i].mapped) = ClusterCounters{};
+	}
+
+	VkMemoryPropertyFlags deviceLocal = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	mLightGrid = renderer.createBuffer(sizeof(uint32_t) * 2 * getClusterCount(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, deviceLocal);
+	mLightIndices = renderer.createBuffer(sizeof(uint32_t) * mMaxIndices, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, deviceLocal);
+	mCounters = renderer.createBuffer(sizeof(ClusterCounters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, deviceLocal);
+
+	createDescriptors();
+
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &mSetLayout;
+	if (renderer.getDeviceTable().CreatePipelineLayout(renderer.getDevice(), &layoutInfo, renderer.getAllocationCallbacks(), &mCullLayout) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create light cull pipeline layout!");
+	mCullPipeline = renderer.buildComputePipeline("shader/bin/light_cull.spv", mCullLayout);
+
+	mHook = renderer.addRenderGraphHook(RenderGraphStage::BeforeMainPass, [this](RenderGraph& graph) { addPasses(graph); });
+
+	if (enableLogging)
+		mLogger.info("Created clustered lighting for {} lights, {}x{}x{} clusters, {} light indices.", maxLights, grid.x, grid.y, grid.z, mMaxIndices);
+}
+
+void ke::ClusteredLighting::cleanup()
+{
+	const VkuDeviceDispatchTable& vkd = mRenderer->getDeviceTable();
+	VkDevice device = mRenderer->getDevice();
+	const VkAllocationCallbacks* allocator = mRenderer->getAllocationCallbacks();
+
+	mRenderer->removeRenderGraphHook(mHook);
+	vkd.DestroyPipeline(device, mCullPipeline, allocator);
+	vkd.DestroyPipelineLayout(device, mCullLayout, allocator);
+	vkd.DestroyDescriptorPool(device, mDescriptorPool, allocator);
+	vkd.DestroyDescriptorSetLayout(device, mSetLayout, allocator);
+
+	for (uint32_t i = 0; i < mParamBuffers.size(); i++)
+	{
+		mRenderer->destroyBuffer(mParamBuffers[i]);
+		mRenderer->destroyBuffer(mLightBuffers[i]);
+		mRenderer->destroyBuffer(mReadback[i]);
+	}
+	mRenderer->destroyBuffer(mLightGrid);
+	mRenderer->destroyBuffer(mLightIndices);
+	mRenderer->destroyBuffer(mCounters);
+}
+
+void ke::ClusteredLighting::createDescriptors()
+{
+	const VkuDeviceDispatchTable& vkd = mRenderer->getDeviceTable();
+	VkDevice device = mRenderer->getDevice();
+	uint32_t frames = mRenderer->getMaxFramesInFlight();
+
+	// Params, lights, grid and indices are read by the fragment shaders too; the counters are compute only.
+	VkDescriptorSetLayoutBinding bindings[5]{};
+	for (uint32_t i = 0; i < 5; i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | (i < 4 ? VK_SHADER_STAGE_FRAGMENT_BIT : 0);
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 5;
+	layoutInfo.pBindings = bindings;
+	if (vkd.CreateDescriptorSetLayout(device, &layoutInfo, mRenderer->getAllocationCallbacks(), &mSetLayout) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create lighting descriptor set layout!");
+
+	VkDescriptorPoolSize poolSizes[2] = {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frames },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frames * 4 }
+	};
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = frames;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+	if (vkd.CreateDescriptorPool(device, &poolInfo, mRenderer->getAllocationCallbacks(), &mDescriptorPool) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create lighting descriptor pool!");
+
+	std::vector<VkDescriptorSetLayout> layouts(frames, mSetLayout);
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = mDescriptorPool;
+	allocInfo.descriptorSetCount = frames;
+	allocInfo.pSetLayouts = layouts.data();
+	mDescriptorSets.resize(frames);
+	if (vkd.AllocateDescriptorSets(device, &allocInfo, mDescriptorSets.data()) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to allocate lighting descriptor sets!");
+
+	for (uint32_t frame = 0; frame < frames; frame++)
+	{
+		const Buffer* buffers[5] = { &mParamBuffers[frame], &mLightBuffers[frame], &mLightGrid, &mLightIndices, &mCounters };
+		VkDescriptorBufferInfo bufferInfos[5]{};
+		VkWriteDescriptorSet writes[5]{};
+		for (uint32_t i = 0; i < 5; i++)
+		{
+			bufferInfos[i] = { buffers[i]->buffer, 0, VK_WHOLE_SIZE };
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = mDescriptorSets[frame];
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = bindings[i].descriptorType;
+			writes[i].pBufferInfo = &bufferInfos[i];
+		}
+		vkd.UpdateDescriptorSets(device, 5, writes, 0, nullptr);
+	}
+}
+
+void ke::ClusteredLighting::setCamera(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane)
+{
+	mView = view;
+	mProjection = projection;
+	mNear = nearPlane;
+	mFar = farPlane;
+}
+
+void ke::ClusteredLighting::submit(const Light* lights, uint32_t count)
+{
+	mSpans.push_back({ lights, count });
+}
+
+uint32_t ke::ClusteredLighting::upload(uint32_t slot)
+{
+	// Lights go up in view space so neither the cull nor the shading pass transforms them per cluster or pixel.
+	GpuLight* dst = static_cast<GpuLight*>(mLightBuffers[slot].mapped);
+	uint32_t count = 0;
+	for (const auto& span : mSpans)
+	{
+		uint32_t take = std::min(span.count, mMaxLights - count);
+		if (take < span.count && enableLogging)
+			mLogger.warn("Light buffer is full, dropping {} lights.", span.count - take);
+
+		for (uint32_t i = 0; i < take; i++)
+		{
+			const Light& light = span.lights[i];
+			GpuLight& out = dst[count + i];
+			out.positionRadius = glm::vec4(glm::vec3(mView * glm::vec4(light.position, 1.0f)), light.radius);
+			out.colorType = glm::vec4(light.color * light.intensity, light.type == LightType::Spot ? 1.0f : 0.0f);
+			out.directionOuter = glm::vec4(glm::normalize(glm::mat3(mView) * light.direction), std::cos(light.outerAngle));
+			out.params = glm::vec4(std::cos(light.innerAngle), 0.0f, 0.0f, 0.0f);
+		}
+		count += take;
+	}
+	mSpans.clear();
+
+	VkExtent2D extent = mRenderer->getRenderExtent();
+	float sliceLog = std::log(mFar / mNear);
+
+	ClusterParams& params = *static_cast<ClusterParams*>(mParamBuffers[slot].mapped);
+	params.inverseProjection = glm::inverse(mProjection);
+	params.screenNearFar = glm::vec4(static_cast<float>(extent.width), static_cast<float>(extent.height), mNear, mFar);
+	params.sliceTile = glm::vec4(mGrid.z / sliceLog, -static_cast<float>(mGrid.z) * std::log(mNear) / sliceLog,
+		std::ceil(static_cast<float>(extent.width) / mGrid.x), std::ceil(static_cast<float>(extent.height) / mGrid.y));
+	params.grid = glm::uvec4(mGrid.x, mGrid.y, mGrid.z, count);
+	params.limits = glm::uvec4(mMaxIndices, MAX_LIGHTS_PER_CLUSTER, 0, 0);
+
+	mRenderer->getStats().addUpload(sizeof(GpuLight) * count + sizeof(ClusterParams));
+	return count;
+}
+
+void ke::ClusteredLighting::addPasses(RenderGraph& graph)
+{
+	KE_PROFILE_FUNCTION();
+	uint32_t slot = mRenderer->getCurrentFrameInFlight();
+
+	// This slot's fence has been waited on, so the readback holds the counters of its last submission.
+	const ClusterCounters& counters = *static_cast<const ClusterCounters*>(mReadback[slot].mapped);
+	mStats.occupiedClusters = counters.occupiedClusters;
+	mStats.lightIndices = std::min(counters.indexCount, mMaxIndices);
+	mStats.maxLightsPerCluster = counters.maxClusterLights;
+	mStats.overflowedClusters = counters.overflowedClusters;
+	mStats.lightCount = upload(slot);
+	mRenderer->getStats().setLightStats(mStats.lightCount, mStats.occupiedClusters, mStats.lightIndices, mStats.maxLightsPerCluster);
+
+	RGResource grid = graph.importBuffer("light grid", mLightGrid.buffer, mLightGrid.size, RGAccess::FragmentStorageRead);
+	RGResource indices = graph.importBuffer("light indices", mLightIndices.buffer, mLightIndices.size, RGAccess::FragmentStorageRead);
+	RGResource counterBuffer = graph.importBuffer("light cluster counters", mCounters.buffer, mCounters.size, RGAccess::TransferRead);
+
+	const VkuDeviceDispatchTable* vkd = &mRenderer->getDeviceTable();
+
+	RGPass reset = graph.addPass("light cluster reset", [this, vkd](VkCommandBuffer cmd)
+		{
+			vkd->CmdFillBuffer(cmd, mCounters.buffer, 0, VK_WHOLE_SIZE, 0);
+		});
+	graph.write(reset, counterBuffer, RGAccess::TransferWrite);
+
+	RGPass cull = graph.addPass("light cull", [this, vkd, slot](VkCommandBuffer cmd)
+		{
+			if (mTimer)
+				mTimer->begin(cmd, mCullScope);
+			vkd->CmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mCullPipeline);
+			vkd->CmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mCullLayout, 0, 1, &mDescriptorSets[slot], 0, nullptr);
+			mRenderer->getStats().addPipelineBind();
+			mRenderer->getStats().addDescriptorBinds(1);
+			vkd->CmdDispatch(cmd, mGrid.x, mGrid.y, mGrid.z);
+			if (mTimer)
+				mTimer->end(cmd, mCullScope);
+		});
+	graph.write(cull, grid, RGAccess::ComputeStorageWrite);
+	graph.write(cull, indices, RGAccess::ComputeStorageWrite);
+	graph.write(cull, counterBuffer, RGAccess::ComputeStorageWrite);
+
+	RGPass readback = graph.addPass("light cluster readback", [this, vkd, slot](VkCommandBuffer cmd)
+		{
+			VkBufferCopy region{ 0, 0, sizeof(ClusterCounters) };
+			vkd->CmdCopyBuffer(cmd, mCounters.buffer, mReadback[slot].buffer, 1, &region);
+
+			VkBufferMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.buffer = mReadback[slot].buffer;
+			barrier.size = VK_WHOLE_SIZE;
+			vkd->CmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+		});
+	graph.read(readback, counterBuffer, RGAccess::TransferRead);
+
+	for (RGPass pass : { reset, cull, readback })
+		graph.setSideEffect(pass);
+
+	mRenderer->mainPassRead(grid, RGAccess::FragmentStorageRead);
+	mRenderer->mainPassRead(indices, RGAccess::FragmentStorageRead);
+}
+
+void ke::ClusteredLighting::bind(VkCommandBuffer cmd, VkPipelineLayout layout, uint32_t set)
+{
+	mRenderer->bindDescriptorSets(cmd, layout, set, 1, &mDescriptorSets[mRenderer->getCurrentFrameInFlight()]);
+}
+
+VkDescriptorSetLayout ke::ClusteredLighting::getSetLayout() const
+{
+	return mSetLayout;
+}
+
+void ke::ClusteredLighting::setTimer(GpuTimer* timer, uint32_t cullScope)
+{
+	mTimer = timer;
+	mCullScope = cullScope;
+}
+
+const ke::LightClusterStats& ke::ClusteredLighting::getClusterStats() const
+{
+	return mStats;
+}
+
+uint32_t ke::ClusteredLighting::getClusterCount() const
+{
+	return mGrid.x * mGrid.y * mGrid.z;
+}
\ No newline at end of file
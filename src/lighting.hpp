@@ -0,0 +1,144 @@
+#pragma once
+#include "renderer.hpp"
+#include "gputimer.hpp"
+#include "specialization.hpp"
+#include <glm/glm.hpp>
+
+namespace ke
+{
+	// Must match the shared list size in light_cull.comp.
+	constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 256;
+
+	// Specialization constants declared by shader/src/clustered.glsl.
+	using ClusteredSpotLights = SpecConstant<0, bool>;
+	using ClusteredShading = SpecializationSet<ClusteredSpotLights>;
+
+	enum class LightType : uint32_t
+	{
+		Point,
+		Spot
+	};
+
+	// World space. Spot angles are half angles in radians.
+	struct Light
+	{
+		glm::vec3 position = glm::vec3(0.0f);
+		float radius = 1.0f;
+		glm::vec3 color = glm::vec3(1.0f);
+		float intensity = 1.0f;
+		glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+		LightType type = LightType::Point;
+		float innerAngle = 0.3f;
+		float outerAngle = 0.5f;
+	};
+
+	// Froxels are screen tiles split into exponentially spaced depth slices.
+	struct ClusterGridDesc
+	{
+		uint32_t x = 16;
+		uint32_t y = 9;
+		uint32_t z = 24;
+		// Sizes the shared light index list; clusters past the budget are truncated.
+		uint32_t averageLightsPerCluster = 64;
+	};
+
+	struct LightClusterStats
+	{
+		uint32_t lightCount = 0;
+		uint32_t occupiedClusters = 0;
+		uint32_t lightIndices = 0;
+		uint32_t maxLightsPerCluster = 0;
+		uint32_t overflowedClusters = 0;
+	};
+
+	// Forward+ light culling. A compute pass ahead of the main pass bins every submitted light into the froxel grid
+	// and writes a compact index list per cluster; fragment shaders include shader/src/clustered.glsl and only
+	// visit the lights of their own cluster.
+	class ClusteredLighting
+	{
+	public:
+		void init(Renderer& renderer, uint32_t maxLights, const ClusterGridDesc& grid = ClusterGridDesc{});
+		void cleanup();
+
+		// Camera and lights are consumed when the frame graph is built, so set them before beginRecording.
+		// Lights are only read then and must stay alive until that point.
+		void setCamera(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane);
+		void submit(const Light* lights, uint32_t count);
+
+		// Binds this frame's lighting set for fragment shading.
+		void bind(VkCommandBuffer cmd, VkPipelineLayout layout, uint32_t set);
+		VkDescriptorSetLayout getSetLayout() const;
+
+		void setTimer(GpuTimer* timer, uint32_t cullScope);
+		// Read back from the GPU one frames-in-flight cycle late and also reported to the renderer stats.
+		const LightClusterStats& getClusterStats() const;
+		uint32_t getClusterCount() const;
+	private:
+		struct GpuLight
+		{
+			glm::vec4 positionRadius;
+			glm::vec4 colorType;
+			glm::vec4 directionOuter;
+			glm::vec4 params;
+		};
+
+		// std140 layout of the ClusterParams block.
+		struct ClusterParams
+		{
+			glm::mat4 inverseProjection;
+			glm::vec4 screenNearFar;
+			glm::vec4 sliceTile;
+			glm::uvec4 grid;
+			glm::uvec4 limits;
+		};
+
+		struct ClusterCounters
+		{
+			uint32_t indexCount;
+			uint32_t occupiedClusters;
+			uint32_t maxClusterLights;
+			uint32_t overflowedClusters;
+		};
+
+		struct Span
+		{
+			const Light* lights;
+			uint32_t count;
+		};
+	private:
+		void createDescriptors();
+		void addPasses(RenderGraph& graph);
+		uint32_t upload(uint32_t slot);
+	private:
+		Renderer* mRenderer = nullptr;
+		ClusterGridDesc mGrid;
+		uint32_t mMaxLights = 0;
+		uint32_t mMaxIndices = 0;
+		uint32_t mHook = 0;
+
+		std::vector<Buffer> mParamBuffers;
+		std::vector<Buffer> mLightBuffers;
+		std::vector<Buffer> mReadback;
+		Buffer mLightGrid;
+		Buffer mLightIndices;
+		Buffer mCounters;
+
+		VkDescriptorSetLayout mSetLayout = VK_NULL_HANDLE;
+		VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+		std::vector<VkDescriptorSet> mDescriptorSets;
+		VkPipelineLayout mCullLayout = VK_NULL_HANDLE;
+		VkPipeline mCullPipeline = VK_NULL_HANDLE;
+
+		glm::mat4 mView = glm::mat4(1.0f);
+		glm::mat4 mProjection = glm::mat4(1.0f);
+		float mNear = 0.1f;
+		float mFar = 100.0f;
+		std::vector<Span> mSpans;
+		LightClusterStats mStats;
+
+		GpuTimer* mTimer = nullptr;
+		uint32_t mCullScope = UINT32_MAX;
+
+		ke::Logger mLogger = ke::Logger("Lighting Logger", spdlog::level::debug);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,470 @@
+#include "lod.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+static ke::Logger gGenerateLogger("LOD Generation Logger", spdlog::level::debug);
+
+// Symmetric 4x4 error quadric: a2, ab, ac, ad, b2, bc, bd, c2, cd, d2.
+struct Quadric
+{
+	double q[10] = {};
+
+	void addPlane(const glm::dvec3& n, double d)
+	{
+		double plane[4] = { n.x, n.y, n.z, d };
+		uint32_t k = 0;
+		for (uint32_t i = 0; i < 4; i++)
+			for (uint32_t j = i; j < 4; j++)
+				q[k++] += plane[i] * plane[j];
+	}
+
+	void add(const Quadric& other)
+	{
+		for (uint32_t i = 0; i < 10; i++)
+			q[i] += other.q[i];
+	}
+
+	// Sum of squared distances from p to every accumulated plane.
+	double evaluate(const glm::dvec3& p) const
+	{
+		return q[0] * p.x * p.x + 2.0 * q[1] * p.x * p.y + 2.0 * q[2] * p.x * p.z + 2.0 * q[3] * p.x
+			+ q[4] * p.y * p.y + 2.0 * q[5] * p.y * p.z + 2.0 * q[6] * p.y
+			+ q[7] * p.z * p.z + 2.0 * q[8] * p.z + q[9];
+	}
+};
+
+struct Collapse
+{
+	double cost;
+	uint32_t from;
+	uint32_t to;
+	uint32_t fromStamp;
+	uint32_t toStamp;
+
+	bool operator>(const Collapse& other) const { return cost > other.cost; }
+};
+
+ke::LodMesh ke::generateLods(const glm::vec3* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const LodSettings& settings)
+{
+	KE_PROFILE_FUNCTION();
+	LodMesh mesh;
+	mesh.positions.assign(positions, positions + vertexCount);
+	mesh.indices.assign(indices, indices + indexCount);
+	mesh.levels.push_back({ 0, indexCount, 0.0f });
+	if (vertexCount == 0 || indexCount < 3)
+		return mesh;
+
+	mesh.bounds = { positions[0], positions[0] };
+	for (uint32_t v = 0; v < vertexCount; v++)
+	{
+		mesh.bounds.min = glm::min(mesh.bounds.min, positions[v]);
+		mesh.bounds.max = glm::max(mesh.bounds.max, positions[v]);
+	}
+	mesh.radius = glm::length(mesh.bounds.max - mesh.bounds.min) * 0.5f;
+
+	uint32_t triangleCount = indexCount / 3;
+	std::vector<uint32_t> triangles(indices, indices + triangleCount * 3);
+	std::vector<uint8_t> triangleAlive(triangleCount, 1);
+	std::vector<uint8_t> vertexAlive(vertexCount, 1);
+	std::vector<uint32_t> stamps(vertexCount, 0);
+	std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+	std::vector<Quadric> quadrics(vertexCount);
+	auto position = [&](uint32_t v) { return glm::dvec3(positions[v]); };
+
+	std::unordered_map<uint64_t, uint32_t> edgeUses;
+	auto edgeKey = [](uint32_t a, uint32_t b) { return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b); };
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		const uint32_t* tri = &triangles[t * 3];
+		glm::dvec3 normal = glm::cross(position(tri[1]) - position(tri[0]), position(tri[2]) - position(tri[0]));
+		double length = glm::length(normal);
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			vertexTriangles[tri[i]].push_back(t);
+			edgeUses[edgeKey(tri[i], tri[(i + 1) % 3])]++;
+		}
+		if (length <= 0.0)
+			continue;
+		normal /= length;
+		for (uint32_t i = 0; i < 3; i++)
+			quadrics[tri[i]].addPlane(normal, -glm::dot(normal, position(tri[0])));
+	}
+
+	// Edges used by a single triangle are borders; a plane through the edge, perpendicular to the face, keeps them from shrinking.
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		const uint32_t* tri = &triangles[t * 3];
+		glm::dvec3 faceNormal = glm::cross(position(tri[1]) - position(tri[0]), position(tri[2]) - position(tri[0]));
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			uint32_t a = tri[i], b = tri[(i + 1) % 3];
+			if (edgeUses[edgeKey(a, b)] != 1)
+				continue;
+			glm::dvec3 borderNormal = glm::cross(position(b) - position(a), faceNormal);
+			double length = glm::length(borderNormal);
+			if (length <= 0.0)
+				continue;
+			borderNormal /= length;
+			quadrics[a].addPlane(borderNormal, -glm::dot(borderNormal, position(a)));
+			quadrics[b].addPlane(borderNormal, -glm::dot(borderNormal, position(a)));
+		}
+	}
+
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+	auto pushEdge = [&](uint32_t a, uint32_t b)
+		{
+			Quadric combined = quadrics[a];
+			combined.add(quadrics[b]);
+			double toB = combined.evaluate(position(b));
+			double toA = combined.evaluate(position(a));
+			if (toB <= toA)
+				heap.push({ toB, a, b, stamps[a], stamps[b] });
+			else
+				heap.push({ toA, b, a, stamps[b], stamps[a] });
+		};
+	for (const auto& [key, uses] : edgeUses)
+		pushEdge(static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key & 0xffffffffu));
+
+	// Moving from onto to must not turn any remaining triangle around or collapse it to a sliver.
+	auto flips = [&](uint32_t from, uint32_t to)
+		{
+			for (uint32_t t : vertexTriangles[from])
+			{
+				const uint32_t* tri = &triangles[t * 3];
+				if (!triangleAlive[t] || tri[0] == to || tri[1] == to || tri[2] == to)
+					continue;
+				glm::dvec3 before[3], after[3];
+				for (uint32_t i = 0; i < 3; i++)
+				{
+					before[i] = position(tri[i]);
+					after[i] = tri[i] == from ? position(to) : before[i];
+				}
+				glm::dvec3 oldNormal = glm::cross(before[1] - before[0], before[2] - before[0]);
+				glm::dvec3 newNormal = glm::cross(after[1] - after[0], after[2] - after[0]);
+				if (glm::dot(oldNormal, newNormal) <= 0.2 * glm::length(oldNormal) * glm::length(newNormal))
+					return true;
+			}
+			return false;
+		};
+
+	double maxCost = static_cast<double>(settings.maxError) * mesh.radius;
+	maxCost *= maxCost;
+	double worstCost = 0.0;
+	uint32_t liveTriangles = triangleCount;
+	std::vector<uint32_t> neighbours;
+	bool exhausted = false;
+
+	while (mesh.levels.size() < settings.maxLevels && !exhausted)
+	{
+		uint32_t previous = liveTriangles;
+		uint32_t target = static_cast<uint32_t>(previous * settings.reduction);
+		while (liveTriangles > target)
+		{
+			if (heap.empty())
+			{
+				exhausted = true;
+				break;
+			}
+			Collapse collapse = heap.top();
+			heap.pop();
+			if (!vertexAlive[collapse.from] || !vertexAlive[collapse.to] || stamps[collapse.from] != collapse.fromStamp || stamps[collapse.to] != collapse.toStamp)
+				continue;
+			if (collapse.cost > maxCost)
+			{
+				exhausted = true;
+				break;
+			}
+			if (flips(collapse.from, collapse.to))
+				continue;
+
+			uint32_t from = collapse.from, to = collapse.to;
+			for (uint32_t t : vertexTriangles[from])
+			{
+				if (!triangleAlive[t])
+					continue;
+				uint32_t* tri = &triangles[t * 3];
+				if (tri[0] == to || tri[1] == to || tri[2] == to)
+				{
+					triangleAlive[t] = 0;
+					liveTriangles--;
+					continue;
+				}
+				for (uint32_t i = 0; i < 3; i++)
+					if (tri[i] == from)
+						tri[i] = to;
+				vertexTriangles[to].push_back(t);
+			}
+			vertexAlive[from] = 0;
+			vertexTriangles[from].clear();
+			quadrics[to].add(quadrics[from]);
+			stamps[to]++;
+			worstCost = std::max(worstCost, collapse.cost);
+
+			// Drop dead triangles from the survivor's list and requeue its edges with the merged quadric.
+			auto& adjacent = vertexTriangles[to];
+			adjacent.erase(std::remove_if(adjacent.begin(), adjacent.end(), [&](uint32_t t) { return !triangleAlive[t]; }), adjacent.end());
+			neighbours.clear();
+			for (uint32_t t : adjacent)
+				for (uint32_t i = 0; i < 3; i++)
+					if (triangles[t * 3 + i] != to)
+						neighbours.push_back(triangles[t * 3 + i]);
+			std::sort(neighbours.begin(), neighbours.end());
+			neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+			for (uint32_t n : neighbours)
+			{
+				pushEdge(to, n);
+			}
+		}
+
+		if (liveTriangles >= previous)
+			break;
+
+		LodLevel level;
+		level.firstIndex = static_cast<uint32_t>(mesh.indices.size());
+		for (uint32_t t = 0; t < triangleCount; t++)
+			if (triangleAlive[t])
+				mesh.indices.insert(mesh.indices.end(), &triangles[t * 3], &triangles[t * 3] + 3);
+		level.indexCount = static_cast<uint32_t>(mesh.indices.size()) - level.firstIndex;
+		level.error = static_cast<float>(std::sqrt(worstCost));
+		mesh.levels.push_back(level);
+	}
+
+	if (enableLogging)
+		gGenerateLogger.debug("Generated {} LOD levels from {} triangles, coarsest has {} triangles at error {:.4f}.", mesh.levels.size(), triangleCount,
+			mesh.levels.back().indexCount / 3, mesh.levels.back().error);
+	return mesh;
+}
+
+float ke::lodProjectionScale(float verticalFov, uint32_t screenHeight)
+{
+	return static_cast<float>(screenHeight) / (2.0f * std::tan(verticalFov * 0.5f));
+}
+
+uint32_t ke::selectLod(const std::vector<LodLevel>& levels, float pixelsPerUnit, const LodSelection& selection, uint32_t current)
+{
+	auto coarsestWithin = [&](float threshold)
+		{
+			uint32_t level = 0;
+			for (uint32_t i = 1; i < levels.size() && levels[i].error * pixelsPerUnit <= threshold; i++)
+				level = i;
+			return level;
+		};
+
+	current = std::min(current, static_cast<uint32_t>(levels.size()) - 1);
+	uint32_t coarser = coarsestWithin(selection.pixelThreshold * (1.0f - selection.hysteresis));
+	if (coarser > current)
+		return coarser;
+	if (levels[current].error * pixelsPerUnit > selection.pixelThreshold * (1.0f + selection.hysteresis))
+		return coarsestWithin(selection.pixelThreshold);
+	return current;
+}
+
+void ke::LodRenderer::init(Renderer& renderer, uint32_t maxInstances)
+{
+	mRenderer = &renderer;
+	mMaxInstances = maxInstances;
+
+	mInstanceBuffers.resize(renderer.getMaxFramesInFlight());
+	for (auto& buffer : mInstanceBuffers)
+		buffer = renderer.createBuffer(sizeof(simd::Affine3x4) * std::max(maxInstances, 1u), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	// Draws address their instances through firstInstance, which indirect commands may only do with this feature.
+	const DeviceCapabilities& caps = renderer.getCapabilities();
+	mMultiDraw = caps.multiDrawIndirect && caps.drawIndirectFirstInstance;
+	if (mMultiDraw)
+	{
+		mIndirectBuffers.resize(renderer.getMaxFramesInFlight());
+		for (auto& buffer : mIndirectBuffers)
+			buffer = renderer.createBuffer(sizeof(VkDrawIndexedIndirectCommand) * std::max(maxInstances, 1u), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	}
+	mGeometry.init(renderer, sizeof(glm::vec3), 1u << 16, 1u << 18);
+
+	VkPushConstantRange pushRange{ VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4) };
+	mLayout = renderer.createPipelineLayout({}, { pushRange });
+
+	GraphicsPipelineDesc desc{};
+	desc.vertexShader = "shader/bin/lod_vert.spv";
+	desc.layout = mLayout;
+	desc.bindings.push_back({ 0, sizeof(glm::vec3), VK_VERTEX_INPUT_RATE_VERTEX });
+	desc.bindings.push_back({ 1, sizeof(simd::Affine3x4), VK_VERTEX_INPUT_RATE_INSTANCE });
+	desc.attributes.push_back({ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0 });
+	for (uint32_t row = 0; row < 3; row++)
+		desc.attributes.push_back({ row + 1, 1, VK_FORMAT_R32G32B32A32_SFLOAT, row * static_cast<uint32_t>(sizeof(glm::vec4)) });
+	mPipeline = renderer.buildGraphicsPipeline(desc);
+
+	if (enableLogging)
+		mLogger.info("Created LOD renderer for {} instances, {}.", maxInstances, mMultiDraw ? "multi-draw indirect" : "one draw call per level");
+}
+
+void ke::LodRenderer::cleanup()
+{
+	for (auto& buffer : mInstanceBuffers)
+		mRenderer->destroyBuffer(buffer);
+	for (auto& buffer : mIndirectBuffers)
+		mRenderer->destroyBuffer(buffer);
+	mGeometry.cleanup();
+	mRenderer->destroyPipeline(mPipeline);
+	mRenderer->getDeviceTable().DestroyPipelineLayout(mRenderer->getDevice(), mLayout, mRenderer->getAllocationCallbacks());
+}
+
+uint32_t ke::LodRenderer::addMesh(const LodMesh& lodMesh)
+{
+	uint32_t geometry = mGeometry.addMesh(lodMesh.positions.data(), static_cast<uint32_t>(lodMesh.positions.size()), lodMesh.indices.data(), static_cast<uint32_t>(lodMesh.indices.size()));
+	if (geometry == UINT32_MAX)
+		return UINT32_MAX;
+
+	Mesh mesh;
+	mesh.geometry = geometry;
+	mesh.levels = lodMesh.levels;
+	mesh.center = (lodMesh.bounds.min + lodMesh.bounds.max) * 0.5f;
+	mesh.radius = lodMesh.radius;
+	mesh.buckets.resize(lodMesh.levels.size());
+	mMeshes.push_back(std::move(mesh));
+	mOrdinals.push_back(0);
+	if (mLevelHistogram.size() < lodMesh.levels.size())
+		mLevelHistogram.resize(lodMesh.levels.size());
+	return static_cast<uint32_t>(mMeshes.size() - 1);
+}
+
+void ke::LodRenderer::setCamera(const glm::mat4& viewProjection, const glm::vec3& position, float projectionScale)
+{
+	mViewProjection = viewProjection;
+	mCameraPosition = position;
+	mProjectionScale = projectionScale;
+}
+
+void ke::LodRenderer::setSelection(const LodSelection& selection)
+{
+	mSelection = selection;
+}
+
+void ke::LodRenderer::forceLevel(int32_t level)
+{
+	mForcedLevel = level;
+}
+
+void ke::LodRenderer::submit(uint32_t mesh, const glm::mat4* transforms, uint32_t count)
+{
+	mSpans.push_back({ mesh, transforms, count });
+}
+
+void ke::LodRenderer::record(VkCommandBuffer cmd)
+{
+	KE_PROFILE_FUNCTION();
+	std::fill(mOrdinals.begin(), mOrdinals.end(), 0);
+	std::fill(mLevelHistogram.begin(), mLevelHistogram.end(), 0);
+	mTriangleCount = 0;
+
+	for (const auto& span : mSpans)
+	{
+		Mesh& mesh = mMeshes[span.mesh];
+		uint32_t& ordinal = mOrdinals[span.mesh];
+		if (mesh.currentLevels.size() < ordinal + span.count)
+			mesh.currentLevels.resize(ordinal + span.count, 0);
+
+		uint32_t levelCount = static_cast<uint32_t>(mesh.levels.size());
+		for (uint32_t i = 0; i < span.count; i++, ordinal++)
+		{
+			const glm::mat4& transform = span.transforms[i];
+			uint32_t level;
+			if (mForcedLevel >= 0)
+				level = std::min(static_cast<uint32_t>(mForcedLevel), levelCount - 1);
+			else
+			{
+				// Distance to the nearest point of the bounding sphere, scaled by the instance's largest axis.
+				float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+				glm::vec3 center = glm::vec3(transform * glm::vec4(mesh.center, 1.0f));
+				float distance = std::max(glm::length(center - mCameraPosition) - mesh.radius * scale, 1e-3f);
+				level = selectLod(mesh.levels, mProjectionScale * scale / distance, mSelection, mesh.currentLevels[ordinal]);
+			}
+			mesh.currentLevels[ordinal] = static_cast<uint8_t>(level);
+			mesh.buckets[level].push_back(&transform);
+		}
+	}
+	mSpans.clear();
+
+	Buffer& instanceBuffer = mInstanceBuffers[mRenderer->getCurrentFrameInFlight()];
+	simd::Affine3x4* packed = static_cast<simd::Affine3x4*>(instanceBuffer.mapped);
+	uint32_t instanceCount = 0;
+
+	mRenderer->bindPipeline(cmd, mPipeline);
+	mRenderer->pushConstants(cmd, mLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &mViewProjection);
+	VkDeviceSize instanceOffset = 0;
+	mRenderer->bindVertexBuffers(cmd, 1, 1, &instanceBuffer.buffer, &instanceOffset);
+	mGeometry.bind(cmd, 0);
+
+	mCommands.clear();
+	for (auto& mesh : mMeshes)
+	{
+		const GeometryRange& range = mGeometry.getRange(mesh.geometry);
+		for (uint32_t level = 0; level < mesh.levels.size(); level++)
+		{
+			auto& bucket = mesh.buckets[level];
+			uint32_t count = std::min(static_cast<uint32_t>(bucket.size()), mMaxInstances - instanceCount);
+			if (count < bucket.size() && enableLogging)
+				mLogger.warn("Instance buffer is full, dropping {} instances.", bucket.size() - count);
+			if (count > 0)
+			{
+				for (uint32_t i = 0; i < count; i++)
+					simd::packAffine(bucket[i], 1, packed + instanceCount + i);
+
+				const LodLevel& lod = mesh.levels[level];
+				mCommands.push_back({ lod.indexCount, count, range.firstIndex + lod.firstIndex, range.vertexOffset, instanceCount });
+				mLevelHistogram[level] += count;
+				mTriangleCount += static_cast<uint64_t>(lod.indexCount / 3) * count;
+				instanceCount += count;
+			}
+			bucket.clear();
+		}
+	}
+	mRenderer->getStats().addUpload(sizeof(simd::Affine3x4) * static_cast<uint64_t>(instanceCount));
+
+	uint32_t drawCount = static_cast<uint32_t>(mCommands.size());
+	if (mMultiDraw && drawCount > 0)
+	{
+		Buffer& indirectBuffer = mIndirectBuffers[mRenderer->getCurrentFrameInFlight()];
+		std::memcpy(indirectBuffer.mapped, mCommands.data(), sizeof(VkDrawIndexedIndirectCommand) * drawCount);
+		const VkuDeviceDispatchTable& vkd = mRenderer->getDeviceTable();
+		for (uint32_t first = 0; first < drawCount; first += mRenderer->getCapabilities().maxDrawIndirectCount)
+		{
+			uint32_t count = std::min(drawCount - first, mRenderer->getCapabilities().maxDrawIndirectCount);
+			vkd.CmdDrawIndexedIndirect(cmd, indirectBuffer.buffer, first * sizeof(VkDrawIndexedIndirectCommand), count, sizeof(VkDrawIndexedIndirectCommand));
+		}
+		// The commands were written here, so the calls are counted with their triangles.
+		for (const auto& command : mCommands)
+			mRenderer->getStats().addDraw(command.indexCount, command.instanceCount);
+		mRenderer->getStats().addUpload(sizeof(VkDrawIndexedIndirectCommand) * static_cast<uint64_t>(drawCount));
+	}
+	else
+	{
+		for (const auto& command : mCommands)
+			mRenderer->drawIndexed(cmd, command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset, command.firstInstance);
+	}
+}
+
+const std::vector<uint32_t>& ke::LodRenderer::getLevelHistogram() const
+{
+	return mLevelHistogram;
+}
+
+uint64_t ke::LodRenderer::getTriangleCount() const
+{
+	return mTriangleCount;
+}
+
+ke::GeometryStats ke::LodRenderer::getGeometryStats() const
+{
+	return mGeometry.getStats();
+}
\ No newline at end of file
@@ -0,0 +1,125 @@
+#pragma once
+#include "renderer.hpp"
+#include "geometrybuffer.hpp"
+#include "scene.hpp"
+#include "simd.hpp"
+#include <glm/glm.hpp>
+
+namespace ke
+{
+	struct LodSettings
+	{
+		uint32_t maxLevels = 6;
+		// Each level aims for this fraction of the previous level's triangles.
+		float reduction = 0.5f;
+		// Simplification stops once the geometric error would exceed this fraction of the bounding radius.
+		float maxError = 0.05f;
+	};
+
+	// A range of the shared index list. error is an object-space distance bound to the base mesh.
+	struct LodLevel
+	{
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		float error = 0.0f;
+	};
+
+	// Every level indexes the base mesh's vertices, so the chain adds index data only.
+	struct LodMesh
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t> indices;
+		std::vector<LodLevel> levels;
+		Bounds bounds;
+		float radius = 0.0f;
+	};
+
+	// Quadric error edge collapse. Collapses keep one endpoint, are rejected if they flip a triangle, and open borders
+	// are held in place by extra constraint planes. Meant for cook or load time, not per frame.
+	LodMesh generateLods(const glm::vec3* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const LodSettings& settings = LodSettings{});
+
+	struct LodSelection
+	{
+		// Largest projected error, in pixels, a level may have to be chosen.
+		float pixelThreshold = 1.0f;
+		// Switching to a coarser level needs the error under threshold * (1 - hysteresis), going back to a finer one
+		// needs it over threshold * (1 + hysteresis), so objects near a boundary don't pop every frame.
+		float hysteresis = 0.25f;
+	};
+
+	// Pixels per unit of object-space error at distance 1.
+	float lodProjectionScale(float verticalFov, uint32_t screenHeight);
+	// pixelsPerUnit is the projection scale times the instance scale over its distance. Level errors must not decrease.
+	uint32_t selectLod(const std::vector<LodLevel>& levels, float pixelsPerUnit, const LodSelection& selection, uint32_t current);
+
+	// Draws instanced LOD meshes. Each instance's level is selected from its projected error every frame, and
+	// instances are grouped per mesh and level into one indexed instanced draw each. All meshes share one geometry
+	// buffer, so the pass binds once and, with multiDrawIndirect, issues every draw from a single indirect call.
+	class LodRenderer
+	{
+	public:
+		void init(Renderer& renderer, uint32_t maxInstances);
+		void cleanup();
+
+		uint32_t addMesh(const LodMesh& mesh);
+
+		void setCamera(const glm::mat4& viewProjection, const glm::vec3& position, float projectionScale);
+		void setSelection(const LodSelection& selection);
+		// Pins every instance to one level, or -1 to select by screen-space error again.
+		void forceLevel(int32_t level);
+
+		// Instances keep their hysteresis state by submission order, so submit them in the same order every frame.
+		// Transforms are only read when the batch is recorded, so they must stay alive until then.
+		void submit(uint32_t mesh, const glm::mat4* transforms, uint32_t count);
+		void record(VkCommandBuffer cmd);
+
+		// Instances drawn at each level in the last recorded batch.
+		const std::vector<uint32_t>& getLevelHistogram() const;
+		uint64_t getTriangleCount() const;
+		GeometryStats getGeometryStats() const;
+	private:
+		struct Mesh
+		{
+			uint32_t geometry;
+			std::vector<LodLevel> levels;
+			glm::vec3 center;
+			float radius;
+			std::vector<uint8_t> currentLevels;
+			std::vector<std::vector<const glm::mat4*>> buckets;
+		};
+
+		struct Span
+		{
+			uint32_t mesh;
+			const glm::mat4* transforms;
+			uint32_t count;
+		};
+	private:
+		Renderer* mRenderer = nullptr;
+		uint32_t mMaxInstances = 0;
+		bool mMultiDraw = false;
+
+		VkPipelineLayout mLayout = VK_NULL_HANDLE;
+		VkPipeline mPipeline = VK_NULL_HANDLE;
+		std::vector<Buffer> mInstanceBuffers;
+		GeometryBuffer mGeometry;
+		// Every draw has at least one instance, so maxInstances commands always suffice.
+		std::vector<Buffer> mIndirectBuffers;
+		std::vector<VkDrawIndexedIndirectCommand> mCommands;
+
+		std::vector<Mesh> mMeshes;
+		std::vector<Span> mSpans;
+		std::vector<uint32_t> mOrdinals;
+
+		glm::mat4 mViewProjection = glm::mat4(1.0f);
+		glm::vec3 mCameraPosition = glm::vec3(0.0f);
+		float mProjectionScale = 1.0f;
+		LodSelection mSelection;
+		int32_t mForcedLevel = -1;
+
+		std::vector<uint32_t> mLevelHistogram;
+		uint64_t mTriangleCount = 0;
+
+		ke::Logger mLogger = ke::Logger("LOD Logger", spdlog::level::debug);
+	};
+}
\ No newline at end of file
@@ -1,44 +1,45 @@
 #include "logger.hpp"
 #include <spdlog/sinks/stdout_color_sinks.h>
+#include <mutex>
 
-ke::Logger::Logger(std::string n, spdlog::level::level_enum l)
-	:mLoggerName(n)
-{
-	auto consoleSink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
-	mLogger = std::make_shared<spdlog::logger>(n, consoleSink);
+// Bounded queue shared by every async logger. When full the oldest message is overwritten,
+// so the calling thread never waits on the console.
+static constexpr size_t asyncQueueSize = 8192;
 
-	mLogger.get()->set_pattern("[%H:%M:%S] %^%n %l:%$ %v");
-	mLogger.get()->set_level(l);
-}
-
-void ke::Logger::trace(std::string content) const
+static std::shared_ptr<spdlog::details::thread_pool> getThreadPool()
 {
-	mLogger.get()->trace(content);
+	static std::shared_ptr<spdlog::details::thread_pool> threadPool = std::make_shared<spdlog::details::thread_pool>(asyncQueueSize, 1);
+	return threadPool;
 }
 
-void ke::Logger::debug(std::string content) const
+static spdlog::sink_ptr getConsoleSink()
 {
-	mLogger.get()->debug(content);
+	static spdlog::sink_ptr consoleSink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+	return consoleSink;
 }
 
-void ke::Logger::info(std::string content) const
+ke::Logger::Logger(std::string n, spdlog::level::level_enum l, LogMode mode)
+	:mLoggerName(n)
 {
-	mLogger.get()->info(content);
-}
+	if (mode == LogMode::Async)
+	{
+		mThreadPool = getThreadPool();
+		mLogger = std::make_shared<spdlog::async_logger>(n, getConsoleSink(), mThreadPool, spdlog::async_overflow_policy::overrun_oldest);
+	}
+	else
+		mLogger = std::make_shared<spdlog::logger>(n, getConsoleSink());
 
-void ke::Logger::warn(std::string content) const
-{
-	mLogger.get()->warn(content);
+	mLogger.get()->set_pattern("[%H:%M:%S] %^%n %l:%$ %v");
+	mLogger.get()->set_level(l);
+	mLogger.get()->flush_on(spdlog::level::err);
 }
 
-void ke::Logger::error(std::string content) const
+void ke::Logger::flush() const
 {
-	mLogger.get()->error(content);
+	mLogger.get()->flush();
 }
 
-void ke::Logger::critical(std::string content) const
+size_t ke::Logger::getDroppedCount()
 {
-	mLogger.get()->critical(content);
-}
-
-
+	return getThreadPool()->overrun_counter();
+}
\ No newline at end of file
@@ -1,21 +1,80 @@
 #pragma once
 #include <spdlog/spdlog.h>
+#include <spdlog/async.h>
 #include <spdlog/sinks/basic_file_sink.h>
+
+// Calls below this level are compiled out entirely. Defaults to info in release builds.
+#ifndef KE_LOG_LEVEL
+#ifdef NDEBUG
+#define KE_LOG_LEVEL SPDLOG_LEVEL_INFO
+#else
+#define KE_LOG_LEVEL SPDLOG_LEVEL_TRACE
+#endif
+#endif
+
 namespace ke {
+	enum class LogMode
+	{
+		Async,
+		Sync
+	};
+
 	class Logger
 	{
 	public:
-		Logger(std::string n, spdlog::level::level_enum l);
-
-		void trace(std::string content) const;
-		void debug(std::string content) const;
-		void info(std::string content) const;
-		void warn(std::string content) const;
-		void error(std::string content) const;
-		void critical(std::string content) const;
+		Logger(std::string n, spdlog::level::level_enum l, LogMode mode = LogMode::Async);
+
+		// Formatting runs only when the level is enabled, and on the logging thread in async mode.
+		template<typename... Args>
+		void trace(spdlog::format_string_t<Args...> fmt, Args&&... args) const
+		{
+			if constexpr (KE_LOG_LEVEL <= SPDLOG_LEVEL_TRACE)
+				mLogger->trace(fmt, std::forward<Args>(args)...);
+		}
+
+		template<typename... Args>
+		void debug(spdlog::format_string_t<Args...> fmt, Args&&... args) const
+		{
+			if constexpr (KE_LOG_LEVEL <= SPDLOG_LEVEL_DEBUG)
+				mLogger->debug(fmt, std::forward<Args>(args)...);
+		}
+
+		template<typename... Args>
+		void info(spdlog::format_string_t<Args...> fmt, Args&&... args) const
+		{
+			if constexpr (KE_LOG_LEVEL <= SPDLOG_LEVEL_INFO)
+				mLogger->info(fmt, std::forward<Args>(args)...);
+		}
+
+		template<typename... Args>
+		void warn(spdlog::format_string_t<Args...> fmt, Args&&... args) const
+		{
+			if constexpr (KE_LOG_LEVEL <= SPDLOG_LEVEL_WARN)
+				mLogger->warn(fmt, std::forward<Args>(args)...);
+		}
+
+		template<typename... Args>
+		void error(spdlog::format_string_t<Args...> fmt, Args&&... args) const
+		{
+			if constexpr (KE_LOG_LEVEL <= SPDLOG_LEVEL_ERROR)
+				mLogger->error(fmt, std::forward<Args>(args)...);
+		}
+
+		template<typename... Args>
+		void critical(spdlog::format_string_t<Args...> fmt, Args&&... args) const
+		{
+			if constexpr (KE_LOG_LEVEL <= SPDLOG_LEVEL_CRITICAL)
+				mLogger->critical(fmt, std::forward<Args>(args)...);
+		}
+
+		void flush() const;
+
+		// Number of async messages overwritten because the queue was full.
+		static size_t getDroppedCount();
 	private:
 		std::string mLoggerName;
 
+		std::shared_ptr<spdlog::details::thread_pool> mThreadPool;
 		std::shared_ptr<spdlog::logger> mLogger;
 	};
 }
\ No newline at end of file
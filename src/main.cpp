@@ -1,43 +1,194 @@
 #include "window.hpp"
 #include "logger.hpp"
 #include "renderer.hpp"
+#include "benchmark.hpp"
+#include "profiler.hpp"
+#include "capture.hpp"
+#include "renderthread.hpp"
+#include "archive.hpp"
+#include "debughud.hpp"
+#include "gputimer.hpp"
+#include <algorithm>
 #include <iostream>
+#include <chrono>
 
 int main(int argc, char** argv)
 {
-	ke::Window::init();
-#ifndef NDEBUG
+	auto startTime = std::chrono::steady_clock::now();
 	ke::Logger logger("Main Function Logger", spdlog::level::trace);
-#endif
+	KE_PROFILE_THREAD("Main");
+
+	// Packer mode: engine --pack <archive> <files or directories...>
+	if (argc > 3 && std::string(argv[1]) == "--pack")
+		return ke::AssetArchive::pack(argv[2], std::vector<std::string>(argv + 3, argv + argc)) ? 0 : 1;
+
+	std::string tracePath, statsPath, hostAllocMode, devicePreference, dynamicResTarget;
+	std::string capturePath, captureFrames = "300", replayPath, replayLoops = "1";
+	std::string archivePath = "assets.kpak";
+	bool showHud = std::find(argv + 1, argv + argc, std::string("--hud")) != argv + argc;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (std::string(argv[i]) == "--trace")
+			tracePath = argv[i + 1];
+		else if (std::string(argv[i]) == "--stats")
+			statsPath = argv[i + 1];
+		else if (std::string(argv[i]) == "--host-alloc")
+			hostAllocMode = argv[i + 1];
+		else if (std::string(argv[i]) == "--device")
+			devicePreference = argv[i + 1];
+		else if (std::string(argv[i]) == "--dynamic-res")
+			dynamicResTarget = argv[i + 1];
+		else if (std::string(argv[i]) == "--capture")
+			capturePath = argv[i + 1];
+		else if (std::string(argv[i]) == "--capture-frames")
+			captureFrames = argv[i + 1];
+		else if (std::string(argv[i]) == "--replay")
+			replayPath = argv[i + 1];
+		else if (std::string(argv[i]) == "--loops")
+			replayLoops = argv[i + 1];
+		else if (std::string(argv[i]) == "--archive")
+			archivePath = argv[i + 1];
+	}
+
+	// Assets resolve through the archive first, so startup I/O is one mapping instead of a read per file.
+	if (ke::AssetLoader::getInstance().exists(archivePath))
+		ke::AssetLoader::getInstance().mount(archivePath);
+
+	// Vulkan instance creation runs on a worker while the window is created.
+	ke::Renderer& renderer = ke::Renderer::getInstance();
+	if (hostAllocMode == "tracking")
+		renderer.setHostAllocatorMode(ke::HostAllocatorMode::Tracking);
+	else if (hostAllocMode == "arena")
+		renderer.setHostAllocatorMode(ke::HostAllocatorMode::Arena);
+	renderer.setDevicePreference(devicePreference);
+	if (!dynamicResTarget.empty())
+	{
+		ke::DynamicResolutionSettings dynamicRes;
+		dynamicRes.enabled = true;
+		dynamicRes.targetMs = std::stof(dynamicResTarget);
+		renderer.setDynamicResolution(dynamicRes);
+	}
+
+	// Replays run headless, so no window or surface is created.
+	if (!replayPath.empty())
+	{
+		ke::CaptureReplay replay;
+		if (!replay.load(replayPath))
+			return 1;
+		renderer.setHeadless(replay.getExtent());
+		renderer.initVulkan(nullptr);
+		ke::ReplayResult result = replay.run(renderer, std::stoul(replayLoops));
+		if (result.frames > 0)
+			logger.info("Replayed {} frames in {:.2f} ms: {:.3f} ms average, {:.3f} ms min, {:.3f} ms max.", result.frames, result.totalMs,
+				result.totalMs / result.frames, result.minFrameMs, result.maxFrameMs);
+		if (!tracePath.empty())
+			ke::Profiler::getInstance().writeChromeTrace(tracePath);
+		if (!statsPath.empty())
+			renderer.getStats().write(statsPath);
+		renderer.cleanupRenderer();
+		return 0;
+	}
+
+	ke::Window::init();
+	// Started ahead of initialisation so the renderer's own resources are part of the capture.
+	if (!capturePath.empty())
+		renderer.startCapture(capturePath, std::stoul(captureFrames));
+	renderer.beginInit();
+
 	GLFWmonitor* monitor = glfwGetPrimaryMonitor();
 	const GLFWvidmode* videoMode = glfwGetVideoMode(monitor);
 	unsigned int screenWidth = videoMode->width, screenHeight = videoMode->height;
 
 	ke::Window window(screenWidth/2, screenHeight/2, "Hello, World!");
 	window.setPosition(screenWidth / 4, screenHeight / 4);
-#ifndef NDEBUG
 	logger.info("Created GLFW window.");
-#endif
-	ke::Renderer& renderer = ke::Renderer::getInstance();
-#ifndef NDEBUG
 	logger.trace("Called for vulkan initiation.");
-#endif
 	renderer.initVulkan(window.getWindow());
-#ifndef NDEBUG
 	logger.info("Finished Vulkan initiation.");
-#endif
-	while (!window.shouldClose())
+	if (argc > 2 && std::string(argv[1]) == "--bench")
+	{
+		ke::bench::run(argv[2], window, renderer);
+		if (!tracePath.empty())
+			ke::Profiler::getInstance().writeChromeTrace(tracePath);
+		if (!statsPath.empty())
+			renderer.getStats().write(statsPath);
+		renderer.cleanupRenderer();
+		return 0;
+	}
+
+	// Live stats overlay, available in release builds too. It times itself so it can report its own GPU cost.
+	ke::GpuTimer hudTimer;
+	ke::DebugHud hud;
+	if (showHud)
 	{
-		renderer.beginRecording(window.getWindow(), window.hasResized());
-		// DRAW CALLS GO HERE
-		vkCmdDraw(renderer.getCommandBuffer(), 3, 1, 0, 0);
-		
-		renderer.endRecording();
-		renderer.present(window.getWindow());
+		hudTimer.init(renderer);
+		hud.init(renderer);
+		hud.setTimer(&hudTimer, hudTimer.registerScope("debug hud"));
+	}
+
+	// Events and simulation stay on this thread. Recording and presentation run on the render thread, which works
+	// on the previous frame's snapshot while the next one is simulated.
+	struct FrameSnapshot
+	{
+		uint64_t frame = 0;
+		bool resized = false;
+	};
+
+	int lastWidth, lastHeight;
+	window.getFramebufferSize(lastWidth, lastHeight);
+	renderer.setFramebufferSize(lastWidth, lastHeight);
+
+	ke::RenderThread<FrameSnapshot> renderThread;
+	renderThread.start([&](const FrameSnapshot& snapshot)
+		{
+			if (!renderer.beginRecording(window.getWindow(), snapshot.resized))
+				return;
+			// DRAW CALLS GO HERE
+			renderer.draw(3);
 
+			if (showHud)
+				hud.record(renderer.getCommandBuffer());
+			renderer.endRecording();
+			renderer.present(window.getWindow());
+			if (renderer.getStats().getCurrent().frame == 0)
+				logger.info("Time to first frame: {:.2f} ms.", std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+			renderer.advanceFrame();
+		});
+
+	uint64_t frame = 0;
+	while (!window.shouldClose())
+	{
 		window.pollEvents();
-		renderer.advanceFrame();
-	}	
+		int width, height;
+		window.getFramebufferSize(width, height);
+		renderer.setFramebufferSize(width, height);
+		if (width == 0 || height == 0)
+		{
+			window.waitEvents();
+			continue;
+		}
+
+		FrameSnapshot snapshot;
+		snapshot.frame = frame++;
+		snapshot.resized = width != lastWidth || height != lastHeight;
+		lastWidth = width;
+		lastHeight = height;
+		// SIMULATION GOES HERE
+
+		renderThread.submit(snapshot);
+	}
+	renderer.requestStop();
+	renderThread.stop();
+	if (showHud)
+	{
+		renderer.getDeviceTable().DeviceWaitIdle(renderer.getDevice());
+		hud.cleanup();
+		hudTimer.cleanup();
+	}
 
+	if (!tracePath.empty())
+		ke::Profiler::getInstance().writeChromeTrace(tracePath);
+	if (!statsPath.empty())
+		renderer.getStats().write(statsPath);
 	renderer.cleanupRenderer();
 }
\ No newline at end of file
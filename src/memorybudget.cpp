@@ -0,0 +1,233 @@
+#include "memorybudget.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+void ke::MemoryBudget::init(const VkuInstanceDispatchTable& vki, VkPhysicalDevice physicalDevice, bool budgetExtension, uint32_t framesInFlight)
+{
+	mVki = &vki;
+	mPhysicalDevice = physicalDevice;
+	mBudgetExtension = budgetExtension;
+	mFramesInFlight = framesInFlight;
+
+	mVki->GetPhysicalDeviceMemoryProperties(mPhysicalDevice, &mMemoryProperties);
+	mHeaps.assign(mMemoryProperties.memoryHeapCount, HeapBudget{});
+	mTracked.assign(mMemoryProperties.memoryHeapCount, 0);
+	for (uint32_t heap = 0; heap < mMemoryProperties.memoryHeapCount; heap++)
+	{
+		mHeaps[heap].size = mMemoryProperties.memoryHeaps[heap].size;
+		mHeaps[heap].deviceLocal = (mMemoryProperties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+	}
+	query();
+
+	if (enableLogging)
+	{
+		if (mBudgetExtension)
+			mLogger.info("Tracking memory budget with VK_EXT_memory_budget.");
+		else
+			mLogger.info("VK_EXT_memory_budget is not available, budgets fall back to heap sizes.");
+		for (uint32_t heap = 0; heap < mHeaps.size(); heap++)
+			mLogger.debug("Heap {}{}: {} MiB, budget {} MiB.", heap, mHeaps[heap].deviceLocal ? " (device local)" : "",
+				mHeaps[heap].size >> 20, mHeaps[heap].budget >> 20);
+	}
+}
+
+void ke::MemoryBudget::cleanup()
+{
+	if (mStreamableCount > 0 && enableLogging)
+		mLogger.warn("{} streamable resources were still registered at cleanup.", mStreamableCount);
+	if (!mAllocations.empty() && enableLogging)
+		mLogger.warn("{} tracked allocations were never freed.", mAllocations.size());
+	mStreamables.clear();
+	mFreeStreamables.clear();
+	mAllocations.clear();
+	mStreamableCount = 0;
+}
+
+void ke::MemoryBudget::query()
+{
+	if (mBudgetExtension)
+	{
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+		budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+		VkPhysicalDeviceMemoryProperties2 properties{};
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+		properties.pNext = &budget;
+		mVki->GetPhysicalDeviceMemoryProperties2(mPhysicalDevice, &properties);
+
+		for (uint32_t heap = 0; heap < mHeaps.size(); heap++)
+		{
+			mHeaps[heap].budget = budget.heapBudget[heap];
+			mHeaps[heap].usage = budget.heapUsage[heap];
+		}
+	}
+	else
+		for (uint32_t heap = 0; heap < mHeaps.size(); heap++)
+		{
+			mHeaps[heap].budget = mHeaps[heap].size;
+			mHeaps[heap].usage = mTracked[heap];
+		}
+}
+
+void ke::MemoryBudget::update(uint64_t frame)
+{
+	KE_PROFILE_FUNCTION();
+	mFrame = frame;
+	mLastEvictionCount = 0;
+	query();
+
+	for (uint32_t heap = 0; heap < mHeaps.size(); heap++)
+	{
+		VkDeviceSize target = static_cast<VkDeviceSize>(mHeaps[heap].budget * static_cast<double>(mThreshold));
+		if (mHeaps[heap].usage > target)
+			evict(heap, target);
+		if (mHeaps[heap].usage > mHeaps[heap].budget && enableLogging)
+			mLogger.warn("Heap {} is over budget: {} MiB used of {} MiB.", heap, mHeaps[heap].usage >> 20, mHeaps[heap].budget >> 20);
+	}
+}
+
+void ke::MemoryBudget::setEvictionThreshold(float fraction)
+{
+	mThreshold = std::clamp(fraction, 0.0f, 1.0f);
+}
+
+float ke::MemoryBudget::getEvictionThreshold() const
+{
+	return mThreshold;
+}
+
+void ke::MemoryBudget::trackAllocation(VkDeviceMemory memory, uint32_t memoryType, VkDeviceSize size)
+{
+	uint32_t heap = getHeapIndex(memoryType);
+	mAllocations[memory] = { heap, size };
+	// Usage is refreshed by the next query either way; counting it now keeps makeRoom accurate in between.
+	mTracked[heap] += size;
+	mHeaps[heap].usage += size;
+}
+
+void ke::MemoryBudget::trackFree(VkDeviceMemory memory)
+{
+	auto it = mAllocations.find(memory);
+	if (it == mAllocations.end())
+		return;
+	mTracked[it->second.heap] -= it->second.size;
+	mHeaps[it->second.heap].usage -= std::min(mHeaps[it->second.heap].usage, it->second.size);
+	mAllocations.erase(it);
+}
+
+uint32_t ke::MemoryBudget::registerStreamable(uint32_t memoryType, VkDeviceSize size, EvictFn evict)
+{
+	uint32_t handle;
+	if (!mFreeStreamables.empty())
+	{
+		handle = mFreeStreamables.back();
+		mFreeStreamables.pop_back();
+	}
+	else
+	{
+		handle = static_cast<uint32_t>(mStreamables.size());
+		mStreamables.emplace_back();
+	}
+
+	Streamable& streamable = mStreamables[handle];
+	streamable.alive = true;
+	streamable.heap = getHeapIndex(memoryType);
+	streamable.size = size;
+	streamable.lastUsed = mFrame;
+	streamable.evict = std::move(evict);
+	mStreamableCount++;
+	return handle;
+}
+
+void ke::MemoryBudget::unregisterStreamable(uint32_t handle)
+{
+	if (handle >= mStreamables.size() || !mStreamables[handle].alive)
+		return;
+	mStreamables[handle].alive = false;
+	mStreamables[handle].evict = nullptr;
+	mFreeStreamables.push_back(handle);
+	mStreamableCount--;
+}
+
+void ke::MemoryBudget::touch(uint32_t handle)
+{
+	if (handle < mStreamables.size())
+		mStreamables[handle].lastUsed = mFrame;
+}
+
+VkDeviceSize ke::MemoryBudget::makeRoom(uint32_t memoryType, VkDeviceSize size)
+{
+	uint32_t heap = getHeapIndex(memoryType);
+	VkDeviceSize target = static_cast<VkDeviceSize>(mHeaps[heap].budget * static_cast<double>(mThreshold));
+	target = target > size ? target - size : 0;
+	if (mHeaps[heap].usage <= target)
+		return 0;
+	return evict(heap, target);
+}
+
+VkDeviceSize ke::MemoryBudget::evict(uint32_t heap, VkDeviceSize target)
+{
+	// Anything touched by the last framesInFlight frames may still be read by the GPU.
+	std::vector<uint32_t> candidates;
+	for (uint32_t handle = 0; handle < mStreamables.size(); handle++)
+	{
+		const Streamable& streamable = mStreamables[handle];
+		if (streamable.alive && streamable.heap == heap && streamable.lastUsed + mFramesInFlight <= mFrame)
+			candidates.push_back(handle);
+	}
+	std::sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b) { return mStreamables[a].lastUsed < mStreamables[b].lastUsed; });
+
+	VkDeviceSize freed = 0;
+	for (uint32_t handle : candidates)
+	{
+		if (mHeaps[heap].usage <= target)
+			break;
+
+		// The callback may register or unregister resources, so the entry is released before it runs.
+		EvictFn evictFn = std::move(mStreamables[handle].evict);
+		VkDeviceSize size = mStreamables[handle].size;
+		unregisterStreamable(handle);
+		VkDeviceSize usage = mHeaps[heap].usage;
+		evictFn();
+
+		// Resources suballocated from a larger block free nothing trackFree sees, so their size is taken off here.
+		freed += size;
+		if (mHeaps[heap].usage == usage)
+			mHeaps[heap].usage -= std::min(usage, size);
+		mLastEvictionCount++;
+	}
+
+	if (freed > 0 && enableLogging)
+		mLogger.debug("Evicted {} KiB from heap {}.", freed >> 10, heap);
+	return freed;
+}
+
+const std::vector<ke::HeapBudget>& ke::MemoryBudget::getHeaps() const
+{
+	return mHeaps;
+}
+
+uint32_t ke::MemoryBudget::getHeapIndex(uint32_t memoryType) const
+{
+	return mMemoryProperties.memoryTypes[memoryType].heapIndex;
+}
+
+bool ke::MemoryBudget::hasBudgetExtension() const
+{
+	return mBudgetExtension;
+}
+
+uint32_t ke::MemoryBudget::getLastEvictionCount() const
+{
+	return mLastEvictionCount;
+}
+
+uint32_t ke::MemoryBudget::getStreamableCount() const
+{
+	return mStreamableCount;
+}
\ No newline at end of file
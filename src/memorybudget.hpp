@@ -0,0 +1,93 @@
+#pragma once
+#include "vk.hpp"
+#include "logger.hpp"
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+namespace ke
+{
+	struct HeapBudget
+	{
+		VkDeviceSize size = 0;
+		// How much this process may use before it starts competing with other applications.
+		VkDeviceSize budget = 0;
+		VkDeviceSize usage = 0;
+		bool deviceLocal = false;
+	};
+
+	// Per-heap budget and usage, from VK_EXT_memory_budget when the device has it. Otherwise the budget is the heap
+	// size and usage counts only the allocations reported through trackAllocation.
+	// Streamable resources register with an evict callback. Once a heap's usage passes the eviction threshold,
+	// the least recently touched ones are evicted until it is back under, skipping any touched by a frame still in flight.
+	class MemoryBudget
+	{
+	public:
+		using EvictFn = std::function<void()>;
+
+		void init(const VkuInstanceDispatchTable& vki, VkPhysicalDevice physicalDevice, bool budgetExtension, uint32_t framesInFlight);
+		void cleanup();
+
+		// Call once per frame after the frame's fence has been waited on. Queries the heaps and evicts where needed.
+		void update(uint64_t frame);
+		// Fraction of the budget above which eviction starts.
+		void setEvictionThreshold(float fraction);
+		float getEvictionThreshold() const;
+
+		void trackAllocation(VkDeviceMemory memory, uint32_t memoryType, VkDeviceSize size);
+		void trackFree(VkDeviceMemory memory);
+
+		// evict must release the resource; it runs from update or makeRoom and the handle is unregistered afterwards.
+		uint32_t registerStreamable(uint32_t memoryType, VkDeviceSize size, EvictFn evict);
+		void unregisterStreamable(uint32_t handle);
+		// Marks the resource as used by the frame being recorded.
+		void touch(uint32_t handle);
+		// Evicts idle resources from the heap behind memoryType until size more bytes fit under the threshold.
+		// Returns the bytes freed.
+		VkDeviceSize makeRoom(uint32_t memoryType, VkDeviceSize size);
+
+		const std::vector<HeapBudget>& getHeaps() const;
+		uint32_t getHeapIndex(uint32_t memoryType) const;
+		bool hasBudgetExtension() const;
+		uint32_t getLastEvictionCount() const;
+		uint32_t getStreamableCount() const;
+	private:
+		struct Streamable
+		{
+			bool alive = false;
+			uint32_t heap = 0;
+			VkDeviceSize size = 0;
+			uint64_t lastUsed = 0;
+			EvictFn evict;
+		};
+
+		struct Allocation
+		{
+			uint32_t heap;
+			VkDeviceSize size;
+		};
+	private:
+		void query();
+		VkDeviceSize evict(uint32_t heap, VkDeviceSize target);
+	private:
+		const VkuInstanceDispatchTable* mVki = nullptr;
+		VkPhysicalDevice mPhysicalDevice = VK_NULL_HANDLE;
+		VkPhysicalDeviceMemoryProperties mMemoryProperties{};
+		bool mBudgetExtension = false;
+		uint32_t mFramesInFlight = 1;
+		float mThreshold = 0.9f;
+		uint64_t mFrame = 0;
+
+		std::vector<HeapBudget> mHeaps;
+		// Bytes tracked per heap, used as the usage when there is no budget extension.
+		std::vector<VkDeviceSize> mTracked;
+		std::unordered_map<VkDeviceMemory, Allocation> mAllocations;
+
+		std::vector<Streamable> mStreamables;
+		std::vector<uint32_t> mFreeStreamables;
+		uint32_t mStreamableCount = 0;
+		uint32_t mLastEvictionCount = 0;
+
+		ke::Logger mLogger = ke::Logger("Memory Budget Logger", spdlog::level::debug);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,675 @@
+#include "occlusion.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cmath>
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+static uint32_t floorPowerOfTwo(uint32_t value)
+{
+	uint32_t result = 1;
+	while (result * 2 <= value)
+		result *= 2;
+	return result;
+}
+
+void ke::OcclusionCuller::init(Renderer& renderer, uint32_t maxObjects, uint32_t maxOccluders, const OcclusionCullDesc& desc)
+{
+	mRenderer = &renderer;
+	mDesc = desc;
+	mMaxObjects = std::max(maxObjects, 1u);
+	mMaxOccluders = std::max(maxOccluders, 1u);
+
+	const DeviceCapabilities& caps = renderer.getCapabilities();
+	if (caps.drawIndirectCount)
+		mDrawIndirectCount = caps.drawIndirectCountExtension ? renderer.getDeviceTable().CmdDrawIndirectCountKHR : renderer.getDeviceTable().CmdDrawIndirectCount;
+	if (!caps.drawIndirectFirstInstance && enableLogging)
+		mLogger.warn("Device has no drawIndirectFirstInstance, culled draws cannot identify their object.");
+
+	VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	uint32_t frames = renderer.getMaxFramesInFlight();
+	mParamBuffers.resize(frames);
+	mObjectBuffers.resize(frames);
+	mOccluderBuffers.resize(frames);
+	mReadback.resize(frames);
+	mObjectCounts.assign(frames, 0);
+	mOccluderCounts.assign(frames, 0);
+	for (uint32_t i = 0; i < frames; i++)
+	{
+		mParamBuffers[i] = renderer.createBuffer(sizeof(CullParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, hostVisible);
+		mObjectBuffers[i] = renderer.createBuffer(sizeof(GpuObject) * mMaxObjects, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible);
+		mOccluderBuffers[i] = renderer.createBuffer(sizeof(GpuBox) * mMaxOccluders, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, hostVisible);
+		mReadback[i] = renderer.createBuffer(sizeof(CullCounters), VK_BUFFER_USAGE_TRANSFER_DST_BIT, hostVisible);
+		*static_cast<CullCounters*>(mReadback[i].mapped) = CullCounters{};
+	}
+
+	VkMemoryPropertyFlags deviceLocal = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	mDrawCommands = renderer.createBuffer(sizeof(VkDrawIndirectCommand) * mMaxObjects, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, deviceLocal);
+	mDrawCount = renderer.createBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, deviceLocal);
+	mCounters = renderer.createBuffer(sizeof(CullCounters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, deviceLocal);
+
+	createImages();
+	createDepthPass();
+	createDescriptors();
+	createPipelines();
+
+	mHook = renderer.addRenderGraphHook(RenderGraphStage::BeforeMainPass, [this](RenderGraph& graph) { addPasses(graph); });
+
+	if (enableLogging)
+		mLogger.info("Created occlusion culling for {} objects and {} occluders, {}x{} depth, {}x{} Hi-Z with {} mips.", mMaxObjects, mMaxOccluders,
+			desc.depthExtent.width, desc.depthExtent.height, mHiZExtent.width, mHiZExtent.height, mMipCount);
+}
+
+void ke::OcclusionCuller::cleanup()
+{
+	const VkuDeviceDispatchTable& vkd = mRenderer->getDeviceTable();
+	VkDevice device = mRenderer->getDevice();
+	const VkAllocationCallbacks* allocator = mRenderer->getAllocationCallbacks();
+
+	mRenderer->removeRenderGraphHook(mHook);
+	mRenderer->destroyPipeline(mDepthPipeline);
+	vkd.DestroyPipeline(device, mReducePipeline, allocator);
+	vkd.DestroyPipeline(device, mCullPipeline, allocator);
+	vkd.DestroyPipelineLayout(device, mDepthLayout, allocator);
+	vkd.DestroyPipelineLayout(device, mReduceLayout, allocator);
+	vkd.DestroyPipelineLayout(device, mCullLayout, allocator);
+	vkd.DestroyDescriptorPool(device, mDescriptorPool, allocator);
+	vkd.DestroyDescriptorSetLayout(device, mReduceSetLayout, allocator);
+	vkd.DestroyDescriptorSetLayout(device, mCullSetLayout, allocator);
+
+	vkd.DestroyFramebuffer(device, mDepthFramebuffer, allocator);
+	vkd.DestroyRenderPass(device, mDepthPass, allocator);
+	mRenderer->releaseImageViews(mHiZ);
+	vkd.DestroyImage(device, mHiZ, allocator);
+	vkd.FreeMemory(device, mHiZMemory, allocator);
+	mRenderer->releaseImageViews(mDepth);
+	vkd.DestroyImage(device, mDepth, allocator);
+	vkd.FreeMemory(device, mDepthMemory, allocator);
+
+	for (uint32_t i = 0; i < mParamBuffers.size(); i++)
+	{
+		mRenderer->destroyBuffer(mParamBuffers[i]);
+		mRenderer->destroyBuffer(mObjectBuffers[i]);
+		mRenderer->destroyBuffer(mOccluderBuffers[i]);
+		mRenderer->destroyBuffer(mReadback[i]);
+	}
+	mRenderer->destroyBuffer(mDrawCommands);
+	mRenderer->destroyBuffer(mDrawCount);
+	mRenderer->destroyBuffer(mCounters);
+}
+
+void ke::OcclusionCuller::createImages()
+{
+	const VkuDeviceDispatchTable& vkd = mRenderer->getDeviceTable();
+	VkDevice device = mRenderer->getDevice();
+	const VkAllocationCallbacks* allocator = mRenderer->getAllocationCallbacks();
+
+	VkFormatFeatureFlags depthFeatures = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+	VkFormatProperties properties{};
+	mRenderer->getInstanceTable().GetPhysicalDeviceFormatProperties(mRenderer->getPhysicalDevice(), VK_FORMAT_D32_SFLOAT, &properties);
+	mDepthFormat = (properties.optimalTilingFeatures & depthFeatures) == depthFeatures ? VK_FORMAT_D32_SFLOAT : VK_FORMAT_D16_UNORM;
+
+	// The pyramid starts at the largest power of two that fits, so every level halves cleanly down to 1x1.
+	mHiZExtent = { floorPowerOfTwo(mDesc.depthExtent.width), floorPowerOfTwo(mDesc.depthExtent.height) };
+	mMipCount = static_cast<uint32_t>(std::log2(std::max(mHiZExtent.width, mHiZExtent.height))) + 1;
+
+	struct ImageSetup
+	{
+		VkImage* image;
+		VkDeviceMemory* memory;
+		VkFormat format;
+		VkExtent2D extent;
+		uint32_t mips;
+		VkImageUsageFlags usage;
+		VkImageAspectFlags aspect;
+	};
+	ImageSetup setups[2] = {
+		{ &mDepth, &mDepthMemory, mDepthFormat, mDesc.depthExtent, 1, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_DEPTH_BIT },
+		{ &mHiZ, &mHiZMemory, VK_FORMAT_R32_SFLOAT, mHiZExtent, mMipCount, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT }
+	};
+	for (const ImageSetup& setup : setups)
+	{
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = setup.format;
+		imageInfo.extent = { setup.extent.width, setup.extent.height, 1 };
+		imageInfo.mipLevels = setup.mips;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = setup.usage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		if (vkd.CreateImage(device, &imageInfo, allocator, setup.image) != VK_SUCCESS && enableLogging)
+			mLogger.error("Failed to create an occlusion culling image!");
+
+		VkMemoryRequirements requirements{};
+		vkd.GetImageMemoryRequirements(device, *setup.image, &requirements);
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = requirements.size;
+		allocInfo.memoryTypeIndex = mRenderer->findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (vkd.AllocateMemory(device, &allocInfo, allocator, setup.memory) != VK_SUCCESS && enableLogging)
+			mLogger.error("Failed to allocate occlusion culling image memory!");
+		vkd.BindImageMemory(device, *setup.image, *setup.memory, 0);
+	}
+
+	auto createView = [&](VkImage image, VkFormat format, VkImageAspectFlags aspect, uint32_t baseMip, uint32_t mipCount)
+		{
+			VkImageViewCreateInfo viewInfo{};
+			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewInfo.image = image;
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewInfo.format = format;
+			viewInfo.subresourceRange = { aspect, baseMip, mipCount, 0, 1 };
+			return mRenderer->getImageView(viewInfo);
+		};
+	mDepthView = createView(mDepth, mDepthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1);
+	mHiZView = createView(mHiZ, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 0, mMipCount);
+	mMipViews.resize(mMipCount);
+	for (uint32_t mip = 0; mip < mMipCount; mip++)
+		mMipViews[mip] = createView(mHiZ, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, mip, 1);
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	mSampler = mRenderer->getSampler(samplerInfo);
+
+	// Both images are imported as last sampled by the cull, so they have to start out in that layout.
+	mRenderer->submitImmediate([&](VkCommandBuffer cmd)
+		{
+			VkImageMemoryBarrier barriers[2]{};
+			for (uint32_t i = 0; i < 2; i++)
+			{
+				barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				barriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+				barriers[i].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+				barriers[i].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+				barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barriers[i].image = *setups[i].image;
+				barriers[i].subresourceRange = { setups[i].aspect, 0, setups[i].mips, 0, 1 };
+			}
+			vkd.CmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 2, barriers);
+		});
+}
+
+void ke::OcclusionCuller::createDepthPass()
+{
+	const VkuDeviceDispatchTable& vkd = mRenderer->getDeviceTable();
+	VkDevice device = mRenderer->getDevice();
+
+	VkAttachmentDescription depthAtt{};
+	depthAtt.format = mDepthFormat;
+	depthAtt.samples = VK_SAMPLE_COUNT_1_BIT;
+	depthAtt.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAtt.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	depthAtt.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAtt.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	// Layout transitions in and out of the pass are recorded by the render graph.
+	depthAtt.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthAtt.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference depthRef{};
+	depthRef.attachment = 0;
+	depthRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass{};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.pDepthStencilAttachment = &depthRef;
+
+	VkRenderPassCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	createInfo.attachmentCount = 1;
+	createInfo.pAttachments = &depthAtt;
+	createInfo.subpassCount = 1;
+	createInfo.pSubpasses = &subpass;
+	if (vkd.CreateRenderPass(device, &createInfo, mRenderer->getAllocationCallbacks(), &mDepthPass) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create occluder depth render pass!");
+
+	VkFramebufferCreateInfo framebufferInfo{};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = mDepthPass;
+	framebufferInfo.attachmentCount = 1;
+	framebufferInfo.pAttachments = &mDepthView;
+	framebufferInfo.width = mDesc.depthExtent.width;
+	framebufferInfo.height = mDesc.depthExtent.height;
+	framebufferInfo.layers = 1;
+	if (vkd.CreateFramebuffer(device, &framebufferInfo, mRenderer->getAllocationCallbacks(), &mDepthFramebuffer) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create occluder depth framebuffer!");
+}
+
+void ke::OcclusionCuller::createDescriptors()
+{
+	const VkuDeviceDispatchTable& vkd = mRenderer->getDeviceTable();
+	VkDevice device = mRenderer->getDevice();
+	const VkAllocationCallbacks* allocator = mRenderer->getAllocationCallbacks();
+	uint32_t frames = mRenderer->getMaxFramesInFlight();
+
+	VkDescriptorSetLayoutBinding reduceBindings[2]{};
+	reduceBindings[0] = { 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+	reduceBindings[1] = { 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+
+	// Params, objects, draw commands, draw count, counters and the pyramid.
+	VkDescriptorSetLayoutBinding cullBindings[6]{};
+	for (uint32_t i = 0; i < 6; i++)
+	{
+		cullBindings[i].binding = i;
+		cullBindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : i == 5 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		cullBindings[i].descriptorCount = 1;
+		cullBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 2;
+	layoutInfo.pBindings = reduceBindings;
+	if (vkd.CreateDescriptorSetLayout(device, &layoutInfo, allocator, &mReduceSetLayout) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create Hi-Z reduce descriptor set layout!");
+	layoutInfo.bindingCount = 6;
+	layoutInfo.pBindings = cullBindings;
+	if (vkd.CreateDescriptorSetLayout(device, &layoutInfo, allocator, &mCullSetLayout) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create occlusion cull descriptor set layout!");
+
+	VkDescriptorPoolSize poolSizes[4] = {
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, mMipCount + frames },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, mMipCount },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frames },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frames * 4 }
+	};
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = mMipCount + frames;
+	poolInfo.poolSizeCount = 4;
+	poolInfo.pPoolSizes = poolSizes;
+	if (vkd.CreateDescriptorPool(device, &poolInfo, allocator, &mDescriptorPool) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create occlusion culling descriptor pool!");
+
+	std::vector<VkDescriptorSetLayout> reduceLayouts(mMipCount, mReduceSetLayout);
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = mDescriptorPool;
+	allocInfo.descriptorSetCount = mMipCount;
+	allocInfo.pSetLayouts = reduceLayouts.data();
+	mReduceSets.resize(mMipCount);
+	if (vkd.AllocateDescriptorSets(device, &allocInfo, mReduceSets.data()) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to allocate Hi-Z reduce descriptor sets!");
+
+	std::vector<VkDescriptorSetLayout> cullLayouts(frames, mCullSetLayout);
+	allocInfo.descriptorSetCount = frames;
+	allocInfo.pSetLayouts = cullLayouts.data();
+	mCullSets.resize(frames);
+	if (vkd.AllocateDescriptorSets(device, &allocInfo, mCullSets.data()) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to allocate occlusion cull descriptor sets!");
+
+	// Level 0 reduces the depth buffer; every other level reduces the one above it, which is in GENERAL while the pyramid is built.
+	for (uint32_t mip = 0; mip < mMipCount; mip++)
+	{
+		VkDescriptorImageInfo source{ mSampler, mip == 0 ? mDepthView : mMipViews[mip - 1],
+			mip == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL };
+		VkDescriptorImageInfo destination{ VK_NULL_HANDLE, mMipViews[mip], VK_IMAGE_LAYOUT_GENERAL };
+		VkWriteDescriptorSet writes[2]{};
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = mReduceSets[mip];
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = reduceBindings[i].descriptorType;
+		}
+		writes[0].pImageInfo = &source;
+		writes[1].pImageInfo = &destination;
+		vkd.UpdateDescriptorSets(device, 2, writes, 0, nullptr);
+	}
+
+	for (uint32_t frame = 0; frame < frames; frame++)
+	{
+		const Buffer* buffers[5] = { &mParamBuffers[frame], &mObjectBuffers[frame], &mDrawCommands, &mDrawCount, &mCounters };
+		VkDescriptorBufferInfo bufferInfos[5]{};
+		VkDescriptorImageInfo pyramid{ mSampler, mHiZView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		VkWriteDescriptorSet writes[6]{};
+		for (uint32_t i = 0; i < 6; i++)
+		{
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = mCullSets[frame];
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = cullBindings[i].descriptorType;
+			if (i < 5)
+			{
+				bufferInfos[i] = { buffers[i]->buffer, 0, VK_WHOLE_SIZE };
+				writes[i].pBufferInfo = &bufferInfos[i];
+			}
+		}
+		writes[5].pImageInfo = &pyramid;
+		vkd.UpdateDescriptorSets(device, 6, writes, 0, nullptr);
+	}
+}
+
+void ke::OcclusionCuller::createPipelines()
+{
+	const VkuDeviceDispatchTable& vkd = mRenderer->getDeviceTable();
+	VkDevice device = mRenderer->getDevice();
+	const VkAllocationCallbacks* allocator = mRenderer->getAllocationCallbacks();
+
+	VkPushConstantRange cameraRange{ VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4) };
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &cameraRange;
+	if (vkd.CreatePipelineLayout(device, &layoutInfo, allocator, &mDepthLayout) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create occluder depth pipeline layout!");
+
+	VkPushConstantRange reduceRange{ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReduceConstants) };
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &mReduceSetLayout;
+	layoutInfo.pPushConstantRanges = &reduceRange;
+	if (vkd.CreatePipelineLayout(device, &layoutInfo, allocator, &mReduceLayout) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create Hi-Z reduce pipeline layout!");
+
+	layoutInfo.pSetLayouts = &mCullSetLayout;
+	layoutInfo.pushConstantRangeCount = 0;
+	layoutInfo.pPushConstantRanges = nullptr;
+	if (vkd.CreatePipelineLayout(device, &layoutInfo, allocator, &mCullLayout) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create occlusion cull pipeline layout!");
+
+	GraphicsPipelineDesc desc{};
+	desc.vertexShader = "shader/bin/occluder_vert.spv";
+	desc.fragmentShader = nullptr;
+	desc.bindings = { { 0, sizeof(GpuBox), VK_VERTEX_INPUT_RATE_INSTANCE } };
+	desc.attributes = {
+		{ 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(GpuBox, min) },
+		{ 1, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(GpuBox, max) }
+	};
+	desc.layout = mDepthLayout;
+	desc.renderPass = mDepthPass;
+	desc.depthTest = true;
+	desc.depthWrite = true;
+	mDepthPipeline = mRenderer->buildGraphicsPipeline(desc);
+	mReducePipeline = mRenderer->buildComputePipeline("shader/bin/hiz_reduce.spv", mReduceLayout);
+	mCullPipeline = mRenderer->buildComputePipeline("shader/bin/occlusion_cull.spv", mCullLayout);
+}
+
+void ke::OcclusionCuller::setCamera(const glm::mat4& viewProjection)
+{
+	mViewProjection = viewProjection;
+}
+
+void ke::OcclusionCuller::submitOccluders(const Bounds* boxes, uint32_t count)
+{
+	mOccluderSpans.push_back({ boxes, count });
+}
+
+void ke::OcclusionCuller::submitObjects(const OcclusionObject* objects, uint32_t count)
+{
+	mObjectSpans.push_back({ objects, count });
+}
+
+void ke::OcclusionCuller::setOcclusionEnabled(bool enabled)
+{
+	mOcclusionEnabled = enabled;
+}
+
+void ke::OcclusionCuller::upload(uint32_t slot)
+{
+	GpuBox* boxes = static_cast<GpuBox*>(mOccluderBuffers[slot].mapped);
+	uint32_t occluders = 0;
+	for (const auto& span : mOccluderSpans)
+	{
+		uint32_t take = std::min(span.count, mMaxOccluders - occluders);
+		if (take < span.count && enableLogging)
+			mLogger.warn("Occluder buffer is full, dropping {} occluders.", span.count - take);
+		for (uint32_t i = 0; i < take; i++)
+			boxes[occluders + i] = { glm::vec4(span.data[i].min, 1.0f), glm::vec4(span.data[i].max, 1.0f) };
+		occluders += take;
+	}
+	mOccluderSpans.clear();
+
+	GpuObject* objects = static_cast<GpuObject*>(mObjectBuffers[slot].mapped);
+	uint32_t count = 0;
+	for (const auto& span : mObjectSpans)
+	{
+		uint32_t take = std::min(span.count, mMaxObjects - count);
+		if (take < span.count && enableLogging)
+			mLogger.warn("Object buffer is full, dropping {} objects.", span.count - take);
+		for (uint32_t i = 0; i < take; i++)
+		{
+			const OcclusionObject& object = span.data[i];
+			objects[count + i] = { glm::vec4(object.bounds.min, 1.0f), glm::vec4(object.bounds.max, 1.0f), glm::uvec4(object.vertexCount, object.firstVertex, 0, 0) };
+		}
+		count += take;
+	}
+	mObjectSpans.clear();
+
+	mOccluderCounts[slot] = occluders;
+	mObjectCounts[slot] = count;
+
+	CullParams& params = *static_cast<CullParams*>(mParamBuffers[slot].mapped);
+	params.viewProjection = mViewProjection;
+	params.counts = glm::uvec4(count, mDrawIndirectCount ? 1 : 0, mOcclusionEnabled && occluders > 0 ? 1 : 0, mMipCount);
+	params.hizSize = glm::vec4(static_cast<float>(mHiZExtent.width), static_cast<float>(mHiZExtent.height), 0.0f, 0.0f);
+
+	mRenderer->getStats().addUpload(sizeof(GpuBox) * occluders + sizeof(GpuObject) * count + sizeof(CullParams));
+}
+
+void ke::OcclusionCuller::addPasses(RenderGraph& graph)
+{
+	KE_PROFILE_FUNCTION();
+	uint32_t slot = mRenderer->getCurrentFrameInFlight();
+
+	// This slot's fence has been waited on, so the readback and object count still describe its last submission.
+	const CullCounters& counters = *static_cast<const CullCounters*>(mReadback[slot].mapped);
+	mStats.tested = mObjectCounts[slot];
+	mStats.frustumCulled = std::min(counters.frustumCulled, mStats.tested);
+	mStats.occlusionCulled = std::min(counters.occlusionCulled, mStats.tested - mStats.frustumCulled);
+	mStats.visible = mStats.tested - mStats.frustumCulled - mStats.occlusionCulled;
+	mRenderer->getStats().setCullStats(mStats.tested, mStats.frustumCulled, mStats.occlusionCulled);
+	upload(slot);
+
+	RGImageDesc depthDesc{};
+	depthDesc.format = mDepthFormat;
+	depthDesc.extent = mDesc.depthExtent;
+	depthDesc.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	depthDesc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+	RGImageDesc hizDesc{};
+	hizDesc.format = VK_FORMAT_R32_SFLOAT;
+	hizDesc.extent = mHiZExtent;
+	hizDesc.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	hizDesc.mipLevels = mMipCount;
+
+	RGResource depth = graph.importImage("occluder depth", mDepth, mDepthView, depthDesc, RGAccess::ComputeSampledRead, RGAccess::ComputeSampledRead);
+	RGResource hiz = graph.importImage("hi-z", mHiZ, mHiZView, hizDesc, RGAccess::ComputeSampledRead, RGAccess::ComputeSampledRead);
+	RGResource commands = graph.importBuffer("occlusion draws", mDrawCommands.buffer, mDrawCommands.size, RGAccess::IndirectRead);
+	RGResource drawCount = graph.importBuffer("occlusion draw count", mDrawCount.buffer, mDrawCount.size, RGAccess::IndirectRead);
+	RGResource counterBuffer = graph.importBuffer("occlusion counters", mCounters.buffer, mCounters.size, RGAccess::TransferRead);
+
+	const VkuDeviceDispatchTable* vkd = &mRenderer->getDeviceTable();
+	std::vector<RGPass> passes;
+
+	RGPass reset = graph.addPass("occlusion reset", [this, vkd](VkCommandBuffer cmd)
+		{
+			vkd->CmdFillBuffer(cmd, mDrawCount.buffer, 0, VK_WHOLE_SIZE, 0);
+			vkd->CmdFillBuffer(cmd, mCounters.buffer, 0, VK_WHOLE_SIZE, 0);
+		});
+	graph.write(reset, drawCount, RGAccess::TransferWrite);
+	graph.write(reset, counterBuffer, RGAccess::TransferWrite);
+	passes.push_back(reset);
+
+	if (mOcclusionEnabled && mOccluderCounts[slot] > 0)
+	{
+		RGPass depthPass = graph.addPass("occluder depth", [this, slot](VkCommandBuffer cmd) { recordDepth(cmd, slot); });
+		graph.write(depthPass, depth, RGAccess::DepthAttachmentWrite);
+
+		RGPass reduce = graph.addPass("hi-z reduce", [this](VkCommandBuffer cmd) { recordReduce(cmd); });
+		graph.read(reduce, depth, RGAccess::ComputeSampledRead);
+		graph.write(reduce, hiz, RGAccess::ComputeStorageWrite);
+		passes.push_back(depthPass);
+		passes.push_back(reduce);
+	}
+
+	uint32_t objectCount = mObjectCounts[slot];
+	RGPass cull = graph.addPass("occlusion cull", [this, vkd, slot, objectCount](VkCommandBuffer cmd)
+		{
+			if (mTimer)
+				mTimer->begin(cmd, mCullScope);
+			vkd->CmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mCullPipeline);
+			vkd->CmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mCullLayout, 0, 1, &mCullSets[slot], 0, nullptr);
+			mRenderer->getStats().addPipelineBind();
+			mRenderer->getStats().addDescriptorBinds(1);
+			if (objectCount > 0)
+				vkd->CmdDispatch(cmd, (objectCount + 63) / 64, 1, 1);
+			if (mTimer)
+				mTimer->end(cmd, mCullScope);
+		});
+	graph.read(cull, hiz, RGAccess::ComputeSampledRead);
+	graph.write(cull, commands, RGAccess::ComputeStorageWrite);
+	graph.write(cull, drawCount, RGAccess::ComputeStorageWrite);
+	graph.write(cull, counterBuffer, RGAccess::ComputeStorageWrite);
+	passes.push_back(cull);
+
+	RGPass readback = graph.addPass("occlusion readback", [this, vkd, slot](VkCommandBuffer cmd)
+		{
+			VkBufferCopy region{ 0, 0, sizeof(CullCounters) };
+			vkd->CmdCopyBuffer(cmd, mCounters.buffer, mReadback[slot].buffer, 1, &region);
+
+			VkBufferMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.buffer = mReadback[slot].buffer;
+			barrier.size = VK_WHOLE_SIZE;
+			vkd->CmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+		});
+	graph.read(readback, counterBuffer, RGAccess::TransferRead);
+	passes.push_back(readback);
+
+	for (RGPass pass : passes)
+		graph.setSideEffect(pass);
+
+	mRenderer->mainPassRead(commands, RGAccess::IndirectRead);
+	mRenderer->mainPassRead(drawCount, RGAccess::IndirectRead);
+}
+
+void ke::OcclusionCuller::recordDepth(VkCommandBuffer cmd, uint32_t slot)
+{
+	const VkuDeviceDispatchTable& vkd = mRenderer->getDeviceTable();
+
+	VkClearValue clear{};
+	clear.depthStencil = { 1.0f, 0 };
+	VkRenderPassBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	beginInfo.renderPass = mDepthPass;
+	beginInfo.framebuffer = mDepthFramebuffer;
+	beginInfo.renderArea.extent = mDesc.depthExtent;
+	beginInfo.clearValueCount = 1;
+	beginInfo.pClearValues = &clear;
+	vkd.CmdBeginRenderPass(cmd, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	VkViewport viewport{ 0.0f, 0.0f, static_cast<float>(mDesc.depthExtent.width), static_cast<float>(mDesc.depthExtent.height), 0.0f, 1.0f };
+	VkRect2D scissor{ { 0, 0 }, mDesc.depthExtent };
+	vkd.CmdSetViewport(cmd, 0, 1, &viewport);
+	vkd.CmdSetScissor(cmd, 0, 1, &scissor);
+
+	mRenderer->bindPipeline(cmd, mDepthPipeline);
+	vkd.CmdPushConstants(cmd, mDepthLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &mViewProjection);
+	VkDeviceSize offset = 0;
+	vkd.CmdBindVertexBuffers(cmd, 0, 1, &mOccluderBuffers[slot].buffer, &offset);
+	// 36 vertices, the cube is expanded in occluder.vert.
+	vkd.CmdDraw(cmd, 36, mOccluderCounts[slot], 0, 0);
+	mRenderer->getStats().addDraw(36, mOccluderCounts[slot]);
+
+	vkd.CmdEndRenderPass(cmd);
+}
+
+void ke::OcclusionCuller::recordReduce(VkCommandBuffer cmd)
+{
+	const VkuDeviceDispatchTable& vkd = mRenderer->getDeviceTable();
+	vkd.CmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mReducePipeline);
+	mRenderer->getStats().addPipelineBind();
+
+	glm::ivec2 srcSize(mDesc.depthExtent.width, mDesc.depthExtent.height);
+	for (uint32_t mip = 0; mip < mMipCount; mip++)
+	{
+		glm::ivec2 dstSize(std::max(mHiZExtent.width >> mip, 1u), std::max(mHiZExtent.height >> mip, 1u));
+		ReduceConstants constants{ srcSize, dstSize };
+		vkd.CmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mReduceLayout, 0, 1, &mReduceSets[mip], 0, nullptr);
+		vkd.CmdPushConstants(cmd, mReduceLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReduceConstants), &constants);
+		vkd.CmdDispatch(cmd, (dstSize.x + 7) / 8, (dstSize.y + 7) / 8, 1);
+		mRenderer->getStats().addDescriptorBinds(1);
+
+		// The render graph only tracks the whole image, so the level-to-level dependency is recorded here.
+		if (mip + 1 < mMipCount)
+		{
+			VkImageMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = mHiZ;
+			barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, mip, 1, 0, 1 };
+			vkd.CmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		}
+		srcSize = dstSize;
+	}
+}
+
+void ke::OcclusionCuller::record(VkCommandBuffer cmd)
+{
+	KE_PROFILE_FUNCTION();
+	const VkuDeviceDispatchTable& vkd = mRenderer->getDeviceTable();
+	uint32_t count = std::min(mObjectCounts[mRenderer->getCurrentFrameInFlight()], mRenderer->getCapabilities().maxDrawIndirectCount);
+	if (count == 0)
+		return;
+
+	// The visible count only exists on the GPU, so calls are counted without their triangles.
+	if (mDrawIndirectCount)
+	{
+		mDrawIndirectCount(cmd, mDrawCommands.buffer, 0, mDrawCount.buffer, 0, count, sizeof(VkDrawIndirectCommand));
+		mRenderer->getStats().addDraw(0, 0);
+	}
+	else if (mRenderer->getCapabilities().multiDrawIndirect)
+	{
+		vkd.CmdDrawIndirect(cmd, mDrawCommands.buffer, 0, count, sizeof(VkDrawIndirectCommand));
+		mRenderer->getStats().addDraw(0, 0);
+	}
+	else
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			vkd.CmdDrawIndirect(cmd, mDrawCommands.buffer, i * sizeof(VkDrawIndirectCommand), 1, sizeof(VkDrawIndirectCommand));
+			mRenderer->getStats().addDraw(0, 0);
+		}
+	}
+}
+
+void ke::OcclusionCuller::setTimer(GpuTimer* timer, uint32_t cullScope)
+{
+	mTimer = timer;
+	mCullScope = cullScope;
+}
+
+const ke::OcclusionCullStats& ke::OcclusionCuller::getCullStats() const
+{
+	return mStats;
+}
+
+uint32_t ke::OcclusionCuller::getHiZMipCount() const
+{
+	return mMipCount;
+}
\ No newline at end of file
@@ -0,0 +1,162 @@
+#pragma once
+#include "renderer.hpp"
+#include "gputimer.hpp"
+#include "scene.hpp"
+#include <glm/glm.hpp>
+
+namespace ke
+{
+	// A draw that is culled as a whole. Surviving draws are issued with firstInstance set to the object's index.
+	struct OcclusionObject
+	{
+		Bounds bounds;
+		uint32_t vertexCount = 0;
+		uint32_t firstVertex = 0;
+	};
+
+	struct OcclusionCullDesc
+	{
+		// Occluders are rasterised at this fixed size, independent of the render extent.
+		VkExtent2D depthExtent = { 512, 256 };
+	};
+
+	struct OcclusionCullStats
+	{
+		uint32_t tested = 0;
+		uint32_t frustumCulled = 0;
+		uint32_t occlusionCulled = 0;
+		uint32_t visible = 0;
+	};
+
+	// GPU occlusion culling. Occluder boxes are drawn into a small depth prepass, reduced into a max-depth mip pyramid
+	// and every object's bounding box is tested against the frustum and the pyramid level where the box covers at most
+	// 2x2 texels. Visible objects are compacted into an indirect draw list ahead of the main pass.
+	class OcclusionCuller
+	{
+	public:
+		void init(Renderer& renderer, uint32_t maxObjects, uint32_t maxOccluders, const OcclusionCullDesc& desc = OcclusionCullDesc{});
+		void cleanup();
+
+		// Camera, occluders and objects are consumed when the frame graph is built, so set them before beginRecording.
+		// The arrays are only read then and must stay alive until that point.
+		void setCamera(const glm::mat4& viewProjection);
+		// Occluder boxes must lie inside the geometry they stand for, or they hide objects that are actually visible.
+		void submitOccluders(const Bounds* boxes, uint32_t count);
+		void submitObjects(const OcclusionObject* objects, uint32_t count);
+		// With occlusion off only the frustum test runs, for comparing the two.
+		void setOcclusionEnabled(bool enabled);
+
+		// Draws the visible objects with the bound pipeline in the main pass.
+		void record(VkCommandBuffer cmd);
+
+		void setTimer(GpuTimer* timer, uint32_t cullScope);
+		// Read back from the GPU one frames-in-flight cycle late and also reported to the renderer stats.
+		const OcclusionCullStats& getCullStats() const;
+		uint32_t getHiZMipCount() const;
+	private:
+		struct GpuBox
+		{
+			glm::vec4 min;
+			glm::vec4 max;
+		};
+
+		struct GpuObject
+		{
+			glm::vec4 min;
+			glm::vec4 max;
+			glm::uvec4 draw;
+		};
+
+		// std140 layout of the CullParams block.
+		struct CullParams
+		{
+			glm::mat4 viewProjection;
+			glm::uvec4 counts;
+			glm::vec4 hizSize;
+		};
+
+		struct CullCounters
+		{
+			uint32_t frustumCulled;
+			uint32_t occlusionCulled;
+		};
+
+		struct ReduceConstants
+		{
+			glm::ivec2 srcSize;
+			glm::ivec2 dstSize;
+		};
+
+		template <typename T>
+		struct Span
+		{
+			const T* data;
+			uint32_t count;
+		};
+	private:
+		void createImages();
+		void createDepthPass();
+		void createPipelines();
+		void createDescriptors();
+		void addPasses(RenderGraph& graph);
+		void upload(uint32_t slot);
+		void recordDepth(VkCommandBuffer cmd, uint32_t slot);
+		void recordReduce(VkCommandBuffer cmd);
+	private:
+		Renderer* mRenderer = nullptr;
+		OcclusionCullDesc mDesc;
+		uint32_t mMaxObjects = 0;
+		uint32_t mMaxOccluders = 0;
+		uint32_t mHook = 0;
+		// Set when the device has draw indirect count; otherwise culled draws stay in place with no instances.
+		PFN_vkCmdDrawIndirectCount mDrawIndirectCount = nullptr;
+		bool mOcclusionEnabled = true;
+
+		VkFormat mDepthFormat = VK_FORMAT_D32_SFLOAT;
+		VkImage mDepth = VK_NULL_HANDLE;
+		VkDeviceMemory mDepthMemory = VK_NULL_HANDLE;
+		VkImageView mDepthView = VK_NULL_HANDLE;
+		VkRenderPass mDepthPass = VK_NULL_HANDLE;
+		VkFramebuffer mDepthFramebuffer = VK_NULL_HANDLE;
+
+		VkExtent2D mHiZExtent{};
+		uint32_t mMipCount = 0;
+		VkImage mHiZ = VK_NULL_HANDLE;
+		VkDeviceMemory mHiZMemory = VK_NULL_HANDLE;
+		VkImageView mHiZView = VK_NULL_HANDLE;
+		std::vector<VkImageView> mMipViews;
+		VkSampler mSampler = VK_NULL_HANDLE;
+
+		std::vector<Buffer> mParamBuffers;
+		std::vector<Buffer> mObjectBuffers;
+		std::vector<Buffer> mOccluderBuffers;
+		std::vector<Buffer> mReadback;
+		std::vector<uint32_t> mObjectCounts;
+		std::vector<uint32_t> mOccluderCounts;
+		Buffer mDrawCommands;
+		Buffer mDrawCount;
+		Buffer mCounters;
+
+		VkDescriptorSetLayout mReduceSetLayout = VK_NULL_HANDLE;
+		VkDescriptorSetLayout mCullSetLayout = VK_NULL_HANDLE;
+		VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+		std::vector<VkDescriptorSet> mReduceSets;
+		std::vector<VkDescriptorSet> mCullSets;
+		VkPipelineLayout mDepthLayout = VK_NULL_HANDLE;
+		VkPipelineLayout mReduceLayout = VK_NULL_HANDLE;
+		VkPipelineLayout mCullLayout = VK_NULL_HANDLE;
+		VkPipeline mDepthPipeline = VK_NULL_HANDLE;
+		VkPipeline mReducePipeline = VK_NULL_HANDLE;
+		VkPipeline mCullPipeline = VK_NULL_HANDLE;
+
+		glm::mat4 mViewProjection = glm::mat4(1.0f);
+		std::vector<Span<Bounds>> mOccluderSpans;
+		std::vector<Span<OcclusionObject>> mObjectSpans;
+		OcclusionCullStats mStats;
+
+		GpuTimer* mTimer = nullptr;
+		uint32_t mCullScope = UINT32_MAX;
+
+		ke::Logger mLogger = ke::Logger("Occlusion Logger", spdlog::level::debug);
+	};
+}
\ No newline at end of file
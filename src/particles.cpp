@@ -0,0 +1,326 @@
+#include "particles.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+static constexpr uint32_t PARTICLE_GROUP_SIZE = 64;
+
+void ke::ParticleSystem::init(Renderer& renderer, uint32_t maxParticles)
+{
+	mRenderer = &renderer;
+	mMaxParticles = maxParticles;
+
+	VkMemoryPropertyFlags deviceLocal = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	mParticles = renderer.createBuffer(sizeof(GpuParticle) * maxParticles, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, deviceLocal);
+	mAlive = renderer.createBuffer(sizeof(uint32_t) * 2 * maxParticles, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, deviceLocal);
+	mDead = renderer.createBuffer(sizeof(uint32_t) * maxParticles, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, deviceLocal);
+	mCounters = renderer.createBuffer(sizeof(Counters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, deviceLocal);
+	mIndirect = renderer.createBuffer(sizeof(IndirectArgs), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, deviceLocal);
+
+	mReadback.resize(renderer.getMaxFramesInFlight());
+	for (auto& buffer : mReadback)
+	{
+		buffer = renderer.createBuffer(sizeof(Counters), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		*static_cast<Counters*>(buffer.mapped) = Counters{};
+	}
+
+	createDescriptors();
+	createPipelines();
+	mPush.maxParticles = maxParticles;
+
+	// Every slot starts on the dead list.
+	renderer.submitImmediate([this](VkCommandBuffer cmd)
+		{
+			bindCompute(cmd, mInitPipeline);
+			mRenderer->getDeviceTable().CmdDispatch(cmd, (mMaxParticles + PARTICLE_GROUP_SIZE - 1) / PARTICLE_GROUP_SIZE, 1, 1);
+
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+			mRenderer->getDeviceTable().CmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+				0, 1, &barrier, 0, nullptr, 0, nullptr);
+		});
+
+	mHook = renderer.addRenderGraphHook(RenderGraphStage::BeforeMainPass, [this](RenderGraph& graph) { addPasses(graph); });
+
+	if (enableLogging)
+		mLogger.info("Created particle system for {} particles.", maxParticles);
+}
+
+void ke::ParticleSystem::cleanup()
+{
+	const VkuDeviceDispatchTable& vkd = mRenderer->getDeviceTable();
+	VkDevice device = mRenderer->getDevice();
+	const VkAllocationCallbacks* allocator = mRenderer->getAllocationCallbacks();
+
+	mRenderer->removeRenderGraphHook(mHook);
+	for (VkPipeline pipeline : { mInitPipeline, mBeginPipeline, mEmitPipeline, mSimulatePipeline, mFinishPipeline })
+		vkd.DestroyPipeline(device, pipeline, allocator);
+	mRenderer->destroyPipeline(mRenderPipeline);
+	vkd.DestroyPipelineLayout(device, mPipelineLayout, allocator);
+	vkd.DestroyDescriptorPool(device, mDescriptorPool, allocator);
+	vkd.DestroyDescriptorSetLayout(device, mSetLayout, allocator);
+
+	for (auto& buffer : mReadback)
+		mRenderer->destroyBuffer(buffer);
+	mRenderer->destroyBuffer(mParticles);
+	mRenderer->destroyBuffer(mAlive);
+	mRenderer->destroyBuffer(mDead);
+	mRenderer->destroyBuffer(mCounters);
+	mRenderer->destroyBuffer(mIndirect);
+}
+
+void ke::ParticleSystem::createDescriptors()
+{
+	const VkuDeviceDispatchTable& vkd = mRenderer->getDeviceTable();
+	VkDevice device = mRenderer->getDevice();
+
+	// Particles and the alive lists are also read by the vertex shader.
+	VkDescriptorSetLayoutBinding bindings[5]{};
+	for (uint32_t i = 0; i < 5; i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | (i < 2 ? VK_SHADER_STAGE_VERTEX_BIT : 0);
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 5;
+	layoutInfo.pBindings = bindings;
+	if (vkd.CreateDescriptorSetLayout(device, &layoutInfo, mRenderer->getAllocationCallbacks(), &mSetLayout) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create particle descriptor set layout!");
+
+	VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5 };
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	if (vkd.CreateDescriptorPool(device, &poolInfo, mRenderer->getAllocationCallbacks(), &mDescriptorPool) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create particle descriptor pool!");
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = mDescriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &mSetLayout;
+	if (vkd.AllocateDescriptorSets(device, &allocInfo, &mDescriptorSet) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to allocate particle descriptor set!");
+
+	const Buffer* buffers[5] = { &mParticles, &mAlive, &mDead, &mCounters, &mIndirect };
+	VkDescriptorBufferInfo bufferInfos[5]{};
+	VkWriteDescriptorSet writes[5]{};
+	for (uint32_t i = 0; i < 5; i++)
+	{
+		bufferInfos[i] = { buffers[i]->buffer, 0, VK_WHOLE_SIZE };
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = mDescriptorSet;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+	vkd.UpdateDescriptorSets(device, 5, writes, 0, nullptr);
+}
+
+void ke::ParticleSystem::createPipelines()
+{
+	VkPushConstantRange pushRange{};
+	pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushRange.size = sizeof(PushConstants);
+
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &mSetLayout;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushRange;
+	if (mRenderer->getDeviceTable().CreatePipelineLayout(mRenderer->getDevice(), &layoutInfo, mRenderer->getAllocationCallbacks(), &mPipelineLayout) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create particle pipeline layout!");
+
+	mRenderer->preloadShaders({ "shader/bin/particle_init.spv", "shader/bin/particle_begin.spv", "shader/bin/particle_emit.spv",
+		"shader/bin/particle_simulate.spv", "shader/bin/particle_finish.spv", "shader/bin/particle_vert.spv", "shader/bin/particle_frag.spv" });
+
+	mInitPipeline = mRenderer->buildComputePipeline("shader/bin/particle_init.spv", mPipelineLayout);
+	mBeginPipeline = mRenderer->buildComputePipeline("shader/bin/particle_begin.spv", mPipelineLayout);
+	mEmitPipeline = mRenderer->buildComputePipeline("shader/bin/particle_emit.spv", mPipelineLayout);
+	mSimulatePipeline = mRenderer->buildComputePipeline("shader/bin/particle_simulate.spv", mPipelineLayout);
+	mFinishPipeline = mRenderer->buildComputePipeline("shader/bin/particle_finish.spv", mPipelineLayout);
+
+	GraphicsPipelineDesc desc{};
+	desc.vertexShader = "shader/bin/particle_vert.spv";
+	desc.fragmentShader = "shader/bin/particle_frag.spv";
+	desc.layout = mPipelineLayout;
+	desc.additiveBlend = true;
+	mRenderPipeline = mRenderer->buildGraphicsPipeline(desc);
+}
+
+void ke::ParticleSystem::setEmitter(const ParticleEmitterSettings& settings)
+{
+	mEmitter = settings;
+}
+
+const ke::ParticleEmitterSettings& ke::ParticleSystem::getEmitter() const
+{
+	return mEmitter;
+}
+
+void ke::ParticleSystem::burst(uint32_t count)
+{
+	mPendingEmit = std::min(mPendingEmit + count, mMaxParticles);
+}
+
+void ke::ParticleSystem::update(float deltaTime)
+{
+	mDeltaTime = deltaTime;
+	mEmitRemainder += mEmitter.rate * deltaTime;
+	uint32_t count = static_cast<uint32_t>(mEmitRemainder);
+	mEmitRemainder -= static_cast<float>(count);
+	burst(count);
+}
+
+void ke::ParticleSystem::setTimer(GpuTimer* timer, uint32_t simulateScope, uint32_t renderScope)
+{
+	mTimer = timer;
+	mSimulateScope = simulateScope;
+	mRenderScope = renderScope;
+}
+
+void ke::ParticleSystem::bindCompute(VkCommandBuffer cmd, VkPipeline pipeline)
+{
+	const VkuDeviceDispatchTable& vkd = mRenderer->getDeviceTable();
+	vkd.CmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkd.CmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1, &mDescriptorSet, 0, nullptr);
+	vkd.CmdPushConstants(cmd, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &mPush);
+	mRenderer->getStats().addPipelineBind();
+	mRenderer->getStats().addDescriptorBinds(1);
+}
+
+void ke::ParticleSystem::addPasses(RenderGraph& graph)
+{
+	KE_PROFILE_FUNCTION();
+	uint32_t slot = mRenderer->getCurrentFrameInFlight();
+	// This slot's fence has been waited on, so its readback holds the counters from its last submission.
+	mAliveCount = static_cast<const Counters*>(mReadback[slot].mapped)->aliveCount;
+
+	mPush.originSpread = glm::vec4(mEmitter.origin, mEmitter.spread);
+	mPush.directionSpeed = glm::vec4(glm::normalize(mEmitter.direction), mEmitter.speed);
+	mPush.gravityDelta = glm::vec4(mEmitter.gravity, mDeltaTime);
+	mPush.lifetime = mEmitter.lifetime;
+	mPush.size = mEmitter.size;
+	mPush.emitCount = mPendingEmit;
+	mPush.seed++;
+	mPendingEmit = 0;
+
+	// Initial accesses are each buffer's last use in the previous frame, so work from the frame before is waited on.
+	RGResource particles = graph.importBuffer("particles", mParticles.buffer, mParticles.size, RGAccess::VertexStorageRead);
+	RGResource alive = graph.importBuffer("particle alive lists", mAlive.buffer, mAlive.size, RGAccess::VertexStorageRead);
+	RGResource dead = graph.importBuffer("particle dead list", mDead.buffer, mDead.size, RGAccess::ComputeStorageWrite);
+	RGResource counters = graph.importBuffer("particle counters", mCounters.buffer, mCounters.size, RGAccess::TransferRead);
+	RGResource indirect = graph.importBuffer("particle indirect args", mIndirect.buffer, mIndirect.size, RGAccess::IndirectRead);
+
+	// Pass callbacks run after this returns, so they hold the renderer's table rather than a local reference.
+	const VkuDeviceDispatchTable* vkd = &mRenderer->getDeviceTable();
+
+	RGPass begin = graph.addPass("particle begin", [this, vkd](VkCommandBuffer cmd)
+		{
+			if (mTimer)
+				mTimer->begin(cmd, mSimulateScope);
+			bindCompute(cmd, mBeginPipeline);
+			vkd->CmdDispatch(cmd, 1, 1, 1);
+		});
+	graph.write(begin, counters, RGAccess::ComputeStorageWrite);
+	graph.write(begin, indirect, RGAccess::ComputeStorageWrite);
+
+	RGPass emit = graph.addPass("particle emit", [this, vkd](VkCommandBuffer cmd)
+		{
+			bindCompute(cmd, mEmitPipeline);
+			vkd->CmdDispatchIndirect(cmd, mIndirect.buffer, offsetof(IndirectArgs, emit));
+		});
+	graph.read(emit, indirect, RGAccess::IndirectRead);
+	graph.write(emit, particles, RGAccess::ComputeStorageWrite);
+	graph.write(emit, alive, RGAccess::ComputeStorageWrite);
+	graph.write(emit, dead, RGAccess::ComputeStorageWrite);
+	graph.write(emit, counters, RGAccess::ComputeStorageWrite);
+
+	RGPass simulate = graph.addPass("particle simulate", [this, vkd](VkCommandBuffer cmd)
+		{
+			bindCompute(cmd, mSimulatePipeline);
+			vkd->CmdDispatchIndirect(cmd, mIndirect.buffer, offsetof(IndirectArgs, simulate));
+		});
+	graph.read(simulate, indirect, RGAccess::IndirectRead);
+	graph.write(simulate, particles, RGAccess::ComputeStorageWrite);
+	graph.write(simulate, alive, RGAccess::ComputeStorageWrite);
+	graph.write(simulate, dead, RGAccess::ComputeStorageWrite);
+	graph.write(simulate, counters, RGAccess::ComputeStorageWrite);
+
+	RGPass finish = graph.addPass("particle finish", [this, vkd](VkCommandBuffer cmd)
+		{
+			bindCompute(cmd, mFinishPipeline);
+			vkd->CmdDispatch(cmd, 1, 1, 1);
+			if (mTimer)
+				mTimer->end(cmd, mSimulateScope);
+		});
+	graph.write(finish, counters, RGAccess::ComputeStorageWrite);
+	graph.write(finish, indirect, RGAccess::ComputeStorageWrite);
+
+	RGPass readback = graph.addPass("particle readback", [this, vkd, slot](VkCommandBuffer cmd)
+		{
+			VkBufferCopy region{ 0, 0, sizeof(Counters) };
+			vkd->CmdCopyBuffer(cmd, mCounters.buffer, mReadback[slot].buffer, 1, &region);
+
+			VkBufferMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.buffer = mReadback[slot].buffer;
+			barrier.size = VK_WHOLE_SIZE;
+			vkd->CmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+		});
+	graph.read(readback, counters, RGAccess::TransferRead);
+
+	for (RGPass pass : { begin, emit, simulate, finish, readback })
+		graph.setSideEffect(pass);
+
+	mRenderer->mainPassRead(particles, RGAccess::VertexStorageRead);
+	mRenderer->mainPassRead(alive, RGAccess::VertexStorageRead);
+	mRenderer->mainPassRead(indirect, RGAccess::IndirectRead);
+}
+
+void ke::ParticleSystem::record(VkCommandBuffer cmd)
+{
+	KE_PROFILE_FUNCTION();
+	const VkuDeviceDispatchTable& vkd = mRenderer->getDeviceTable();
+	if (mTimer)
+		mTimer->begin(cmd, mRenderScope);
+
+	mRenderer->bindPipeline(cmd, mRenderPipeline);
+	mRenderer->bindDescriptorSets(cmd, mPipelineLayout, 0, 1, &mDescriptorSet);
+	vkd.CmdDrawIndirect(cmd, mIndirect.buffer, offsetof(IndirectArgs, draw), 1, sizeof(VkDrawIndirectCommand));
+	// The vertex count only exists on the GPU, so the call is counted without its triangles.
+	mRenderer->getStats().addDraw(0, 0);
+
+	if (mTimer)
+		mTimer->end(cmd, mRenderScope);
+}
+
+uint32_t ke::ParticleSystem::getAliveCount() const
+{
+	return mAliveCount;
+}
+
+uint32_t ke::ParticleSystem::getMaxParticles() const
+{
+	return mMaxParticles;
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+#include "renderer.hpp"
+#include "gputimer.hpp"
+#include <glm/glm.hpp>
+
+namespace ke
+{
+	// Positions and velocities are in normalized device coordinates per second.
+	struct ParticleEmitterSettings
+	{
+		glm::vec3 origin = glm::vec3(0.0f, 0.6f, 0.5f);
+		glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+		glm::vec3 gravity = glm::vec3(0.0f, 1.2f, 0.0f);
+		float rate = 10000.0f;
+		float speed = 1.5f;
+		float spread = 0.6f;
+		// Each particle lives between half and all of this many seconds.
+		float lifetime = 2.0f;
+		float size = 0.004f;
+	};
+
+	// Emission, simulation and dead-list recycling all run in compute passes ahead of the main pass; the CPU only
+	// decides how many particles to spawn. Survivors are compacted into the other half of a ping-pong alive list
+	// and drawn with one indirect call whose vertex count the simulation writes.
+	class ParticleSystem
+	{
+	public:
+		void init(Renderer& renderer, uint32_t maxParticles);
+		void cleanup();
+
+		void setEmitter(const ParticleEmitterSettings& settings);
+		const ParticleEmitterSettings& getEmitter() const;
+		void burst(uint32_t count);
+		// Call once per frame before beginRecording; the passes are added when the frame graph is built.
+		void update(float deltaTime);
+		// Records the draw into the main pass.
+		void record(VkCommandBuffer cmd);
+
+		// Optional. Scopes must be registered on the timer by the caller.
+		void setTimer(GpuTimer* timer, uint32_t simulateScope, uint32_t renderScope);
+
+		// Alive count read back from the GPU, one frames-in-flight cycle old.
+		uint32_t getAliveCount() const;
+		uint32_t getMaxParticles() const;
+	private:
+		struct GpuParticle
+		{
+			glm::vec4 positionLife;
+			glm::vec4 velocitySize;
+		};
+
+		// Matches the push constant block of the particle compute shaders.
+		struct PushConstants
+		{
+			glm::vec4 originSpread;
+			glm::vec4 directionSpeed;
+			glm::vec4 gravityDelta;
+			float lifetime;
+			float size;
+			uint32_t emitCount;
+			uint32_t maxParticles;
+			uint32_t seed;
+		};
+
+		struct Counters
+		{
+			uint32_t aliveCount;
+			uint32_t nextAliveCount;
+			uint32_t deadCount;
+			uint32_t emitCount;
+			uint32_t parity;
+		};
+
+		// Emit and simulate dispatch arguments followed by the draw arguments.
+		struct IndirectArgs
+		{
+			VkDispatchIndirectCommand emit;
+			VkDispatchIndirectCommand simulate;
+			VkDrawIndirectCommand draw;
+		};
+	private:
+		void createDescriptors();
+		void createPipelines();
+		void addPasses(RenderGraph& graph);
+		void bindCompute(VkCommandBuffer cmd, VkPipeline pipeline);
+	private:
+		Renderer* mRenderer = nullptr;
+		uint32_t mMaxParticles = 0;
+		uint32_t mHook = 0;
+
+		Buffer mParticles;
+		Buffer mAlive;
+		Buffer mDead;
+		Buffer mCounters;
+		Buffer mIndirect;
+		std::vector<Buffer> mReadback;
+
+		VkDescriptorSetLayout mSetLayout = VK_NULL_HANDLE;
+		VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+		VkDescriptorSet mDescriptorSet = VK_NULL_HANDLE;
+		VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
+		VkPipeline mInitPipeline = VK_NULL_HANDLE;
+		VkPipeline mBeginPipeline = VK_NULL_HANDLE;
+		VkPipeline mEmitPipeline = VK_NULL_HANDLE;
+		VkPipeline mSimulatePipeline = VK_NULL_HANDLE;
+		VkPipeline mFinishPipeline = VK_NULL_HANDLE;
+		VkPipeline mRenderPipeline = VK_NULL_HANDLE;
+
+		ParticleEmitterSettings mEmitter;
+		PushConstants mPush{};
+		float mDeltaTime = 0.0f;
+		float mEmitRemainder = 0.0f;
+		uint32_t mPendingEmit = 0;
+		uint32_t mAliveCount = 0;
+
+		GpuTimer* mTimer = nullptr;
+		uint32_t mSimulateScope = UINT32_MAX;
+		uint32_t mRenderScope = UINT32_MAX;
+
+		ke::Logger mLogger = ke::Logger("Particle Logger", spdlog::level::debug);
+	};
+}
\ No newline at end of file
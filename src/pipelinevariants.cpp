@@ -0,0 +1,46 @@
+#include "pipelinevariants.hpp"
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+void ke::PipelineVariants::init(Renderer& renderer, const GraphicsPipelineDesc& base)
+{
+	mRenderer = &renderer;
+	mBase = base;
+}
+
+void ke::PipelineVariants::cleanup()
+{
+	for (auto& [hash, bucket] : mVariants)
+		for (auto& variant : bucket)
+			mRenderer->destroyPipeline(variant.pipeline);
+	mVariants.clear();
+	mVariantCount = 0;
+}
+
+VkPipeline ke::PipelineVariants::get(const ShaderSpecialization& specialization)
+{
+	std::vector<Variant>& bucket = mVariants[specialization.hash()];
+	for (const auto& variant : bucket)
+		if (variant.specialization == specialization)
+			return variant.pipeline;
+
+	GraphicsPipelineDesc desc = mBase;
+	desc.specialization = specialization;
+	Variant variant;
+	variant.specialization = specialization;
+	variant.pipeline = mRenderer->buildGraphicsPipeline(desc);
+	bucket.push_back(variant);
+	mVariantCount++;
+	if (enableLogging)
+		mLogger.debug("Built variant {} of {}.", mVariantCount, mBase.fragmentShader ? mBase.fragmentShader : mBase.vertexShader);
+	return variant.pipeline;
+}
+
+uint32_t ke::PipelineVariants::getVariantCount() const
+{
+	return mVariantCount;
+}
\ No newline at end of file
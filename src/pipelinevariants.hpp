@@ -0,0 +1,40 @@
+#pragma once
+#include "renderer.hpp"
+#include "specialization.hpp"
+#include <unordered_map>
+
+namespace ke
+{
+	// Specialized variants of one pipeline description. Each variant is built the first time it is requested and
+	// kept until cleanup, so switching between them costs a lookup.
+	class PipelineVariants
+	{
+	public:
+		// The shader paths in base must outlive this object.
+		void init(Renderer& renderer, const GraphicsPipelineDesc& base);
+		void cleanup();
+
+		VkPipeline get(const ShaderSpecialization& specialization);
+		template<typename... Constants>
+		VkPipeline get(const SpecializationSet<Constants...>& set)
+		{
+			return get(set.build());
+		}
+
+		uint32_t getVariantCount() const;
+	private:
+		struct Variant
+		{
+			ShaderSpecialization specialization;
+			VkPipeline pipeline = VK_NULL_HANDLE;
+		};
+	private:
+		Renderer* mRenderer = nullptr;
+		GraphicsPipelineDesc mBase;
+		// Keyed by ShaderSpecialization::hash(); the bucket resolves collisions.
+		std::unordered_map<uint64_t, std::vector<Variant>> mVariants;
+		uint32_t mVariantCount = 0;
+
+		ke::Logger mLogger = ke::Logger("Pipeline Variants Logger", spdlog::level::debug);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "profiler.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+static void writeJsonString(std::ofstream& out, const char* text)
+{
+	out << '"';
+	for (const char* c = text; *c; c++)
+	{
+		if (*c == '"' || *c == '\\')
+			out << '\\';
+		out << *c;
+	}
+	out << '"';
+}
+
+ke::Profiler& ke::Profiler::getInstance()
+{
+	static Profiler instance;
+	return instance;
+}
+
+ke::Profiler::Profiler()
+{
+	mStartTicks = now();
+	mStartTime = std::chrono::steady_clock::now();
+	mFrameBegin = mStartTicks;
+}
+
+ke::Profiler::ThreadBuffer* ke::Profiler::registerThread()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto buffer = std::make_unique<ThreadBuffer>();
+	buffer->threadId = static_cast<uint32_t>(mThreads.size()) + 1;
+	buffer->name = "Thread " + std::to_string(buffer->threadId);
+	tThreadBuffer = buffer.get();
+	mThreads.push_back(std::move(buffer));
+	return tThreadBuffer;
+}
+
+void ke::Profiler::setThreadName(const char* name)
+{
+	ThreadBuffer* buffer = tThreadBuffer ? tThreadBuffer : registerThread();
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	buffer->name = name;
+}
+
+void ke::Profiler::markFrame()
+{
+	uint64_t frameEnd = now();
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	Frame frame;
+	if (mHistoryLength > 0 && mFrames.size() >= mHistoryLength)
+	{
+		// Reuse the oldest frame's storage so steady-state collection does not allocate.
+		frame.zones = std::move(mFrames.front().zones);
+		frame.zones.clear();
+		mFrames.pop_front();
+	}
+	frame.index = mFrameIndex++;
+	frame.begin = mFrameBegin;
+	frame.end = frameEnd;
+	mFrameBegin = frameEnd;
+
+	for (auto& buffer : mThreads)
+	{
+		uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+		uint64_t head = buffer->head.load(std::memory_order_acquire);
+		for (uint64_t i = tail; i < head; i++)
+			frame.zones.push_back({ buffer->zones[i & (ThreadBuffer::capacity - 1)], buffer->threadId });
+		buffer->tail.store(head, std::memory_order_release);
+	}
+
+	if (mHistoryLength > 0)
+		mFrames.push_back(std::move(frame));
+}
+
+bool ke::Profiler::writeChromeTrace(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	std::ofstream out(path, std::ios::trunc);
+	if (!out.is_open())
+	{
+		if (enableLogging)
+			mLogger.error("Failed to open {} for writing.", path);
+		return false;
+	}
+
+	double ticksPerUs = ticksPerMicrosecond();
+	auto toUs = [&](uint64_t ticks) { return static_cast<double>(static_cast<int64_t>(ticks - mStartTicks)) / ticksPerUs; };
+
+	out << std::fixed << std::setprecision(3);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Frames\"}}";
+	for (const auto& buffer : mThreads)
+	{
+		out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId << ",\"args\":{\"name\":";
+		writeJsonString(out, buffer->name.c_str());
+		out << "}}";
+	}
+
+	size_t zoneCount = 0;
+	for (auto& frame : mFrames)
+	{
+		out << ",\n{\"name\":\"Frame " << frame.index << "\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":" << toUs(frame.begin)
+			<< ",\"dur\":" << toUs(frame.end) - toUs(frame.begin) << "}";
+
+		// Parents before children so viewers nest zones that share a start time correctly.
+		std::sort(frame.zones.begin(), frame.zones.end(), [](const CollectedZone& a, const CollectedZone& b)
+			{
+				if (a.zone.begin != b.zone.begin)
+					return a.zone.begin < b.zone.begin;
+				return a.zone.end > b.zone.end;
+			});
+		for (const auto& collected : frame.zones)
+		{
+			out << ",\n{\"name\":";
+			writeJsonString(out, collected.zone.name);
+			out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << collected.threadId << ",\"ts\":" << toUs(collected.zone.begin)
+				<< ",\"dur\":" << toUs(collected.zone.end) - toUs(collected.zone.begin) << "}";
+		}
+		zoneCount += frame.zones.size();
+	}
+	out << "\n]}\n";
+
+	if (enableLogging)
+		mLogger.info("Wrote {} zones over {} frames to {}.", zoneCount, mFrames.size(), path);
+	return true;
+}
+
+void ke::Profiler::setHistoryLength(uint32_t frames)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mHistoryLength = frames;
+	while (mFrames.size() > mHistoryLength)
+		mFrames.pop_front();
+}
+
+uint64_t ke::Profiler::getDroppedCount()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	uint64_t dropped = 0;
+	for (const auto& buffer : mThreads)
+		dropped += buffer->dropped.load(std::memory_order_relaxed);
+	return dropped;
+}
+
+uint64_t ke::Profiler::getFrameIndex() const
+{
+	return mFrameIndex;
+}
+
+double ke::Profiler::ticksPerMicrosecond() const
+{
+	// Calibrates the tick counter against steady_clock over the whole session.
+	uint64_t ticks = now() - mStartTicks;
+	double elapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - mStartTime).count();
+	if (elapsedUs <= 0.0 || ticks == 0)
+		return 1.0;
+	return static_cast<double>(ticks) / elapsedUs;
+}
\ No newline at end of file
@@ -0,0 +1,156 @@
+#pragma once
+#include "logger.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Set KE_PROFILE to 0 to compile every zone macro out.
+#ifndef KE_PROFILE
+#define KE_PROFILE 1
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define KE_PROFILE_RDTSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace ke
+{
+	struct ProfileZone
+	{
+		const char* name;
+		uint64_t begin;
+		uint64_t end;
+	};
+
+	class Profiler
+	{
+	public:
+		static Profiler& getInstance();
+
+		// Raw tick counter. Ticks are converted to microseconds only when a trace is written.
+		static uint64_t now()
+		{
+#ifdef KE_PROFILE_RDTSC
+			return __rdtsc();
+#else
+			return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+		}
+
+		// Appends a finished zone to the calling thread's ring. Never blocks; drops the zone if the ring is full.
+		// name is stored by pointer and must outlive the profiler, so pass string literals.
+		static void record(const char* name, uint64_t begin, uint64_t end)
+		{
+			ThreadBuffer* buffer = tThreadBuffer ? tThreadBuffer : getInstance().registerThread();
+			uint64_t head = buffer->head.load(std::memory_order_relaxed);
+			if (head - buffer->tail.load(std::memory_order_acquire) >= ThreadBuffer::capacity)
+			{
+				buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			buffer->zones[head & (ThreadBuffer::capacity - 1)] = { name, begin, end };
+			buffer->head.store(head + 1, std::memory_order_release);
+		}
+
+		void setThreadName(const char* name);
+
+		// Closes the current frame and moves every thread's zones into the frame history.
+		void markFrame();
+
+		// Writes the frame history as Chrome trace event JSON, loadable in chrome://tracing and Perfetto.
+		bool writeChromeTrace(const std::string& path);
+
+		void setHistoryLength(uint32_t frames);
+		uint64_t getDroppedCount();
+		uint64_t getFrameIndex() const;
+	private:
+		Profiler();
+
+		struct ThreadBuffer
+		{
+			static constexpr uint64_t capacity = 1 << 16;
+
+			std::unique_ptr<ProfileZone[]> zones = std::make_unique<ProfileZone[]>(capacity);
+			alignas(64) std::atomic<uint64_t> head = 0;
+			alignas(64) std::atomic<uint64_t> tail = 0;
+			std::atomic<uint64_t> dropped = 0;
+			uint32_t threadId = 0;
+			std::string name;
+		};
+
+		struct CollectedZone
+		{
+			ProfileZone zone;
+			uint32_t threadId;
+		};
+
+		struct Frame
+		{
+			uint64_t index;
+			uint64_t begin;
+			uint64_t end;
+			std::vector<CollectedZone> zones;
+		};
+
+		ThreadBuffer* registerThread();
+		double ticksPerMicrosecond() const;
+	private:
+		static inline thread_local ThreadBuffer* tThreadBuffer = nullptr;
+
+		std::mutex mMutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> mThreads;
+		std::deque<Frame> mFrames;
+		uint32_t mHistoryLength = 600;
+		uint64_t mFrameIndex = 0;
+		uint64_t mFrameBegin = 0;
+
+		uint64_t mStartTicks = 0;
+		std::chrono::steady_clock::time_point mStartTime;
+
+		ke::Logger mLogger = ke::Logger("Profiler Logger", spdlog::level::debug);
+	};
+
+	class ProfileScope
+	{
+	public:
+		explicit ProfileScope(const char* name)
+			:mName(name), mBegin(Profiler::now())
+		{
+		}
+
+		~ProfileScope()
+		{
+			Profiler::record(mName, mBegin, Profiler::now());
+		}
+
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope& operator=(const ProfileScope&) = delete;
+	private:
+		const char* mName;
+		uint64_t mBegin;
+	};
+}
+
+#if KE_PROFILE
+#define KE_PROFILE_CONCAT_INNER(a, b) a##b
+#define KE_PROFILE_CONCAT(a, b) KE_PROFILE_CONCAT_INNER(a, b)
+#define KE_PROFILE_SCOPE(name) ke::ProfileScope KE_PROFILE_CONCAT(keProfileScope, __LINE__)(name)
+#define KE_PROFILE_FUNCTION() KE_PROFILE_SCOPE(__FUNCTION__)
+#define KE_PROFILE_FRAME() ke::Profiler::getInstance().markFrame()
+#define KE_PROFILE_THREAD(name) ke::Profiler::getInstance().setThreadName(name)
+#else
+#define KE_PROFILE_SCOPE(name) ((void)0)
+#define KE_PROFILE_FUNCTION() ((void)0)
+#define KE_PROFILE_FRAME() ((void)0)
+#define KE_PROFILE_THREAD(name) ((void)0)
+#endif
\ No newline at end of file
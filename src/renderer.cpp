@@ -1,8 +1,11 @@
 #include "renderer.hpp"
 #include <algorithm>
-#include <map>
 #include <set>
-#include "util.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "archive.hpp"
+#include "profiler.hpp"
 
 #ifndef NDEBUG
 bool enableLogging = true;
@@ -10,17 +13,17 @@ bool enableLogging = true;
 bool enableLogging = false;
 #endif
 
-static VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugUtilsMessenger)
+static VkResult CreateDebugUtilsMessengerEXT(const VkuInstanceDispatchTable& vki, VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugUtilsMessenger)
 {
-	auto func = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
+	auto func = vki.CreateDebugUtilsMessengerEXT;
 	if (func != nullptr)
 		return func(instance, pCreateInfo, pAllocator, pDebugUtilsMessenger);
 	else return VK_ERROR_EXTENSION_NOT_PRESENT;
 }
 
-static void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator)
+static void DestroyDebugUtilsMessengerEXT(const VkuInstanceDispatchTable& vki, VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator)
 {
-	auto func = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
+	auto func = vki.DestroyDebugUtilsMessengerEXT;
 	if (func != nullptr)
 		func(instance, debugMessenger, pAllocator);
 
@@ -42,36 +45,91 @@ bool enableValidationLayers = false;
 bool enableValidationLayers = true;
 #endif
 
+void ke::Renderer::beginInit()
+{
+	if (mInitStarted)
+		return;
+	mInitStarted = true;
+	mInitStart = std::chrono::steady_clock::now();
+
+	preloadShaders({ GraphicsPipelineDesc{}.vertexShader, GraphicsPipelineDesc{}.fragmentShader });
+
+	// Instance creation only needs GLFW to be initialised, so it runs while the caller creates the window.
+	mInstanceTask = std::async(std::launch::async, [this]
+		{
+			KE_PROFILE_SCOPE("Renderer instance");
+			StatTimer timer;
+			mHostAllocator.init(mHostAllocatorMode, maxFramesInFlight);
+			if (!mVulkanLibrary.load())
+				return;
+			mVulkanLibrary.initGlobalTable(mVki);
+			createVulkanInstance();
+			setupDebugMessenger();
+			if (enableLogging)
+				mLogger.debug("Startup phase 'instance' took {:.2f} ms.", timer.elapsedMs());
+		});
+}
+
 void ke::Renderer::initVulkan(GLFWwindow* window)
 {
-	createVulkanInstance();
-	setupDebugMessenger();
-	createWindowSurface(window);
-	pickPhysicalDevice();
-	createLogicalDevice();
-	createSwapchain(window);
-	createSwapchainImageViews();
-	createRenderPass();
-	createGraphicsPipelineLayout();
-	createGraphicsPipeline();
-	createFramebuffers();
-	createCommandPool();
-	createCommandBuffer();
-	createSyncObjects();
+	beginInit();
+
+	auto phase = [this](const char* name, auto&& step)
+	{
+		KE_PROFILE_SCOPE(name);
+		StatTimer timer;
+		step();
+		if (enableLogging)
+			mLogger.debug("Startup phase '{}' took {:.2f} ms.", name, timer.elapsedMs());
+	};
+
+	phase("wait for instance", [&] { mInstanceTask.get(); });
+	if (mInstance == VK_NULL_HANDLE)
+		return;
+
+	phase("device", [&]
+		{
+			createWindowSurface(window);
+			pickPhysicalDevice();
+			createLogicalDevice();
+			mMemoryBudget.init(mVki, mPhysicalDevice, mCapabilities.memoryBudget, maxFramesInFlight);
+			mDescriptors.init(mDevice, &mVkd, mHostAllocator.getCallbacks(), maxFramesInFlight);
+			mResourceCache.init(mDevice, &mVkd, mHostAllocator.getCallbacks());
+		});
+	phase("render pass", [&] { chooseSwapchainFormat(); createRenderPass(); });
+
+	// Pipelines only depend on the device, the render pass and the preloaded shader code, so they build
+	// while the swapchain and command resources are set up.
+	std::future<void> pipelineTask = std::async(std::launch::async, [&]
+		{
+			phase("pipelines", [&] { createPipelineCache(); createGraphicsPipelineLayout(); createGraphicsPipeline(); });
+		});
+
+	phase("swapchain", [&] { createSwapchain(window); createSwapchainImageViews(); createFramebuffers(); });
+	phase("commands", [&] { createCommandPool(); createCommandBuffer(); createComputeCommandResources(); createSyncObjects(); mBundles.init(mDevice, &mVkd, mHostAllocator.getCallbacks(), mQueueFamilies.graphicsFamily.value(), maxFramesInFlight); });
+	phase("render graph", [&] { createRenderGraph(); });
+	phase("render target", [&] { createRenderTarget(); createFrameQueries(); });
+	phase("wait for pipelines", [&] { pipelineTask.get(); });
+
+	if (enableLogging)
+		mLogger.info("Renderer initialised in {:.2f} ms.", std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - mInitStart).count());
 }
 
 void ke::Renderer::createVulkanInstance()
 {
 	VkApplicationInfo appInfo{};
-	appInfo.apiVersion = VK_API_VERSION_1_0;
+	appInfo.apiVersion = VK_API_VERSION_1_3;
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 	appInfo.pApplicationName = "Knaj's engine";
 	appInfo.pEngineName = "No engine";
 	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
 
 	std::vector<const char*> requiredExtensions = getRequiredExtensions();
-	requiredExtensions.push_back("VK_KHR_win32_surface");
-	requiredExtensions.push_back("VK_KHR_surface");
+	if (!mHeadless)
+	{
+		requiredExtensions.push_back("VK_KHR_win32_surface");
+		requiredExtensions.push_back("VK_KHR_surface");
+	}
 
 
 	if (checkInstanceExtensionSupport(requiredExtensions) && enableLogging)
@@ -96,8 +154,9 @@ void ke::Renderer::createVulkanInstance()
 	}
 	
 
-	if (vkCreateInstance(&createInfo, nullptr, &mInstance) != VK_SUCCESS && enableLogging)
+	if (mVki.CreateInstance(&createInfo, mHostAllocator.getCallbacks(), &mInstance) != VK_SUCCESS && enableLogging)
 		mLogger.critical("Failed to create vulkan instance!");
+	mVulkanLibrary.initInstanceTable(mInstance, mVki);
 	if(enableLogging)
 		mLogger.info("Created vulkan instance.");
 }
@@ -105,9 +164,9 @@ void ke::Renderer::createVulkanInstance()
 bool ke::Renderer::checkInstanceExtensionSupport(const std::vector<const char*>& exts)
 {
 	uint32_t supportedExtensionCount = 0;
-	vkEnumerateInstanceExtensionProperties(nullptr, &supportedExtensionCount, nullptr);
+	mVki.EnumerateInstanceExtensionProperties(nullptr, &supportedExtensionCount, nullptr);
 	std::vector<VkExtensionProperties> supportedExtensions(supportedExtensionCount);
-	vkEnumerateInstanceExtensionProperties(nullptr, &supportedExtensionCount, supportedExtensions.data());
+	mVki.EnumerateInstanceExtensionProperties(nullptr, &supportedExtensionCount, supportedExtensions.data());
 
 	bool failedCheck = false;
 
@@ -132,9 +191,9 @@ bool ke::Renderer::checkInstanceExtensionSupport(const std::vector<const char*>&
 bool ke::Renderer::checkValidationLayerSupport()
 {
 	uint32_t supportedLayerCount = 0;
-	vkEnumerateInstanceLayerProperties(&supportedLayerCount, nullptr);
+	mVki.EnumerateInstanceLayerProperties(&supportedLayerCount, nullptr);
 	std::vector<VkLayerProperties> supportedLayers(supportedLayerCount);
-	vkEnumerateInstanceLayerProperties(&supportedLayerCount, supportedLayers.data());
+	mVki.EnumerateInstanceLayerProperties(&supportedLayerCount, supportedLayers.data());
 
 	bool failedCheck = false;
 
@@ -160,8 +219,10 @@ std::vector<const char*> ke::Renderer::getRequiredExtensions()
 {
 	std::vector<const char*> requiredExtensions;
 	uint32_t glfwExtensionCount = 0;
-	const char** glfwExtensions;
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	const char** glfwExtensions = nullptr;
+	// Headless runs never initialise GLFW.
+	if (!mHeadless)
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
 	std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
 
@@ -183,59 +244,100 @@ void ke::Renderer::setupDebugMessenger()
 	createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
 	createInfo.pfnUserCallback = debugCallback;
 
-	if (CreateDebugUtilsMessengerEXT(mInstance, &createInfo, nullptr, &mDebugMessenger) != VK_SUCCESS && enableLogging)
+	if (CreateDebugUtilsMessengerEXT(mVki, mInstance, &createInfo, mHostAllocator.getCallbacks(), &mDebugMessenger) != VK_SUCCESS && enableLogging)
 		mLogger.critical("Failed to create a debug utils messenger!");
 }
 
 void ke::Renderer::pickPhysicalDevice()
 {
 	uint32_t deviceCount = 0;
-	vkEnumeratePhysicalDevices(mInstance, &deviceCount, nullptr);
+	mVki.EnumeratePhysicalDevices(mInstance, &deviceCount, nullptr);
 	std::vector<VkPhysicalDevice> devices(deviceCount);
-	vkEnumeratePhysicalDevices(mInstance, &deviceCount, devices.data());
+	mVki.EnumeratePhysicalDevices(mInstance, &deviceCount, devices.data());
 
 	if (deviceCount == 0 && enableLogging)
 		mLogger.critical("No physical devices found on this machine.");
 
-	std::map<int, VkPhysicalDevice> candidates;
+	// A configured device wins over scoring as long as it can present. Matches a device index or part of its name.
+	std::string preference = mDevicePreference;
+	if (preference.empty())
+		if (const char* environment = std::getenv("KE_DEVICE"))
+			preference = environment;
+
+	// A purely numeric preference is an index only, so "1" does not pick a device named "RTX 4090".
+	bool numericPreference = !preference.empty() && std::all_of(preference.begin(), preference.end(), [](char c) { return c >= '0' && c <= '9'; });
+	uint32_t preferredIndex = UINT32_MAX;
+	if (numericPreference && preference.size() < 10)
+		preferredIndex = static_cast<uint32_t>(std::stoul(preference));
+
+	unsigned int bestScore = 0;
+	bool matchedPreference = false;
+	for (uint32_t i = 0; i < deviceCount; i++)
+	{
+		unsigned int score = rateDeviceSuitability(devices[i]);
+		VkPhysicalDeviceProperties properties{};
+		mVki.GetPhysicalDeviceProperties(devices[i], &properties);
+		std::string name = properties.deviceName;
+		if (enableLogging)
+			mLogger.debug("Device {}: {} (score {})", i, name, score);
+
+		bool preferred = numericPreference ? i == preferredIndex : !preference.empty() && name.find(preference) != std::string::npos;
+		if (preferred && score > 0)
+		{
+			mPhysicalDevice = devices[i];
+			bestScore = score;
+			matchedPreference = true;
+			break;
+		}
+		if (score > bestScore)
+		{
+			mPhysicalDevice = devices[i];
+			bestScore = score;
+		}
+	}
 
-	for (const auto& device : devices)
+	if (mPhysicalDevice == VK_NULL_HANDLE)
 	{
-		unsigned int score = rateDeviceSuitability(device);
-		candidates.insert(std::make_pair(score, device));
+		if (enableLogging)
+			mLogger.critical("Failed to find a suitable physical device!");
+		return;
 	}
 
-	if (candidates.rbegin()->first > 0 && enableLogging)
+	mCapabilities = probeDeviceCapabilities(mVki, mPhysicalDevice);
+	if (enableLogging)
 	{
-		mPhysicalDevice = candidates.rbegin()->second;
-		mLogger.info(("Chosen physical device has score of " + std::to_string(candidates.rbegin()->first)));
+		if (!preference.empty() && !matchedPreference)
+			mLogger.warn("No usable device matches '{}', falling back to the best scoring one.", preference);
+		mLogger.info("Chose {} with a score of {}.", mCapabilities.deviceName, bestScore);
 	}
-	else if(enableLogging)
-		mLogger.critical("Failed to find a suitable physical device!");
 }
 
 unsigned int ke::Renderer::rateDeviceSuitability(VkPhysicalDevice device)
 {
-	VkPhysicalDeviceProperties  deviceProperties{};
-	VkPhysicalDeviceFeatures deviceFeatures{};
-	vkGetPhysicalDeviceProperties(device, &deviceProperties);
-	vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
-
-	int score = 0;
+	QueueFamilyIndices indices = findQueueFamilies(device);
+	if (!indices.isComplete()) return 0;
 
-	if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) score += 1000;
+	if (!mHeadless)
+	{
+		if (!checkDeviceExtensionSupport(device)) return 0;
 
-	score += deviceProperties.limits.maxImageDimension2D;
+		SwapchainSupportDetails swapchainSupport = querySwapchainSupport(device);
+		if (swapchainSupport.formats.empty() || swapchainSupport.presentModes.empty()) return 0;
+	}
 
-	if (!deviceFeatures.geometryShader) return 0;
+	DeviceCapabilities caps = probeDeviceCapabilities(mVki, device);
 
-	QueueFamilyIndices indices = findQueueFamilies(device);
-	if (!indices.isComplete()) return 0;
+	// Software rasterisers such as lavapipe still score above zero so they are usable when nothing else is.
+	unsigned int score = 1;
+	if (caps.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) score += 10000;
+	else if (caps.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU) score += 5000;
+	else if (caps.deviceType == VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU) score += 2000;
 
-	if (!checkDeviceExtensionSupport(device)) return 0;
+	VkPhysicalDeviceProperties deviceProperties{};
+	mVki.GetPhysicalDeviceProperties(device, &deviceProperties);
+	score += deviceProperties.limits.maxImageDimension2D / 16;
 
-	SwapchainSupportDetails swapchainSupport = querySwapchainSupport(device);
-	if (swapchainSupport.formats.empty() || swapchainSupport.presentModes.empty()) return 0;
+	score += 100 * (caps.synchronization2 + caps.timelineSemaphore + caps.dynamicRendering + caps.descriptorIndexing + caps.drawIndirectCount);
 
 	return score;
 }
@@ -245,26 +347,41 @@ QueueFamilyIndices ke::Renderer::findQueueFamilies(VkPhysicalDevice device) cons
 	QueueFamilyIndices indices;
 
 	uint32_t queueFamilyCount = 0;
-	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+	mVki.GetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
 	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+	mVki.GetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
 	int i = 0;
 	for (const auto& family : queueFamilies)
 	{
-		if (family.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+		if ((family.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !indices.graphicsFamily.has_value())
 			indices.graphicsFamily = i;
 
 		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, mSurface, &presentSupport);
+		if (!mHeadless)
+			mVki.GetPhysicalDeviceSurfaceSupportKHR(device, i, mSurface, &presentSupport);
 
-		if (presentSupport)
+		if (presentSupport && !indices.presentFamily.has_value())
 			indices.presentFamily = i;
 
-		if (indices.isComplete()) break;
+		if ((family.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(family.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !indices.computeFamily.has_value())
+			indices.computeFamily = i;
+
 		i++;
 	}
 
+	// Nothing is presented headless, so the graphics queue stands in for the present queue.
+	if (mHeadless)
+		indices.presentFamily = indices.graphicsFamily;
+
+	// Without a dedicated family, compute shares the graphics family and takes a second queue from it when one exists.
+	if (!indices.computeFamily.has_value() && indices.graphicsFamily.has_value())
+	{
+		indices.computeFamily = indices.graphicsFamily;
+		if (queueFamilies[indices.graphicsFamily.value()].queueCount > 1)
+			indices.computeQueueIndex = 1;
+	}
+
 	return indices;
 }
 
@@ -272,32 +389,41 @@ void ke::Renderer::createLogicalDevice()
 {
 	QueueFamilyIndices indices = findQueueFamilies(mPhysicalDevice);
 
-	float queuePriority = 1.0f;
+	float queuePriorities[] = { 1.0f, 1.0f };
 
 	std::vector<VkDeviceQueueCreateInfo> createInfos;
-	std::set<uint32_t> uniqueQueueIndices = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+	std::set<uint32_t> uniqueQueueIndices = { indices.graphicsFamily.value(), indices.presentFamily.value(), indices.computeFamily.value() };
 	
 	for (const auto& index : uniqueQueueIndices)
 	{
 		VkDeviceQueueCreateInfo graphicsQueueInfo{};
 		graphicsQueueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-		graphicsQueueInfo.queueCount = 1;
+		graphicsQueueInfo.queueCount = index == indices.computeFamily.value() ? indices.computeQueueIndex + 1 : 1;
 		graphicsQueueInfo.queueFamilyIndex = index;
-		graphicsQueueInfo.pQueuePriorities = &queuePriority;
+		graphicsQueueInfo.pQueuePriorities = queuePriorities;
 
 		createInfos.push_back(graphicsQueueInfo);
 	}
 	
 
-	VkPhysicalDeviceFeatures deviceFeatures{};
+	DeviceFeatureChain features;
+	buildFeatureChain(mCapabilities, features);
 
+	std::vector<const char*> deviceExtensions;
+	if (!mHeadless)
+		deviceExtensions = gDeviceExtensions;
+	deviceExtensions.insert(deviceExtensions.end(), features.extensions.begin(), features.extensions.end());
+
+	// Pre-1.1 devices take the plain feature struct; everything newer goes through the features2 chain.
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	bool featureChain = mCapabilities.apiVersion >= VK_API_VERSION_1_1;
+	createInfo.pNext = featureChain ? &features.features2 : nullptr;
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(createInfos.size());
 	createInfo.pQueueCreateInfos = createInfos.data();
-	createInfo.pEnabledFeatures = &deviceFeatures;
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(gDeviceExtensions.size());
-	createInfo.ppEnabledExtensionNames = gDeviceExtensions.data();
+	createInfo.pEnabledFeatures = featureChain ? nullptr : &features.features2.features;
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 	if (enableValidationLayers)
 	{
 		createInfo.enabledLayerCount = static_cast<uint32_t>(gValidationLayers.size());
@@ -306,24 +432,46 @@ void ke::Renderer::createLogicalDevice()
 	else
 		createInfo.enabledLayerCount = 0;
 
-	if (vkCreateDevice(mPhysicalDevice, &createInfo, nullptr, &mDevice) != VK_SUCCESS && enableLogging)
+	if (mVki.CreateDevice(mPhysicalDevice, &createInfo, mHostAllocator.getCallbacks(), &mDevice) != VK_SUCCESS && enableLogging)
 		mLogger.critical("Failed to create logical device!");
+	mVulkanLibrary.initDeviceTable(mVki, mInstance, mDevice, mVkd);
 
 	if(enableLogging)
 		mLogger.info("Created a logical device.");
 
-	vkGetDeviceQueue(mDevice, indices.graphicsFamily.value(), 0, &graphicsQueue);
-	vkGetDeviceQueue(mDevice, indices.presentFamily.value(), 0, &presentQueue);
+	mVkd.GetDeviceQueue(mDevice, indices.graphicsFamily.value(), 0, &graphicsQueue);
+	mVkd.GetDeviceQueue(mDevice, indices.presentFamily.value(), 0, &presentQueue);
+	mVkd.GetDeviceQueue(mDevice, indices.computeFamily.value(), indices.computeQueueIndex, &computeQueue);
+	mQueueFamilies = indices;
+
+	if (enableLogging)
+	{
+		if (hasAsyncCompute())
+			mLogger.info("Using a separate compute queue (family {}).", indices.computeFamily.value());
+		else
+			mLogger.info("No separate compute queue, compute work runs on the graphics queue.");
+	}
+
+	if (mCapabilities.synchronization2)
+		mCmdPipelineBarrier2 = mCapabilities.synchronization2Extension ? mVkd.CmdPipelineBarrier2KHR : mVkd.CmdPipelineBarrier2;
+
+	if (enableLogging)
+		mLogger.info("Device features: timeline semaphores {}, synchronization2 {}, dynamic rendering {}, descriptor indexing {}, draw indirect count {}, subgroup size {}.",
+			mCapabilities.timelineSemaphore, mCapabilities.synchronization2, mCapabilities.dynamicRendering,
+			mCapabilities.descriptorIndexing, mCapabilities.drawIndirectCount, mCapabilities.subgroupSize);
 }
 
 void ke::Renderer::createWindowSurface(GLFWwindow* window)
 {
+	if (mHeadless)
+		return;
+
 	VkWin32SurfaceCreateInfoKHR createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
 	createInfo.hwnd = glfwGetWin32Window(window);
 	createInfo.hinstance = GetModuleHandle(nullptr);
 
-	if (vkCreateWin32SurfaceKHR(mInstance, &createInfo, nullptr, &mSurface) != VK_SUCCESS && enableLogging)
+	if (mVki.CreateWin32SurfaceKHR(mInstance, &createInfo, mHostAllocator.getCallbacks(), &mSurface) != VK_SUCCESS && enableLogging)
 		mLogger.error("Failed to create window surface.");
 
 	if(enableLogging)
@@ -333,9 +481,9 @@ void ke::Renderer::createWindowSurface(GLFWwindow* window)
 bool ke::Renderer::checkDeviceExtensionSupport(VkPhysicalDevice device)
 {
 	uint32_t extensionCount = 0;
-	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+	mVki.EnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
 	std::vector<VkExtensionProperties> extensions(extensionCount);
-	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+	mVki.EnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
 	
 	std::set<std::string> requiredExtensions(gDeviceExtensions.begin(), gDeviceExtensions.end());
 
@@ -349,22 +497,22 @@ bool ke::Renderer::checkDeviceExtensionSupport(VkPhysicalDevice device)
 SwapchainSupportDetails ke::Renderer::querySwapchainSupport(VkPhysicalDevice device) const
 {
 	SwapchainSupportDetails supportDetails;
-	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, mSurface, &supportDetails.capabilities);
+	mVki.GetPhysicalDeviceSurfaceCapabilitiesKHR(device, mSurface, &supportDetails.capabilities);
 
 	uint32_t formatCount = 0;
-	vkGetPhysicalDeviceSurfaceFormatsKHR(device, mSurface, &formatCount, nullptr);
+	mVki.GetPhysicalDeviceSurfaceFormatsKHR(device, mSurface, &formatCount, nullptr);
 	if (formatCount != 0)
 	{
 		supportDetails.formats.resize(formatCount);
-		vkGetPhysicalDeviceSurfaceFormatsKHR(device, mSurface, &formatCount, supportDetails.formats.data());
+		mVki.GetPhysicalDeviceSurfaceFormatsKHR(device, mSurface, &formatCount, supportDetails.formats.data());
 	}
 	
 	uint32_t presentModeCount = 0;
-	vkGetPhysicalDeviceSurfacePresentModesKHR(device, mSurface, &presentModeCount, nullptr);
+	mVki.GetPhysicalDeviceSurfacePresentModesKHR(device, mSurface, &presentModeCount, nullptr);
 	if (presentModeCount != 0)
 	{
 		supportDetails.presentModes.resize(presentModeCount);
-		vkGetPhysicalDeviceSurfacePresentModesKHR(device, mSurface, &presentModeCount, supportDetails.presentModes.data());
+		mVki.GetPhysicalDeviceSurfacePresentModesKHR(device, mSurface, &presentModeCount, supportDetails.presentModes.data());
 	}
 
 
@@ -400,18 +548,23 @@ VkPresentModeKHR ke::Renderer::chooseSurfacePresentMode(const std::vector<VkPres
 	return VK_PRESENT_MODE_FIFO_KHR;
 }
 
-VkExtent2D ke::Renderer::chooseSwapchainExtent(const VkSurfaceCapabilitiesKHR& capabilities, GLFWwindow* pWindow)
+VkExtent2D ke::Renderer::getFramebufferSize(GLFWwindow* pWindow) const
 {
-	if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max())
-		return capabilities.currentExtent;
+	uint64_t size = mFramebufferSize.load(std::memory_order_acquire);
+	if (size != UINT64_MAX)
+		return { static_cast<uint32_t>(size >> 32), static_cast<uint32_t>(size) };
 
 	int width, height;
 	glfwGetFramebufferSize(pWindow, &width, &height);
+	return { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+}
 
-	VkExtent2D actualExtent = {
-		static_cast<uint32_t>(width),
-		static_cast<uint32_t>(height)
-	};
+VkExtent2D ke::Renderer::chooseSwapchainExtent(const VkSurfaceCapabilitiesKHR& capabilities, GLFWwindow* pWindow)
+{
+	if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max())
+		return capabilities.currentExtent;
+
+	VkExtent2D actualExtent = getFramebufferSize(pWindow);
 
 	actualExtent.width = std::clamp(actualExtent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
 	actualExtent.height = std::clamp(actualExtent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
@@ -421,6 +574,12 @@ VkExtent2D ke::Renderer::chooseSwapchainExtent(const VkSurfaceCapabilitiesKHR& c
 
 void ke::Renderer::createSwapchain(GLFWwindow* pWindow)
 {
+	if (mHeadless)
+	{
+		createHeadlessBackbuffer();
+		return;
+	}
+
 	SwapchainSupportDetails supportDetails = querySwapchainSupport(mPhysicalDevice);
 
 	VkSurfaceFormatKHR surfaceFormat = chooseSurfaceFormat(supportDetails.formats);
@@ -441,6 +600,8 @@ void ke::Renderer::createSwapchain(GLFWwindow* pWindow)
 	createInfo.minImageCount = supportDetails.capabilities.minImageCount;
 	createInfo.imageArrayLayers = 1;
 	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	if (mDynamicResolution.enabled)
+		createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
 	QueueFamilyIndices indices = findQueueFamilies(mPhysicalDevice);
 	uint32_t queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
@@ -457,19 +618,57 @@ void ke::Renderer::createSwapchain(GLFWwindow* pWindow)
 	createInfo.oldSwapchain = VK_NULL_HANDLE;
 	createInfo.clipped = VK_TRUE;
 
-	if (vkCreateSwapchainKHR(mDevice, &createInfo, nullptr, &mSwapchain) != VK_SUCCESS && enableLogging)
+	if (mVkd.CreateSwapchainKHR(mDevice, &createInfo, mHostAllocator.getCallbacks(), &mSwapchain) != VK_SUCCESS && enableLogging)
 		mLogger.critical("Failed to create Swapchain!");
 	if(enableLogging)
 		mLogger.info("Created swapchain.");
 
-	vkGetSwapchainImagesKHR(mDevice, mSwapchain, &imageCount, nullptr);
+	mVkd.GetSwapchainImagesKHR(mDevice, mSwapchain, &imageCount, nullptr);
 	mSwapchainImages.resize(imageCount);
-	vkGetSwapchainImagesKHR(mDevice, mSwapchain, &imageCount, mSwapchainImages.data());
+	mVkd.GetSwapchainImagesKHR(mDevice, mSwapchain, &imageCount, mSwapchainImages.data());
 
 	mSwapchainImageFormat = surfaceFormat.format;
 	mSwapchainExtent = extent;
 }
 
+void ke::Renderer::createHeadlessBackbuffer()
+{
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = mSwapchainImageFormat;
+	imageInfo.extent = { mHeadlessExtent.width, mHeadlessExtent.height, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	if (mDynamicResolution.enabled)
+		imageInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VkImage image = VK_NULL_HANDLE;
+	if (mVkd.CreateImage(mDevice, &imageInfo, mHostAllocator.getCallbacks(), &image) != VK_SUCCESS && enableLogging)
+		mLogger.critical("Failed to create the headless backbuffer!");
+
+	VkMemoryRequirements requirements{};
+	mVkd.GetImageMemoryRequirements(mDevice, image, &requirements);
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = requirements.size;
+	allocInfo.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (mVkd.AllocateMemory(mDevice, &allocInfo, mHostAllocator.getCallbacks(), &mHeadlessMemory) != VK_SUCCESS && enableLogging)
+		mLogger.critical("Failed to allocate headless backbuffer memory!");
+	mMemoryBudget.trackAllocation(mHeadlessMemory, allocInfo.memoryTypeIndex, allocInfo.allocationSize);
+	mVkd.BindImageMemory(mDevice, image, mHeadlessMemory, 0);
+
+	mSwapchainImages = { image };
+	mSwapchainExtent = mHeadlessExtent;
+	if (enableLogging)
+		mLogger.info("Created {}x{} headless backbuffer.", mHeadlessExtent.width, mHeadlessExtent.height);
+}
+
 void ke::Renderer::createSwapchainImageViews()
 {
 	mSwapchainImageViews.resize(mSwapchainImages.size());
@@ -492,58 +691,114 @@ void ke::Renderer::createSwapchainImageViews()
 	{
 		createInfo.image = mSwapchainImages[i];
 		
-		if (vkCreateImageView(mDevice, &createInfo, nullptr, &mSwapchainImageViews[i]) != VK_SUCCESS && enableLogging)
+		if (mVkd.CreateImageView(mDevice, &createInfo, mHostAllocator.getCallbacks(), &mSwapchainImageViews[i]) != VK_SUCCESS && enableLogging)
 			mLogger.error("Failed to create an image view.");
 	}
 	if(enableLogging)
 		mLogger.info("Created swapchain image views.");
 }
 
+void ke::Renderer::chooseSwapchainFormat()
+{
+	if (mHeadless)
+	{
+		mSwapchainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+		return;
+	}
+
+	SwapchainSupportDetails supportDetails = querySwapchainSupport(mPhysicalDevice);
+	mSwapchainImageFormat = chooseSurfaceFormat(supportDetails.formats).format;
+}
+
+void ke::Renderer::createPipelineCache()
+{
+	VkPipelineCacheCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	if (mVkd.CreatePipelineCache(mDevice, &createInfo, mHostAllocator.getCallbacks(), &mPipelineCache) != VK_SUCCESS && enableLogging)
+		mLogger.warn("Failed to create a pipeline cache, pipelines are built without one.");
+}
+
 void ke::Renderer::createGraphicsPipelineLayout()
 {
-	VkPipelineLayoutCreateInfo createInfo{};
-	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	createInfo.pushConstantRangeCount = 0;
-	createInfo.setLayoutCount = 0;
-	
-	if (vkCreatePipelineLayout(mDevice, &createInfo, nullptr, &mPipelineLayout) != VK_SUCCESS && enableLogging)
-		mLogger.error("Failed to create graphics pipeline layout!");
+	mPipelineLayout = createPipelineLayout({}, {});
 	if(enableLogging)
 		mLogger.info("Created graphics pipeline layout.");
 }
 
+VkPipelineLayout ke::Renderer::createPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstants)
+{
+	VkPipelineLayoutCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	createInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	createInfo.pSetLayouts = setLayouts.data();
+	createInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstants.size());
+	createInfo.pPushConstantRanges = pushConstants.data();
+
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	if (mVkd.CreatePipelineLayout(mDevice, &createInfo, mHostAllocator.getCallbacks(), &layout) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create a pipeline layout!");
+	mCapture.recordPipelineLayout(layout, setLayouts, pushConstants);
+	return layout;
+}
+
 void ke::Renderer::createGraphicsPipeline()
 {
-	auto vertexCode = ke::util::readFile("shader/bin/vert.spv");
-	auto fragCode = ke::util::readFile("shader/bin/frag.spv");
+	GraphicsPipelineDesc desc{};
+	desc.layout = mPipelineLayout;
+
+	mGraphicsPipeline = buildGraphicsPipeline(desc);
+	if(enableLogging)
+		mLogger.info("Created graphics pipeline!");
+}
+
+VkPipeline ke::Renderer::buildGraphicsPipeline(const GraphicsPipelineDesc& desc) const
+{
+	const std::vector<char>& vertexCode = getShaderCode(desc.vertexShader);
+	bool depthOnly = desc.fragmentShader == nullptr;
 
 	auto vertexModule = createShaderModule(vertexCode);
-	auto fragModule = createShaderModule(fragCode);
+	VkShaderModule fragModule = depthOnly ? VK_NULL_HANDLE : createShaderModule(getShaderCode(desc.fragmentShader));
+
+	VkSpecializationInfo specialization = desc.specialization.getInfo();
 
 	VkPipelineShaderStageCreateInfo vertStage{};
 	vertStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	vertStage.stage = VK_SHADER_STAGE_VERTEX_BIT;
 	vertStage.module = vertexModule;
 	vertStage.pName = "main";
+	vertStage.pSpecializationInfo = desc.specialization.empty() ? nullptr : &specialization;
 
 	VkPipelineShaderStageCreateInfo fragStage{};
 	fragStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	fragStage.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
 	fragStage.module = fragModule;
 	fragStage.pName = "main";
+	fragStage.pSpecializationInfo = vertStage.pSpecializationInfo;
 
 	VkPipelineShaderStageCreateInfo shaderStages[] = { vertStage, fragStage };
 	
 	VkPipelineColorBlendAttachmentState colorAtt{};
 	colorAtt.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorAtt.blendEnable = VK_FALSE;
+	colorAtt.blendEnable = desc.additiveBlend || desc.alphaBlend ? VK_TRUE : VK_FALSE;
+	colorAtt.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	colorAtt.dstColorBlendFactor = desc.additiveBlend ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	colorAtt.colorBlendOp = VK_BLEND_OP_ADD;
+	colorAtt.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorAtt.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorAtt.alphaBlendOp = VK_BLEND_OP_ADD;
 
 	VkPipelineColorBlendStateCreateInfo colorBlend{};
 	colorBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	colorBlend.attachmentCount = 1;
+	colorBlend.attachmentCount = depthOnly ? 0 : 1;
 	colorBlend.pAttachments = &colorAtt;
 	colorBlend.logicOpEnable = VK_FALSE;
 
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = desc.depthTest ? VK_TRUE : VK_FALSE;
+	depthStencil.depthWriteEnable = desc.depthWrite ? VK_TRUE : VK_FALSE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
 	std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_SCISSOR, VK_DYNAMIC_STATE_VIEWPORT };
 
 	VkPipelineDynamicStateCreateInfo dynamicState{};
@@ -554,7 +809,7 @@ void ke::Renderer::createGraphicsPipeline()
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
 	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
 	inputAssembly.primitiveRestartEnable = VK_FALSE;
-	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.topology = desc.topology;
 	
 	VkPipelineMultisampleStateCreateInfo multisampling{};
 	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
@@ -579,16 +834,18 @@ void ke::Renderer::createGraphicsPipeline()
 
 	VkPipelineVertexInputStateCreateInfo vertexInput{};
 	vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInput.vertexAttributeDescriptionCount = 0;
-	vertexInput.vertexBindingDescriptionCount = 0;
+	vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(desc.attributes.size());
+	vertexInput.pVertexAttributeDescriptions = desc.attributes.data();
+	vertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(desc.bindings.size());
+	vertexInput.pVertexBindingDescriptions = desc.bindings.data();
 
 	VkGraphicsPipelineCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	createInfo.layout = mPipelineLayout;
-	createInfo.stageCount = 2;
+	createInfo.layout = desc.layout;
+	createInfo.stageCount = depthOnly ? 1 : 2;
 	createInfo.pStages = shaderStages;
 	createInfo.pColorBlendState = &colorBlend;
-	createInfo.pDepthStencilState = nullptr;
+	createInfo.pDepthStencilState = (desc.depthTest || desc.depthWrite) ? &depthStencil : nullptr;
 	createInfo.pDynamicState = &dynamicState;
 	createInfo.pInputAssemblyState = &inputAssembly;
 	createInfo.pMultisampleState = &multisampling;
@@ -596,15 +853,47 @@ void ke::Renderer::createGraphicsPipeline()
 	createInfo.pTessellationState = nullptr;
 	createInfo.pViewportState = &viewport;
 	createInfo.pVertexInputState = &vertexInput;
-	createInfo.renderPass = mRenderPass;
+	createInfo.renderPass = desc.renderPass != VK_NULL_HANDLE ? desc.renderPass : mRenderPass;
 
-	if (vkCreateGraphicsPipelines(mDevice, 0, 1, &createInfo, nullptr, &mGraphicsPipeline) != VK_SUCCESS && enableLogging)
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	if (mVkd.CreateGraphicsPipelines(mDevice, mPipelineCache, 1, &createInfo, mHostAllocator.getCallbacks(), &pipeline) != VK_SUCCESS && enableLogging)
 		mLogger.critical("Failed to create a graphics pipeline!");
-	if(enableLogging)
-		mLogger.info("Created graphics pipeline!");
 
-	vkDestroyShaderModule(mDevice, vertexModule, nullptr);
-	vkDestroyShaderModule(mDevice, fragModule, nullptr);
+	mVkd.DestroyShaderModule(mDevice, vertexModule, mHostAllocator.getCallbacks());
+	if (!depthOnly)
+		mVkd.DestroyShaderModule(mDevice, fragModule, mHostAllocator.getCallbacks());
+
+	mCapture.recordPipeline(pipeline, desc);
+	return pipeline;
+}
+
+void ke::Renderer::destroyPipeline(VkPipeline& pipeline)
+{
+	mBundles.resourceChanged(reinterpret_cast<uint64_t>(pipeline));
+	mVkd.DestroyPipeline(mDevice, pipeline, mHostAllocator.getCallbacks());
+	pipeline = VK_NULL_HANDLE;
+}
+
+VkPipeline ke::Renderer::buildComputePipeline(const char* shader, VkPipelineLayout layout, const ShaderSpecialization& specialization) const
+{
+	VkShaderModule module = createShaderModule(getShaderCode(shader));
+	VkSpecializationInfo specializationInfo = specialization.getInfo();
+
+	VkComputePipelineCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	createInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	createInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	createInfo.stage.module = module;
+	createInfo.stage.pName = "main";
+	createInfo.stage.pSpecializationInfo = specialization.empty() ? nullptr : &specializationInfo;
+	createInfo.layout = layout;
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	if (mVkd.CreateComputePipelines(mDevice, mPipelineCache, 1, &createInfo, mHostAllocator.getCallbacks(), &pipeline) != VK_SUCCESS && enableLogging)
+		mLogger.critical("Failed to create a compute pipeline from {}!", shader);
+
+	mVkd.DestroyShaderModule(mDevice, module, mHostAllocator.getCallbacks());
+	return pipeline;
 }
 
 void ke::Renderer::createRenderPass()
@@ -616,22 +905,14 @@ void ke::Renderer::createRenderPass()
 	colorAtt.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	colorAtt.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	colorAtt.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAtt.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAtt.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	// Layout transitions in and out of the pass are recorded by the render graph.
+	colorAtt.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAtt.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
 	VkAttachmentReference colorRef{};
 	colorRef.attachment = 0;
 	colorRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
-	VkSubpassDependency dependency{};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-
 	VkSubpassDescription subpass{};
 	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 	subpass.colorAttachmentCount = 1;
@@ -643,11 +924,27 @@ void ke::Renderer::createRenderPass()
 	createInfo.pSubpasses = &subpass;
 	createInfo.attachmentCount = 1;
 	createInfo.pAttachments = &colorAtt;
+	createInfo.dependencyCount = 0;
+	createInfo.pDependencies = nullptr;
+
+	if (mVkd.CreateRenderPass(mDevice, &createInfo, mHostAllocator.getCallbacks(), &mRenderPass) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create render pass!");
+
+	// Load ops are not part of render pass compatibility, so pipelines and framebuffers work with both passes.
+	colorAtt.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+
+	VkSubpassDependency dependency{};
+	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependency.dstSubpass = 0;
+	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 	createInfo.dependencyCount = 1;
 	createInfo.pDependencies = &dependency;
 
-	if (vkCreateRenderPass(mDevice, &createInfo, nullptr, &mRenderPass) != VK_SUCCESS && enableLogging)
-		mLogger.error("Failed to create render pass!");
+	if (mVkd.CreateRenderPass(mDevice, &createInfo, mHostAllocator.getCallbacks(), &mLoadRenderPass) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create load render pass!");
 	if(enableLogging)
 		mLogger.info("Created render pass.");
 }
@@ -661,7 +958,7 @@ void ke::Renderer::createCommandPool()
 	createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 	createInfo.queueFamilyIndex = indices.graphicsFamily.value();
 
-	if (vkCreateCommandPool(mDevice, &createInfo, nullptr, &mCommandPool) != VK_SUCCESS && enableLogging)
+	if (mVkd.CreateCommandPool(mDevice, &createInfo, mHostAllocator.getCallbacks(), &mCommandPool) != VK_SUCCESS && enableLogging)
 		mLogger.error("Failed to create command pool!");
 	if(enableLogging)
 		mLogger.info("Created command pool.");
@@ -677,12 +974,46 @@ void ke::Renderer::createCommandBuffer()
 	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 	allocInfo.commandPool = mCommandPool;
 
-	if (vkAllocateCommandBuffers(mDevice, &allocInfo, mCommandBuffers.data()) != VK_SUCCESS && enableLogging)
+	if (mVkd.AllocateCommandBuffers(mDevice, &allocInfo, mCommandBuffers.data()) != VK_SUCCESS && enableLogging)
 		mLogger.critical("Failed to allocate command buffer!");
 	if(enableLogging)
 		mLogger.info("Created command buffer.");
 }
 
+void ke::Renderer::createComputeCommandResources()
+{
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = mQueueFamilies.computeFamily.value();
+
+	if (mVkd.CreateCommandPool(mDevice, &poolInfo, mHostAllocator.getCallbacks(), &mComputeCommandPool) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create compute command pool!");
+
+	mComputeCommandBuffers.resize(maxFramesInFlight);
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandBufferCount = static_cast<uint32_t>(mComputeCommandBuffers.size());
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = mComputeCommandPool;
+
+	if (mVkd.AllocateCommandBuffers(mDevice, &allocInfo, mComputeCommandBuffers.data()) != VK_SUCCESS && enableLogging)
+		mLogger.critical("Failed to allocate compute command buffers!");
+
+	mComputeFinishedSemaphores.resize(maxFramesInFlight);
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for (size_t i = 0; i < maxFramesInFlight; i++)
+		if (mVkd.CreateSemaphore(mDevice, &semaphoreInfo, mHostAllocator.getCallbacks(), &mComputeFinishedSemaphores[i]) != VK_SUCCESS && enableLogging)
+			mLogger.error("Failed to create a compute semaphore!");
+
+	if(enableLogging)
+		mLogger.info("Created compute command resources.");
+}
+
 void ke::Renderer::createFramebuffers()
 {
 	mFramebuffers.resize(mSwapchainImages.size());
@@ -700,7 +1031,7 @@ void ke::Renderer::createFramebuffers()
 		createInfo.pAttachments = attachment;
 		createInfo.renderPass = mRenderPass;
 
-		if (vkCreateFramebuffer(mDevice, &createInfo, nullptr, &mFramebuffers[i]) != VK_SUCCESS && enableLogging)
+		if (mVkd.CreateFramebuffer(mDevice, &createInfo, mHostAllocator.getCallbacks(), &mFramebuffers[i]) != VK_SUCCESS && enableLogging)
 			mLogger.error("Framebuffer creation failed!");
 		if(enableLogging)
 			mLogger.info("Created framebuffer.");
@@ -722,9 +1053,9 @@ void ke::Renderer::createSyncObjects()
 
 	for (size_t i = 0; i < maxFramesInFlight; i++)
 	{
-		if (vkCreateFence(mDevice, &fenceInfo, nullptr, &mInFlightFences[i]) != VK_SUCCESS ||
-			vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &mImageReadySemaphores[i]) != VK_SUCCESS ||
-			vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &mRenderFinishedSemaphores[i]) != VK_SUCCESS && enableLogging)
+		if (mVkd.CreateFence(mDevice, &fenceInfo, mHostAllocator.getCallbacks(), &mInFlightFences[i]) != VK_SUCCESS ||
+			mVkd.CreateSemaphore(mDevice, &semaphoreInfo, mHostAllocator.getCallbacks(), &mImageReadySemaphores[i]) != VK_SUCCESS ||
+			mVkd.CreateSemaphore(mDevice, &semaphoreInfo, mHostAllocator.getCallbacks(), &mRenderFinishedSemaphores[i]) != VK_SUCCESS && enableLogging)
 			mLogger.error("Failed to create at least one synchronisation object!");
 	}
 	
@@ -732,6 +1063,260 @@ void ke::Renderer::createSyncObjects()
 		mLogger.info("Created sync objects.");
 }
 
+void ke::Renderer::createRenderGraph()
+{
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	mVki.GetPhysicalDeviceMemoryProperties(mPhysicalDevice, &memoryProperties);
+	mRenderGraph.init(mDevice, &mVkd, mHostAllocator.getCallbacks(), memoryProperties, maxFramesInFlight, mCmdPipelineBarrier2);
+	if(enableLogging)
+		mLogger.info("Created render graph.");
+}
+
+void ke::Renderer::buildFrameGraph()
+{
+	KE_PROFILE_FUNCTION();
+	mRenderGraph.reset();
+
+	RGImageDesc backbufferDesc{};
+	backbufferDesc.format = mSwapchainImageFormat;
+	backbufferDesc.extent = mSwapchainExtent;
+	backbufferDesc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	backbufferDesc.usage |= mDynamicResolution.enabled ? VK_IMAGE_USAGE_TRANSFER_DST_BIT : 0;
+	// The present layout needs the swapchain extension, so a headless backbuffer stays a color attachment.
+	mBackbuffer = mRenderGraph.importImage("backbuffer", mSwapchainImages[currentImageIndex], mSwapchainImageViews[currentImageIndex],
+		backbufferDesc, mDynamicResolution.enabled ? RGAccess::AcquireForTransfer : RGAccess::Acquire, mHeadless ? RGAccess::ColorAttachmentWrite : RGAccess::Present);
+
+	mSceneTarget = mBackbuffer;
+	if (mDynamicResolution.enabled)
+	{
+		// The target starts and ends every frame as a color attachment, so frames that are never submitted leave it consistent.
+		RGImageDesc sceneDesc = backbufferDesc;
+		sceneDesc.extent = mRenderTargetExtent;
+		sceneDesc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		mSceneTarget = mRenderGraph.importImage("scene", mRenderTarget, mRenderTargetView, sceneDesc, RGAccess::ColorAttachmentWrite, RGAccess::ColorAttachmentWrite);
+	}
+
+	mMainPassReads.clear();
+	for (auto& [handle, hook] : mPreMainHooks)
+		hook(mRenderGraph);
+
+	mMainPass = mRenderGraph.addPass("main");
+	mRenderGraph.write(mMainPass, mSceneTarget, RGAccess::ColorAttachmentWrite);
+	for (const auto& [resource, access] : mMainPassReads)
+		mRenderGraph.read(mMainPass, resource, access);
+
+	if (mDynamicResolution.enabled)
+	{
+		RGPass upscale = mRenderGraph.addPass("upscale", [this](VkCommandBuffer cmd) { recordUpscale(cmd); });
+		mRenderGraph.read(upscale, mSceneTarget, RGAccess::TransferRead);
+		mRenderGraph.write(upscale, mBackbuffer, RGAccess::TransferWrite);
+		mRenderGraph.setSideEffect(upscale);
+	}
+
+	for (auto& [handle, hook] : mPostMainHooks)
+		hook(mRenderGraph);
+
+	mRenderGraph.compile();
+}
+
+void ke::Renderer::createRenderTarget()
+{
+	mRenderExtent = mSwapchainExtent;
+	if (!mDynamicResolution.enabled)
+		return;
+
+	float maxScale = mDynamicResolution.maxScale;
+	mRenderTargetExtent.width = std::max(1u, static_cast<uint32_t>(std::ceil(mSwapchainExtent.width * maxScale)));
+	mRenderTargetExtent.height = std::max(1u, static_cast<uint32_t>(std::ceil(mSwapchainExtent.height * maxScale)));
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = mSwapchainImageFormat;
+	imageInfo.extent = { mRenderTargetExtent.width, mRenderTargetExtent.height, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	if (mVkd.CreateImage(mDevice, &imageInfo, mHostAllocator.getCallbacks(), &mRenderTarget) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create the internal render target!");
+
+	VkMemoryRequirements requirements{};
+	mVkd.GetImageMemoryRequirements(mDevice, mRenderTarget, &requirements);
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = requirements.size;
+	allocInfo.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (mVkd.AllocateMemory(mDevice, &allocInfo, mHostAllocator.getCallbacks(), &mRenderTargetMemory) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to allocate internal render target memory!");
+	mMemoryBudget.trackAllocation(mRenderTargetMemory, allocInfo.memoryTypeIndex, allocInfo.allocationSize);
+	mVkd.BindImageMemory(mDevice, mRenderTarget, mRenderTargetMemory, 0);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = mRenderTarget;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = mSwapchainImageFormat;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	if (mVkd.CreateImageView(mDevice, &viewInfo, mHostAllocator.getCallbacks(), &mRenderTargetView) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create the internal render target view!");
+
+	VkFramebufferCreateInfo framebufferInfo{};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = mRenderPass;
+	framebufferInfo.attachmentCount = 1;
+	framebufferInfo.pAttachments = &mRenderTargetView;
+	framebufferInfo.width = mRenderTargetExtent.width;
+	framebufferInfo.height = mRenderTargetExtent.height;
+	framebufferInfo.layers = 1;
+	if (mVkd.CreateFramebuffer(mDevice, &framebufferInfo, mHostAllocator.getCallbacks(), &mRenderTargetFramebuffer) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create the internal render target framebuffer!");
+
+	VkFormatProperties formatProperties{};
+	mVki.GetPhysicalDeviceFormatProperties(mPhysicalDevice, mSwapchainImageFormat, &formatProperties);
+	mUpscaleFilter = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT) && enableLogging)
+		mLogger.warn("Swapchain format does not support blits, upscaling will fail.");
+
+	// Every frame expects the target as a color attachment on entry.
+	submitImmediate([this](VkCommandBuffer cmd)
+		{
+			VkImageMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = mRenderTarget;
+			barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+			mVkd.CmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		});
+
+	mResolutionController.reset();
+	updateRenderExtent();
+	if (enableLogging)
+		mLogger.info("Created {}x{} internal render target for dynamic resolution.", mRenderTargetExtent.width, mRenderTargetExtent.height);
+}
+
+void ke::Renderer::destroyRenderTarget()
+{
+	if (mRenderTarget == VK_NULL_HANDLE)
+		return;
+	mVkd.DestroyFramebuffer(mDevice, mRenderTargetFramebuffer, mHostAllocator.getCallbacks());
+	mVkd.DestroyImageView(mDevice, mRenderTargetView, mHostAllocator.getCallbacks());
+	mVkd.DestroyImage(mDevice, mRenderTarget, mHostAllocator.getCallbacks());
+	mMemoryBudget.trackFree(mRenderTargetMemory);
+	mVkd.FreeMemory(mDevice, mRenderTargetMemory, mHostAllocator.getCallbacks());
+	mRenderTarget = VK_NULL_HANDLE;
+}
+
+void ke::Renderer::createFrameQueries()
+{
+	uint32_t familyCount = 0;
+	mVki.GetPhysicalDeviceQueueFamilyProperties(mPhysicalDevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	mVki.GetPhysicalDeviceQueueFamilyProperties(mPhysicalDevice, &familyCount, families.data());
+	uint32_t validBits = families[mQueueFamilies.graphicsFamily.value()].timestampValidBits;
+	if (validBits == 0 || mCapabilities.timestampPeriod <= 0.0f)
+	{
+		if (enableLogging)
+			mLogger.warn("Graphics queue has no timestamps, GPU frame time is not measured.");
+		return;
+	}
+	mTimestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	VkQueryPoolCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	createInfo.queryCount = maxFramesInFlight * 2;
+	if (mVkd.CreateQueryPool(mDevice, &createInfo, mHostAllocator.getCallbacks(), &mFrameQueryPool) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create frame timestamp query pool!");
+	mFrameQueryWritten.assign(maxFramesInFlight, 0);
+}
+
+float ke::Renderer::readGpuFrameTime()
+{
+	if (mFrameQueryPool == VK_NULL_HANDLE || !mFrameQueryWritten[currentFrameInFlight])
+		return 0.0f;
+
+	// Frames that were recorded but never submitted leave their queries unavailable.
+	uint64_t timestamps[2] = {};
+	if (mVkd.GetQueryPoolResults(mDevice, mFrameQueryPool, currentFrameInFlight * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		return 0.0f;
+	uint64_t ticks = (timestamps[1] - timestamps[0]) & mTimestampMask;
+	return static_cast<float>(static_cast<double>(ticks) * mCapabilities.timestampPeriod * 1e-6);
+}
+
+void ke::Renderer::updateRenderExtent()
+{
+	float gpuMs = readGpuFrameTime();
+	mStats.setGpuTime(gpuMs);
+	if (!mDynamicResolution.enabled)
+	{
+		mRenderExtent = mSwapchainExtent;
+		return;
+	}
+
+	// Without timestamps the last frame's wall time stands in for GPU time.
+	float scale = mResolutionController.update(mFrameQueryPool != VK_NULL_HANDLE ? gpuMs : mStats.getFrame(0).frameMs);
+	mRenderExtent.width = std::clamp(static_cast<uint32_t>(std::lround(mSwapchainExtent.width * scale)), 1u, mRenderTargetExtent.width);
+	mRenderExtent.height = std::clamp(static_cast<uint32_t>(std::lround(mSwapchainExtent.height * scale)), 1u, mRenderTargetExtent.height);
+	mStats.setRenderScale(scale);
+}
+
+void ke::Renderer::beginMainPass(VkCommandBuffer cmd, VkRenderPass renderPass, VkSubpassContents contents)
+{
+	VkClearValue clearColor = { {{0.0f, 0.0f, 0.0f, 1.0f}} };
+
+	VkRenderPassBeginInfo rBeginInfo{};
+	rBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	rBeginInfo.clearValueCount = 1;
+	rBeginInfo.pClearValues = &clearColor;
+	rBeginInfo.framebuffer = mDynamicResolution.enabled ? mRenderTargetFramebuffer : mFramebuffers[currentImageIndex];
+	rBeginInfo.renderArea.extent = mRenderExtent;
+	rBeginInfo.renderArea.offset = { 0,0 };
+	rBeginInfo.renderPass = renderPass;
+
+	mVkd.CmdBeginRenderPass(cmd, &rBeginInfo, contents);
+}
+
+void ke::Renderer::recordUpscale(VkCommandBuffer cmd)
+{
+	VkImageBlit region{};
+	region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.srcOffsets[1] = { static_cast<int32_t>(mRenderExtent.width), static_cast<int32_t>(mRenderExtent.height), 1 };
+	region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.dstOffsets[1] = { static_cast<int32_t>(mSwapchainExtent.width), static_cast<int32_t>(mSwapchainExtent.height), 1 };
+	mVkd.CmdBlitImage(cmd, mRenderTarget, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, mSwapchainImages[currentImageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		1, &region, mUpscaleFilter);
+}
+
+void ke::Renderer::preloadShaders(const std::vector<std::string>& paths)
+{
+	std::lock_guard<std::mutex> lock(mShaderMutex);
+	for (const auto& path : paths)
+		if (mShaderCode.find(path) == mShaderCode.end())
+			mShaderCode.emplace(path, std::async(std::launch::async, [path] { return ke::AssetLoader::getInstance().load(path); }).share());
+}
+
+const std::vector<char>& ke::Renderer::getShaderCode(const std::string& path) const
+{
+	std::shared_future<std::vector<char>> code;
+	{
+		std::lock_guard<std::mutex> lock(mShaderMutex);
+		auto it = mShaderCode.find(path);
+		if (it == mShaderCode.end())
+			it = mShaderCode.emplace(path, std::async(std::launch::deferred, [path] { return ke::AssetLoader::getInstance().load(path); }).share()).first;
+		code = it->second;
+	}
+	// The cache keeps the shared state alive, so the reference outlives this copy.
+	return code.get();
+}
+
 VkShaderModule ke::Renderer::createShaderModule(const std::vector<char>& code) const
 {
 	VkShaderModuleCreateInfo createInfo{};
@@ -740,153 +1325,256 @@ VkShaderModule ke::Renderer::createShaderModule(const std::vector<char>& code) c
 	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
 
 	VkShaderModule mod;
-	if (vkCreateShaderModule(mDevice, &createInfo, nullptr, &mod) != VK_SUCCESS && enableLogging)
+	if (mVkd.CreateShaderModule(mDevice, &createInfo, mHostAllocator.getCallbacks(), &mod) != VK_SUCCESS && enableLogging)
 		mLogger.error("Failed to create a shader module.");
 
 	return mod;
 }
 
-void ke::Renderer::recreateSwapchain(GLFWwindow* pWindow)
+bool ke::Renderer::recreateSwapchain(GLFWwindow* pWindow)
 {
-	int width, height;
-	glfwGetFramebufferSize(pWindow, &width, &height);
-	while (width == 0 || height == 0)
+	VkExtent2D framebuffer = getFramebufferSize(pWindow);
+	while (framebuffer.width == 0 || framebuffer.height == 0)
 	{
-		glfwGetFramebufferSize(pWindow, &width, &height);
-		glfwWaitEvents();
+		if (mStopRequested.load(std::memory_order_acquire))
+			return false;
+		// A minimized window has no framebuffer; only the thread that owns the window may wait for its events.
+		if (mFramebufferSize.load(std::memory_order_acquire) == UINT64_MAX)
+			glfwWaitEvents();
+		else
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		framebuffer = getFramebufferSize(pWindow);
 	}
 
-	vkDeviceWaitIdle(mDevice);
+	mVkd.DeviceWaitIdle(mDevice);
+	mStats.addSwapchainRecreation();
+	mBundles.invalidateAll();
 
 	cleanupSwapchain();
 
 	createSwapchain(pWindow);
 	createSwapchainImageViews();
 	createFramebuffers();
-
+	destroyRenderTarget();
+	createRenderTarget();
+	return true;
 }
 
 void ke::Renderer::cleanupSwapchain()
 {
 	for (auto fb : mFramebuffers)
-		vkDestroyFramebuffer(mDevice, fb, nullptr);
+		mVkd.DestroyFramebuffer(mDevice, fb, mHostAllocator.getCallbacks());
 	for (auto imageView : mSwapchainImageViews)
-		vkDestroyImageView(mDevice, imageView, nullptr);
-	vkDestroySwapchainKHR(mDevice, mSwapchain, nullptr);
+		mVkd.DestroyImageView(mDevice, imageView, mHostAllocator.getCallbacks());
+	if (mHeadless)
+	{
+		mVkd.DestroyImage(mDevice, mSwapchainImages[0], mHostAllocator.getCallbacks());
+		mMemoryBudget.trackFree(mHeadlessMemory);
+		mVkd.FreeMemory(mDevice, mHeadlessMemory, mHostAllocator.getCallbacks());
+	}
+	else
+		mVkd.DestroySwapchainKHR(mDevice, mSwapchain, mHostAllocator.getCallbacks());
 }
 
 void ke::Renderer::cleanupRenderer()
 {
-	vkDeviceWaitIdle(mDevice);
+	mVkd.DeviceWaitIdle(mDevice);
 	if(enableLogging)
 	mLogger.trace("Initiating renderer cleanup.");
 
+	if (mCapture.isActive())
+		mCapture.finish();
+
 	cleanupSwapchain();
+	destroyRenderTarget();
+	if (mFrameQueryPool != VK_NULL_HANDLE)
+		mVkd.DestroyQueryPool(mDevice, mFrameQueryPool, mHostAllocator.getCallbacks());
+	mRenderGraph.cleanup();
+	mDescriptors.cleanup();
+	mResourceCache.cleanup();
+	mMemoryBudget.cleanup();
 
 	for (size_t i = 0; i < maxFramesInFlight; i++)
 	{
-		vkDestroySemaphore(mDevice, mImageReadySemaphores[i], nullptr);
-		vkDestroySemaphore(mDevice, mRenderFinishedSemaphores[i], nullptr);
-		vkDestroyFence(mDevice, mInFlightFences[i], nullptr);
+		mVkd.DestroySemaphore(mDevice, mImageReadySemaphores[i], mHostAllocator.getCallbacks());
+		mVkd.DestroySemaphore(mDevice, mRenderFinishedSemaphores[i], mHostAllocator.getCallbacks());
+		mVkd.DestroyFence(mDevice, mInFlightFences[i], mHostAllocator.getCallbacks());
+		mVkd.DestroySemaphore(mDevice, mComputeFinishedSemaphores[i], mHostAllocator.getCallbacks());
 	}
+
+	mVkd.FreeCommandBuffers(mDevice, mComputeCommandPool, static_cast<uint32_t>(mComputeCommandBuffers.size()), mComputeCommandBuffers.data());
+	mVkd.DestroyCommandPool(mDevice, mComputeCommandPool, mHostAllocator.getCallbacks());
 	
-	vkFreeCommandBuffers(mDevice, mCommandPool, static_cast<uint32_t>(mCommandBuffers.size()), mCommandBuffers.data());
-	vkDestroyCommandPool(mDevice, mCommandPool, nullptr);
-	vkDestroyRenderPass(mDevice, mRenderPass, nullptr);
-	vkDestroyPipelineLayout(mDevice, mPipelineLayout, nullptr);
-	vkDestroyPipeline(mDevice, mGraphicsPipeline, nullptr);
+	mBundles.cleanup();
+	mVkd.FreeCommandBuffers(mDevice, mCommandPool, static_cast<uint32_t>(mCommandBuffers.size()), mCommandBuffers.data());
+	mVkd.DestroyCommandPool(mDevice, mCommandPool, mHostAllocator.getCallbacks());
+	mVkd.DestroyRenderPass(mDevice, mRenderPass, mHostAllocator.getCallbacks());
+	mVkd.DestroyRenderPass(mDevice, mLoadRenderPass, mHostAllocator.getCallbacks());
+	mVkd.DestroyPipelineLayout(mDevice, mPipelineLayout, mHostAllocator.getCallbacks());
+	mVkd.DestroyPipeline(mDevice, mGraphicsPipeline, mHostAllocator.getCallbacks());
+	mVkd.DestroyPipelineCache(mDevice, mPipelineCache, mHostAllocator.getCallbacks());
 	
-	DestroyDebugUtilsMessengerEXT(mInstance, mDebugMessenger, nullptr);
-	vkDestroySurfaceKHR(mInstance, mSurface, nullptr);
-	vkDestroyInstance(mInstance, nullptr);
+	DestroyDebugUtilsMessengerEXT(mVki, mInstance, mDebugMessenger, mHostAllocator.getCallbacks());
+	if (mSurface != VK_NULL_HANDLE)
+		mVki.DestroySurfaceKHR(mInstance, mSurface, mHostAllocator.getCallbacks());
+	mVki.DestroyInstance(mInstance, mHostAllocator.getCallbacks());
+	mVulkanLibrary.unload();
+	mHostAllocator.logStats();
+	mHostAllocator.cleanup();
 	
 	mLogger.trace("Renderer cleanup done.");
 }
 
-void ke::Renderer::beginRecording(GLFWwindow* pWindow, bool hasResized)
+bool ke::Renderer::beginRecording(GLFWwindow* pWindow, bool hasResized)
 {
-	vkWaitForFences(mDevice, 1, &mInFlightFences[currentFrameInFlight], VK_TRUE, UINT64_MAX);
-
-	VkResult result = vkAcquireNextImageKHR(mDevice, mSwapchain, UINT64_MAX, mImageReadySemaphores[currentFrameInFlight], VK_NULL_HANDLE, &currentImageIndex);
+	KE_PROFILE_FUNCTION();
+	StatTimer fenceTimer;
+	mVkd.WaitForFences(mDevice, 1, &mInFlightFences[currentFrameInFlight], VK_TRUE, UINT64_MAX);
+	mStats.addFenceWait(fenceTimer.elapsedMs());
+	mHostAllocator.beginFrame(currentFrameInFlight);
+	mDescriptors.beginFrame(currentFrameInFlight);
+	mMemoryBudget.update(mStats.getCurrent().frame);
+
+	VkResult result = VK_SUCCESS;
+	if (mHeadless)
+		currentImageIndex = 0;
+	else
+	{
+		StatTimer acquireTimer;
+		result = mVkd.AcquireNextImageKHR(mDevice, mSwapchain, UINT64_MAX, mImageReadySemaphores[currentFrameInFlight], VK_NULL_HANDLE, &currentImageIndex);
+		mStats.addAcquireWait(acquireTimer.elapsedMs());
+	}
 
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || hasResized)
+	if (!mHeadless && (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || hasResized))
 	{
 		framebufferResized = false;
-		recreateSwapchain(pWindow);
+		// The fence is still signaled here, so a skipped frame leaves nothing to wait on.
+		if (!recreateSwapchain(pWindow))
+			return false;
 		recreatedSwapchain = true;
 	}
 	else recreatedSwapchain = false;
+
+	updateRenderExtent();
 		
-	vkResetFences(mDevice, 1, &mInFlightFences[currentFrameInFlight]);
+	mVkd.ResetFences(mDevice, 1, &mInFlightFences[currentFrameInFlight]);
 
-	vkResetCommandBuffer(mCommandBuffers[currentFrameInFlight], 0);
+	mVkd.ResetCommandBuffer(mCommandBuffers[currentFrameInFlight], 0);
+	mBundles.prepare(currentFrameInFlight, mRenderPass, mRenderExtent, mStats);
 
 	VkCommandBufferBeginInfo cBeginInfo{};
 	cBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	
-	if (vkBeginCommandBuffer(mCommandBuffers[currentFrameInFlight], &cBeginInfo) != VK_SUCCESS)
+	if (mVkd.BeginCommandBuffer(mCommandBuffers[currentFrameInFlight], &cBeginInfo) != VK_SUCCESS)
 		mLogger.critical("Failed to begin command buffer!");
 
-	VkClearValue clearColor = { {{0.0f, 0.0f, 0.0f, 1.0f}} };
+	if (mFrameQueryPool != VK_NULL_HANDLE)
+	{
+		mVkd.CmdResetQueryPool(mCommandBuffers[currentFrameInFlight], mFrameQueryPool, currentFrameInFlight * 2, 2);
+		mVkd.CmdWriteTimestamp(mCommandBuffers[currentFrameInFlight], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, mFrameQueryPool, currentFrameInFlight * 2);
+		mFrameQueryWritten[currentFrameInFlight] = 1;
+	}
 
-	VkRenderPassBeginInfo rBeginInfo{};
-	rBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	rBeginInfo.clearValueCount = 1;
-	rBeginInfo.pClearValues = &clearColor;
-	rBeginInfo.framebuffer = mFramebuffers[currentImageIndex];
-	rBeginInfo.renderArea.extent = mSwapchainExtent;
-	rBeginInfo.renderArea.offset = { 0,0 };
-	rBeginInfo.renderPass = mRenderPass;
+	buildFrameGraph();
+	mRenderGraph.executeUntil(mCommandBuffers[currentFrameInFlight], mMainPass);
 
-	vkCmdBeginRenderPass(mCommandBuffers[currentFrameInFlight], &rBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	// A subpass either executes secondaries or records inline, so background bundles get a pass instance of their own.
+	if (mBundles.hasCommands(BundleLayer::Background))
+	{
+		beginMainPass(mCommandBuffers[currentFrameInFlight], mRenderPass, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		mBundles.execute(mCommandBuffers[currentFrameInFlight], BundleLayer::Background);
+		mVkd.CmdEndRenderPass(mCommandBuffers[currentFrameInFlight]);
+		beginMainPass(mCommandBuffers[currentFrameInFlight], mLoadRenderPass, VK_SUBPASS_CONTENTS_INLINE);
+	}
+	else
+		beginMainPass(mCommandBuffers[currentFrameInFlight], mRenderPass, VK_SUBPASS_CONTENTS_INLINE);
+	mCapture.beginFrame(mCommandBuffers[currentFrameInFlight], mSwapchainExtent);
 
-	vkCmdBindPipeline(mCommandBuffers[currentFrameInFlight], VK_PIPELINE_BIND_POINT_GRAPHICS, mGraphicsPipeline);
+	bindPipeline(mCommandBuffers[currentFrameInFlight], mGraphicsPipeline);
 
 	VkViewport viewport{};
-	viewport.height = mSwapchainExtent.height;
-	viewport.width = mSwapchainExtent.width;
+	viewport.height = mRenderExtent.height;
+	viewport.width = mRenderExtent.width;
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
-	vkCmdSetViewport(mCommandBuffers[currentFrameInFlight], 0, 1, &viewport);
+	mVkd.CmdSetViewport(mCommandBuffers[currentFrameInFlight], 0, 1, &viewport);
 
 	VkRect2D scissor{};
-	scissor.extent = mSwapchainExtent;
+	scissor.extent = mRenderExtent;
 	scissor.offset = { 0,0 };
-	vkCmdSetScissor(mCommandBuffers[currentFrameInFlight], 0, 1, &scissor);
+	mVkd.CmdSetScissor(mCommandBuffers[currentFrameInFlight], 0, 1, &scissor);
+	return true;
 }
 
 void ke::Renderer::endRecording()
 {
-	if (recreatedSwapchain) return;
+	KE_PROFILE_FUNCTION();
+	mCapture.endFrame();
+	if (recreatedSwapchain)
+	{
+		mComputePending = false;
+		return;
+	}
 
-	vkCmdEndRenderPass(mCommandBuffers[currentFrameInFlight]);
-	if (vkEndCommandBuffer(mCommandBuffers[currentFrameInFlight]) != VK_SUCCESS)
+	if (mBundles.hasCommands(BundleLayer::Overlay))
+	{
+		mVkd.CmdEndRenderPass(mCommandBuffers[currentFrameInFlight]);
+		beginMainPass(mCommandBuffers[currentFrameInFlight], mLoadRenderPass, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		mBundles.execute(mCommandBuffers[currentFrameInFlight], BundleLayer::Overlay);
+	}
+	mVkd.CmdEndRenderPass(mCommandBuffers[currentFrameInFlight]);
+	// The frame time covers the scene only, not the upscale or anything waiting on the swapchain image.
+	if (mFrameQueryPool != VK_NULL_HANDLE)
+		mVkd.CmdWriteTimestamp(mCommandBuffers[currentFrameInFlight], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mFrameQueryPool, currentFrameInFlight * 2 + 1);
+	mRenderGraph.executeAfter(mCommandBuffers[currentFrameInFlight], mMainPass);
+
+	if (mVkd.EndCommandBuffer(mCommandBuffers[currentFrameInFlight]) != VK_SUCCESS)
 		mLogger.error("Failed to record command buffer!");
 
+	// Compute goes to its own queue first so it runs alongside rasterization; graphics only waits where it consumes the results.
+	if (mComputePending)
+	{
+		VkSubmitInfo computeSubmit{};
+		computeSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		computeSubmit.commandBufferCount = 1;
+		computeSubmit.pCommandBuffers = &mComputeCommandBuffers[currentFrameInFlight];
+		computeSubmit.signalSemaphoreCount = 1;
+		computeSubmit.pSignalSemaphores = &mComputeFinishedSemaphores[currentFrameInFlight];
+
+		if (mVkd.QueueSubmit(computeQueue, 1, &computeSubmit, VK_NULL_HANDLE) != VK_SUCCESS)
+			mLogger.critical("Failed to submit to compute queue!");
+	}
+
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	VkSemaphore waitSemaphore[] = {mImageReadySemaphores[currentFrameInFlight]};
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphore;
-	submitInfo.pWaitDstStageMask = waitStages;
+	VkSemaphore waitSemaphore[] = {mImageReadySemaphores[currentFrameInFlight], mComputeFinishedSemaphores[currentFrameInFlight]};
+	// With an internal target the swapchain image is first touched by the upscale blit, so the scene does not wait for it.
+	VkPipelineStageFlags imageWaitStage = mDynamicResolution.enabled ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	VkPipelineStageFlags waitStages[] = { imageWaitStage, mComputeWaitStages };
+	// Headless frames have no acquired image to wait for and nothing to present.
+	uint32_t firstWait = mHeadless ? 1 : 0;
+	submitInfo.waitSemaphoreCount = (mComputePending ? 2 : 1) - firstWait;
+	submitInfo.pWaitSemaphores = waitSemaphore + firstWait;
+	submitInfo.pWaitDstStageMask = waitStages + firstWait;
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &mCommandBuffers[currentFrameInFlight];
 	VkSemaphore signalSemaphore[] = { mRenderFinishedSemaphores[currentFrameInFlight]};
-	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.signalSemaphoreCount = mHeadless ? 0 : 1;
 	submitInfo.pSignalSemaphores = signalSemaphore;
 
-	if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, mInFlightFences[currentFrameInFlight]) != VK_SUCCESS)
+	if (mVkd.QueueSubmit(graphicsQueue, 1, &submitInfo, mInFlightFences[currentFrameInFlight]) != VK_SUCCESS)
 		mLogger.critical("Failed to submit to graphics queue!");
 
+	mComputePending = false;
 }
 
 void ke::Renderer::present(GLFWwindow* pWindow)
 {
-	if (recreatedSwapchain) return;
+	KE_PROFILE_FUNCTION();
+	if (recreatedSwapchain || mHeadless) return;
 	VkSemaphore waitSemaphore[] = { mRenderFinishedSemaphores[currentFrameInFlight]};
 
 	VkPresentInfoKHR presentInfo{};
@@ -899,17 +1587,501 @@ void ke::Renderer::present(GLFWwindow* pWindow)
 	presentInfo.pResults = nullptr;
 	presentInfo.pImageIndices = &currentImageIndex;
 
-	VkResult result = vkQueuePresentKHR(presentQueue, &presentInfo);
+	StatTimer presentTimer;
+	VkResult result = mVkd.QueuePresentKHR(presentQueue, &presentInfo);
+	mStats.addPresentWait(presentTimer.elapsedMs());
 	if (result == VK_ERROR_OUT_OF_DATE_KHR)
 		recreateSwapchain(pWindow);
 }
 
 void ke::Renderer::advanceFrame()
 {
+	KE_PROFILE_FRAME();
+	uint64_t hostAllocations = mHostAllocator.getAllocationCount();
+	uint64_t hostBytes = mHostAllocator.getAllocatedBytes();
+	mStats.addHostAllocations(hostAllocations - mLastHostAllocations, hostBytes - mLastHostBytes);
+	mLastHostAllocations = hostAllocations;
+	mLastHostBytes = hostBytes;
+	uint64_t memoryBudget = 0, memoryUsage = 0;
+	for (const auto& heap : mMemoryBudget.getHeaps())
+		if (heap.deviceLocal)
+		{
+			memoryBudget += heap.budget;
+			memoryUsage += heap.usage;
+		}
+	mStats.setMemoryStats(memoryBudget, memoryUsage, mMemoryBudget.getLastEvictionCount());
+	mStats.setDescriptorStats(mDescriptors.getAllocatedCount(), mDescriptors.getReusedCount());
+	mStats.endFrame();
 	currentFrameInFlight = (currentFrameInFlight + 1) % maxFramesInFlight;
 }
 
+void ke::Renderer::setFramebufferSize(uint32_t width, uint32_t height)
+{
+	mFramebufferSize.store((static_cast<uint64_t>(width) << 32) | height, std::memory_order_release);
+}
+
+void ke::Renderer::requestStop()
+{
+	mStopRequested.store(true, std::memory_order_release);
+}
+
 VkCommandBuffer ke::Renderer::getCommandBuffer() const
 {
 	return mCommandBuffers[currentFrameInFlight];
 }
+
+void ke::Renderer::draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance)
+{
+	draw(mCommandBuffers[currentFrameInFlight], vertexCount, instanceCount, firstVertex, firstInstance);
+}
+
+void ke::Renderer::draw(VkCommandBuffer cmd, uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance)
+{
+	mVkd.CmdDraw(cmd, vertexCount, instanceCount, firstVertex, firstInstance);
+	mStats.addDraw(vertexCount, instanceCount);
+	mCapture.recordDraw(cmd, vertexCount, instanceCount, firstVertex, firstInstance);
+}
+
+void ke::Renderer::drawIndexed(VkCommandBuffer cmd, uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance)
+{
+	mVkd.CmdDrawIndexed(cmd, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+	mStats.addDraw(indexCount, instanceCount);
+	mCapture.recordDrawIndexed(cmd, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+}
+
+void ke::Renderer::bindPipeline(VkCommandBuffer cmd, VkPipeline pipeline)
+{
+	mVkd.CmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	mStats.addPipelineBind();
+	mBundles.trackDependency(reinterpret_cast<uint64_t>(pipeline));
+	mCapture.recordBindPipeline(cmd, pipeline);
+}
+
+void ke::Renderer::bindVertexBuffers(VkCommandBuffer cmd, uint32_t firstBinding, uint32_t count, const VkBuffer* buffers, const VkDeviceSize* offsets)
+{
+	mVkd.CmdBindVertexBuffers(cmd, firstBinding, count, buffers, offsets);
+	for (uint32_t i = 0; i < count; i++)
+		mBundles.trackDependency(reinterpret_cast<uint64_t>(buffers[i]));
+	mCapture.recordBindVertexBuffers(cmd, firstBinding, count, buffers, offsets);
+}
+
+void ke::Renderer::bindIndexBuffer(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset, VkIndexType type)
+{
+	mVkd.CmdBindIndexBuffer(cmd, buffer, offset, type);
+	mBundles.trackDependency(reinterpret_cast<uint64_t>(buffer));
+	mCapture.recordBindIndexBuffer(cmd, buffer, offset, type);
+}
+
+void ke::Renderer::bindDescriptorSets(VkCommandBuffer cmd, VkPipelineLayout layout, uint32_t firstSet, uint32_t count, const VkDescriptorSet* sets)
+{
+	mVkd.CmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, firstSet, count, sets, 0, nullptr);
+	mStats.addDescriptorBinds(count);
+	for (uint32_t i = 0; i < count; i++)
+		mBundles.trackDependency(reinterpret_cast<uint64_t>(sets[i]));
+}
+
+void ke::Renderer::pushConstants(VkCommandBuffer cmd, VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void* data)
+{
+	mVkd.CmdPushConstants(cmd, layout, stages, offset, size, data);
+	mCapture.recordPushConstants(cmd, layout, stages, offset, size, data);
+}
+
+void ke::Renderer::setDevicePreference(const std::string& preference)
+{
+	mDevicePreference = preference;
+}
+
+const ke::DeviceCapabilities& ke::Renderer::getCapabilities() const
+{
+	return mCapabilities;
+}
+
+ke::RendererStats& ke::Renderer::getStats()
+{
+	return mStats;
+}
+
+void ke::Renderer::setHostAllocatorMode(HostAllocatorMode mode)
+{
+	mHostAllocatorMode = mode;
+}
+
+void ke::Renderer::setDynamicResolution(const DynamicResolutionSettings& settings)
+{
+	mDynamicResolution = settings;
+	mResolutionController.configure(settings);
+}
+
+const ke::DynamicResolutionSettings& ke::Renderer::getDynamicResolution() const
+{
+	return mDynamicResolution;
+}
+
+void ke::Renderer::setHeadless(VkExtent2D extent)
+{
+	mHeadless = true;
+	mHeadlessExtent = { std::max(extent.width, 1u), std::max(extent.height, 1u) };
+}
+
+bool ke::Renderer::isHeadless() const
+{
+	return mHeadless;
+}
+
+bool ke::Renderer::startCapture(const std::string& path, uint32_t frameCount)
+{
+	return mCapture.open(path, frameCount);
+}
+
+ke::MemoryBudget& ke::Renderer::getMemoryBudget()
+{
+	return mMemoryBudget;
+}
+
+ke::DescriptorAllocator& ke::Renderer::getDescriptorAllocator()
+{
+	return mDescriptors;
+}
+
+VkSampler ke::Renderer::getSampler(const VkSamplerCreateInfo& info)
+{
+	return mResourceCache.getSampler(info);
+}
+
+VkImageView ke::Renderer::getImageView(const VkImageViewCreateInfo& info)
+{
+	return mResourceCache.getImageView(info);
+}
+
+void ke::Renderer::releaseImageViews(VkImage image)
+{
+	mResourceCache.releaseImageViews(image);
+}
+
+const ke::HostAllocator& ke::Renderer::getHostAllocator() const
+{
+	return mHostAllocator;
+}
+
+const VkAllocationCallbacks* ke::Renderer::getAllocationCallbacks() const
+{
+	return mHostAllocator.getCallbacks();
+}
+
+uint32_t ke::Renderer::addRenderGraphHook(RenderGraphStage stage, std::function<void(RenderGraph&)> hook)
+{
+	uint32_t handle = mNextHook++;
+	if (stage == RenderGraphStage::BeforeMainPass)
+		mPreMainHooks.emplace_back(handle, std::move(hook));
+	else
+		mPostMainHooks.emplace_back(handle, std::move(hook));
+	return handle;
+}
+
+void ke::Renderer::removeRenderGraphHook(uint32_t hook)
+{
+	auto matches = [hook](const auto& entry) { return entry.first == hook; };
+	mPreMainHooks.erase(std::remove_if(mPreMainHooks.begin(), mPreMainHooks.end(), matches), mPreMainHooks.end());
+	mPostMainHooks.erase(std::remove_if(mPostMainHooks.begin(), mPostMainHooks.end(), matches), mPostMainHooks.end());
+}
+
+void ke::Renderer::mainPassRead(RGResource resource, RGAccess access)
+{
+	mMainPassReads.emplace_back(resource, access);
+}
+
+uint32_t ke::Renderer::addStaticBundle(BundleLayer layer, std::function<void(VkCommandBuffer)> record)
+{
+	return mBundles.add(layer, std::move(record));
+}
+
+void ke::Renderer::invalidateStaticBundle(uint32_t bundle)
+{
+	mBundles.invalidate(bundle);
+}
+
+void ke::Renderer::removeStaticBundle(uint32_t bundle)
+{
+	mBundles.remove(bundle);
+}
+
+void ke::Renderer::trackBundleDependency(uint64_t handle)
+{
+	mBundles.trackDependency(handle);
+}
+
+void ke::Renderer::notifyResourceChanged(uint64_t handle)
+{
+	mBundles.resourceChanged(handle);
+}
+
+ke::RenderGraph& ke::Renderer::getRenderGraph()
+{
+	return mRenderGraph;
+}
+
+ke::RGResource ke::Renderer::getBackbuffer() const
+{
+	return mBackbuffer;
+}
+
+ke::RGResource ke::Renderer::getSceneTarget() const
+{
+	return mSceneTarget;
+}
+
+ke::RGPass ke::Renderer::getMainPass() const
+{
+	return mMainPass;
+}
+
+VkCommandBuffer ke::Renderer::beginComputeRecording()
+{
+	VkCommandBuffer cmd = mComputeCommandBuffers[currentFrameInFlight];
+	mVkd.ResetCommandBuffer(cmd, 0);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (mVkd.BeginCommandBuffer(cmd, &beginInfo) != VK_SUCCESS)
+		mLogger.critical("Failed to begin compute command buffer!");
+
+	return cmd;
+}
+
+void ke::Renderer::endComputeRecording(VkPipelineStageFlags graphicsWaitStages)
+{
+	if (mVkd.EndCommandBuffer(mComputeCommandBuffers[currentFrameInFlight]) != VK_SUCCESS)
+		mLogger.error("Failed to record compute command buffer!");
+
+	// A zero wait mask is invalid, so an unspecified one waits before any graphics work.
+	if (graphicsWaitStages == 0)
+	{
+		if (enableLogging)
+			mLogger.warn("No graphics wait stages given for compute work, waiting on all commands.");
+		graphicsWaitStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	}
+	mComputeWaitStages = graphicsWaitStages;
+	mComputePending = true;
+}
+
+VkCommandBuffer ke::Renderer::getComputeCommandBuffer() const
+{
+	return mComputeCommandBuffers[currentFrameInFlight];
+}
+
+bool ke::Renderer::hasAsyncCompute() const
+{
+	return mQueueFamilies.computeFamily != mQueueFamilies.graphicsFamily || mQueueFamilies.computeQueueIndex != 0;
+}
+
+std::vector<uint32_t> ke::Renderer::getSharedQueueFamilies() const
+{
+	std::set<uint32_t> families = { mQueueFamilies.graphicsFamily.value(), mQueueFamilies.computeFamily.value() };
+	return std::vector<uint32_t>(families.begin(), families.end());
+}
+
+ke::Buffer ke::Renderer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+{
+	Buffer buffer = allocateBuffer(size, usage, properties);
+	mCapture.recordCreateBuffer(buffer, usage, properties);
+	return buffer;
+}
+
+ke::Buffer ke::Renderer::allocateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+{
+	Buffer buffer{};
+	buffer.size = size;
+
+	VkBufferCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	createInfo.size = size;
+	createInfo.usage = usage;
+	createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (mVkd.CreateBuffer(mDevice, &createInfo, mHostAllocator.getCallbacks(), &buffer.buffer) != VK_SUCCESS && enableLogging)
+		mLogger.error("Failed to create a buffer!");
+
+	VkMemoryRequirements requirements{};
+	mVkd.GetBufferMemoryRequirements(mDevice, buffer.buffer, &requirements);
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = requirements.size;
+	allocInfo.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+
+	// Stays under the eviction threshold where streamable resources allow it, and evicts every idle one before giving up.
+	mMemoryBudget.makeRoom(allocInfo.memoryTypeIndex, allocInfo.allocationSize);
+	VkResult result = mVkd.AllocateMemory(mDevice, &allocInfo, mHostAllocator.getCallbacks(), &buffer.memory);
+	if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY && mMemoryBudget.makeRoom(allocInfo.memoryTypeIndex, ~VkDeviceSize(0)) > 0)
+		result = mVkd.AllocateMemory(mDevice, &allocInfo, mHostAllocator.getCallbacks(), &buffer.memory);
+	if (result != VK_SUCCESS)
+	{
+		if (enableLogging)
+			mLogger.error("Failed to allocate buffer memory!");
+	}
+	else
+		mMemoryBudget.trackAllocation(buffer.memory, allocInfo.memoryTypeIndex, allocInfo.allocationSize);
+	buffer.memoryType = allocInfo.memoryTypeIndex;
+
+	mVkd.BindBufferMemory(mDevice, buffer.buffer, buffer.memory, 0);
+
+	if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		mVkd.MapMemory(mDevice, buffer.memory, 0, VK_WHOLE_SIZE, 0, &buffer.mapped);
+
+	return buffer;
+}
+
+void ke::Renderer::destroyBuffer(Buffer& buffer)
+{
+	mCapture.recordDestroyBuffer(buffer);
+	mBundles.resourceChanged(reinterpret_cast<uint64_t>(buffer.buffer));
+	if (buffer.mapped)
+		mVkd.UnmapMemory(mDevice, buffer.memory);
+	mVkd.DestroyBuffer(mDevice, buffer.buffer, mHostAllocator.getCallbacks());
+	mMemoryBudget.trackFree(buffer.memory);
+	mVkd.FreeMemory(mDevice, buffer.memory, mHostAllocator.getCallbacks());
+	buffer = Buffer{};
+}
+
+void ke::Renderer::uploadBuffer(const Buffer& buffer, const void* data, VkDeviceSize size, VkDeviceSize offset)
+{
+	mStats.addUpload(size);
+	if (buffer.mapped)
+	{
+		std::memcpy(static_cast<char*>(buffer.mapped) + offset, data, size);
+		return;
+	}
+
+	// The staging buffer goes around createBuffer so captures only see the upload itself.
+	mCapture.recordWrite(buffer, offset, size, data);
+	Buffer staging = allocateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	std::memcpy(staging.mapped, data, size);
+	submitImmediate([&](VkCommandBuffer cmd)
+		{
+			VkBufferCopy region{ 0, offset, size };
+			mVkd.CmdCopyBuffer(cmd, staging.buffer, buffer.buffer, 1, &region);
+		});
+	destroyBuffer(staging);
+}
+
+void ke::Renderer::submitImmediate(const std::function<void(VkCommandBuffer)>& record)
+{
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = mCommandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer cmd;
+	if (mVkd.AllocateCommandBuffers(mDevice, &allocInfo, &cmd) != VK_SUCCESS)
+	{
+		if (enableLogging)
+			mLogger.error("Failed to allocate an immediate command buffer!");
+		return;
+	}
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	mVkd.BeginCommandBuffer(cmd, &beginInfo);
+	record(cmd);
+	mVkd.EndCommandBuffer(cmd);
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	VkFence fence;
+	mVkd.CreateFence(mDevice, &fenceInfo, mHostAllocator.getCallbacks(), &fence);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &cmd;
+	if (mVkd.QueueSubmit(graphicsQueue, 1, &submitInfo, fence) == VK_SUCCESS)
+		mVkd.WaitForFences(mDevice, 1, &fence, VK_TRUE, UINT64_MAX);
+	else if (enableLogging)
+		mLogger.error("Failed to submit an immediate command buffer!");
+
+	mVkd.DestroyFence(mDevice, fence, mHostAllocator.getCallbacks());
+	mVkd.FreeCommandBuffers(mDevice, mCommandPool, 1, &cmd);
+}
+
+uint32_t ke::Renderer::findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const
+{
+	VkPhysicalDeviceMemoryProperties memoryProperties{};
+	mVki.GetPhysicalDeviceMemoryProperties(mPhysicalDevice, &memoryProperties);
+
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+		if ((typeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+			return i;
+
+	if (enableLogging)
+		mLogger.error("Failed to find a suitable memory type!");
+	return 0;
+}
+
+const VkuInstanceDispatchTable& ke::Renderer::getInstanceTable() const
+{
+	return mVki;
+}
+
+const VkuDeviceDispatchTable& ke::Renderer::getDeviceTable() const
+{
+	return mVkd;
+}
+
+VkInstance ke::Renderer::getVulkanInstance() const
+{
+	return mInstance;
+}
+
+uint32_t ke::Renderer::getGraphicsQueueFamily() const
+{
+	return mQueueFamilies.graphicsFamily.value();
+}
+
+VkDevice ke::Renderer::getDevice() const
+{
+	return mDevice;
+}
+
+VkPhysicalDevice ke::Renderer::getPhysicalDevice() const
+{
+	return mPhysicalDevice;
+}
+
+VkRenderPass ke::Renderer::getRenderPass() const
+{
+	return mRenderPass;
+}
+
+VkPipelineLayout ke::Renderer::getPipelineLayout() const
+{
+	return mPipelineLayout;
+}
+
+VkExtent2D ke::Renderer::getSwapchainExtent() const
+{
+	return mSwapchainExtent;
+}
+
+VkExtent2D ke::Renderer::getRenderExtent() const
+{
+	return mRenderExtent;
+}
+
+float ke::Renderer::getRenderScale() const
+{
+	return mDynamicResolution.enabled ? mResolutionController.getScale() : 1.0f;
+}
+
+uint32_t ke::Renderer::getCurrentFrameInFlight() const
+{
+	return currentFrameInFlight;
+}
+
+uint32_t ke::Renderer::getMaxFramesInFlight() const
+{
+	return maxFramesInFlight;
+}
@@ -1,11 +1,26 @@
 #pragma once
-#define VK_USE_PLATFORM_WIN32_KHR
-#define NOMINMAX
-#include <vulkan/vulkan.h>
+#include "vk.hpp"
+#include "vkloader.hpp"
 #include "logger.hpp"
+#include "rendergraph.hpp"
+#include "stats.hpp"
+#include "hostallocator.hpp"
+#include "capabilities.hpp"
+#include "resolution.hpp"
+#include "capture.hpp"
+#include "specialization.hpp"
+#include "commandbundles.hpp"
+#include "memorybudget.hpp"
+#include "descriptors.hpp"
+#include "resourcecache.hpp"
 #include <vector>
 #include <iostream>
 #include <optional>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
 #include <GLFW/glfw3.h>
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3native.h>
@@ -26,6 +41,9 @@ struct QueueFamilyIndices
 {
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
+	// Dedicated compute family when the device has one, otherwise the graphics family.
+	std::optional<uint32_t> computeFamily;
+	uint32_t computeQueueIndex = 0;
 
 	bool isComplete() const
 	{
@@ -43,6 +61,40 @@ struct SwapchainSupportDetails
 
 namespace ke
 {
+	enum class RenderGraphStage
+	{
+		BeforeMainPass,
+		AfterMainPass
+	};
+
+	struct Buffer
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+		void* mapped = nullptr;
+		uint32_t memoryType = 0;
+	};
+
+	struct GraphicsPipelineDesc
+	{
+		const char* vertexShader = "shader/bin/vert.spv";
+		const char* fragmentShader = "shader/bin/frag.spv";
+		std::vector<VkVertexInputBindingDescription> bindings;
+		std::vector<VkVertexInputAttributeDescription> attributes;
+		VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		VkPipelineLayout layout = VK_NULL_HANDLE;
+		bool additiveBlend = false;
+		// Standard over blending. Ignored when additiveBlend is set.
+		bool alphaBlend = false;
+		// Defaults to the main render pass. Without a fragment shader the pipeline is depth only and has no color attachments.
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		bool depthTest = false;
+		bool depthWrite = false;
+		// Applied to every stage; stages ignore constant ids they do not declare.
+		ShaderSpecialization specialization;
+	};
+
 	class Renderer
 	{
 	public:
@@ -55,16 +107,125 @@ namespace ke
 		Renderer(Renderer& other) = delete;
 		Renderer operator=(Renderer& other) = delete;
 
+		// Starts library loading, instance creation and shader reads on worker threads. Call before creating the
+		// window so they overlap with it; initVulkan calls it itself otherwise.
+		void beginInit();
 		void initVulkan(GLFWwindow* window);
 
 		void cleanupRenderer();
 
-		void beginRecording(GLFWwindow* pWindow, bool hasResized);
+		// Returns false when the frame was skipped because requestStop was called while waiting on a minimized window.
+		bool beginRecording(GLFWwindow* pWindow, bool hasResized);
 		void endRecording();
 		void present(GLFWwindow* pWindow);
 
 		void advanceFrame();
+		// GLFW window queries are main thread only. When another thread records and presents, the main thread reports
+		// the framebuffer size here every frame and the renderer stops querying the window itself.
+		void setFramebufferSize(uint32_t width, uint32_t height);
+		// Releases a render thread waiting for a minimized window to reopen. Call before stopping the thread, since the
+		// framebuffer size is no longer reported once the main loop exits.
+		void requestStop();
 		VkCommandBuffer getCommandBuffer() const;
+
+		// Records into the current frame's command buffer and updates the frame counters.
+		void draw(uint32_t vertexCount, uint32_t instanceCount = 1, uint32_t firstVertex = 0, uint32_t firstInstance = 0);
+		// Recording through these keeps the frame counters and any active capture up to date.
+		void draw(VkCommandBuffer cmd, uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance);
+		void drawIndexed(VkCommandBuffer cmd, uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance);
+		void bindPipeline(VkCommandBuffer cmd, VkPipeline pipeline);
+		void bindVertexBuffers(VkCommandBuffer cmd, uint32_t firstBinding, uint32_t count, const VkBuffer* buffers, const VkDeviceSize* offsets);
+		void bindIndexBuffer(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset, VkIndexType type);
+		void bindDescriptorSets(VkCommandBuffer cmd, VkPipelineLayout layout, uint32_t firstSet, uint32_t count, const VkDescriptorSet* sets);
+		void pushConstants(VkCommandBuffer cmd, VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void* data);
+		RendererStats& getStats();
+
+		// Must be set before initVulkan. The device preference is an index or part of a device name and
+		// defaults to the KE_DEVICE environment variable.
+		void setDevicePreference(const std::string& preference);
+		const DeviceCapabilities& getCapabilities() const;
+		void setHostAllocatorMode(HostAllocatorMode mode);
+		// Must be set before initVulkan. The scene then renders into an internal target sized for maxScale and is
+		// upscaled to the swapchain image after the main pass.
+		void setDynamicResolution(const DynamicResolutionSettings& settings);
+		const DynamicResolutionSettings& getDynamicResolution() const;
+		// Must be set before beginInit. Renders into an offscreen image instead of a window surface and skips presentation.
+		void setHeadless(VkExtent2D extent);
+		bool isHeadless() const;
+		// Captures every buffer and pipeline created from now on plus the main pass of the next frameCount frames.
+		// Start before initVulkan to include the renderer's own pipeline.
+		bool startCapture(const std::string& path, uint32_t frameCount);
+		const HostAllocator& getHostAllocator() const;
+		// Budgets are refreshed and idle streamable resources evicted at the start of every frame.
+		MemoryBudget& getMemoryBudget();
+		const VkAllocationCallbacks* getAllocationCallbacks() const;
+		// Per-frame descriptor sets, reset when the frame's fence has signalled. Sets that outlive a frame need a pool of their own.
+		DescriptorAllocator& getDescriptorAllocator();
+		// Deduplicated by create info and owned by the renderer; cached views must be released before their image is destroyed.
+		VkSampler getSampler(const VkSamplerCreateInfo& info);
+		VkImageView getImageView(const VkImageViewCreateInfo& info);
+		void releaseImageViews(VkImage image);
+
+		// Compute recording happens between beginRecording and endRecording and is submitted ahead of the graphics work.
+		// Resources touched by both queues should use concurrent sharing over getSharedQueueFamilies().
+		VkCommandBuffer beginComputeRecording();
+		// graphicsWaitStages are the graphics stages that wait for the compute work; 0 falls back to all commands.
+		void endComputeRecording(VkPipelineStageFlags graphicsWaitStages);
+		VkCommandBuffer getComputeCommandBuffer() const;
+		bool hasAsyncCompute() const;
+		std::vector<uint32_t> getSharedQueueFamilies() const;
+
+		// Hooks run in registration order every time the frame graph is built. The returned handle removes the hook again.
+		uint32_t addRenderGraphHook(RenderGraphStage stage, std::function<void(RenderGraph&)> hook);
+		void removeRenderGraphHook(uint32_t hook);
+		void mainPassRead(RGResource resource, RGAccess access);
+		// Main pass content recorded once into cached secondary command buffers and replayed every frame. record runs
+		// inside beginRecording for each frame in flight, again whenever the bundle is invalidated, the render extent
+		// changes or the swapchain is recreated. Changes made during a frame take effect from the next one.
+		uint32_t addStaticBundle(BundleLayer layer, std::function<void(VkCommandBuffer)> record);
+		void invalidateStaticBundle(uint32_t bundle);
+		void removeStaticBundle(uint32_t bundle);
+		// Everything bound through the recording helpers is tracked automatically, and destroyBuffer and destroyPipeline
+		// re-record the bundles that used them. Owners of other resources, such as descriptor sets that get rewritten,
+		// report them through notifyResourceChanged; handles recorded without a helper can be tracked by hand.
+		void trackBundleDependency(uint64_t handle);
+		void notifyResourceChanged(uint64_t handle);
+		RenderGraph& getRenderGraph();
+		RGResource getBackbuffer() const;
+		// What the main pass renders into: the internal target with dynamic resolution, the backbuffer otherwise.
+		RGResource getSceneTarget() const;
+		RGPass getMainPass() const;
+
+		// Host-visible buffers are persistently mapped.
+		Buffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+		void destroyBuffer(Buffer& buffer);
+		// Copies data into the buffer, through a staging buffer when it is not host-visible.
+		void uploadBuffer(const Buffer& buffer, const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+		VkPipelineLayout createPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstants);
+		// Records a one-off command buffer on the graphics queue and blocks until it has finished executing.
+		void submitImmediate(const std::function<void(VkCommandBuffer)>& record);
+		uint32_t findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const;
+		VkPipeline buildGraphicsPipeline(const GraphicsPipelineDesc& desc) const;
+		void destroyPipeline(VkPipeline& pipeline);
+		VkPipeline buildComputePipeline(const char* shader, VkPipelineLayout layout, const ShaderSpecialization& specialization = {}) const;
+		VkShaderModule createShaderModule(const std::vector<char>& code) const;
+		// Reads shader binaries in the background; buildGraphicsPipeline picks them up from the cache.
+		void preloadShaders(const std::vector<std::string>& paths);
+
+		const VkuInstanceDispatchTable& getInstanceTable() const;
+		const VkuDeviceDispatchTable& getDeviceTable() const;
+		VkInstance getVulkanInstance() const;
+		uint32_t getGraphicsQueueFamily() const;
+		VkDevice getDevice() const;
+		VkPhysicalDevice getPhysicalDevice() const;
+		VkRenderPass getRenderPass() const;
+		VkPipelineLayout getPipelineLayout() const;
+		VkExtent2D getSwapchainExtent() const;
+		// Extent the scene renders at this frame, which viewports and screen-space passes should use.
+		VkExtent2D getRenderExtent() const;
+		float getRenderScale() const;
+		uint32_t getCurrentFrameInFlight() const;
+		uint32_t getMaxFramesInFlight() const;
 	private:
 		Renderer() = default;
 
@@ -82,31 +243,56 @@ namespace ke
 		inline SwapchainSupportDetails querySwapchainSupport(VkPhysicalDevice device) const;
 		VkSurfaceFormatKHR chooseSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
 		VkPresentModeKHR chooseSurfacePresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
+		VkExtent2D getFramebufferSize(GLFWwindow* pWindow) const;
 		VkExtent2D chooseSwapchainExtent(const VkSurfaceCapabilitiesKHR& capabilities, GLFWwindow* pWindow);
+		void chooseSwapchainFormat();
 		void createSwapchain(GLFWwindow* pWindow);
 		void createSwapchainImageViews();
+		void createHeadlessBackbuffer();
+		void createPipelineCache();
 		void createGraphicsPipelineLayout();
 		void createGraphicsPipeline();
 		void createRenderPass();
 		void createCommandPool();
 		void createCommandBuffer();
+		void createComputeCommandResources();
 		void createFramebuffers();
 		void createSyncObjects();
-		VkShaderModule createShaderModule(const std::vector<char>& code) const;
-		void recreateSwapchain(GLFWwindow* pWindow);
+		void createRenderGraph();
+		void buildFrameGraph();
+		void createRenderTarget();
+		void destroyRenderTarget();
+		void createFrameQueries();
+		float readGpuFrameTime();
+		void updateRenderExtent();
+		void recordUpscale(VkCommandBuffer cmd);
+		void beginMainPass(VkCommandBuffer cmd, VkRenderPass renderPass, VkSubpassContents contents);
+		Buffer allocateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+		// Returns false without recreating when a stop is requested while the framebuffer is empty.
+		bool recreateSwapchain(GLFWwindow* pWindow);
 		void cleanupSwapchain();
+		const std::vector<char>& getShaderCode(const std::string& path) const;
 	private:
-		VkInstance mInstance;
+		VulkanLibrary mVulkanLibrary;
+		VkuInstanceDispatchTable mVki{};
+		VkuDeviceDispatchTable mVkd{};
+
+		VkInstance mInstance = VK_NULL_HANDLE;
 
 		VkDebugUtilsMessengerEXT mDebugMessenger;
 
 		VkPhysicalDevice mPhysicalDevice = VK_NULL_HANDLE;
+		DeviceCapabilities mCapabilities;
+		std::string mDevicePreference;
 		VkDevice mDevice = VK_NULL_HANDLE;
 
 		VkQueue graphicsQueue;
 		VkQueue presentQueue;
+		VkQueue computeQueue;
+
+		QueueFamilyIndices mQueueFamilies;
 
-		VkSurfaceKHR mSurface;
+		VkSurfaceKHR mSurface = VK_NULL_HANDLE;
 
 		VkSwapchainKHR mSwapchain;
 		std::vector<VkImage> mSwapchainImages;
@@ -114,15 +300,29 @@ namespace ke
 
 		VkFormat mSwapchainImageFormat;
 		VkExtent2D mSwapchainExtent;
+
+		bool mHeadless = false;
+		VkExtent2D mHeadlessExtent{};
+		VkDeviceMemory mHeadlessMemory = VK_NULL_HANDLE;
 		
 		VkRenderPass mRenderPass;
+		// Same attachments but loads them, so the main pass can be split around secondary command buffers.
+		VkRenderPass mLoadRenderPass = VK_NULL_HANDLE;
 
 		VkPipelineLayout mPipelineLayout;
 		VkPipeline mGraphicsPipeline;
+		// Shared by every pipeline build so variants of the same shaders reuse the driver's compiled code.
+		VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
 
 		VkCommandPool mCommandPool;
 		std::vector<VkCommandBuffer> mCommandBuffers;
 
+		VkCommandPool mComputeCommandPool;
+		std::vector<VkCommandBuffer> mComputeCommandBuffers;
+		std::vector<VkSemaphore> mComputeFinishedSemaphores;
+		VkPipelineStageFlags mComputeWaitStages = 0;
+		bool mComputePending = false;
+
 		std::vector<VkFramebuffer> mFramebuffers;
 
 		std::vector<VkFence> mInFlightFences;
@@ -135,6 +335,53 @@ namespace ke
 
 		bool recreatedSwapchain = false;
 		bool framebufferResized = false;
+		// Width in the high half, height in the low half; UINT64_MAX until setFramebufferSize is first called.
+		std::atomic<uint64_t> mFramebufferSize = UINT64_MAX;
+		std::atomic<bool> mStopRequested = false;
+
+		PFN_vkCmdPipelineBarrier2 mCmdPipelineBarrier2 = nullptr;
+
+		RenderGraph mRenderGraph;
+		RGResource mBackbuffer = RG_INVALID;
+		RGResource mSceneTarget = RG_INVALID;
+		RGPass mMainPass = RG_INVALID;
+		std::vector<std::pair<uint32_t, std::function<void(RenderGraph&)>>> mPreMainHooks;
+		std::vector<std::pair<uint32_t, std::function<void(RenderGraph&)>>> mPostMainHooks;
+		uint32_t mNextHook = 0;
+		std::vector<std::pair<RGResource, RGAccess>> mMainPassReads;
+		CommandBundleCache mBundles;
+
+		RendererStats mStats;
+		MemoryBudget mMemoryBudget;
+		DescriptorAllocator mDescriptors;
+		ResourceCache mResourceCache;
+
+		DynamicResolutionSettings mDynamicResolution;
+		ResolutionController mResolutionController;
+		VkExtent2D mRenderExtent{};
+		VkExtent2D mRenderTargetExtent{};
+		VkImage mRenderTarget = VK_NULL_HANDLE;
+		VkDeviceMemory mRenderTargetMemory = VK_NULL_HANDLE;
+		VkImageView mRenderTargetView = VK_NULL_HANDLE;
+		VkFramebuffer mRenderTargetFramebuffer = VK_NULL_HANDLE;
+		VkFilter mUpscaleFilter = VK_FILTER_LINEAR;
+
+		VkQueryPool mFrameQueryPool = VK_NULL_HANDLE;
+		std::vector<uint8_t> mFrameQueryWritten;
+		uint64_t mTimestampMask = ~0ull;
+
+		mutable CommandCapture mCapture;
+
+		HostAllocatorMode mHostAllocatorMode = HostAllocatorMode::Default;
+		HostAllocator mHostAllocator;
+		uint64_t mLastHostAllocations = 0;
+		uint64_t mLastHostBytes = 0;
+
+		bool mInitStarted = false;
+		std::chrono::steady_clock::time_point mInitStart;
+		std::future<void> mInstanceTask;
+		mutable std::mutex mShaderMutex;
+		mutable std::unordered_map<std::string, std::shared_future<std::vector<char>>> mShaderCode;
 	private:
 		ke::Logger mLogger = ke::Logger("Render Logger", spdlog::level::debug);
 	};
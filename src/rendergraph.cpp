@@ -0,0 +1,782 @@
+#include "rendergraph.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+ke::RGAccessInfo ke::getAccessInfo(RGAccess access)
+{
+	switch (access)
+	{
+	case RGAccess::ColorAttachmentWrite:
+		return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true };
+	case RGAccess::DepthAttachmentWrite:
+		return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true };
+	case RGAccess::DepthAttachmentRead:
+		return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, false };
+	case RGAccess::FragmentSampledRead:
+		return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false };
+	case RGAccess::ComputeSampledRead:
+		return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false };
+	case RGAccess::FragmentStorageRead:
+		return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false };
+	case RGAccess::VertexStorageRead:
+		return { VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false };
+	case RGAccess::ComputeStorageRead:
+		return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false };
+	case RGAccess::ComputeStorageWrite:
+		return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true };
+	case RGAccess::IndirectRead:
+		return { VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false };
+	case RGAccess::VertexInputRead:
+		return { VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_2_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false };
+	case RGAccess::TransferRead:
+		return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false };
+	case RGAccess::TransferWrite:
+		return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true };
+	case RGAccess::Acquire:
+		return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED, false };
+	case RGAccess::AcquireForTransfer:
+		return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED, false };
+	case RGAccess::Present:
+		return { VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, false };
+	default:
+		return { VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED, false };
+	}
+}
+
+static VkImageUsageFlags usageFromAccess(ke::RGAccess access)
+{
+	switch (access)
+	{
+	case ke::RGAccess::ColorAttachmentWrite:
+		return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	case ke::RGAccess::DepthAttachmentWrite:
+	case ke::RGAccess::DepthAttachmentRead:
+		return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	case ke::RGAccess::FragmentSampledRead:
+	case ke::RGAccess::ComputeSampledRead:
+		return VK_IMAGE_USAGE_SAMPLED_BIT;
+	case ke::RGAccess::FragmentStorageRead:
+	case ke::RGAccess::VertexStorageRead:
+	case ke::RGAccess::ComputeStorageRead:
+	case ke::RGAccess::ComputeStorageWrite:
+		return VK_IMAGE_USAGE_STORAGE_BIT;
+	case ke::RGAccess::TransferRead:
+		return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	case ke::RGAccess::TransferWrite:
+		return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	default:
+		return 0;
+	}
+}
+
+static VkPipelineStageFlags toLegacyStages(VkPipelineStageFlags2 stages, VkPipelineStageFlags fallback)
+{
+	if (stages == VK_PIPELINE_STAGE_2_NONE)
+		return fallback;
+	return static_cast<VkPipelineStageFlags>(stages & 0xFFFFFFFFull);
+}
+
+static VkAccessFlags toLegacyAccess(VkAccessFlags2 access)
+{
+	VkAccessFlags legacy = static_cast<VkAccessFlags>(access & 0xFFFFFFFFull);
+	if (access & (VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT))
+		legacy |= VK_ACCESS_SHADER_READ_BIT;
+	if (access & VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT)
+		legacy |= VK_ACCESS_SHADER_WRITE_BIT;
+	return legacy;
+}
+
+void ke::RenderGraph::init(VkDevice device, const VkuDeviceDispatchTable* vkd, const VkAllocationCallbacks* allocator, const VkPhysicalDeviceMemoryProperties& memoryProperties, uint32_t framesInFlight, PFN_vkCmdPipelineBarrier2 barrier2)
+{
+	mDevice = device;
+	mVkd = vkd;
+	mAllocator = allocator;
+	mFramesInFlight = framesInFlight;
+	mCmdPipelineBarrier2 = barrier2;
+	mMemoryProperties = memoryProperties;
+
+	if (enableLogging)
+	{
+		if (mCmdPipelineBarrier2)
+			mLogger.info("Render graph initialised with synchronization2 barriers.");
+		else
+			mLogger.warn("synchronization2 unavailable, render graph falls back to legacy barriers.");
+	}
+}
+
+void ke::RenderGraph::cleanup()
+{
+	for (auto& retired : mRetired)
+		destroyAllocation(retired.allocation);
+	mRetired.clear();
+	destroyAllocation(mTransients);
+
+	mResources.clear();
+	mPasses.clear();
+}
+
+void ke::RenderGraph::reset()
+{
+	mResources.clear();
+	mPasses.clear();
+	mImageBarriers.clear();
+	mBufferBarriers.clear();
+	mBarrierBatchCount = 0;
+	mFrameIndex++;
+
+	auto it = std::remove_if(mRetired.begin(), mRetired.end(), [this](RetiredAllocation& retired)
+		{
+			if (mFrameIndex - retired.retireFrame <= mFramesInFlight)
+				return false;
+			destroyAllocation(retired.allocation);
+			return true;
+		});
+	mRetired.erase(it, mRetired.end());
+}
+
+ke::RGResource ke::RenderGraph::importImage(const char* name, VkImage image, VkImageView view, const RGImageDesc& desc, RGAccess initialAccess, RGAccess finalAccess)
+{
+	Resource resource;
+	resource.name = name;
+	resource.imported = true;
+	resource.desc = desc;
+	resource.image = image;
+	resource.view = view;
+	resource.initialAccess = initialAccess;
+	resource.finalAccess = finalAccess;
+	mResources.push_back(std::move(resource));
+	return static_cast<RGResource>(mResources.size() - 1);
+}
+
+ke::RGResource ke::RenderGraph::importBuffer(const char* name, VkBuffer buffer, VkDeviceSize size, RGAccess initialAccess)
+{
+	Resource resource;
+	resource.name = name;
+	resource.isImage = false;
+	resource.imported = true;
+	resource.buffer = buffer;
+	resource.bufferSize = size;
+	resource.initialAccess = initialAccess;
+	mResources.push_back(std::move(resource));
+	return static_cast<RGResource>(mResources.size() - 1);
+}
+
+ke::RGResource ke::RenderGraph::createImage(const char* name, const RGImageDesc& desc)
+{
+	Resource resource;
+	resource.name = name;
+	resource.desc = desc;
+	mResources.push_back(std::move(resource));
+	return static_cast<RGResource>(mResources.size() - 1);
+}
+
+ke::RGPass ke::RenderGraph::addPass(const char* name, ExecuteFn execute)
+{
+	Pass pass;
+	pass.name = name;
+	pass.execute = std::move(execute);
+	mPasses.push_back(std::move(pass));
+	return static_cast<RGPass>(mPasses.size() - 1);
+}
+
+void ke::RenderGraph::read(RGPass pass, RGResource resource, RGAccess access)
+{
+	mPasses[pass].reads.push_back({ resource, access });
+}
+
+void ke::RenderGraph::write(RGPass pass, RGResource resource, RGAccess access)
+{
+	mPasses[pass].writes.push_back({ resource, access });
+}
+
+void ke::RenderGraph::setSideEffect(RGPass pass)
+{
+	mPasses[pass].sideEffect = true;
+}
+
+void ke::RenderGraph::markOutput(RGResource resource)
+{
+	mResources[resource].output = true;
+}
+
+void ke::RenderGraph::compile()
+{
+	KE_PROFILE_FUNCTION();
+	cullPasses();
+	computeLifetimes();
+	allocateTransients();
+	buildBarriers();
+#ifndef NDEBUG
+	validateAliasing();
+#endif
+}
+
+void ke::RenderGraph::cullPasses()
+{
+	for (auto& resource : mResources)
+		resource.readerCount = 0;
+
+	for (auto& pass : mPasses)
+	{
+		pass.culled = false;
+		pass.refCount = static_cast<uint32_t>(pass.writes.size());
+		for (const auto& use : pass.reads)
+			mResources[use.resource].readerCount++;
+	}
+
+	std::vector<RGResource> unreferenced;
+	for (RGResource i = 0; i < mResources.size(); i++)
+		if (mResources[i].readerCount == 0 && !mResources[i].imported && !mResources[i].output)
+			unreferenced.push_back(i);
+
+	while (!unreferenced.empty())
+	{
+		RGResource resource = unreferenced.back();
+		unreferenced.pop_back();
+
+		for (auto& pass : mPasses)
+		{
+			if (pass.culled || pass.sideEffect)
+				continue;
+
+			bool writesResource = std::any_of(pass.writes.begin(), pass.writes.end(),
+				[resource](const Use& use) { return use.resource == resource; });
+			if (!writesResource || --pass.refCount > 0)
+				continue;
+
+			pass.culled = true;
+			for (const auto& use : pass.reads)
+			{
+				Resource& read = mResources[use.resource];
+				if (--read.readerCount == 0 && !read.imported && !read.output)
+					unreferenced.push_back(use.resource);
+			}
+		}
+	}
+
+	for (auto& pass : mPasses)
+		if (pass.writes.empty() && !pass.sideEffect)
+			pass.culled = true;
+}
+
+void ke::RenderGraph::computeLifetimes()
+{
+	for (uint32_t p = 0; p < mPasses.size(); p++)
+	{
+		const Pass& pass = mPasses[p];
+		if (pass.culled)
+			continue;
+
+		auto touch = [this, p](const Use& use)
+			{
+				Resource& resource = mResources[use.resource];
+				if (resource.firstUse == RG_INVALID)
+					resource.firstUse = p;
+				resource.lastUse = p;
+				if (!resource.imported)
+					resource.desc.usage |= usageFromAccess(use.access);
+			};
+		std::for_each(pass.reads.begin(), pass.reads.end(), touch);
+		std::for_each(pass.writes.begin(), pass.writes.end(), touch);
+	}
+}
+
+size_t ke::RenderGraph::hashTransients() const
+{
+	size_t hash = 14695981039346656037ull;
+	auto mix = [&hash](uint64_t value)
+		{
+			hash ^= value;
+			hash *= 1099511628211ull;
+		};
+
+	for (const auto& resource : mResources)
+	{
+		if (resource.imported || resource.firstUse == RG_INVALID)
+			continue;
+		mix(resource.desc.format);
+		mix((static_cast<uint64_t>(resource.desc.extent.width) << 32) | resource.desc.extent.height);
+		mix(resource.desc.usage);
+		mix(resource.desc.aspect);
+		mix(resource.desc.mipLevels);
+		mix((static_cast<uint64_t>(resource.firstUse) << 32) | resource.lastUse);
+	}
+	return hash;
+}
+
+void ke::RenderGraph::allocateTransients()
+{
+	size_t key = hashTransients();
+
+	if (key != mTransients.key || mTransients.images.empty())
+	{
+		if (!mTransients.images.empty())
+			mRetired.push_back({ std::move(mTransients), mFrameIndex });
+		mTransients = TransientAllocation{};
+		mTransients.key = key;
+
+		for (const auto& resource : mResources)
+		{
+			if (resource.imported || resource.firstUse == RG_INVALID)
+				continue;
+
+			TransientImage transient;
+			transient.desc = resource.desc;
+			transient.firstUse = resource.firstUse;
+			transient.lastUse = resource.lastUse;
+
+			VkImageCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			createInfo.imageType = VK_IMAGE_TYPE_2D;
+			createInfo.format = resource.desc.format;
+			createInfo.extent = { resource.desc.extent.width, resource.desc.extent.height, 1 };
+			createInfo.mipLevels = resource.desc.mipLevels;
+			createInfo.arrayLayers = 1;
+			createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			createInfo.usage = resource.desc.usage;
+			createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			if (mVkd->CreateImage(mDevice, &createInfo, mAllocator, &transient.image) != VK_SUCCESS && enableLogging)
+				mLogger.error("Failed to create a transient image.");
+			mVkd->GetImageMemoryRequirements(mDevice, transient.image, &transient.requirements);
+
+			mTransients.images.push_back(transient);
+		}
+
+		// Largest images pick their block first; an image may share a block only with images whose lifetimes do not overlap.
+		std::vector<uint32_t> order(mTransients.images.size());
+		for (uint32_t i = 0; i < order.size(); i++)
+			order[i] = i;
+		std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+			{
+				return mTransients.images[a].requirements.size > mTransients.images[b].requirements.size;
+			});
+
+		for (uint32_t index : order)
+		{
+			TransientImage& image = mTransients.images[index];
+
+			for (uint32_t b = 0; b < mTransients.blocks.size() && image.block == RG_INVALID; b++)
+			{
+				MemoryBlock& block = mTransients.blocks[b];
+				if ((block.memoryTypeBits & image.requirements.memoryTypeBits) == 0 || block.size < image.requirements.size)
+					continue;
+
+				bool overlaps = std::any_of(block.occupants.begin(), block.occupants.end(), [this, &image](uint32_t other)
+					{
+						const TransientImage& occupant = mTransients.images[other];
+						return image.firstUse <= occupant.lastUse && occupant.firstUse <= image.lastUse;
+					});
+				if (overlaps)
+					continue;
+
+				block.memoryTypeBits &= image.requirements.memoryTypeBits;
+				block.occupants.push_back(index);
+				image.block = b;
+			}
+
+			if (image.block == RG_INVALID)
+			{
+				MemoryBlock block;
+				block.size = image.requirements.size;
+				block.memoryTypeBits = image.requirements.memoryTypeBits;
+				block.occupants.push_back(index);
+				image.block = static_cast<uint32_t>(mTransients.blocks.size());
+				mTransients.blocks.push_back(block);
+			}
+		}
+
+		for (auto& block : mTransients.blocks)
+		{
+			VkMemoryAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			allocInfo.allocationSize = block.size;
+			allocInfo.memoryTypeIndex = findMemoryType(block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+			if (mVkd->AllocateMemory(mDevice, &allocInfo, mAllocator, &block.memory) != VK_SUCCESS && enableLogging)
+				mLogger.error("Failed to allocate transient attachment memory.");
+		}
+
+		for (auto& image : mTransients.images)
+		{
+			mVkd->BindImageMemory(mDevice, image.image, mTransients.blocks[image.block].memory, 0);
+
+			VkImageViewCreateInfo viewInfo{};
+			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewInfo.image = image.image;
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewInfo.format = image.desc.format;
+			viewInfo.subresourceRange.aspectMask = image.desc.aspect;
+			viewInfo.subresourceRange.baseMipLevel = 0;
+			viewInfo.subresourceRange.levelCount = image.desc.mipLevels;
+			viewInfo.subresourceRange.baseArrayLayer = 0;
+			viewInfo.subresourceRange.layerCount = 1;
+
+			if (mVkd->CreateImageView(mDevice, &viewInfo, mAllocator, &image.view) != VK_SUCCESS && enableLogging)
+				mLogger.error("Failed to create a transient image view.");
+		}
+
+		if (enableLogging)
+			mLogger.debug("Allocated {} transient images in {} memory blocks ({} bytes).",
+				mTransients.images.size(), mTransients.blocks.size(), getTransientMemorySize());
+	}
+
+	uint32_t next = 0;
+	for (auto& resource : mResources)
+	{
+		if (resource.imported || resource.firstUse == RG_INVALID)
+			continue;
+		resource.transient = next;
+		resource.image = mTransients.images[next].image;
+		resource.view = mTransients.images[next].view;
+		next++;
+	}
+}
+
+void ke::RenderGraph::addBarrier(const Resource& resource, const RGAccessInfo& dst, VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess, VkImageLayout oldLayout)
+{
+	if (resource.isImage)
+	{
+		VkImageMemoryBarrier2 barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+		barrier.srcStageMask = srcStages;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstStageMask = dst.stages;
+		barrier.dstAccessMask = dst.access;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = dst.layout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = resource.image;
+		barrier.subresourceRange.aspectMask = resource.desc.aspect;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+		mImageBarriers.push_back(barrier);
+	}
+	else
+	{
+		VkBufferMemoryBarrier2 barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+		barrier.srcStageMask = srcStages;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstStageMask = dst.stages;
+		barrier.dstAccessMask = dst.access;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = resource.buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+		mBufferBarriers.push_back(barrier);
+	}
+}
+
+void ke::RenderGraph::transition(Resource& resource, const RGAccessInfo& info)
+{
+	RGResourceState& state = resource.state;
+	bool layoutChange = resource.isImage && state.layout != info.layout;
+
+	if (layoutChange || info.write)
+	{
+		addBarrier(resource, info, state.writeStages | state.readStages, state.writeAccess, state.layout);
+
+		// A layout transition counts as a write that is already visible to the destination stages.
+		state.layout = resource.isImage ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+		state.writeStages = info.stages;
+		state.writeAccess = info.write ? info.access : VK_ACCESS_2_NONE;
+		state.readStages = info.write ? VK_PIPELINE_STAGE_2_NONE : info.stages;
+		state.readAccess = info.write ? VK_ACCESS_2_NONE : info.access;
+		return;
+	}
+
+	bool alreadyVisible = (state.readStages & info.stages) == info.stages && (state.readAccess & info.access) == info.access;
+	if (!alreadyVisible && state.writeStages != VK_PIPELINE_STAGE_2_NONE)
+		addBarrier(resource, info, state.writeStages, state.writeAccess, state.layout);
+
+	state.readStages |= info.stages;
+	state.readAccess |= info.access;
+}
+
+void ke::RenderGraph::buildBarriers()
+{
+	for (auto& resource : mResources)
+	{
+		if (resource.imported)
+		{
+			RGAccessInfo initial = getAccessInfo(resource.initialAccess);
+			resource.state = RGResourceState{};
+			resource.state.layout = resource.isImage ? initial.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+			resource.state.writeStages = initial.stages;
+			resource.state.writeAccess = initial.write ? initial.access : VK_ACCESS_2_NONE;
+		}
+	}
+
+	std::vector<Use> merged;
+	for (uint32_t p = 0; p < mPasses.size(); p++)
+	{
+		Pass& pass = mPasses[p];
+		pass.imageBarrierBegin = static_cast<uint32_t>(mImageBarriers.size());
+		pass.bufferBarrierBegin = static_cast<uint32_t>(mBufferBarriers.size());
+		pass.imageBarrierCount = 0;
+		pass.bufferBarrierCount = 0;
+		if (pass.culled)
+			continue;
+
+		// Transients start undefined and inherit the last stages that touched their memory, which is an earlier
+		// occupant of the same block if one retired before this pass.
+		for (auto& resource : mResources)
+		{
+			if (resource.transient == RG_INVALID || resource.firstUse != p)
+				continue;
+			const MemoryBlock& block = mTransients.blocks[mTransients.images[resource.transient].block];
+			resource.state = RGResourceState{};
+			resource.state.writeStages = block.lastStages;
+			resource.state.writeAccess = block.lastAccess;
+		}
+
+		merged.clear();
+		merged.insert(merged.end(), pass.reads.begin(), pass.reads.end());
+		merged.insert(merged.end(), pass.writes.begin(), pass.writes.end());
+
+		for (size_t i = 0; i < merged.size(); i++)
+		{
+			RGResource resource = merged[i].resource;
+			bool seen = std::any_of(merged.begin(), merged.begin() + i, [resource](const Use& use) { return use.resource == resource; });
+			if (seen)
+				continue;
+
+			// A pass that reads and writes the same resource gets one barrier covering both uses.
+			RGAccessInfo info{ VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED, false };
+			for (size_t j = i; j < merged.size(); j++)
+			{
+				if (merged[j].resource != resource)
+					continue;
+				RGAccessInfo use = getAccessInfo(merged[j].access);
+				info.stages |= use.stages;
+				info.access |= use.access;
+				if (use.write || info.layout == VK_IMAGE_LAYOUT_UNDEFINED)
+					info.layout = use.layout;
+				info.write |= use.write;
+			}
+
+			transition(mResources[resource], info);
+		}
+
+		pass.imageBarrierCount = static_cast<uint32_t>(mImageBarriers.size()) - pass.imageBarrierBegin;
+		pass.bufferBarrierCount = static_cast<uint32_t>(mBufferBarriers.size()) - pass.bufferBarrierBegin;
+		if (pass.imageBarrierCount + pass.bufferBarrierCount > 0)
+			mBarrierBatchCount++;
+
+		for (auto& resource : mResources)
+		{
+			if (resource.transient == RG_INVALID || resource.lastUse != p)
+				continue;
+			TransientImage& image = mTransients.images[resource.transient];
+			MemoryBlock& block = mTransients.blocks[image.block];
+			block.lastStages = resource.state.writeStages | resource.state.readStages;
+			block.lastAccess = resource.state.writeAccess;
+			image.finalStages = block.lastStages;
+		}
+	}
+
+	mFinalImageBarrierBegin = static_cast<uint32_t>(mImageBarriers.size());
+	mFinalBufferBarrierBegin = static_cast<uint32_t>(mBufferBarriers.size());
+	for (auto& resource : mResources)
+	{
+		if (!resource.imported || resource.finalAccess == RGAccess::None)
+			continue;
+		transition(resource, getAccessInfo(resource.finalAccess));
+	}
+	if (mImageBarriers.size() > mFinalImageBarrierBegin || mBufferBarriers.size() > mFinalBufferBarrierBegin)
+		mBarrierBatchCount++;
+}
+
+void ke::RenderGraph::validateAliasing() const
+{
+	for (const auto& resource : mResources)
+	{
+		if (resource.transient == RG_INVALID)
+			continue;
+
+		// The first barrier of an aliased image has to wait on the occupant that retired last before it.
+		const TransientImage& image = mTransients.images[resource.transient];
+		const TransientImage* previous = nullptr;
+		for (uint32_t other : mTransients.blocks[image.block].occupants)
+		{
+			const TransientImage& occupant = mTransients.images[other];
+			if (occupant.lastUse < image.firstUse && (previous == nullptr || occupant.lastUse > previous->lastUse))
+				previous = &occupant;
+		}
+		if (previous == nullptr)
+			continue;
+
+		const Pass& pass = mPasses[image.firstUse];
+		auto begin = mImageBarriers.begin() + pass.imageBarrierBegin, end = begin + pass.imageBarrierCount;
+		auto barrier = std::find_if(begin, end, [&image](const VkImageMemoryBarrier2& b) { return b.image == image.image; });
+		if (barrier == end || (barrier->srcStageMask & previous->finalStages) != previous->finalStages)
+			mLogger.error("Transient '{}' is not ordered after the image it aliases in pass '{}'.", resource.name, pass.name);
+	}
+}
+
+void ke::RenderGraph::recordBarriers(VkCommandBuffer cmd, uint32_t imageBegin, uint32_t imageCount, uint32_t bufferBegin, uint32_t bufferCount) const
+{
+	if (imageCount == 0 && bufferCount == 0)
+		return;
+
+	if (mCmdPipelineBarrier2)
+	{
+		VkDependencyInfo dependency{};
+		dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		dependency.imageMemoryBarrierCount = imageCount;
+		dependency.pImageMemoryBarriers = imageCount ? &mImageBarriers[imageBegin] : nullptr;
+		dependency.bufferMemoryBarrierCount = bufferCount;
+		dependency.pBufferMemoryBarriers = bufferCount ? &mBufferBarriers[bufferBegin] : nullptr;
+		mCmdPipelineBarrier2(cmd, &dependency);
+		return;
+	}
+
+	VkPipelineStageFlags srcStages = 0;
+	VkPipelineStageFlags dstStages = 0;
+	std::vector<VkImageMemoryBarrier> imageBarriers(imageCount);
+	std::vector<VkBufferMemoryBarrier> bufferBarriers(bufferCount);
+
+	for (uint32_t i = 0; i < imageCount; i++)
+	{
+		const VkImageMemoryBarrier2& src = mImageBarriers[imageBegin + i];
+		VkImageMemoryBarrier& dst = imageBarriers[i];
+		dst.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		dst.srcAccessMask = toLegacyAccess(src.srcAccessMask);
+		dst.dstAccessMask = toLegacyAccess(src.dstAccessMask);
+		dst.oldLayout = src.oldLayout;
+		dst.newLayout = src.newLayout;
+		dst.srcQueueFamilyIndex = src.srcQueueFamilyIndex;
+		dst.dstQueueFamilyIndex = src.dstQueueFamilyIndex;
+		dst.image = src.image;
+		dst.subresourceRange = src.subresourceRange;
+		srcStages |= toLegacyStages(src.srcStageMask, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+		dstStages |= toLegacyStages(src.dstStageMask, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+	}
+
+	for (uint32_t i = 0; i < bufferCount; i++)
+	{
+		const VkBufferMemoryBarrier2& src = mBufferBarriers[bufferBegin + i];
+		VkBufferMemoryBarrier& dst = bufferBarriers[i];
+		dst.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		dst.srcAccessMask = toLegacyAccess(src.srcAccessMask);
+		dst.dstAccessMask = toLegacyAccess(src.dstAccessMask);
+		dst.srcQueueFamilyIndex = src.srcQueueFamilyIndex;
+		dst.dstQueueFamilyIndex = src.dstQueueFamilyIndex;
+		dst.buffer = src.buffer;
+		dst.offset = src.offset;
+		dst.size = src.size;
+		srcStages |= toLegacyStages(src.srcStageMask, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+		dstStages |= toLegacyStages(src.dstStageMask, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+	}
+
+	mVkd->CmdPipelineBarrier(cmd, srcStages, dstStages, 0, 0, nullptr,
+		bufferCount, bufferBarriers.data(), imageCount, imageBarriers.data());
+}
+
+void ke::RenderGraph::recordPass(VkCommandBuffer cmd, const Pass& pass, bool runCallback) const
+{
+	if (pass.culled)
+		return;
+
+	recordBarriers(cmd, pass.imageBarrierBegin, pass.imageBarrierCount, pass.bufferBarrierBegin, pass.bufferBarrierCount);
+	if (runCallback && pass.execute)
+		pass.execute(cmd);
+}
+
+void ke::RenderGraph::execute(VkCommandBuffer cmd)
+{
+	for (const auto& pass : mPasses)
+		recordPass(cmd, pass, true);
+
+	recordBarriers(cmd, mFinalImageBarrierBegin, static_cast<uint32_t>(mImageBarriers.size()) - mFinalImageBarrierBegin,
+		mFinalBufferBarrierBegin, static_cast<uint32_t>(mBufferBarriers.size()) - mFinalBufferBarrierBegin);
+}
+
+void ke::RenderGraph::executeUntil(VkCommandBuffer cmd, RGPass pass)
+{
+	for (RGPass p = 0; p < pass; p++)
+		recordPass(cmd, mPasses[p], true);
+
+	recordPass(cmd, mPasses[pass], false);
+}
+
+void ke::RenderGraph::executeAfter(VkCommandBuffer cmd, RGPass pass)
+{
+	for (RGPass p = pass + 1; p < mPasses.size(); p++)
+		recordPass(cmd, mPasses[p], true);
+
+	recordBarriers(cmd, mFinalImageBarrierBegin, static_cast<uint32_t>(mImageBarriers.size()) - mFinalImageBarrierBegin,
+		mFinalBufferBarrierBegin, static_cast<uint32_t>(mBufferBarriers.size()) - mFinalBufferBarrierBegin);
+}
+
+VkImage ke::RenderGraph::getImage(RGResource resource) const
+{
+	return mResources[resource].image;
+}
+
+VkImageView ke::RenderGraph::getImageView(RGResource resource) const
+{
+	return mResources[resource].view;
+}
+
+VkBuffer ke::RenderGraph::getBuffer(RGResource resource) const
+{
+	return mResources[resource].buffer;
+}
+
+bool ke::RenderGraph::isCulled(RGPass pass) const
+{
+	return mPasses[pass].culled;
+}
+
+uint32_t ke::RenderGraph::getBarrierBatchCount() const
+{
+	return mBarrierBatchCount;
+}
+
+VkDeviceSize ke::RenderGraph::getTransientMemorySize() const
+{
+	VkDeviceSize total = 0;
+	for (const auto& block : mTransients.blocks)
+		total += block.size;
+	return total;
+}
+
+uint32_t ke::RenderGraph::findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < mMemoryProperties.memoryTypeCount; i++)
+		if ((typeBits & (1u << i)) && (mMemoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+			return i;
+
+	if (enableLogging)
+		mLogger.error("Failed to find a suitable memory type for transient attachments.");
+	return 0;
+}
+
+void ke::RenderGraph::destroyAllocation(TransientAllocation& allocation)
+{
+	for (auto& image : allocation.images)
+	{
+		mVkd->DestroyImageView(mDevice, image.view, mAllocator);
+		mVkd->DestroyImage(mDevice, image.image, mAllocator);
+	}
+	for (auto& block : allocation.blocks)
+		mVkd->FreeMemory(mDevice, block.memory, mAllocator);
+
+	allocation.images.clear();
+	allocation.blocks.clear();
+	allocation.key = 0;
+}
\ No newline at end of file
@@ -0,0 +1,214 @@
+#pragma once
+#include "vk.hpp"
+#include "logger.hpp"
+#include <vector>
+#include <string>
+#include <functional>
+
+namespace ke
+{
+	using RGResource = uint32_t;
+	using RGPass = uint32_t;
+	constexpr uint32_t RG_INVALID = UINT32_MAX;
+
+	// How a pass touches a resource. Each access maps to a fixed stage, access mask and image layout.
+	enum class RGAccess : uint8_t
+	{
+		None,
+		ColorAttachmentWrite,
+		DepthAttachmentWrite,
+		DepthAttachmentRead,
+		FragmentSampledRead,
+		ComputeSampledRead,
+		FragmentStorageRead,
+		VertexStorageRead,
+		ComputeStorageRead,
+		ComputeStorageWrite,
+		IndirectRead,
+		VertexInputRead,
+		TransferRead,
+		TransferWrite,
+		Acquire,
+		// Swapchain image whose first use is a transfer, so the acquire wait can sit at the transfer stage.
+		AcquireForTransfer,
+		Present
+	};
+
+	struct RGImageDesc
+	{
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkExtent2D extent = { 0, 0 };
+		VkImageUsageFlags usage = 0;
+		VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+		uint32_t mipLevels = 1;
+	};
+
+	struct RGAccessInfo
+	{
+		VkPipelineStageFlags2 stages;
+		VkAccessFlags2 access;
+		VkImageLayout layout;
+		bool write;
+	};
+
+	RGAccessInfo getAccessInfo(RGAccess access);
+
+	struct RGResourceState
+	{
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags2 writeStages = VK_PIPELINE_STAGE_2_NONE;
+		VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+		VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE;
+		VkAccessFlags2 readAccess = VK_ACCESS_2_NONE;
+	};
+
+	class RenderGraph
+	{
+	public:
+		using ExecuteFn = std::function<void(VkCommandBuffer)>;
+
+		void init(VkDevice device, const VkuDeviceDispatchTable* vkd, const VkAllocationCallbacks* allocator, const VkPhysicalDeviceMemoryProperties& memoryProperties, uint32_t framesInFlight, PFN_vkCmdPipelineBarrier2 barrier2);
+		void cleanup();
+
+		void reset();
+
+		RGResource importImage(const char* name, VkImage image, VkImageView view, const RGImageDesc& desc, RGAccess initialAccess, RGAccess finalAccess);
+		RGResource importBuffer(const char* name, VkBuffer buffer, VkDeviceSize size, RGAccess initialAccess = RGAccess::None);
+		RGResource createImage(const char* name, const RGImageDesc& desc);
+
+		RGPass addPass(const char* name, ExecuteFn execute = nullptr);
+		void read(RGPass pass, RGResource resource, RGAccess access);
+		void write(RGPass pass, RGResource resource, RGAccess access);
+		void setSideEffect(RGPass pass);
+		void markOutput(RGResource resource);
+
+		void compile();
+		void execute(VkCommandBuffer cmd);
+		void executeUntil(VkCommandBuffer cmd, RGPass pass);
+		void executeAfter(VkCommandBuffer cmd, RGPass pass);
+
+		VkImage getImage(RGResource resource) const;
+		VkImageView getImageView(RGResource resource) const;
+		VkBuffer getBuffer(RGResource resource) const;
+		bool isCulled(RGPass pass) const;
+
+		uint32_t getBarrierBatchCount() const;
+		VkDeviceSize getTransientMemorySize() const;
+	private:
+		struct Use
+		{
+			RGResource resource;
+			RGAccess access;
+		};
+
+		struct Resource
+		{
+			std::string name;
+			bool isImage = true;
+			bool imported = false;
+			bool output = false;
+			RGImageDesc desc;
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkDeviceSize bufferSize = 0;
+			RGAccess initialAccess = RGAccess::None;
+			RGAccess finalAccess = RGAccess::None;
+
+			uint32_t readerCount = 0;
+			uint32_t firstUse = RG_INVALID;
+			uint32_t lastUse = RG_INVALID;
+			uint32_t transient = RG_INVALID;
+			RGResourceState state;
+		};
+
+		struct Pass
+		{
+			std::string name;
+			ExecuteFn execute;
+			std::vector<Use> reads;
+			std::vector<Use> writes;
+			bool sideEffect = false;
+			bool culled = false;
+			uint32_t refCount = 0;
+
+			uint32_t imageBarrierBegin = 0;
+			uint32_t imageBarrierCount = 0;
+			uint32_t bufferBarrierBegin = 0;
+			uint32_t bufferBarrierCount = 0;
+		};
+
+		struct MemoryBlock
+		{
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize size = 0;
+			uint32_t memoryTypeBits = ~0u;
+			std::vector<uint32_t> occupants;
+			VkPipelineStageFlags2 lastStages = VK_PIPELINE_STAGE_2_NONE;
+			VkAccessFlags2 lastAccess = VK_ACCESS_2_NONE;
+		};
+
+		struct TransientImage
+		{
+			RGImageDesc desc;
+			uint32_t firstUse = 0;
+			uint32_t lastUse = 0;
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+			VkMemoryRequirements requirements{};
+			uint32_t block = RG_INVALID;
+			// Stages of its last use in the most recent compile.
+			VkPipelineStageFlags2 finalStages = VK_PIPELINE_STAGE_2_NONE;
+		};
+
+		struct TransientAllocation
+		{
+			size_t key = 0;
+			std::vector<TransientImage> images;
+			std::vector<MemoryBlock> blocks;
+		};
+
+		struct RetiredAllocation
+		{
+			TransientAllocation allocation;
+			uint32_t retireFrame = 0;
+		};
+	private:
+		void cullPasses();
+		void computeLifetimes();
+		void allocateTransients();
+		void buildBarriers();
+		void addBarrier(const Resource& resource, const RGAccessInfo& dst, VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess, VkImageLayout oldLayout);
+		void transition(Resource& resource, const RGAccessInfo& info);
+		// Debug check that every aliased transient waits on the image that used its memory before it.
+		void validateAliasing() const;
+		void recordBarriers(VkCommandBuffer cmd, uint32_t imageBegin, uint32_t imageCount, uint32_t bufferBegin, uint32_t bufferCount) const;
+		void recordPass(VkCommandBuffer cmd, const Pass& pass, bool runCallback) const;
+
+		size_t hashTransients() const;
+		uint32_t findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const;
+		void destroyAllocation(TransientAllocation& allocation);
+	private:
+		VkDevice mDevice = VK_NULL_HANDLE;
+		const VkuDeviceDispatchTable* mVkd = nullptr;
+		const VkAllocationCallbacks* mAllocator = nullptr;
+		VkPhysicalDeviceMemoryProperties mMemoryProperties{};
+		PFN_vkCmdPipelineBarrier2 mCmdPipelineBarrier2 = nullptr;
+		uint32_t mFramesInFlight = 1;
+		uint32_t mFrameIndex = 0;
+
+		std::vector<Resource> mResources;
+		std::vector<Pass> mPasses;
+
+		std::vector<VkImageMemoryBarrier2> mImageBarriers;
+		std::vector<VkBufferMemoryBarrier2> mBufferBarriers;
+		uint32_t mFinalImageBarrierBegin = 0;
+		uint32_t mFinalBufferBarrierBegin = 0;
+		uint32_t mBarrierBatchCount = 0;
+
+		TransientAllocation mTransients;
+		std::vector<RetiredAllocation> mRetired;
+
+		ke::Logger mLogger = ke::Logger("Render Graph Logger", spdlog::level::debug);
+	};
+}
\ No newline at end of file
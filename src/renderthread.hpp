@@ -0,0 +1,68 @@
+#pragma once
+#include "framequeue.hpp"
+#include "profiler.hpp"
+#include <functional>
+#include <thread>
+
+namespace ke
+{
+	// Records and presents on its own thread from immutable snapshots that the simulation thread submits, so
+	// simulating frame N + 1 overlaps with rendering frame N. Each queued snapshot adds a frame of latency, and
+	// submit blocks while Depth snapshots are waiting. Nothing else may use the renderer between start and stop.
+	template<typename Snapshot, uint32_t Depth = 1>
+	class RenderThread
+	{
+	public:
+		using RenderFn = std::function<void(const Snapshot&)>;
+
+		~RenderThread()
+		{
+			stop();
+		}
+
+		void start(RenderFn render)
+		{
+			if (mThread.joinable())
+				return;
+			mQueue.reopen();
+			mRender = std::move(render);
+			mThread = std::thread([this]
+				{
+					KE_PROFILE_THREAD("Render");
+					Snapshot snapshot;
+					while (mQueue.pop(snapshot))
+						mRender(snapshot);
+				});
+		}
+
+		// Returns false once stopped.
+		bool submit(Snapshot snapshot)
+		{
+			KE_PROFILE_FUNCTION();
+			return mQueue.push(std::move(snapshot));
+		}
+
+		// Renders the snapshots still queued, then joins the thread.
+		void stop()
+		{
+			if (!mThread.joinable())
+				return;
+			mQueue.close();
+			mThread.join();
+		}
+
+		bool isRunning() const
+		{
+			return mThread.joinable();
+		}
+
+		uint32_t getQueuedCount() const
+		{
+			return mQueue.size();
+		}
+	private:
+		FrameQueue<Snapshot, Depth> mQueue;
+		RenderFn mRender;
+		std::thread mThread;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "resolution.hpp"
+#include <algorithm>
+#include <cmath>
+
+static constexpr float SMOOTHING = 0.1f;
+static constexpr float DEADBAND = 0.05f;
+static constexpr float MAX_STEP = 0.05f;
+static constexpr float SCALE_QUANTUM = 1.0f / 64.0f;
+
+void ke::ResolutionController::configure(const DynamicResolutionSettings& settings)
+{
+	mSettings = settings;
+	mSettings.minScale = std::clamp(settings.minScale, 0.1f, 1.0f);
+	mSettings.maxScale = std::clamp(settings.maxScale, mSettings.minScale, 2.0f);
+	reset();
+}
+
+void ke::ResolutionController::reset()
+{
+	mScale = mSettings.maxScale;
+	mSmoothedMs = 0.0f;
+	mSamples = 0;
+}
+
+float ke::ResolutionController::update(float gpuMs)
+{
+	if (gpuMs <= 0.0f)
+		return mScale;
+
+	mSmoothedMs = mSamples++ == 0 ? gpuMs : mSmoothedMs + (gpuMs - mSmoothedMs) * SMOOTHING;
+
+	float goal = mSettings.targetMs * mSettings.headroom;
+	float ratio = goal / mSmoothedMs;
+	bool spike = gpuMs > mSettings.targetMs;
+	if (!spike && std::abs(ratio - 1.0f) < DEADBAND)
+		return mScale;
+
+	// Everything eases in, except that a frame over the full target drops by its own time straight away. The smoothed
+	// time has barely moved on a spike, and the spike must never raise the scale.
+	float desired = mScale * std::sqrt(ratio);
+	float step = std::clamp(desired - mScale, -MAX_STEP, MAX_STEP);
+	if (spike)
+		step = std::min(step, std::min(mScale * std::sqrt(goal / gpuMs) - mScale, 0.0f));
+	float scale = std::clamp(mScale + step, mSettings.minScale, mSettings.maxScale);
+	mScale = std::round(scale / SCALE_QUANTUM) * SCALE_QUANTUM;
+	mScale = std::clamp(mScale, mSettings.minScale, mSettings.maxScale);
+	return mScale;
+}
+
+float ke::ResolutionController::getScale() const
+{
+	return mScale;
+}
+
+float ke::ResolutionController::getSmoothedMs() const
+{
+	return mSmoothedMs;
+}
\ No newline at end of file
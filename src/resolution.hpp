@@ -0,0 +1,37 @@
+#pragma once
+#include "logger.hpp"
+#include <cstdint>
+
+namespace ke
+{
+	struct DynamicResolutionSettings
+	{
+		bool enabled = false;
+		// Per-axis scale of the internal render target relative to the swapchain.
+		float minScale = 0.5f;
+		float maxScale = 1.0f;
+		float targetMs = 16.0f;
+		// Fraction of the target the controller aims for, leaving room for spikes.
+		float headroom = 0.9f;
+	};
+
+	// Picks the render scale from measured GPU time. GPU cost is assumed to follow the pixel count, so the scale
+	// moves with the square root of the time ratio. Changes are rate limited and ignored inside a small deadband
+	// so the resolution does not oscillate around the target.
+	class ResolutionController
+	{
+	public:
+		void configure(const DynamicResolutionSettings& settings);
+		// Feeds one frame's GPU time and returns the scale for the next frame.
+		float update(float gpuMs);
+		void reset();
+
+		float getScale() const;
+		float getSmoothedMs() const;
+	private:
+		DynamicResolutionSettings mSettings;
+		float mScale = 1.0f;
+		float mSmoothedMs = 0.0f;
+		uint32_t mSamples = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "resourcecache.hpp"
+#include <cstring>
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+static uint64_t hashSampler(const VkSamplerCreateInfo& info, VkSamplerReductionMode reductionMode)
+{
+	uint64_t hash = 14695981039346656037ull;
+	auto mix = [&hash](uint64_t value)
+		{
+			hash ^= value;
+			hash *= 1099511628211ull;
+		};
+	auto bits = [](float value)
+		{
+			uint32_t result;
+			std::memcpy(&result, &value, sizeof(result));
+			return result;
+		};
+
+	mix(info.flags);
+	mix((static_cast<uint64_t>(info.magFilter) << 32) | info.minFilter);
+	mix(info.mipmapMode);
+	mix((static_cast<uint64_t>(info.addressModeU) << 32) | info.addressModeV);
+	mix(info.addressModeW);
+	mix(bits(info.mipLodBias));
+	mix((static_cast<uint64_t>(info.anisotropyEnable) << 32) | bits(info.maxAnisotropy));
+	mix((static_cast<uint64_t>(info.compareEnable) << 32) | info.compareOp);
+	mix((static_cast<uint64_t>(bits(info.minLod)) << 32) | bits(info.maxLod));
+	mix((static_cast<uint64_t>(info.borderColor) << 32) | info.unnormalizedCoordinates);
+	mix(reductionMode);
+	return hash;
+}
+
+static bool sameSampler(const VkSamplerCreateInfo& a, const VkSamplerCreateInfo& b)
+{
+	return a.flags == b.flags && a.magFilter == b.magFilter && a.minFilter == b.minFilter && a.mipmapMode == b.mipmapMode
+		&& a.addressModeU == b.addressModeU && a.addressModeV == b.addressModeV && a.addressModeW == b.addressModeW
+		&& a.mipLodBias == b.mipLodBias && a.anisotropyEnable == b.anisotropyEnable && a.maxAnisotropy == b.maxAnisotropy
+		&& a.compareEnable == b.compareEnable && a.compareOp == b.compareOp && a.minLod == b.minLod && a.maxLod == b.maxLod
+		&& a.borderColor == b.borderColor && a.unnormalizedCoordinates == b.unnormalizedCoordinates;
+}
+
+static bool sameView(const VkImageViewCreateInfo& a, const VkImageViewCreateInfo& b)
+{
+	return a.flags == b.flags && a.viewType == b.viewType && a.format == b.format
+		&& a.components.r == b.components.r && a.components.g == b.components.g && a.components.b == b.components.b && a.components.a == b.components.a
+		&& a.subresourceRange.aspectMask == b.subresourceRange.aspectMask
+		&& a.subresourceRange.baseMipLevel == b.subresourceRange.baseMipLevel && a.subresourceRange.levelCount == b.subresourceRange.levelCount
+		&& a.subresourceRange.baseArrayLayer == b.subresourceRange.baseArrayLayer && a.subresourceRange.layerCount == b.subresourceRange.layerCount;
+}
+
+void ke::ResourceCache::init(VkDevice device, const VkuDeviceDispatchTable* vkd, const VkAllocationCallbacks* allocator)
+{
+	mDevice = device;
+	mVkd = vkd;
+	mAllocator = allocator;
+}
+
+void ke::ResourceCache::cleanup()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (const auto& cached : mSamplers)
+		mVkd->DestroySampler(mDevice, cached.sampler, mAllocator);
+	if (!mViews.empty() && enableLogging)
+		mLogger.warn("{} cached image views were never released.", mViewCount);
+	for (const auto& [image, views] : mViews)
+		for (const auto& cached : views)
+			mVkd->DestroyImageView(mDevice, cached.view, mAllocator);
+	mSamplers.clear();
+	mViews.clear();
+	mViewCount = 0;
+}
+
+VkSampler ke::ResourceCache::getSampler(const VkSamplerCreateInfo& info)
+{
+	// Reduction modes are the only extension that changes what a sampler returns and is common enough to key on.
+	bool shared = true;
+	VkSamplerReductionMode reductionMode = VK_SAMPLER_REDUCTION_MODE_WEIGHTED_AVERAGE;
+	for (auto next = static_cast<const VkBaseInStructure*>(info.pNext); next; next = next->pNext)
+	{
+		if (next->sType == VK_STRUCTURE_TYPE_SAMPLER_REDUCTION_MODE_CREATE_INFO)
+			reductionMode = reinterpret_cast<const VkSamplerReductionModeCreateInfo*>(next)->reductionMode;
+		else
+			shared = false;
+	}
+	uint64_t hash = hashSampler(info, reductionMode);
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (shared)
+		for (const auto& cached : mSamplers)
+			if (cached.shared && cached.hash == hash && cached.reductionMode == reductionMode && sameSampler(cached.info, info))
+				return cached.sampler;
+
+	CachedSampler cached;
+	cached.hash = hash;
+	cached.shared = shared;
+	cached.info = info;
+	cached.info.pNext = nullptr;
+	cached.reductionMode = reductionMode;
+	if (mVkd->CreateSampler(mDevice, &info, mAllocator, &cached.sampler) != VK_SUCCESS)
+	{
+		mLogger.error("Failed to create a sampler!");
+		return VK_NULL_HANDLE;
+	}
+	mSamplers.push_back(cached);
+	return cached.sampler;
+}
+
+VkImageView ke::ResourceCache::getImageView(const VkImageViewCreateInfo& info)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	std::vector<CachedView>& views = mViews[info.image];
+	bool shared = info.pNext == nullptr;
+	if (shared)
+		for (const auto& cached : views)
+			if (cached.shared && sameView(cached.info, info))
+				return cached.view;
+
+	CachedView cached;
+	cached.shared = shared;
+	cached.info = info;
+	cached.info.pNext = nullptr;
+	if (mVkd->CreateImageView(mDevice, &info, mAllocator, &cached.view) != VK_SUCCESS)
+	{
+		mLogger.error("Failed to create an image view!");
+		if (views.empty())
+			mViews.erase(info.image);
+		return VK_NULL_HANDLE;
+	}
+	views.push_back(cached);
+	mViewCount++;
+	return cached.view;
+}
+
+void ke::ResourceCache::releaseImageViews(VkImage image)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto it = mViews.find(image);
+	if (it == mViews.end())
+		return;
+	for (const auto& cached : it->second)
+		mVkd->DestroyImageView(mDevice, cached.view, mAllocator);
+	mViewCount -= static_cast<uint32_t>(it->second.size());
+	mViews.erase(it);
+}
+
+uint32_t ke::ResourceCache::getSamplerCount() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return static_cast<uint32_t>(mSamplers.size());
+}
+
+uint32_t ke::ResourceCache::getImageViewCount() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mViewCount;
+}
\ No newline at end of file
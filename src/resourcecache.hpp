@@ -0,0 +1,54 @@
+#pragma once
+#include "vk.hpp"
+#include "logger.hpp"
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+
+namespace ke
+{
+	// Samplers and image views deduplicated by their create info. Everything handed out stays owned by the cache:
+	// samplers until cleanup, views until their image is released. Create infos with a pNext chain the cache does
+	// not understand still work but are never shared.
+	class ResourceCache
+	{
+	public:
+		void init(VkDevice device, const VkuDeviceDispatchTable* vkd, const VkAllocationCallbacks* allocator);
+		void cleanup();
+
+		VkSampler getSampler(const VkSamplerCreateInfo& info);
+		VkImageView getImageView(const VkImageViewCreateInfo& info);
+		// Destroys every view handed out for image. Call before destroying the image itself.
+		void releaseImageViews(VkImage image);
+
+		uint32_t getSamplerCount() const;
+		uint32_t getImageViewCount() const;
+	private:
+		struct CachedSampler
+		{
+			uint64_t hash = 0;
+			bool shared = true;
+			VkSamplerCreateInfo info{};
+			VkSamplerReductionMode reductionMode = VK_SAMPLER_REDUCTION_MODE_WEIGHTED_AVERAGE;
+			VkSampler sampler = VK_NULL_HANDLE;
+		};
+
+		struct CachedView
+		{
+			bool shared = true;
+			VkImageViewCreateInfo info{};
+			VkImageView view = VK_NULL_HANDLE;
+		};
+	private:
+		VkDevice mDevice = VK_NULL_HANDLE;
+		const VkuDeviceDispatchTable* mVkd = nullptr;
+		const VkAllocationCallbacks* mAllocator = nullptr;
+
+		mutable std::mutex mMutex;
+		std::vector<CachedSampler> mSamplers;
+		std::unordered_map<VkImage, std::vector<CachedView>> mViews;
+		uint32_t mViewCount = 0;
+
+		ke::Logger mLogger = ke::Logger("Resource Cache Logger", spdlog::level::debug);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,427 @@
+#include "scene.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <execution>
+#include <numeric>
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+constexpr uint32_t PROPAGATION_GRAIN = 4096;
+constexpr uint8_t ALL_FRAME_SLOTS = 0xFF;
+
+template<typename T>
+static void permute(std::vector<T>& data, const std::vector<uint32_t>& order)
+{
+	std::vector<T> sorted;
+	sorted.reserve(order.size());
+	for (uint32_t index : order)
+		sorted.push_back(data[index]);
+	data.swap(sorted);
+}
+
+static ke::Bounds transformBounds(const glm::mat4& m, const ke::Bounds& bounds)
+{
+	glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+	glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+
+	glm::vec3 worldCenter = glm::vec3(m * glm::vec4(center, 1.0f));
+	glm::vec3 worldExtent = glm::abs(glm::vec3(m[0])) * extent.x
+		+ glm::abs(glm::vec3(m[1])) * extent.y
+		+ glm::abs(glm::vec3(m[2])) * extent.z;
+
+	return { worldCenter - worldExtent, worldCenter + worldExtent };
+}
+
+ke::Entity ke::Scene::create(Entity parent, uint32_t renderHandle)
+{
+	// Checked before a free slot is taken, since a dead parent's id may be the slot handed out below.
+	if (parent != NULL_ENTITY && !isAlive(parent))
+	{
+		if (enableLogging)
+			mLogger.error("Cannot parent a new entity to {}, it is not alive. Creating it as a root.", parent);
+		parent = NULL_ENTITY;
+	}
+
+	Entity entity;
+	if (!mFreeEntities.empty())
+	{
+		entity = mFreeEntities.back();
+		mFreeEntities.pop_back();
+		mReleasedGpuDirty[entity] = 0;
+	}
+	else
+	{
+		entity = static_cast<Entity>(mDenseIndex.size());
+		mDenseIndex.push_back(INVALID_INDEX);
+		mParentEntity.push_back(NULL_ENTITY);
+		mReleasedGpuDirty.push_back(0);
+	}
+
+	uint32_t index = static_cast<uint32_t>(mEntity.size());
+	uint32_t parentIndex = parent != NULL_ENTITY ? mDenseIndex[parent] : INVALID_INDEX;
+	uint32_t depth = parentIndex != INVALID_INDEX ? mDepth[parentIndex] + 1 : 0;
+
+	mDenseIndex[entity] = index;
+	mParentEntity[entity] = parent;
+
+	mEntity.push_back(entity);
+	mParent.push_back(parentIndex);
+	mDepth.push_back(depth);
+	mPosition.push_back(glm::vec3(0.0f));
+	mRotation.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+	mScale.push_back(glm::vec3(1.0f));
+	mWorld.push_back(glm::mat4(1.0f));
+	mLocalBounds.push_back(Bounds{});
+	mWorldBounds.push_back(Bounds{});
+	mRenderHandle.push_back(renderHandle);
+	mLocalDirty.push_back(1);
+	mWorldChanged.push_back(0);
+	mGpuDirty.push_back(ALL_FRAME_SLOTS);
+
+	// Appending to the deepest level (or opening a new one) keeps the depth order intact.
+	if (mLevelStart.empty())
+		mLevelStart.push_back(0);
+	if (mOrderDirty)
+		return entity;
+	if (depth + 1 == mLevelStart.size())
+		mLevelStart.push_back(index + 1);
+	else if (depth + 2 == mLevelStart.size())
+		mLevelStart.back() = index + 1;
+	else
+		mOrderDirty = true;
+
+	return entity;
+}
+
+void ke::Scene::destroy(Entity entity)
+{
+	if (!isAlive(entity))
+		return;
+	if (mOrderDirty)
+		sortByDepth();
+
+	// Parents precede children, so one pass marks the whole subtree.
+	std::vector<uint8_t> removed(mEntity.size(), 0);
+	removed[mDenseIndex[entity]] = 1;
+	for (uint32_t i = mDenseIndex[entity] + 1; i < mEntity.size(); i++)
+		if (mParent[i] != INVALID_INDEX && removed[mParent[i]])
+			removed[i] = 1;
+
+	std::vector<uint32_t> order;
+	order.reserve(mEntity.size());
+	for (uint32_t i = 0; i < mEntity.size(); i++)
+	{
+		if (!removed[i])
+		{
+			order.push_back(i);
+			continue;
+		}
+		mDenseIndex[mEntity[i]] = INVALID_INDEX;
+		mParentEntity[mEntity[i]] = NULL_ENTITY;
+		mFreeEntities.push_back(mEntity[i]);
+		mReleasedGpuDirty[mEntity[i]] = ALL_FRAME_SLOTS;
+		mReleased.push_back(mEntity[i]);
+	}
+
+	reorder(order);
+}
+
+void ke::Scene::setParent(Entity entity, Entity parent)
+{
+	if (!isAlive(entity) || (parent != NULL_ENTITY && !isAlive(parent)))
+	{
+		if (enableLogging)
+			mLogger.error("Cannot parent entity {} to {}, one of them is not alive.", entity, parent);
+		return;
+	}
+
+	for (Entity ancestor = parent; ancestor != NULL_ENTITY; ancestor = mParentEntity[ancestor])
+	{
+		if (ancestor == entity)
+		{
+			if (enableLogging)
+				mLogger.error("Refusing to parent an entity to its own descendant.");
+			return;
+		}
+	}
+
+	mParentEntity[entity] = parent;
+	mOrderDirty = true;
+	markLocalDirty(mDenseIndex[entity]);
+}
+
+bool ke::Scene::isAlive(Entity entity) const
+{
+	return entity < mDenseIndex.size() && mDenseIndex[entity] != INVALID_INDEX;
+}
+
+void ke::Scene::markLocalDirty(uint32_t index)
+{
+	mLocalDirty[index] = 1;
+}
+
+void ke::Scene::setPosition(Entity entity, const glm::vec3& position)
+{
+	uint32_t index = mDenseIndex[entity];
+	mPosition[index] = position;
+	markLocalDirty(index);
+}
+
+void ke::Scene::setRotation(Entity entity, const glm::quat& rotation)
+{
+	uint32_t index = mDenseIndex[entity];
+	mRotation[index] = rotation;
+	markLocalDirty(index);
+}
+
+void ke::Scene::setScale(Entity entity, const glm::vec3& scale)
+{
+	uint32_t index = mDenseIndex[entity];
+	mScale[index] = scale;
+	markLocalDirty(index);
+}
+
+void ke::Scene::setTransform(Entity entity, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+	uint32_t index = mDenseIndex[entity];
+	mPosition[index] = position;
+	mRotation[index] = rotation;
+	mScale[index] = scale;
+	markLocalDirty(index);
+}
+
+void ke::Scene::setLocalBounds(Entity entity, const Bounds& bounds)
+{
+	uint32_t index = mDenseIndex[entity];
+	mLocalBounds[index] = bounds;
+	markLocalDirty(index);
+}
+
+void ke::Scene::setRenderHandle(Entity entity, uint32_t renderHandle)
+{
+	uint32_t index = mDenseIndex[entity];
+	mRenderHandle[index] = renderHandle;
+	mGpuDirty[index] = ALL_FRAME_SLOTS;
+}
+
+const glm::mat4& ke::Scene::getWorldMatrix(Entity entity) const
+{
+	return mWorld[mDenseIndex[entity]];
+}
+
+const ke::Bounds& ke::Scene::getWorldBounds(Entity entity) const
+{
+	return mWorldBounds[mDenseIndex[entity]];
+}
+
+uint32_t ke::Scene::getRenderHandle(Entity entity) const
+{
+	return mRenderHandle[mDenseIndex[entity]];
+}
+
+void ke::Scene::sortByDepth()
+{
+	std::vector<uint32_t> depth(mDenseIndex.size(), INVALID_INDEX);
+	std::vector<Entity> chain;
+	uint32_t maxDepth = 0;
+
+	for (Entity entity : mEntity)
+	{
+		Entity current = entity;
+		while (current != NULL_ENTITY && depth[current] == INVALID_INDEX)
+		{
+			chain.push_back(current);
+			current = mParentEntity[current];
+		}
+		uint32_t base = current == NULL_ENTITY ? 0 : depth[current] + 1;
+		for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+			depth[*it] = base++;
+		chain.clear();
+		maxDepth = std::max(maxDepth, depth[entity]);
+	}
+
+	std::vector<uint32_t> counts(maxDepth + 2, 0);
+	for (uint32_t i = 0; i < mEntity.size(); i++)
+	{
+		mDepth[i] = depth[mEntity[i]];
+		counts[mDepth[i] + 1]++;
+	}
+	std::partial_sum(counts.begin(), counts.end(), counts.begin());
+
+	std::vector<uint32_t> order(mEntity.size());
+	for (uint32_t i = 0; i < mEntity.size(); i++)
+		order[counts[mDepth[i]]++] = i;
+
+	reorder(order);
+	mOrderDirty = false;
+
+	if (enableLogging)
+		mLogger.debug("Re-sorted {} scene nodes into {} levels.", mEntity.size(), getLevelCount());
+}
+
+void ke::Scene::reorder(const std::vector<uint32_t>& order)
+{
+	permute(mEntity, order);
+	permute(mDepth, order);
+	permute(mPosition, order);
+	permute(mRotation, order);
+	permute(mScale, order);
+	permute(mWorld, order);
+	permute(mLocalBounds, order);
+	permute(mWorldBounds, order);
+	permute(mRenderHandle, order);
+	permute(mLocalDirty, order);
+	permute(mWorldChanged, order);
+	permute(mGpuDirty, order);
+
+	for (uint32_t i = 0; i < mEntity.size(); i++)
+		mDenseIndex[mEntity[i]] = i;
+
+	mParent.resize(mEntity.size());
+	mLevelStart.assign(1, 0);
+	for (uint32_t i = 0; i < mEntity.size(); i++)
+	{
+		Entity parent = mParentEntity[mEntity[i]];
+		mParent[i] = parent != NULL_ENTITY ? mDenseIndex[parent] : INVALID_INDEX;
+		while (mLevelStart.size() <= mDepth[i] + 1)
+			mLevelStart.push_back(i);
+		mLevelStart.back() = i + 1;
+	}
+}
+
+void ke::Scene::propagateLevel(uint32_t begin, uint32_t end)
+{
+	KE_PROFILE_FUNCTION();
+	for (uint32_t i = begin; i < end; i++)
+	{
+		uint32_t parent = mParent[i];
+		bool parentChanged = parent != INVALID_INDEX && mWorldChanged[parent];
+		if (!mLocalDirty[i] && !parentChanged)
+		{
+			mWorldChanged[i] = 0;
+			continue;
+		}
+
+		glm::mat4 local = glm::mat4_cast(mRotation[i]);
+		local[0] *= mScale[i].x;
+		local[1] *= mScale[i].y;
+		local[2] *= mScale[i].z;
+		local[3] = glm::vec4(mPosition[i], 1.0f);
+
+		if (parent == INVALID_INDEX)
+			mWorld[i] = local;
+		else
+			simd::mulMatrix(mWorld[parent], local, mWorld[i]);
+
+		mWorldBounds[i] = transformBounds(mWorld[i], mLocalBounds[i]);
+		mLocalDirty[i] = 0;
+		mWorldChanged[i] = 1;
+		mGpuDirty[i] = ALL_FRAME_SLOTS;
+	}
+}
+
+void ke::Scene::updateTransforms()
+{
+	KE_PROFILE_FUNCTION();
+	if (mOrderDirty)
+		sortByDepth();
+
+	std::atomic<uint32_t> updated = 0;
+	for (uint32_t level = 0; level + 1 < mLevelStart.size(); level++)
+	{
+		uint32_t begin = mLevelStart[level];
+		uint32_t end = mLevelStart[level + 1];
+		uint32_t chunkCount = (end - begin + PROPAGATION_GRAIN - 1) / PROPAGATION_GRAIN;
+
+		auto propagateChunk = [&](uint32_t chunk)
+			{
+				uint32_t chunkBegin = begin + chunk * PROPAGATION_GRAIN;
+				uint32_t chunkEnd = std::min(end, chunkBegin + PROPAGATION_GRAIN);
+				propagateLevel(chunkBegin, chunkEnd);
+				uint32_t changed = 0;
+				for (uint32_t i = chunkBegin; i < chunkEnd; i++)
+					changed += mWorldChanged[i];
+				updated += changed;
+			};
+
+		if (chunkCount <= 1)
+		{
+			if (chunkCount == 1)
+				propagateChunk(0);
+			continue;
+		}
+
+		mChunks.resize(chunkCount);
+		std::iota(mChunks.begin(), mChunks.end(), 0);
+		std::for_each(std::execution::par, mChunks.begin(), mChunks.end(), propagateChunk);
+	}
+
+	mLastUpdatedCount = updated;
+}
+
+uint32_t ke::Scene::uploadDirty(uint32_t frameSlot, simd::Affine3x4* dst)
+{
+	KE_PROFILE_FUNCTION();
+	uint8_t bit = static_cast<uint8_t>(1u << frameSlot);
+	uint32_t uploaded = 0;
+
+	for (uint32_t i = 0; i < mEntity.size(); i++)
+	{
+		if (!(mGpuDirty[i] & bit))
+			continue;
+		if (mRenderHandle[i] != NO_RENDER_HANDLE)
+			simd::packAffine(&mWorld[i], 1, &dst[mEntity[i]]);
+		else
+			std::memset(&dst[mEntity[i]], 0, sizeof(simd::Affine3x4));
+		mGpuDirty[i] &= ~bit;
+		uploaded++;
+	}
+
+	// Destroyed entities keep their slot in dst until recycled, so it is zeroed once for every frame slot.
+	for (size_t i = 0; i < mReleased.size();)
+	{
+		Entity entity = mReleased[i];
+		if (mReleasedGpuDirty[entity] & bit)
+		{
+			std::memset(&dst[entity], 0, sizeof(simd::Affine3x4));
+			mReleasedGpuDirty[entity] &= ~bit;
+			uploaded++;
+		}
+		if (mReleasedGpuDirty[entity] == 0)
+		{
+			mReleased[i] = mReleased.back();
+			mReleased.pop_back();
+		}
+		else
+			i++;
+	}
+
+	return uploaded;
+}
+
+uint32_t ke::Scene::getNodeCount() const
+{
+	return static_cast<uint32_t>(mEntity.size());
+}
+
+uint32_t ke::Scene::getEntityCapacity() const
+{
+	return static_cast<uint32_t>(mDenseIndex.size());
+}
+
+uint32_t ke::Scene::getLevelCount() const
+{
+	return mLevelStart.empty() ? 0 : static_cast<uint32_t>(mLevelStart.size() - 1);
+}
+
+uint32_t ke::Scene::getLastUpdatedCount() const
+{
+	return mLastUpdatedCount;
+}
\ No newline at end of file
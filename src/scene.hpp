@@ -0,0 +1,89 @@
+#pragma once
+#include "simd.hpp"
+#include "logger.hpp"
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+
+namespace ke
+{
+	using Entity = uint32_t;
+	constexpr Entity NULL_ENTITY = UINT32_MAX;
+	constexpr uint32_t NO_RENDER_HANDLE = UINT32_MAX;
+
+	struct Bounds
+	{
+		glm::vec3 min = glm::vec3(0.0f);
+		glm::vec3 max = glm::vec3(0.0f);
+	};
+
+	// Structure-of-arrays node store. Nodes are kept sorted by hierarchy depth so every parent
+	// precedes its children and each level can be propagated in parallel.
+	class Scene
+	{
+	public:
+		Entity create(Entity parent = NULL_ENTITY, uint32_t renderHandle = NO_RENDER_HANDLE);
+		void destroy(Entity entity);
+		void setParent(Entity entity, Entity parent);
+		bool isAlive(Entity entity) const;
+
+		void setPosition(Entity entity, const glm::vec3& position);
+		void setRotation(Entity entity, const glm::quat& rotation);
+		void setScale(Entity entity, const glm::vec3& scale);
+		void setTransform(Entity entity, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+		void setLocalBounds(Entity entity, const Bounds& bounds);
+		void setRenderHandle(Entity entity, uint32_t renderHandle);
+
+		const glm::mat4& getWorldMatrix(Entity entity) const;
+		const Bounds& getWorldBounds(Entity entity) const;
+		uint32_t getRenderHandle(Entity entity) const;
+
+		// Recomputes world matrices and bounds of every node whose local transform or ancestor changed.
+		void updateTransforms();
+
+		// Writes the packed world transform of every node changed since this frame slot was last uploaded.
+		// dst is indexed by entity, so it must hold getEntityCapacity() transforms. Nodes without a render handle
+		// and destroyed entities are written as zero matrices, which collapse anything drawn with them to a point.
+		uint32_t uploadDirty(uint32_t frameSlot, simd::Affine3x4* dst);
+
+		uint32_t getNodeCount() const;
+		uint32_t getEntityCapacity() const;
+		uint32_t getLevelCount() const;
+		uint32_t getLastUpdatedCount() const;
+	private:
+		void markLocalDirty(uint32_t index);
+		void sortByDepth();
+		void reorder(const std::vector<uint32_t>& order);
+		void propagateLevel(uint32_t begin, uint32_t end);
+	private:
+		// Sparse entity -> dense index mapping.
+		std::vector<uint32_t> mDenseIndex;
+		std::vector<Entity> mParentEntity;
+		std::vector<Entity> mFreeEntities;
+		// Frame slots that still hold a destroyed entity's last transform.
+		std::vector<uint8_t> mReleasedGpuDirty;
+		std::vector<Entity> mReleased;
+
+		// Dense, depth-sorted node data.
+		std::vector<Entity> mEntity;
+		std::vector<uint32_t> mParent;
+		std::vector<uint32_t> mDepth;
+		std::vector<glm::vec3> mPosition;
+		std::vector<glm::quat> mRotation;
+		std::vector<glm::vec3> mScale;
+		std::vector<glm::mat4> mWorld;
+		std::vector<Bounds> mLocalBounds;
+		std::vector<Bounds> mWorldBounds;
+		std::vector<uint32_t> mRenderHandle;
+		std::vector<uint8_t> mLocalDirty;
+		std::vector<uint8_t> mWorldChanged;
+		std::vector<uint8_t> mGpuDirty;
+
+		std::vector<uint32_t> mLevelStart;
+		std::vector<uint32_t> mChunks;
+		bool mOrderDirty = false;
+		uint32_t mLastUpdatedCount = 0;
+
+		ke::Logger mLogger = ke::Logger("Scene Logger", spdlog::level::debug);
+	};
+}
\ No newline at end of file
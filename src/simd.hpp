@@ -0,0 +1,104 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define KE_SIMD_SSE2
+#include <immintrin.h>
+#endif
+
+#if defined(KE_SIMD_SSE2) && (defined(__AVX2__) || defined(__F16C__))
+#define KE_SIMD_F16C
+#endif
+
+namespace ke
+{
+	namespace simd
+	{
+		// 3x4 row-major affine transform, the layout instance streams are uploaded in.
+		struct Affine3x4
+		{
+			float rows[12];
+		};
+
+		struct Affine3x4Half
+		{
+			uint16_t rows[12];
+		};
+
+		inline void packAffine(const glm::mat4* src, size_t count, Affine3x4* dst)
+		{
+#ifdef KE_SIMD_SSE2
+			for (size_t i = 0; i < count; i++)
+			{
+				const float* m = &src[i][0][0];
+				__m128 c0 = _mm_loadu_ps(m);
+				__m128 c1 = _mm_loadu_ps(m + 4);
+				__m128 c2 = _mm_loadu_ps(m + 8);
+				__m128 c3 = _mm_loadu_ps(m + 12);
+				_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+				_mm_storeu_ps(dst[i].rows, c0);
+				_mm_storeu_ps(dst[i].rows + 4, c1);
+				_mm_storeu_ps(dst[i].rows + 8, c2);
+			}
+#else
+			for (size_t i = 0; i < count; i++)
+				for (int r = 0; r < 3; r++)
+					for (int c = 0; c < 4; c++)
+						dst[i].rows[r * 4 + c] = src[i][c][r];
+#endif
+		}
+
+		inline void packAffineHalf(const glm::mat4* src, size_t count, Affine3x4Half* dst)
+		{
+#ifdef KE_SIMD_F16C
+			for (size_t i = 0; i < count; i++)
+			{
+				const float* m = &src[i][0][0];
+				__m128 c0 = _mm_loadu_ps(m);
+				__m128 c1 = _mm_loadu_ps(m + 4);
+				__m128 c2 = _mm_loadu_ps(m + 8);
+				__m128 c3 = _mm_loadu_ps(m + 12);
+				_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+				__m128i r01 = _mm_unpacklo_epi64(_mm_cvtps_ph(c0, _MM_FROUND_TO_NEAREST_INT), _mm_cvtps_ph(c1, _MM_FROUND_TO_NEAREST_INT));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst[i].rows), r01);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(dst[i].rows + 8), _mm_cvtps_ph(c2, _MM_FROUND_TO_NEAREST_INT));
+			}
+#else
+			for (size_t i = 0; i < count; i++)
+				for (int r = 0; r < 3; r++)
+					for (int c = 0; c < 4; c++)
+						dst[i].rows[r * 4 + c] = glm::packHalf1x16(src[i][c][r]);
+#endif
+		}
+
+		// out = a * b for column-major matrices. out may alias either input.
+		inline void mulMatrix(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+		{
+#ifdef KE_SIMD_SSE2
+			const float* pa = &a[0][0];
+			const float* pb = &b[0][0];
+			__m128 a0 = _mm_loadu_ps(pa);
+			__m128 a1 = _mm_loadu_ps(pa + 4);
+			__m128 a2 = _mm_loadu_ps(pa + 8);
+			__m128 a3 = _mm_loadu_ps(pa + 12);
+			__m128 columns[4];
+			for (int c = 0; c < 4; c++)
+			{
+				__m128 column = _mm_mul_ps(a0, _mm_set1_ps(pb[c * 4 + 0]));
+				column = _mm_add_ps(column, _mm_mul_ps(a1, _mm_set1_ps(pb[c * 4 + 1])));
+				column = _mm_add_ps(column, _mm_mul_ps(a2, _mm_set1_ps(pb[c * 4 + 2])));
+				column = _mm_add_ps(column, _mm_mul_ps(a3, _mm_set1_ps(pb[c * 4 + 3])));
+				columns[c] = column;
+			}
+			float* po = &out[0][0];
+			for (int c = 0; c < 4; c++)
+				_mm_storeu_ps(po + c * 4, columns[c]);
+#else
+			out = a * b;
+#endif
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+#pragma once
+#include "vk.hpp"
+#include <vector>
+#include <array>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+
+namespace ke
+{
+	// Binds constant_id Id of a shader to a value of type T. Booleans are stored as VkBool32.
+	template<uint32_t Id, typename T>
+	struct SpecConstant
+	{
+		static_assert(std::is_same_v<T, bool> || std::is_same_v<T, int32_t> || std::is_same_v<T, uint32_t> || std::is_same_v<T, float>,
+			"Specialization constants must be bool, int32_t, uint32_t or float.");
+		static constexpr uint32_t id = Id;
+		using Type = T;
+	};
+
+	// Type-erased constant values as the pipeline consumes them, one 32-bit value per entry in entry order.
+	// Also serves as the key of a pipeline variant.
+	struct ShaderSpecialization
+	{
+		std::vector<VkSpecializationMapEntry> entries;
+		std::vector<uint32_t> data;
+
+		bool empty() const
+		{
+			return entries.empty();
+		}
+
+		// Points into this object, so it must outlive pipeline creation.
+		VkSpecializationInfo getInfo() const
+		{
+			VkSpecializationInfo info{};
+			info.mapEntryCount = static_cast<uint32_t>(entries.size());
+			info.pMapEntries = entries.data();
+			info.dataSize = data.size() * sizeof(uint32_t);
+			info.pData = data.data();
+			return info;
+		}
+
+		uint64_t hash() const
+		{
+			// FNV-1a over ids and values; offsets follow from the order.
+			uint64_t hash = 14695981039346656037ull;
+			auto mix = [&hash](uint32_t value)
+			{
+				for (int i = 0; i < 4; i++)
+				{
+					hash ^= (value >> (i * 8)) & 0xFF;
+					hash *= 1099511628211ull;
+				}
+			};
+			for (size_t i = 0; i < entries.size(); i++)
+			{
+				mix(entries[i].constantID);
+				mix(data[i]);
+			}
+			return hash;
+		}
+
+		bool operator==(const ShaderSpecialization& other) const
+		{
+			if (entries.size() != other.entries.size() || data != other.data)
+				return false;
+			for (size_t i = 0; i < entries.size(); i++)
+				if (entries[i].constantID != other.entries[i].constantID)
+					return false;
+			return true;
+		}
+	};
+
+	template<uint32_t... Ids>
+	constexpr bool specializationIdsUnique()
+	{
+		constexpr uint32_t ids[] = { Ids... };
+		for (size_t i = 0; i < sizeof...(Ids); i++)
+			for (size_t j = i + 1; j < sizeof...(Ids); j++)
+				if (ids[i] == ids[j])
+					return false;
+		return true;
+	}
+
+	// A fixed set of constants whose layout is worked out at compile time. Values start zeroed (false).
+	//
+	//   using AlphaTest = SpecConstant<0, bool>;
+	//   using LightCount = SpecConstant<1, uint32_t>;
+	//   SpecializationSet<AlphaTest, LightCount> variant;
+	//   variant.set<AlphaTest>(true).set<LightCount>(4);
+	template<typename... Constants>
+	class SpecializationSet
+	{
+	public:
+		static constexpr size_t count = sizeof...(Constants);
+
+		template<typename Constant>
+		SpecializationSet& set(typename Constant::Type value)
+		{
+			constexpr size_t index = indexOf<Constant, Constants...>();
+			if constexpr (std::is_same_v<typename Constant::Type, bool>)
+				mValues[index] = value ? VK_TRUE : VK_FALSE;
+			else
+				std::memcpy(&mValues[index], &value, sizeof(uint32_t));
+			return *this;
+		}
+
+		template<typename Constant>
+		typename Constant::Type get() const
+		{
+			constexpr size_t index = indexOf<Constant, Constants...>();
+			typename Constant::Type value{};
+			if constexpr (std::is_same_v<typename Constant::Type, bool>)
+				value = mValues[index] != VK_FALSE;
+			else
+				std::memcpy(&value, &mValues[index], sizeof(uint32_t));
+			return value;
+		}
+
+		ShaderSpecialization build() const
+		{
+			constexpr uint32_t ids[] = { Constants::id... };
+			ShaderSpecialization result;
+			result.data.assign(mValues.begin(), mValues.end());
+			for (uint32_t i = 0; i < count; i++)
+				result.entries.push_back({ ids[i], i * static_cast<uint32_t>(sizeof(uint32_t)), sizeof(uint32_t) });
+			return result;
+		}
+	private:
+		template<typename Constant, typename First, typename... Rest>
+		static constexpr size_t indexOf()
+		{
+			if constexpr (std::is_same_v<Constant, First>)
+				return 0;
+			else
+			{
+				static_assert(sizeof...(Rest) > 0, "Constant is not part of this specialization set.");
+				return 1 + indexOf<Constant, Rest...>();
+			}
+		}
+
+		static_assert(count > 0, "A specialization set needs at least one constant.");
+		static_assert(specializationIdsUnique<Constants::id...>(), "Specialization constants in a set must have distinct ids.");
+	private:
+		std::array<uint32_t, sizeof...(Constants)> mValues{};
+	};
+}
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include "stats.hpp"
+#include <algorithm>
+#include <fstream>
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+float ke::FrameStats::getCpuMs() const
+{
+	return std::max(0.0f, frameMs - fenceWaitMs - acquireWaitMs - presentWaitMs);
+}
+
+ke::RendererStats::RendererStats(uint32_t historyLength)
+	:mHistory(std::max(historyLength, 1u))
+{
+}
+
+void ke::RendererStats::endFrame()
+{
+	auto now = std::chrono::steady_clock::now();
+	mCurrent.frameMs = std::chrono::duration<float, std::milli>(now - mFrameStart).count();
+	mFrameStart = now;
+
+	mHistory[mHistoryHead] = mCurrent;
+	mHistoryHead = (mHistoryHead + 1) % mHistory.size();
+	mHistorySize = std::min(mHistorySize + 1, static_cast<uint32_t>(mHistory.size()));
+
+	uint64_t nextFrame = mCurrent.frame + 1;
+	mCurrent = FrameStats{};
+	mCurrent.frame = nextFrame;
+}
+
+const ke::FrameStats& ke::RendererStats::getCurrent() const
+{
+	return mCurrent;
+}
+
+const ke::FrameStats& ke::RendererStats::getFrame(uint32_t age) const
+{
+	static const FrameStats empty{};
+	if (age >= mHistorySize)
+		return empty;
+	uint32_t size = static_cast<uint32_t>(mHistory.size());
+	return mHistory[(mHistoryHead + size - 1 - age) % size];
+}
+
+uint32_t ke::RendererStats::getHistorySize() const
+{
+	return mHistorySize;
+}
+
+ke::FrameStats ke::RendererStats::getAverage(uint32_t frames) const
+{
+	FrameStats average{};
+	frames = std::min(frames, mHistorySize);
+	if (frames == 0)
+		return average;
+
+	average.renderScale = 0.0f;
+	for (uint32_t age = 0; age < frames; age++)
+	{
+		const FrameStats& frame = getFrame(age);
+		average.drawCalls += frame.drawCalls;
+		average.triangles += frame.triangles;
+		average.pipelineBinds += frame.pipelineBinds;
+		average.descriptorBinds += frame.descriptorBinds;
+		average.bytesUploaded += frame.bytesUploaded;
+		average.swapchainRecreations += frame.swapchainRecreations;
+		average.hostAllocations += frame.hostAllocations;
+		average.hostAllocatedBytes += frame.hostAllocatedBytes;
+		average.lightCount += frame.lightCount;
+		average.lightClustersOccupied += frame.lightClustersOccupied;
+		average.lightIndices += frame.lightIndices;
+		average.maxLightsPerCluster += frame.maxLightsPerCluster;
+		average.cullTested += frame.cullTested;
+		average.frustumCulled += frame.frustumCulled;
+		average.occlusionCulled += frame.occlusionCulled;
+		average.bundlesExecuted += frame.bundlesExecuted;
+		average.bundlesRecorded += frame.bundlesRecorded;
+		average.memoryBudget += frame.memoryBudget;
+		average.memoryUsage += frame.memoryUsage;
+		average.evictions += frame.evictions;
+		average.descriptorSetsAllocated += frame.descriptorSetsAllocated;
+		average.descriptorSetsReused += frame.descriptorSetsReused;
+		average.fenceWaitMs += frame.fenceWaitMs;
+		average.acquireWaitMs += frame.acquireWaitMs;
+		average.presentWaitMs += frame.presentWaitMs;
+		average.frameMs += frame.frameMs;
+		average.gpuMs += frame.gpuMs;
+		average.renderScale += frame.renderScale;
+	}
+
+	// Counts are averaged with integer division; swapchain recreations stay a total over the window.
+	average.frame = getFrame(0).frame;
+	average.drawCalls /= frames;
+	average.triangles /= frames;
+	average.pipelineBinds /= frames;
+	average.descriptorBinds /= frames;
+	average.bytesUploaded /= frames;
+	average.hostAllocations /= frames;
+	average.hostAllocatedBytes /= frames;
+	average.lightCount /= frames;
+	average.lightClustersOccupied /= frames;
+	average.lightIndices /= frames;
+	average.maxLightsPerCluster /= frames;
+	average.cullTested /= frames;
+	average.frustumCulled /= frames;
+	average.occlusionCulled /= frames;
+	average.bundlesExecuted /= frames;
+	average.bundlesRecorded /= frames;
+	average.memoryBudget /= frames;
+	average.memoryUsage /= frames;
+	average.evictions /= frames;
+	average.descriptorSetsAllocated /= frames;
+	average.descriptorSetsReused /= frames;
+	average.fenceWaitMs /= frames;
+	average.acquireWaitMs /= frames;
+	average.presentWaitMs /= frames;
+	average.frameMs /= frames;
+	average.gpuMs /= frames;
+	average.renderScale /= frames;
+	return average;
+}
+
+bool ke::RendererStats::write(const std::string& path) const
+{
+	if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0)
+		return writeCsv(path);
+	return writeJson(path);
+}
+
+bool ke::RendererStats::writeCsv(const std::string& path) const
+{
+	std::ofstream out(path, std::ios::trunc);
+	if (!out.is_open())
+	{
+		if (enableLogging)
+			mLogger.error("Failed to open {} for writing.", path);
+		return false;
+	}
+
+	out << "frame,drawCalls,triangles,pipelineBinds,descriptorBinds,bytesUploaded,swapchainRecreations,hostAllocations,hostAllocatedBytes,lightCount,lightClustersOccupied,lightIndices,maxLightsPerCluster,cullTested,frustumCulled,occlusionCulled,bundlesExecuted,bundlesRecorded,memoryBudget,memoryUsage,evictions,descriptorSetsAllocated,descriptorSetsReused,fenceWaitMs,acquireWaitMs,presentWaitMs,cpuMs,frameMs,gpuMs,renderScale\n";
+	for (uint32_t age = mHistorySize; age-- > 0;)
+	{
+		const FrameStats& f = getFrame(age);
+		out << f.frame << ',' << f.drawCalls << ',' << f.triangles << ',' << f.pipelineBinds << ',' << f.descriptorBinds << ','
+			<< f.bytesUploaded << ',' << f.swapchainRecreations << ',' << f.hostAllocations << ',' << f.hostAllocatedBytes << ','
+			<< f.lightCount << ',' << f.lightClustersOccupied << ',' << f.lightIndices << ',' << f.maxLightsPerCluster << ','
+			<< f.cullTested << ',' << f.frustumCulled << ',' << f.occlusionCulled << ','
+			<< f.bundlesExecuted << ',' << f.bundlesRecorded << ',' << f.memoryBudget << ',' << f.memoryUsage << ',' << f.evictions << ','
+			<< f.descriptorSetsAllocated << ',' << f.descriptorSetsReused << ','
+			<< f.fenceWaitMs << ',' << f.acquireWaitMs << ','
+			<< f.presentWaitMs << ',' << f.getCpuMs() << ',' << f.frameMs << ',' << f.gpuMs << ',' << f.renderScale << '\n';
+	}
+	return true;
+}
+
+bool ke::RendererStats::writeJson(const std::string& path) const
+{
+	std::ofstream out(path, std::ios::trunc);
+	if (!out.is_open())
+	{
+		if (enableLogging)
+			mLogger.error("Failed to open {} for writing.", path);
+		return false;
+	}
+
+	out << "{\"frames\":[";
+	for (uint32_t age = mHistorySize; age-- > 0;)
+	{
+		const FrameStats& f = getFrame(age);
+		out << (age + 1 == mHistorySize ? "\n" : ",\n")
+			<< "{\"frame\":" << f.frame << ",\"drawCalls\":" << f.drawCalls << ",\"triangles\":" << f.triangles
+			<< ",\"pipelineBinds\":" << f.pipelineBinds << ",\"descriptorBinds\":" << f.descriptorBinds
+			<< ",\"bytesUploaded\":" << f.bytesUploaded << ",\"swapchainRecreations\":" << f.swapchainRecreations
+			<< ",\"hostAllocations\":" << f.hostAllocations << ",\"hostAllocatedBytes\":" << f.hostAllocatedBytes
+			<< ",\"lightCount\":" << f.lightCount << ",\"lightClustersOccupied\":" << f.lightClustersOccupied
+			<< ",\"lightIndices\":" << f.lightIndices << ",\"maxLightsPerCluster\":" << f.maxLightsPerCluster
+			<< ",\"cullTested\":" << f.cullTested << ",\"frustumCulled\":" << f.frustumCulled << ",\"occlusionCulled\":" << f.occlusionCulled
+			<< ",\"bundlesExecuted\":" << f.bundlesExecuted << ",\"bundlesRecorded\":" << f.bundlesRecorded
+			<< ",\"memoryBudget\":" << f.memoryBudget << ",\"memoryUsage\":" << f.memoryUsage << ",\"evictions\":" << f.evictions
+			<< ",\"descriptorSetsAllocated\":" << f.descriptorSetsAllocated << ",\"descriptorSetsReused\":" << f.descriptorSetsReused
+			<< ",\"fenceWaitMs\":" << f.fenceWaitMs << ",\"acquireWaitMs\":" << f.acquireWaitMs
+			<< ",\"presentWaitMs\":" << f.presentWaitMs << ",\"cpuMs\":" << f.getCpuMs() << ",\"frameMs\":" << f.frameMs
+			<< ",\"gpuMs\":" << f.gpuMs << ",\"renderScale\":" << f.renderScale << "}";
+	}
+	out << "\n]}\n";
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+#pragma once
+#include "logger.hpp"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ke
+{
+	// Counters for one frame. Frames whose wait times make up most of frameMs are GPU or display bound;
+	// frames dominated by the remaining CPU time are CPU bound.
+	struct FrameStats
+	{
+		uint64_t frame = 0;
+		uint32_t drawCalls = 0;
+		uint64_t triangles = 0;
+		uint32_t pipelineBinds = 0;
+		uint32_t descriptorBinds = 0;
+		uint64_t bytesUploaded = 0;
+		uint32_t swapchainRecreations = 0;
+		uint64_t hostAllocations = 0;
+		uint64_t hostAllocatedBytes = 0;
+		uint32_t lightCount = 0;
+		uint32_t lightClustersOccupied = 0;
+		uint32_t lightIndices = 0;
+		uint32_t maxLightsPerCluster = 0;
+		uint32_t cullTested = 0;
+		uint32_t frustumCulled = 0;
+		uint32_t occlusionCulled = 0;
+		uint32_t bundlesExecuted = 0;
+		uint32_t bundlesRecorded = 0;
+		// Summed over device-local heaps.
+		uint64_t memoryBudget = 0;
+		uint64_t memoryUsage = 0;
+		uint32_t evictions = 0;
+		// Transient sets from the descriptor allocator, and requests answered from its per-frame cache.
+		uint32_t descriptorSetsAllocated = 0;
+		uint32_t descriptorSetsReused = 0;
+		float fenceWaitMs = 0.0f;
+		float acquireWaitMs = 0.0f;
+		float presentWaitMs = 0.0f;
+		float frameMs = 0.0f;
+		// GPU time of the scene, read back once the frame's fence has been waited on.
+		float gpuMs = 0.0f;
+		float renderScale = 1.0f;
+
+		float getCpuMs() const;
+	};
+
+	class RendererStats
+	{
+	public:
+		explicit RendererStats(uint32_t historyLength = 600);
+
+		// Triangle counts assume triangle lists.
+		void addDraw(uint32_t vertexCount, uint32_t instanceCount)
+		{
+			mCurrent.drawCalls++;
+			mCurrent.triangles += static_cast<uint64_t>(vertexCount / 3) * instanceCount;
+		}
+		void addPipelineBind() { mCurrent.pipelineBinds++; }
+		void addDescriptorBinds(uint32_t count) { mCurrent.descriptorBinds += count; }
+		void addUpload(uint64_t bytes) { mCurrent.bytesUploaded += bytes; }
+		// Counters of pre-recorded commands that are executed again without going through the recording helpers.
+		void addReplayed(uint32_t drawCalls, uint64_t triangles, uint32_t pipelineBinds, uint32_t descriptorBinds)
+		{
+			mCurrent.drawCalls += drawCalls;
+			mCurrent.triangles += triangles;
+			mCurrent.pipelineBinds += pipelineBinds;
+			mCurrent.descriptorBinds += descriptorBinds;
+		}
+		void addSwapchainRecreation() { mCurrent.swapchainRecreations++; }
+		void addHostAllocations(uint64_t count, uint64_t bytes) { mCurrent.hostAllocations += count; mCurrent.hostAllocatedBytes += bytes; }
+		void addFenceWait(float ms) { mCurrent.fenceWaitMs += ms; }
+		void addAcquireWait(float ms) { mCurrent.acquireWaitMs += ms; }
+		void addPresentWait(float ms) { mCurrent.presentWaitMs += ms; }
+		void setGpuTime(float ms) { mCurrent.gpuMs = ms; }
+		void setRenderScale(float scale) { mCurrent.renderScale = scale; }
+		void setLightStats(uint32_t lightCount, uint32_t occupiedClusters, uint32_t lightIndices, uint32_t maxPerCluster)
+		{
+			mCurrent.lightCount = lightCount;
+			mCurrent.lightClustersOccupied = occupiedClusters;
+			mCurrent.lightIndices = lightIndices;
+			mCurrent.maxLightsPerCluster = maxPerCluster;
+		}
+		void setCullStats(uint32_t tested, uint32_t frustumCulled, uint32_t occlusionCulled)
+		{
+			mCurrent.cullTested = tested;
+			mCurrent.frustumCulled = frustumCulled;
+			mCurrent.occlusionCulled = occlusionCulled;
+		}
+
+		void setBundleStats(uint32_t executed, uint32_t recorded)
+		{
+			mCurrent.bundlesExecuted = executed;
+			mCurrent.bundlesRecorded = recorded;
+		}
+
+		void setMemoryStats(uint64_t budget, uint64_t usage, uint32_t evictions)
+		{
+			mCurrent.memoryBudget = budget;
+			mCurrent.memoryUsage = usage;
+			mCurrent.evictions = evictions;
+		}
+
+		void setDescriptorStats(uint32_t allocated, uint32_t reused)
+		{
+			mCurrent.descriptorSetsAllocated = allocated;
+			mCurrent.descriptorSetsReused = reused;
+		}
+
+		// Closes the current frame into the history. Called by Renderer::advanceFrame.
+		void endFrame();
+
+		const FrameStats& getCurrent() const;
+		// age 0 is the most recently finished frame.
+		const FrameStats& getFrame(uint32_t age) const;
+		uint32_t getHistorySize() const;
+		FrameStats getAverage(uint32_t frames) const;
+
+		// Writes the history oldest first. write() picks CSV for a .csv path and JSON otherwise.
+		bool write(const std::string& path) const;
+		bool writeCsv(const std::string& path) const;
+		bool writeJson(const std::string& path) const;
+	private:
+		std::vector<FrameStats> mHistory;
+		uint32_t mHistoryHead = 0;
+		uint32_t mHistorySize = 0;
+		FrameStats mCurrent;
+		std::chrono::steady_clock::time_point mFrameStart = std::chrono::steady_clock::now();
+
+		ke::Logger mLogger = ke::Logger("Stats Logger", spdlog::level::debug);
+	};
+
+	// Wall-clock timer for the wait counters.
+	class StatTimer
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		StatTimer()
+			:mStart(Clock::now())
+		{
+		}
+
+		float elapsedMs() const
+		{
+			return std::chrono::duration<float, std::milli>(Clock::now() - mStart).count();
+		}
+	private:
+		Clock::time_point mStart;
+	};
+}
\ No newline at end of file
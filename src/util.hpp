@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <string>
 #include <fstream>
 #include <iostream>
 
@@ -7,17 +8,31 @@ namespace ke
 {
 	namespace util
 	{
-		std::vector<char> readFile(const std::string& filename)
+		// Returns an empty buffer if the file cannot be opened or read.
+		inline std::vector<char> readFile(const std::string& filename)
 		{
-			std::ifstream file(filename, std::ios::ate | std::ios::binary);;
+			std::ifstream file(filename, std::ios::ate | std::ios::binary);
 			if (!file.is_open())
+			{
 				std::cerr << "Utility error: failed to open file " << filename << "\n";
+				return {};
+			}
 
-			size_t filesize = (size_t)file.tellg();
-			std::vector<char> buffer(filesize);
+			std::streamoff filesize = file.tellg();
+			if (filesize < 0)
+			{
+				std::cerr << "Utility error: failed to get the size of " << filename << "\n";
+				return {};
+			}
+			std::vector<char> buffer(static_cast<size_t>(filesize));
 
 			file.seekg(0);
 			file.read(buffer.data(), filesize);
+			if (file.gcount() != filesize)
+			{
+				std::cerr << "Utility error: failed to read file " << filename << "\n";
+				return {};
+			}
 
 			return buffer;
 		}
@@ -0,0 +1,6 @@
+#pragma once
+#define VK_USE_PLATFORM_WIN32_KHR
+#define VK_NO_PROTOTYPES
+#define NOMINMAX
+#include <vulkan/vulkan.h>
+#include <vulkan/utility/vk_dispatch_table.h>
\ No newline at end of file
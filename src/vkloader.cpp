@@ -0,0 +1,92 @@
+#include "vkloader.hpp"
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
+#ifndef NDEBUG
+static bool enableLogging = true;
+#else
+static bool enableLogging = false;
+#endif
+
+bool ke::VulkanLibrary::load()
+{
+	if (mModule)
+		return true;
+
+#ifdef _WIN32
+	HMODULE module = LoadLibraryA("vulkan-1.dll");
+	if (module)
+		mGetInstanceProcAddr = reinterpret_cast<PFN_vkGetInstanceProcAddr>(GetProcAddress(module, "vkGetInstanceProcAddr"));
+#else
+	void* module = dlopen("libvulkan.so.1", RTLD_NOW | RTLD_LOCAL);
+	if (module)
+		mGetInstanceProcAddr = reinterpret_cast<PFN_vkGetInstanceProcAddr>(dlsym(module, "vkGetInstanceProcAddr"));
+#endif
+	mModule = reinterpret_cast<void*>(module);
+
+	if (!mModule || !mGetInstanceProcAddr)
+	{
+		if (enableLogging)
+			mLogger.critical("Failed to load the Vulkan library.");
+		unload();
+		return false;
+	}
+
+	if (enableLogging)
+		mLogger.info("Loaded the Vulkan library.");
+	return true;
+}
+
+void ke::VulkanLibrary::unload()
+{
+	if (mModule)
+	{
+#ifdef _WIN32
+		FreeLibrary(reinterpret_cast<HMODULE>(mModule));
+#else
+		dlclose(mModule);
+#endif
+	}
+	mModule = nullptr;
+	mGetInstanceProcAddr = nullptr;
+}
+
+bool ke::VulkanLibrary::isLoaded() const
+{
+	return mGetInstanceProcAddr != nullptr;
+}
+
+void ke::VulkanLibrary::initGlobalTable(VkuInstanceDispatchTable& table) const
+{
+	memset(&table, 0, sizeof(table));
+	table.GetInstanceProcAddr = mGetInstanceProcAddr;
+	table.CreateInstance = reinterpret_cast<PFN_vkCreateInstance>(mGetInstanceProcAddr(VK_NULL_HANDLE, "vkCreateInstance"));
+	table.EnumerateInstanceExtensionProperties = reinterpret_cast<PFN_vkEnumerateInstanceExtensionProperties>(mGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceExtensionProperties"));
+	table.EnumerateInstanceLayerProperties = reinterpret_cast<PFN_vkEnumerateInstanceLayerProperties>(mGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceLayerProperties"));
+	table.EnumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(mGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceVersion"));
+}
+
+void ke::VulkanLibrary::initInstanceTable(VkInstance instance, VkuInstanceDispatchTable& table) const
+{
+	VkuInstanceDispatchTable globals;
+	initGlobalTable(globals);
+
+	vkuInitInstanceDispatchTable(instance, &table, mGetInstanceProcAddr);
+	table.CreateInstance = globals.CreateInstance;
+	table.EnumerateInstanceExtensionProperties = globals.EnumerateInstanceExtensionProperties;
+	table.EnumerateInstanceLayerProperties = globals.EnumerateInstanceLayerProperties;
+	table.EnumerateInstanceVersion = globals.EnumerateInstanceVersion;
+	table.CreateDevice = reinterpret_cast<PFN_vkCreateDevice>(mGetInstanceProcAddr(instance, "vkCreateDevice"));
+}
+
+void ke::VulkanLibrary::initDeviceTable(const VkuInstanceDispatchTable& instanceTable, VkInstance instance, VkDevice device, VkuDeviceDispatchTable& table) const
+{
+	auto getDeviceProcAddr = reinterpret_cast<PFN_vkGetDeviceProcAddr>(instanceTable.GetInstanceProcAddr(instance, "vkGetDeviceProcAddr"));
+	vkuInitDeviceDispatchTable(device, &table, getDeviceProcAddr);
+}
+
+PFN_vkGetInstanceProcAddr ke::VulkanLibrary::getInstanceProcAddr() const
+{
+	return mGetInstanceProcAddr;
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+#include "vk.hpp"
+#include "logger.hpp"
+
+namespace ke
+{
+	// Opens the Vulkan loader library at runtime and fills dispatch tables from it. Device tables come from
+	// vkGetDeviceProcAddr, so recorded commands go straight to the driver instead of through loader trampolines.
+	class VulkanLibrary
+	{
+	public:
+		bool load();
+		void unload();
+		bool isLoaded() const;
+
+		// Only the global commands (instance creation and enumeration) are valid in this table.
+		void initGlobalTable(VkuInstanceDispatchTable& table) const;
+		void initInstanceTable(VkInstance instance, VkuInstanceDispatchTable& table) const;
+		void initDeviceTable(const VkuInstanceDispatchTable& instanceTable, VkInstance instance, VkDevice device, VkuDeviceDispatchTable& table) const;
+
+		PFN_vkGetInstanceProcAddr getInstanceProcAddr() const;
+	private:
+		void* mModule = nullptr;
+		PFN_vkGetInstanceProcAddr mGetInstanceProcAddr = nullptr;
+
+		ke::Logger mLogger = ke::Logger("Vulkan Library Logger", spdlog::level::debug);
+	};
+}
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "window.hpp"
+#include "profiler.hpp"
 
 static void framebufferResizeCallback(GLFWwindow* window, int width, int height)
 {
@@ -35,6 +36,7 @@ bool ke::Window::shouldClose()
 
 void ke::Window::pollEvents()
 {
+	KE_PROFILE_FUNCTION();
 	glfwPollEvents();
 }
 
@@ -43,6 +45,17 @@ GLFWwindow* ke::Window::getWindow() const
 	return pWindow;
 }
 
+void ke::Window::getFramebufferSize(int& width, int& height) const
+{
+	glfwGetFramebufferSize(pWindow, &width, &height);
+}
+
+void ke::Window::waitEvents()
+{
+	KE_PROFILE_FUNCTION();
+	glfwWaitEvents();
+}
+
 bool ke::Window::hasResized() const
 {
 	return mHasResized;
@@ -19,6 +19,8 @@ namespace ke
 		void pollEvents();
 
 		GLFWwindow* getWindow() const;
+		void getFramebufferSize(int& width, int& height) const;
+		void waitEvents();
 
 		bool hasResized() const;
 		void setResized();